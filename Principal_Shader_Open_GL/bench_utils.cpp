@@ -0,0 +1,1066 @@
+#include "bench_utils.h"
+#include "mesh_utils.h"
+#include "thread_utils.h"
+#include "mesh_cache.h"
+#include "vertex_packing.h"
+#include "mesh_optimize.h"
+#include "mesh_lod.h"
+#include "mesh_meshlets.h"
+#include "image_write.h"
+#include "texture_compress.h"
+#include "texture_mips.h"
+#include "image_decode.h"
+#include "file_utils.h"
+#include "ibl_utils.h"
+#include "ibl_cubemap.h"
+#include "External/stb_image.h"
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Helpers
+// ─────
+static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Builds an in-memory OBJ equivalent to a triangulated grid with (at least) cornerCount face corners.
+// Positions, normals and UVs all get their own index streams, like exported scan data: normals are
+// stored in reverse grid order and UVs column-major, and the grid has the splits real meshes have,
+// a hard crease every CREASE_ROWS rows (one position, two normals) and a UV seam every SEAM_COLUMNS
+// columns (one position, two UVs).
+// Faces are split evenly over shapeCount shapes that share the same vertex data.
+static void MakeSyntheticObj(size_t cornerCount, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, size_t shapeCount = 1) {
+    const size_t CREASE_ROWS = 16, SEAM_COLUMNS = 8;
+    size_t quads = (cornerCount + 5) / 6;
+    size_t cols = 1;
+    while (cols * cols < quads) cols++;
+    size_t rows = (quads + cols - 1) / cols;
+
+    attrib = tinyobj::attrib_t();
+    size_t gridVerts = (rows + 1) * (cols + 1);
+    size_t creases = (rows - 1) / CREASE_ROWS, seams = (cols - 1) / SEAM_COLUMNS; // interior rows / columns only
+    attrib.vertices.reserve(gridVerts * 3);
+    attrib.normals.reserve((gridVerts + creases * (cols + 1)) * 3);
+    attrib.texcoords.reserve((gridVerts + seams * (rows + 1)) * 2);
+    for (size_t y = 0; y <= rows; y++) {
+        for (size_t x = 0; x <= cols; x++) {
+            float u = float(x) / cols, v = float(y) / rows;
+            attrib.vertices.insert(attrib.vertices.end(), { u, v, 0.0f });
+        }
+    }
+    for (size_t p = gridVerts; p-- > 0;) {
+        float tilt = float(p % (cols + 1)) / cols - 0.5f;
+        attrib.normals.insert(attrib.normals.end(), { tilt, 0.0f, 1.0f });
+    }
+    for (size_t x = 0; x <= cols; x++) {
+        for (size_t y = 0; y <= rows; y++) {
+            float island = float(x % SEAM_COLUMNS) / SEAM_COLUMNS; // every SEAM_COLUMNS columns start over at 0
+            attrib.texcoords.insert(attrib.texcoords.end(), { island, float(y) / rows });
+        }
+    }
+    // the quads above a crease row see it with a second normal, the quads left of a seam column with u = 1
+    for (size_t c = 1; c <= creases; c++)
+        for (size_t x = 0; x <= cols; x++) attrib.normals.insert(attrib.normals.end(), { 0.0f, -0.7f, 0.7f });
+    for (size_t s = 1; s <= seams; s++)
+        for (size_t y = 0; y <= rows; y++) attrib.texcoords.insert(attrib.texcoords.end(), { 1.0f, float(y) / rows });
+
+    auto corner = [&](size_t x, size_t y, size_t quadX, size_t quadY) {
+        tinyobj::index_t idx;
+        size_t p = y * (cols + 1) + x;
+        idx.vertex_index = int(p);
+        idx.normal_index = int(gridVerts - 1 - p);
+        if (y == quadY && y % CREASE_ROWS == 0 && y / CREASE_ROWS >= 1 && y / CREASE_ROWS <= creases)
+            idx.normal_index = int(gridVerts + (y / CREASE_ROWS - 1) * (cols + 1) + x);
+        idx.texcoord_index = int(x * (rows + 1) + y);
+        if (x == quadX + 1 && x % SEAM_COLUMNS == 0 && x / SEAM_COLUMNS <= seams)
+            idx.texcoord_index = int(gridVerts + (x / SEAM_COLUMNS - 1) * (rows + 1) + y);
+        return idx;
+    };
+
+    shapes.assign(shapeCount, tinyobj::shape_t());
+    size_t quadsPerShape = (quads + shapeCount - 1) / shapeCount;
+    for (size_t q = 0; q < quads; q++) {
+        tinyobj::mesh_t& mesh = shapes[q / quadsPerShape].mesh;
+        if (mesh.indices.empty()) {
+            mesh.indices.reserve(quadsPerShape * 6);
+            mesh.num_face_vertices.reserve(quadsPerShape * 2);
+        }
+        size_t x = q % cols, y = q / cols;
+        tinyobj::index_t c0 = corner(x, y, x, y), c1 = corner(x + 1, y, x, y);
+        tinyobj::index_t c2 = corner(x, y + 1, x, y), c3 = corner(x + 1, y + 1, x, y);
+        for (const tinyobj::index_t& idx : { c0, c1, c3, c0, c3, c2 }) mesh.indices.push_back(idx);
+        mesh.num_face_vertices.push_back(3);
+        mesh.num_face_vertices.push_back(3);
+    }
+}
+
+static size_t CornerCount(const std::vector<tinyobj::shape_t>& shapes) {
+    size_t n = 0;
+    for (const auto& shape : shapes) n += shape.mesh.indices.size();
+    return n;
+}
+
+// The previous loadObjModel dedup (string keys in an unordered_map), kept as the baseline.
+static void BuildObjVerticesStringKeys(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                                       std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::unordered_map<std::string, unsigned int> uniqueVertexMap;
+    for (const auto& shape : shapes) {
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+            int fv = shape.mesh.num_face_vertices[f];
+            for (int v = 0; v < fv; v++) {
+                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
+                Vertex vert;
+                vert.position = { attrib.vertices[3 * idx.vertex_index + 0], attrib.vertices[3 * idx.vertex_index + 1], attrib.vertices[3 * idx.vertex_index + 2] };
+                vert.normal = { attrib.normals[3 * idx.normal_index + 0], attrib.normals[3 * idx.normal_index + 1], attrib.normals[3 * idx.normal_index + 2] };
+                vert.texCoord = { attrib.texcoords[2 * idx.texcoord_index + 0], attrib.texcoords[2 * idx.texcoord_index + 1] };
+
+                std::string key = std::to_string(idx.vertex_index) + "/" +
+                                  std::to_string(idx.normal_index) + "/" +
+                                  std::to_string(idx.texcoord_index);
+                if (uniqueVertexMap.count(key) == 0) {
+                    uniqueVertexMap[key] = static_cast<unsigned int>(vertices.size());
+                    vertices.push_back(vert);
+                }
+                indices.push_back(uniqueVertexMap[key]);
+            }
+            index_offset += fv;
+        }
+    }
+}
+
+// ─────────────────────────────────────────────
+// Benchmarks
+// ─────
+static int BenchDedup() {
+    std::cout << "OBJ vertex dedup: string-keyed unordered_map vs VertexDedupTable" << std::endl;
+    for (size_t corners : { size_t(1000000), size_t(10000000), size_t(50000000) }) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        MakeSyntheticObj(corners, attrib, shapes);
+
+        std::vector<Vertex> refVerts, newVerts;
+        std::vector<unsigned int> refIdx, newIdx;
+
+        auto t0 = std::chrono::steady_clock::now();
+        BuildObjVertices(attrib, shapes, newVerts, newIdx);
+        double tableMs = ElapsedMs(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        BuildObjVerticesStringKeys(attrib, shapes, refVerts, refIdx);
+        double stringMs = ElapsedMs(t0);
+
+        bool match = refIdx == newIdx && refVerts.size() == newVerts.size() &&
+                     std::memcmp(refVerts.data(), newVerts.data(), refVerts.size() * sizeof(Vertex)) == 0;
+        std::cout << "  " << CornerCount(shapes) << " corners, " << newVerts.size() << " unique: "
+                  << "string map " << stringMs << " ms, table " << tableMs << " ms ("
+                  << stringMs / tableMs << "x)" << (match ? "" : "  OUTPUT MISMATCH") << std::endl;
+        if (!match) return 1;
+    }
+    return 0;
+}
+
+static int BenchObjLoad() {
+    std::cout << "OBJ vertex build: serial vs parallel (" << ThreadPool::global().size() << " threads)" << std::endl;
+    for (size_t corners : { size_t(1000000), size_t(10000000), size_t(50000000) }) {
+        for (size_t shapeCount : { size_t(1), size_t(64) }) {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            MakeSyntheticObj(corners, attrib, shapes, shapeCount);
+
+            std::vector<Vertex> serialVerts, parallelVerts;
+            std::vector<unsigned int> serialIdx, parallelIdx;
+
+            auto t0 = std::chrono::steady_clock::now();
+            BuildObjVertices(attrib, shapes, serialVerts, serialIdx);
+            double serialMs = ElapsedMs(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            BuildObjVerticesParallel(attrib, shapes, parallelVerts, parallelIdx);
+            double parallelMs = ElapsedMs(t0);
+
+            // the parallel path promises identical bytes, not just equivalent geometry
+            bool match = serialIdx == parallelIdx && serialVerts.size() == parallelVerts.size() &&
+                         std::memcmp(serialVerts.data(), parallelVerts.data(), serialVerts.size() * sizeof(Vertex)) == 0;
+            std::cout << "  " << CornerCount(shapes) << " corners in " << shapeCount << " shape(s): serial "
+                      << serialMs << " ms, parallel " << parallelMs << " ms (" << serialMs / parallelMs << "x)"
+                      << (match ? "" : "  OUTPUT MISMATCH") << std::endl;
+            if (!match) return 1;
+        }
+    }
+    return 0;
+}
+
+static int BenchMeshCache() {
+    std::cout << "Mesh cold start: OBJ rebuild vs mapped .meshcache" << std::endl;
+    const std::string cachePath = "bench_mesh.meshcache";
+    for (size_t corners : { size_t(1000000), size_t(10000000) }) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        MakeSyntheticObj(corners, attrib, shapes);
+
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        auto t0 = std::chrono::steady_clock::now();
+        BuildObjVerticesParallel(attrib, shapes, vertices, indices);
+        ComputeTangents(vertices, indices);
+        std::vector<MeshLod> lods;
+        BuildLodChain(vertices, indices, lods);
+        std::vector<Meshlet> meshlets;
+        BuildMeshlets(vertices.data(), vertices.size(), indices.data(), lods.data(), lods.size(), meshlets);
+        double rebuildMs = ElapsedMs(t0);
+
+        const uint64_t fakeSourceHash = 42;
+        if (!WriteMeshCache(cachePath, fakeSourceHash, vertices, indices, lods, meshlets)) {
+            std::cerr << "Could not write " << cachePath << std::endl;
+            return 1;
+        }
+
+        t0 = std::chrono::steady_clock::now();
+        MappedMesh cached;
+        bool opened = OpenMeshCache(cachePath, fakeSourceHash, cached);
+        // touch every page, like the driver copy in glBufferData would
+        uint64_t checksum = opened ? HashBytes(cached.vertices, vertices.size() * sizeof(Vertex)) : 0;
+        double mappedMs = ElapsedMs(t0);
+
+        bool match = opened && checksum == HashBytes(vertices.data(), vertices.size() * sizeof(Vertex)) &&
+                     std::memcmp(cached.indices, indices.data(), indices.size() * sizeof(unsigned int)) == 0 &&
+                     cached.header->lodCount == lods.size() &&
+                     std::memcmp(cached.lods, lods.data(), lods.size() * sizeof(MeshLod)) == 0 &&
+                     cached.header->meshletCount == meshlets.size() &&
+                     std::memcmp(cached.meshlets, meshlets.data(), meshlets.size() * sizeof(Meshlet)) == 0;
+        bool staleRejected = !OpenMeshCache(cachePath, fakeSourceHash + 1, cached);
+        std::cout << "  " << CornerCount(shapes) << " corners: rebuild " << rebuildMs << " ms, mapped cache "
+                  << mappedMs << " ms" << (match ? "" : "  CACHE MISMATCH") << (staleRejected ? "" : "  STALE CACHE ACCEPTED") << std::endl;
+        cached = MappedMesh();
+        std::remove(cachePath.c_str());
+        if (!match || !staleRejected) return 1;
+    }
+    return 0;
+}
+
+// UV sphere with analytic normals/tangents, so packing error isn't hidden by flat test data
+static void MakeSphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const float PI = 3.14159265358979f;
+    vertices.clear();
+    indices.clear();
+    for (int r = 0; r <= rings; r++) {
+        float theta = PI * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * PI * s / segments;
+            Vertex v;
+            v.normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            v.position = v.normal * 2.5f + glm::vec3(10.0f, -3.0f, 0.5f);
+            v.texCoord = glm::vec2(float(s) / segments * 4.0f, float(r) / rings * 2.0f);
+            v.tangent = glm::vec4(-std::sin(phi), 0.0f, std::cos(phi), 1.0f);
+            vertices.push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            unsigned int i0 = r * (segments + 1) + s, i1 = i0 + 1;
+            unsigned int i2 = i0 + segments + 1, i3 = i2 + 1;
+            indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+        }
+    }
+}
+
+static int BenchPacking() {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(1000, 2000, vertices, indices);
+
+    auto t0 = std::chrono::steady_clock::now();
+    VertexQuantization q = ComputeQuantization(vertices.data(), vertices.size());
+    std::vector<PackedVertex> packed;
+    PackVertices(vertices.data(), vertices.size(), q, packed);
+    double packMs = ElapsedMs(t0);
+
+    std::cout << "Vertex packing round trip (" << vertices.size() << " sphere vertices, packed in " << packMs << " ms)" << std::endl;
+    PrintPackingReport(MeasurePackingError(vertices.data(), packed.data(), vertices.size(), q));
+    return 0;
+}
+
+static int BenchReorder() {
+    std::cout << "Index reordering (FIFO cache simulator)" << std::endl;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(400, 800, vertices, indices);
+
+    // scanner output is rarely in a nice order: shuffle triangles to model that
+    std::vector<unsigned int> shuffled(indices.size());
+    size_t triCount = indices.size() / 3;
+    uint64_t rng = 12345;
+    std::vector<size_t> order(triCount);
+    for (size_t t = 0; t < triCount; t++) order[t] = t;
+    for (size_t t = triCount - 1; t > 0; t--) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        std::swap(order[t], order[(rng >> 33) % (t + 1)]);
+    }
+    for (size_t t = 0; t < triCount; t++)
+        for (int k = 0; k < 3; k++) shuffled[t * 3 + k] = indices[order[t] * 3 + k];
+
+    for (unsigned int cacheSize : { 16u, 32u }) {
+        std::vector<Vertex> verts = vertices;
+        std::vector<unsigned int> idx = shuffled;
+        VertexCacheStats before = AnalyzeVertexCache(idx.data(), idx.size(), verts.size(), cacheSize);
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<size_t> clusters = OptimizeVertexCache(idx.data(), idx.size(), verts.size(), cacheSize);
+        VertexCacheStats afterCache = AnalyzeVertexCache(idx.data(), idx.size(), verts.size(), cacheSize);
+        OptimizeOverdraw(idx.data(), idx.size(), verts.data(), verts.size(), clusters, 1.05f, cacheSize);
+        VertexCacheStats afterOverdraw = AnalyzeVertexCache(idx.data(), idx.size(), verts.size(), cacheSize);
+        OptimizeVertexFetch(verts, idx.data(), idx.size());
+        double ms = ElapsedMs(t0);
+
+        std::cout << "  cache " << cacheSize << ", " << triCount << " tris: ACMR " << before.acmr << " -> "
+                  << afterCache.acmr << " (tipsify) -> " << afterOverdraw.acmr << " (overdraw clusters), ATVR "
+                  << before.atvr << " -> " << afterOverdraw.atvr << ", " << ms << " ms" << std::endl;
+    }
+    return 0;
+}
+
+// Wavy grid with analytic normals; u mirrors at the center column like a symmetric UV unwrap
+static void MakeMirroredGrid(size_t triCount, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    size_t quads = (triCount + 1) / 2;
+    size_t cols = 2;
+    while (cols * cols < quads) cols += 2;
+    size_t rows = (quads + cols - 1) / cols;
+
+    vertices.resize((rows + 1) * (cols + 1));
+    ParallelFor(rows + 1, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (size_t x = 0; x <= cols; x++) {
+                float fx = float(x) / cols, fy = float(y) / rows;
+                float wx = fx * 40.0f, wy = fy * 40.0f;
+                Vertex& v = vertices[y * (cols + 1) + x];
+                v.position = glm::vec3(fx * 10.0f, fy * 10.0f, 0.1f * std::sin(wx) * std::cos(wy));
+                glm::vec3 dx(1.0f, 0.0f, 0.4f * std::cos(wx) * std::cos(wy));  // d/dfx of position, / 10
+                glm::vec3 dy(0.0f, 1.0f, -0.4f * std::sin(wx) * std::sin(wy)); // d/dfy
+                v.normal = glm::normalize(glm::cross(dx, dy));
+                v.texCoord = glm::vec2(std::fabs(2.0f * fx - 1.0f), fy);
+                v.tangent = glm::vec4(0.0f);
+            }
+        }
+    }, 64);
+
+    indices.resize(rows * cols * 6);
+    ParallelFor(rows, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (size_t x = 0; x < cols; x++) {
+                unsigned int i0 = unsigned(y * (cols + 1) + x), i1 = i0 + 1;
+                unsigned int i2 = i0 + unsigned(cols + 1), i3 = i2 + 1;
+                unsigned int* dst = &indices[(y * cols + x) * 6];
+                dst[0] = i0; dst[1] = i1; dst[2] = i3; dst[3] = i0; dst[4] = i3; dst[5] = i2;
+            }
+        }
+    }, 64);
+}
+
+// The ComputeTangents this repo shipped before the MikkTSpace rewrite, kept as the speed baseline
+static void ComputeTangentsScalar(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        Vertex& v0 = vertices[indices[i]];
+        Vertex& v1 = vertices[indices[i + 1]];
+        Vertex& v2 = vertices[indices[i + 2]];
+        glm::vec3 edge1 = v1.position - v0.position;
+        glm::vec3 edge2 = v2.position - v0.position;
+        glm::vec2 deltaUV1 = v1.texCoord - v0.texCoord;
+        glm::vec2 deltaUV2 = v2.texCoord - v0.texCoord;
+        float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+        glm::vec3 tangent = glm::normalize(f * (deltaUV2.y * edge1 - deltaUV1.y * edge2));
+        v0.tangent += glm::vec4(tangent, 0.0f);
+        v1.tangent += glm::vec4(tangent, 0.0f);
+        v2.tangent += glm::vec4(tangent, 0.0f);
+    }
+    for (Vertex& v : vertices) v.tangent = glm::vec4(glm::normalize(glm::vec3(v.tangent)), 1.0f);
+}
+
+// counts tangents that are NaN, not unit length, or not perpendicular to the normal
+static size_t CountBadTangents(const std::vector<Vertex>& vertices) {
+    size_t bad = 0;
+    for (const Vertex& v : vertices) {
+        glm::vec3 t(v.tangent);
+        float len = glm::length(t);
+        bool ok = std::fabs(len - 1.0f) < 1e-3f && std::fabs(glm::dot(t, v.normal)) < 1e-3f &&
+                  (v.tangent.w == 1.0f || v.tangent.w == -1.0f);
+        if (!ok) bad++;
+    }
+    return bad;
+}
+
+static int BenchTangents() {
+    int failures = 0;
+
+    // accuracy: a UV sphere has a known tangent field (away from the poles, whose triangles collapse)
+    {
+        std::vector<Vertex> reference;
+        std::vector<unsigned int> indices;
+        MakeSphere(200, 400, reference, indices);
+        // MakeSphere winds clockwise seen from outside; MikkTSpace signs assume counter-clockwise fronts
+        for (size_t i = 0; i < indices.size(); i += 3) std::swap(indices[i + 1], indices[i + 2]);
+        std::vector<Vertex> vertices = reference;
+        for (Vertex& v : vertices) v.tangent = glm::vec4(0.0f);
+        ComputeTangents(vertices, indices);
+
+        float maxErrorDeg = 0.0f;
+        size_t signErrors = 0;
+        for (size_t i = 0; i < reference.size(); i++) {
+            if (std::fabs(reference[i].normal.y) > 0.99f) continue;
+            glm::vec3 a(reference[i].tangent), b(vertices[i].tangent);
+            maxErrorDeg = std::max(maxErrorDeg, glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b))));
+            if (vertices[i].tangent.w != reference[i].tangent.w) signErrors++;
+        }
+        size_t bad = CountBadTangents(vertices);
+        std::cout << "Sphere (" << indices.size() / 3 << " tris): max error vs analytic " << maxErrorDeg << " deg, "
+                  << signErrors << " sign errors, " << bad << " invalid tangents" << std::endl;
+        if (maxErrorDeg > 1.0f || signErrors || bad) failures++;
+    }
+
+    // mirrored UVs: the center column must be split, and each half gets its own sign
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        MakeMirroredGrid(2 * 16 * 16, vertices, indices);
+        size_t before = vertices.size();
+        ComputeTangents(vertices, indices);
+        size_t negative = 0;
+        for (const Vertex& v : vertices) negative += v.tangent.w < 0.0f;
+        bool ok = vertices.size() - before == 17 && negative == 17 * 8 + 17 && CountBadTangents(vertices) == 0;
+        std::cout << "Mirrored grid: " << vertices.size() - before << " split vertices, " << negative
+                  << " with negative sign" << (ok ? "" : "  UNEXPECTED") << std::endl;
+        if (!ok) failures++;
+    }
+
+    // degenerate UVs (all zero) used to produce NaNs
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        MakeMirroredGrid(2 * 8 * 8, vertices, indices);
+        for (Vertex& v : vertices) v.texCoord = glm::vec2(0.0f);
+        ComputeTangents(vertices, indices);
+        size_t bad = CountBadTangents(vertices);
+        std::cout << "Zero-area UVs: " << bad << " invalid tangents" << std::endl;
+        if (bad) failures++;
+    }
+
+    std::cout << "Throughput (" << ThreadPool::global().size() << " worker threads)" << std::endl;
+    for (size_t triCount : { size_t(1) << 20, size_t(5) << 20, size_t(20) << 20 }) {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        MakeMirroredGrid(triCount, vertices, indices);
+        size_t tris = indices.size() / 3;
+
+        std::vector<Vertex> baseline = vertices;
+        auto t0 = std::chrono::steady_clock::now();
+        ComputeTangentsScalar(baseline, indices);
+        double scalarMs = ElapsedMs(t0);
+        baseline = std::vector<Vertex>();
+
+        t0 = std::chrono::steady_clock::now();
+        ComputeTangents(vertices, indices);
+        double newMs = ElapsedMs(t0);
+
+        size_t bad = CountBadTangents(vertices);
+        std::cout << "  " << tris << " tris: scalar " << scalarMs << " ms (" << tris / scalarMs / 1000.0
+                  << " Mtri/s), MikkTSpace " << newMs << " ms (" << tris / newMs / 1000.0 << " Mtri/s), "
+                  << bad << " invalid" << std::endl;
+        if (bad) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+// edges (compared by position, so UV seams count as joined) not shared by exactly two triangles
+static size_t CountOpenEdges(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount) {
+    std::unordered_map<std::string, int> edgeUse;
+    auto key = [&](unsigned int a, unsigned int b) {
+        glm::vec3 pa = vertices[a].position, pb = vertices[b].position;
+        if (std::memcmp(&pa, &pb, sizeof(glm::vec3)) > 0) std::swap(pa, pb);
+        return std::string(reinterpret_cast<const char*>(&pa), sizeof(pa)) + std::string(reinterpret_cast<const char*>(&pb), sizeof(pb));
+    };
+    for (size_t i = 0; i < indexCount; i += 3)
+        for (int e = 0; e < 3; e++) edgeUse[key(indices[i + e], indices[i + (e + 1) % 3])]++;
+    size_t open = 0;
+    for (const auto& entry : edgeUse) open += entry.second != 2;
+    return open;
+}
+
+static int BenchLod() {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(400, 800, vertices, indices);  // rings, segments used below
+    // bumpy surface so the levels have something to lose
+    for (Vertex& v : vertices) {
+        float bump = 0.05f * std::sin(v.normal.x * 23.0f) * std::sin(v.normal.y * 17.0f) * std::sin(v.normal.z * 19.0f);
+        v.position = glm::vec3(10.0f, -3.0f, 0.5f) + v.normal * (2.5f + bump);
+    }
+    // weld the UV seam and the poles bit-exactly and drop the pole slivers, so the sphere is closed
+    const int rings = 400, segments = 800;
+    for (int r = 0; r <= rings; r++) {
+        Vertex* row = &vertices[size_t(r) * (segments + 1)];
+        row[segments].position = row[0].position;
+        if (r == 0 || r == rings)
+            for (int s = 1; s < segments; s++) row[s].position = row[0].position;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& a = vertices[indices[i]].position;
+        const glm::vec3& b = vertices[indices[i + 1]].position;
+        const glm::vec3& c = vertices[indices[i + 2]].position;
+        if (a == b || b == c || a == c) continue;
+        for (int k = 0; k < 3; k++) indices[kept++] = indices[i + k];
+    }
+    indices.resize(kept);
+    size_t openBefore = CountOpenEdges(vertices, indices.data(), indices.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<MeshLod> lods;
+    BuildLodChain(vertices, indices, lods);
+    double buildMs = ElapsedMs(t0);
+
+    std::cout << "LOD chain for a " << lods[0].indexCount / 3 << " triangle sphere (radius 2.5) in " << buildMs << " ms" << std::endl;
+    int failures = 0;
+    for (size_t i = 0; i < lods.size(); i++) {
+        size_t open = CountOpenEdges(vertices, indices.data() + lods[i].indexOffset, lods[i].indexCount);
+        std::cout << "  LOD " << i << ": " << lods[i].indexCount / 3 << " tris, error " << lods[i].error
+                  << ", open edges " << open << std::endl;
+        if (open != openBefore) failures++;
+    }
+
+    // what a 1080p, 45 degree camera would draw at each distance with a 1 pixel budget
+    Mesh mesh;
+    mesh.lods = lods;
+    mesh.boundsCenter = glm::vec3(10.0f, -3.0f, 0.5f);
+    mesh.boundsRadius = 2.55f;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    std::cout << "Selection (1 px error budget, 1080 px tall viewport)" << std::endl;
+    for (float distance : { 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f, 320.0f }) {
+        glm::mat4 modelView = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -distance) - mesh.boundsCenter);
+        int lod = mesh.selectLod(modelView, projection, 1080.0f, 1.0f);
+        float pixels = 2.0f * mesh.boundsRadius / (distance - mesh.boundsRadius) * projection[1][1] * 0.5f * 1080.0f;
+        std::cout << "  " << distance << " units (~" << int(pixels) << " px tall): LOD " << lod << ", "
+                  << lods[lod].indexCount / 3 << " tris" << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+// a triangle the GPU would throw away anyway: facing away, or all corners outside one clip plane
+static bool TriangleRejectable(const glm::vec3 p[3], const glm::mat4& viewProjection, const glm::vec3& eye, bool backfaces) {
+    if (backfaces && glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), p[0] - eye) >= 0.0f) return true;
+    glm::vec4 c[3];
+    for (int k = 0; k < 3; k++) c[k] = viewProjection * glm::vec4(p[k], 1.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        bool below = true, above = true;
+        for (int k = 0; k < 3; k++) {
+            below = below && c[k][axis] < -c[k].w;
+            above = above && c[k][axis] > c[k].w;
+        }
+        if (below || above) return true;
+    }
+    return false;
+}
+
+static int BenchMeshlets() {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(700, 1400, vertices, indices);
+    // MakeSphere winds clockwise seen from outside; cone culling assumes counter-clockwise fronts
+    for (size_t i = 0; i < indices.size(); i += 3) std::swap(indices[i + 1], indices[i + 2]);
+    OptimizeVertexCache(indices.data(), indices.size(), vertices.size()); // the order loadObjModel hands over
+
+    std::vector<MeshLod> lods = { { 0, static_cast<unsigned int>(indices.size()), 0.0f } };
+    std::vector<Meshlet> meshlets;
+    auto t0 = std::chrono::steady_clock::now();
+    BuildMeshlets(vertices.data(), vertices.size(), indices.data(), lods.data(), lods.size(), meshlets);
+    double buildMs = ElapsedMs(t0);
+
+    int failures = 0;
+    size_t tris = indices.size() / 3, meshletVertices = 0, overLimit = 0;
+    std::vector<unsigned int> seen(vertices.size(), UINT32_MAX);
+    for (size_t m = 0; m < meshlets.size(); m++) {
+        size_t unique = 0;
+        for (unsigned int i = 0; i < meshlets[m].indexCount; i++) {
+            unsigned int v = indices[meshlets[m].indexOffset + i];
+            if (seen[v] != m) unique++;
+            seen[v] = static_cast<unsigned int>(m);
+        }
+        meshletVertices += unique;
+        overLimit += unique > MESHLET_MAX_VERTICES || meshlets[m].indexCount / 3 > MESHLET_MAX_TRIANGLES;
+    }
+    std::cout << tris << " tris -> " << meshlets.size() << " meshlets (avg " << double(tris) / meshlets.size()
+              << " tris, " << double(meshletVertices) / meshlets.size() << " verts) in " << buildMs << " ms"
+              << (overLimit ? "  OVER LIMIT" : "") << std::endl;
+    if (overLimit) failures++;
+
+    // camera 6 units in front of the sphere (radius 2.5), aimed past its side so part of it is off screen
+    glm::vec3 center(10.0f, -3.0f, 0.5f);
+    glm::vec3 eye = center + glm::vec3(0.0f, 0.0f, 6.0f);
+    glm::mat4 view = glm::lookAt(eye, center + glm::vec3(2.5f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 viewProjection = projection * view;
+
+    std::cout << "Culling (" << ThreadPool::global().size() << " worker threads)" << std::endl;
+    for (bool cone : { false, true }) {
+        MeshletDrawList drawList;
+        MeshletCullStats stats = CullMeshlets(meshlets.data(), meshlets.size(), viewProjection, eye, cone, drawList);
+
+        const int frames = 500;
+        t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) CullMeshlets(meshlets.data(), meshlets.size(), viewProjection, eye, cone, drawList);
+        double frameMs = ElapsedMs(t0) / frames;
+
+        // culling must be conservative: every triangle of a culled meshlet has to be invisible on its own
+        size_t wronglyCulled = 0, rejectable = 0;
+        for (size_t m = 0; m < meshlets.size(); m++) {
+            for (unsigned int i = 0; i < meshlets[m].indexCount; i += 3) {
+                const unsigned int* tri = &indices[meshlets[m].indexOffset + i];
+                glm::vec3 p[3] = { vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position };
+                bool invisible = TriangleRejectable(p, viewProjection, eye, cone);
+                rejectable += invisible;
+                wronglyCulled += !drawList.visible[m] && !invisible;
+            }
+        }
+        std::cout << "  " << (cone ? "frustum + cone: " : "frustum only:   ") << stats.meshletsCulled << " / "
+                  << stats.meshletsTested << " meshlets culled, " << stats.trianglesCulled << " / " << tris
+                  << " tris rejected (per-triangle ideal " << rejectable << "), " << drawList.counts.size()
+                  << " draw ranges, " << frameMs << " ms/frame, " << stats.meshletsCulled / frameMs / 1000.0
+                  << " M meshlets culled/s (" << stats.meshletsTested / frameMs / 1000.0 << " M tested/s)"
+                  << (wronglyCulled ? "  VISIBLE TRIANGLES CULLED: " + std::to_string(wronglyCulled) : "") << std::endl;
+        if (wronglyCulled) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+// encode cost of one headless thumbnail, and a PNG round trip through stb_image
+static int BenchImageWrite() {
+    const int size = 512;
+    std::vector<uint8_t> ldr(size_t(size) * size * 4);
+    std::vector<float> hdr(ldr.size());
+    // something render-like: a shaded disc with noise on a flat background
+    uint32_t noise = 12345;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float dx = (x - size * 0.5f) / (size * 0.4f), dy = (y - size * 0.5f) / (size * 0.4f);
+            float inside = dx * dx + dy * dy < 1.0f ? 1.0f : 0.0f;
+            float shade = inside * std::max(0.0f, std::sqrt(std::max(0.0f, 1.0f - dx * dx - dy * dy)) * 0.8f - dx * 0.3f);
+            noise = noise * 1664525u + 1013904223u;
+            float grain = inside * ((noise >> 24) / 255.0f - 0.5f) * 0.03f;
+            float rgb[3] = { 0.1f + shade * 3.0f + grain, 0.1f + shade * 2.2f + grain, 0.1f + shade * 0.9f + grain };
+            for (int c = 0; c < 4; c++) {
+                size_t i = (size_t(y) * size + x) * 4 + c;
+                hdr[i] = c < 3 ? rgb[c] : 1.0f;
+                float mapped = c < 3 ? std::pow(rgb[c] / (rgb[c] + 1.0f), 1.0f / 2.2f) : 1.0f;
+                ldr[i] = uint8_t(std::min(255.0f, std::max(0.0f, mapped * 255.0f + 0.5f)));
+            }
+        }
+    }
+
+    const int runs = 20;
+    std::vector<uint8_t> png, exr;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) EncodePNG(size, size, 4, ldr.data(), true, png);
+    double pngMs = ElapsedMs(t0) / runs;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) EncodeEXR(size, size, 4, hdr.data(), true, exr);
+    double exrMs = ElapsedMs(t0) / runs;
+
+    int w = 0, h = 0, channels = 0;
+    unsigned char* decoded = stbi_load_from_memory(png.data(), int(png.size()), &w, &h, &channels, 4);
+    bool match = decoded && w == size && h == size;
+    for (int y = 0; match && y < size; y++) // flipY: file row y is source row size-1-y
+        match = std::memcmp(decoded + size_t(y) * size * 4, ldr.data() + size_t(size - 1 - y) * size * 4, size_t(size) * 4) == 0;
+    if (decoded) stbi_image_free(decoded);
+
+    std::cout << size << "x" << size << " RGBA: PNG " << pngMs << " ms (" << png.size() / 1024 << " KiB, "
+              << 3600000.0 / pngMs << " per hour per thread), EXR " << exrMs << " ms (" << exr.size() / 1024
+              << " KiB)" << (match ? "" : "  PNG ROUND TRIP MISMATCH") << std::endl;
+    return match ? 0 : 1;
+}
+
+// quality and size of the block compressed maps vs. the uncompressed uploads, for every image in textures/
+static int BenchTextureCompress() {
+    static const char* FORMAT_NAMES[] = { "BC1", "BC4", "BC5" };
+    size_t totalRaw = 0, totalCompressed = 0;
+    double totalMs = 0.0;
+    int count = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("textures", ec)) {
+        std::string ext = entry.path().extension().string();
+        for (char& c : ext) c = char(std::tolower((unsigned char)c));
+        if (!entry.is_regular_file() || (ext != ".jpg" && ext != ".jpeg" && ext != ".png")) continue;
+
+        std::string path = entry.path().string();
+        DecodedImage image;
+        if (!DecodeImage(path, 0, false, image)) continue;
+        int width = image.width, height = image.height, channels = image.channels;
+        const unsigned char* pixels = image.pixels();
+
+        TextureRole role = GuessTextureRole(path);
+        CompressedTexture compressed;
+        auto t0 = std::chrono::steady_clock::now();
+        CompressImage(pixels, width, height, channels, role, true, compressed);
+        double ms = ElapsedMs(t0);
+
+        // PSNR of the top level over the channels the format keeps
+        std::vector<uint8_t> decoded;
+        DecompressLevel(compressed, 0, decoded);
+        int decodedChannels = compressed.format == BlockFormat::BC1 ? 4 : compressed.format == BlockFormat::BC4 ? 1 : 2;
+        int compared = compressed.format == BlockFormat::BC1 ? 3 : decodedChannels;
+        double squaredError = 0.0;
+        for (size_t i = 0; i < size_t(width) * height; i++) {
+            for (int c = 0; c < compared; c++) {
+                double d = double(decoded[i * decodedChannels + c]) - pixels[i * channels + (channels >= 3 ? c : 0)];
+                squaredError += d * d;
+            }
+        }
+        double mse = squaredError / (double(width) * height * compared);
+        double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+
+        size_t raw = size_t(width) * height * channels * 4 / 3; // what LoadTexture2D uploads, with mips
+        totalRaw += raw;
+        totalCompressed += compressed.data.size();
+        totalMs += ms;
+        count++;
+        std::printf("%-60s %4dx%-4d %s  %6.2f MB -> %5.2f MB (source file %5.2f MB)  PSNR %5.2f dB  %7.1f ms\n",
+                    path.c_str(), width, height, FORMAT_NAMES[int(compressed.format)], raw / 1048576.0,
+                    compressed.data.size() / 1048576.0, entry.file_size() / 1048576.0, psnr, ms);
+    }
+    if (count == 0) {
+        std::cerr << "No .jpg/.png images found under textures/" << std::endl;
+        return 1;
+    }
+    std::printf("%d maps: %.1f MB -> %.1f MB of texture memory (%.1fx smaller), %.0f ms encoding on %u threads\n",
+                count, totalRaw / 1048576.0, totalCompressed / 1048576.0, double(totalRaw) / totalCompressed, totalMs,
+                ThreadPool::global().size());
+    return 0;
+}
+
+// CPU mip chain throughput per filter, plus the two things glGenerateMipmap gets wrong and the cache round trip
+static int BenchMips() {
+    const int size = 2048, runs = 3;
+    // sRGB checker of black and white texels: averaged in linear light the 1x1 mip is sRGB 0.5 = 188, not 128
+    std::vector<uint8_t> color(size_t(size) * size * 4), normals(size_t(size) * size * 3);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint8_t* p = &color[(size_t(y) * size + x) * 4];
+            p[0] = p[1] = p[2] = ((x ^ y) & 1) ? 255 : 0;
+            p[3] = 255;
+            // bumpy normal map: the average of tilted unit normals is shorter than 1 until renormalized
+            float nx = 0.6f * std::sin(x * 0.9f), ny = 0.6f * std::cos(y * 1.3f);
+            float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+            uint8_t* n = &normals[(size_t(y) * size + x) * 3];
+            n[0] = uint8_t(std::lround((nx + 1.0f) * 127.5f));
+            n[1] = uint8_t(std::lround((ny + 1.0f) * 127.5f));
+            n[2] = uint8_t(std::lround((nz + 1.0f) * 127.5f));
+        }
+    }
+
+    bool ok = true;
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos }) {
+        MipChain chain;
+        MipOptions options = MipOptionsForRole(TextureRole::BaseColor, filter);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) BuildMipChain(color.data(), size, size, 4, options, chain);
+        double ms = ElapsedMs(t0) / runs;
+        int gray = chain.data[chain.levels.back().offset];
+
+        MipChain normalChain;
+        BuildMipChain(normals.data(), size, size, 3, MipOptionsForRole(TextureRole::Normal, filter), normalChain);
+        double worst = 0.0;
+        for (const MipLevel& level : normalChain.levels) {
+            const uint8_t* n = &normalChain.data[level.offset];
+            for (size_t i = 0; i < size_t(level.width) * level.height; i++, n += 3) {
+                double x = n[0] / 127.5 - 1.0, y = n[1] / 127.5 - 1.0, z = n[2] / 127.5 - 1.0;
+                worst = std::max(worst, std::fabs(std::sqrt(x * x + y * y + z * z) - 1.0));
+            }
+        }
+        bool pass = std::abs(gray - 188) <= 1 && worst < 0.02;
+        ok = ok && pass;
+        std::printf("%-8s %dx%d RGBA: %7.1f ms  %7.1f MPix/s  1x1 of the sRGB checker = %d (linear-light 188)  "
+                    "worst normal length error %.4f%s\n",
+                    MipFilterName(filter), size, size, ms, double(size) * size / (ms * 1000.0), gray, worst,
+                    pass ? "" : "  FAIL");
+    }
+
+    // cache round trip
+    MipChain chain, reloaded;
+    MipOptions options = MipOptionsForRole(TextureRole::BaseColor);
+    BuildMipChain(color.data(), size, size, 4, options, chain);
+    std::string path = (std::filesystem::temp_directory_path() / "bench_mips.png.mips").string();
+    auto t0 = std::chrono::steady_clock::now();
+    bool written = WriteMipCache(path, 42, true, options, chain);
+    double writeMs = ElapsedMs(t0);
+    t0 = std::chrono::steady_clock::now();
+    bool read = ReadMipCache(path, 42, true, options, reloaded) && reloaded.data == chain.data;
+    double readMs = ElapsedMs(t0);
+    bool stale = !ReadMipCache(path, 43, true, options, reloaded); // a different source hash must miss
+    std::filesystem::remove(path);
+    std::printf("cache: write %.1f ms, read %.1f ms (%.1f MB)%s\n", writeMs, readMs, chain.data.size() / 1048576.0,
+                written && read && stale ? "" : "  ROUND TRIP FAILED");
+    std::printf("%u threads\n", ThreadPool::global().size());
+    return ok && written && read && stale ? 0 : 1;
+}
+
+// decode throughput of the active backends vs. stb_image for every image in textures/, then the whole set
+// decoded one after another vs. concurrently (DecodeImages)
+static int BenchDecode() {
+    const int runs = 3;
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("textures", ec)) {
+        std::string ext = entry.path().extension().string();
+        for (char& c : ext) c = char(std::tolower((unsigned char)c));
+        if (entry.is_regular_file() && (ext == ".jpg" || ext == ".jpeg" || ext == ".png")) paths.push_back(entry.path().string());
+    }
+    if (paths.empty()) {
+        std::cerr << "No .jpg/.png images found under textures/" << std::endl;
+        return 1;
+    }
+
+    const ImageDecoder& stb = StbImageDecoder();
+    double stbTotalMs = 0.0, fileBytes = 0.0;
+    bool ok = true;
+    for (const std::string& path : paths) {
+        MappedFile file;
+        if (!file.open(path)) continue;
+        const ImageDecoder* active = nullptr;
+        for (const ImageDecoder* decoder : ImageDecoders())
+            if (!active && decoder->canDecode(file.data(), file.size())) active = decoder;
+        if (!active) {
+            std::printf("%-60s no decoder recognizes it, skipped\n", path.c_str());
+            continue;
+        }
+
+        double ms[2] = {};
+        DecodedImage images[2];
+        std::string error;
+        for (int d = 0; d < 2; d++) {
+            const ImageDecoder& decoder = d == 0 ? stb : *active;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < runs; i++) decoder.decode(file.data(), file.size(), 0, true, images[d], error);
+            ms[d] = ElapsedMs(t0) / runs;
+        }
+        if (!images[0] || !images[1]) {
+            std::printf("%-60s decode failed: %s\n", path.c_str(), error.c_str());
+            ok = false;
+            continue;
+        }
+        // lossy decoders may round differently; report the largest difference
+        int maxDiff = 0;
+        bool sameShape = images[0].width == images[1].width && images[0].height == images[1].height &&
+                         images[0].channels == images[1].channels;
+        for (size_t i = 0; sameShape && i < images[0].byteSize(); i++)
+            maxDiff = std::max(maxDiff, std::abs(int(images[0].pixels()[i]) - int(images[1].pixels()[i])));
+        double mpix = double(images[0].width) * images[0].height / 1e6;
+        std::printf("%-60s %4dx%-4d %5.2f MB  stb %7.1f ms (%6.1f MB/s, %6.1f MPix/s)  %s %7.1f ms (%6.1f MB/s)  %s\n",
+                    path.c_str(), images[0].width, images[0].height, file.size() / 1048576.0, ms[0],
+                    file.size() / 1048576.0 / (ms[0] / 1000.0), mpix / (ms[0] / 1000.0), active->name(), ms[1],
+                    file.size() / 1048576.0 / (ms[1] / 1000.0),
+                    !sameShape ? "SHAPE MISMATCH" : maxDiff ? ("max diff " + std::to_string(maxDiff)).c_str() : "identical");
+        ok = ok && sameShape;
+        stbTotalMs += ms[0];
+        fileBytes += file.size();
+    }
+
+    std::vector<ImageDecodeRequest> requests(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) requests[i].path = paths[i];
+    std::vector<DecodedImage> images;
+    auto t0 = std::chrono::steady_clock::now();
+    DecodeImages(requests, images);
+    double setMs = ElapsedMs(t0);
+    std::printf("%zu images, %.1f MB: stb one at a time %.0f ms (%.1f MB/s), active backends concurrently %.0f ms "
+                "(%.1f MB/s) on %u threads\n",
+                paths.size(), fileBytes / 1048576.0, stbTotalMs, fileBytes / 1048576.0 / (stbTotalMs / 1000.0), setMs,
+                fileBytes / 1048576.0 / (setMs / 1000.0), ThreadPool::global().size());
+    return ok ? 0 : 1;
+}
+
+// IBL CPU side (ibl_utils.h): the BRDF LUT must conserve energy, the prefilter must pass a white furnace, the
+// downsampled environment ValidateIBL integrates over must stay close to the full one, and the SH projection
+// must be fast and close to the brute force irradiance convolution
+// Sky gradient with a small, very bright sun, 2:1 like the shipped HDRs
+static EnvironmentImage SkyEnvironment(int width, int height, const glm::vec3& sun) {
+    EnvironmentImage env;
+    env.width = width;
+    env.height = height;
+    env.texels.resize(size_t(width) * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            glm::vec3 d = env.direction(x, y);
+            glm::vec3 sky = glm::mix(glm::vec3(0.3f, 0.25f, 0.2f), glm::vec3(0.4f, 0.6f, 1.0f), d.y * 0.5f + 0.5f);
+            env.texels[size_t(y) * width + x] = sky + (glm::dot(d, sun) > 0.9995f ? glm::vec3(500.0f) : glm::vec3(0.0f));
+        }
+    return env;
+}
+
+static int BenchIbl() {
+    const int lutSize = 128;
+    std::vector<glm::vec2> lut;
+    auto t0 = std::chrono::steady_clock::now();
+    BuildBrdfLut(lutSize, lut);
+    double lutMs = ElapsedMs(t0);
+    float maxSum = 0.0f;
+    for (const glm::vec2& v : lut) maxSum = std::max(maxSum, v.x + v.y);
+    glm::vec2 mirror = lut[lutSize - 1]; // NdotV ~ 1, roughness ~ 0: all of F0 comes back
+    bool lutOk = maxSum <= 1.01f && mirror.x + mirror.y > 0.98f;
+    std::printf("BRDF LUT %dx%d (%d samples): %.1f ms  max scale + bias %.4f  at NdotV 1, roughness 0: (%.3f, %.3f)%s\n",
+                lutSize, lutSize, IBL_SAMPLE_COUNT, lutMs, maxSum, mirror.x, mirror.y, lutOk ? "" : "  FAIL");
+
+    glm::vec3 sun = glm::normalize(glm::vec3(0.3f, 0.8f, 0.5f));
+    EnvironmentImage env = SkyEnvironment(1024, 512, sun), furnace;
+    furnace.width = env.width;
+    furnace.height = env.height;
+    furnace.texels.assign(env.texels.size(), glm::vec3(1.0f));
+    EnvironmentImage coarse = env.downsampled(512);
+
+    bool ok = lutOk;
+    const glm::vec3 directions[] = { sun, glm::vec3(0.0f, 1.0f, 0.0f), glm::normalize(glm::vec3(1.0f, 0.2f, -1.0f)),
+                                     glm::vec3(0.0f, -1.0f, 0.0f) };
+    for (int level = 1; level < PREFILTER_MIP_LEVELS; level++) {
+        float roughness = PrefilterRoughness(level);
+        float furnaceError = 0.0f, coarseError = 0.0f;
+        double fullMs = 0.0, coarseMs = 0.0;
+        for (const glm::vec3& d : directions) {
+            furnaceError = std::max(furnaceError, std::fabs(PrefilterReference(furnace, d, roughness).x - 1.0f));
+            t0 = std::chrono::steady_clock::now();
+            glm::vec3 full = PrefilterReference(env, d, roughness);
+            fullMs += ElapsedMs(t0);
+            t0 = std::chrono::steady_clock::now();
+            glm::vec3 small = PrefilterReference(coarse, d, roughness);
+            coarseMs += ElapsedMs(t0);
+            coarseError = std::max(coarseError, glm::length(small - full) / std::max(glm::length(full), 1e-3f));
+        }
+        bool pass = furnaceError < 1e-3f;
+        ok = ok && pass;
+        std::printf("prefilter roughness %.1f: furnace error %.5f  %dx%d vs %dx%d: %.2f%%  %.1f / %.1f ms per direction%s\n",
+                    roughness, furnaceError, coarse.width, coarse.height, env.width, env.height, coarseError * 100.0f,
+                    coarseMs / 4.0, fullMs / 4.0, pass ? "" : "  FAIL");
+    }
+
+    // SH irradiance: projection speed, furnace, and the L2 approximation against the brute force convolution
+    const int runs = 10;
+    t0 = std::chrono::steady_clock::now();
+    IrradianceSH sh;
+    for (int i = 0; i < runs; i++) sh = ProjectIrradianceSH(env);
+    double shMs = ElapsedMs(t0) / runs;
+    glm::vec3 white = ProjectIrradianceSH(furnace).evaluate(glm::vec3(0.0f, 0.0f, 1.0f));
+    EnvironmentImage tiny = env.downsampled(256);
+    float worst = 0.0f, mean = 0.0f;
+    int count = 0;
+    for (int face = 0; face < 6; face++)
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++, count++) {
+                glm::vec3 n = CubemapTexelDirection(face, x, y, 4);
+                glm::vec3 ref = IrradianceReference(tiny, n);
+                float error = glm::length(sh.evaluate(n) - ref) / std::max(glm::length(ref), 1e-3f);
+                worst = std::max(worst, error);
+                mean += error;
+            }
+    mean /= count;
+    bool shOk = std::fabs(white.x - 1.0f) < 1e-3f && mean < 0.05f;
+    ok = ok && shOk;
+    std::printf("SH irradiance %dx%d: %.2f ms (%.0f MPix/s)  furnace %.4f  vs convolution: mean %.2f%%, max %.2f%%%s\n",
+                env.width, env.height, shMs, double(env.width) * env.height / (shMs * 1000.0), white.x, mean * 100.0f,
+                worst * 100.0f, shOk ? "" : "  FAIL");
+    return ok ? 0 : 1;
+}
+
+// The CPU backend of IBLBaker: environment cubemaps at the face sizes artists pick, and the irradiance map
+static int BenchIblBake() {
+    glm::vec3 sun = glm::normalize(glm::vec3(0.3f, 0.8f, 0.5f));
+    EnvironmentImage env = SkyEnvironment(2048, 1024, sun), furnace;
+    furnace.width = 64;
+    furnace.height = 32;
+    furnace.texels.assign(size_t(furnace.width) * furnace.height, glm::vec3(1.0f));
+
+    bool ok = true;
+    CubemapImage cubemap;
+    for (int size : { 256, 512, 1024, 2048 }) {
+        const int runs = size <= 512 ? 5 : 1;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) BuildEnvironmentCubemap(env, size, cubemap);
+        double ms = ElapsedMs(t0) / runs;
+        // the SSE rows against EnvironmentImage::sample, on a sparse grid of level 0
+        double sum = 0.0;
+        float worst = 0.0f;
+        int count = 0;
+        for (int face = 0; face < 6; face++)
+            for (int y = 3; y < size; y += 29)
+                for (int x = 1; x < size; x += 31, count++) {
+                    glm::vec3 ref = env.sample(CubemapTexelDirection(face, x, y, size));
+                    float error = glm::length(cubemap.face(0, face)[size_t(y) * size + x] - ref) / std::max(glm::length(ref), 1e-3f);
+                    sum += error;
+                    worst = std::max(worst, error);
+                }
+        float mean = float(sum / count);
+        glm::vec3 top = cubemap.face(cubemap.levels - 1, 2)[0]; // 1x1 +Y: the sky's average over that face
+        bool pass = mean < 1e-3f && std::isfinite(top.x);
+        ok = ok && pass;
+        std::printf("environment cubemap %4d^2 (%d levels) from %dx%d: %8.1f ms (%.0f MTexel/s)  vs sample(): mean %.4f%%, max %.3f%%%s\n",
+                    size, cubemap.levels, env.width, env.height, ms, 6.0 * size * size / (ms * 1000.0), mean * 100.0f,
+                    worst * 100.0f, pass ? "" : "  FAIL");
+    }
+
+    BuildEnvironmentCubemap(furnace, 64, cubemap);
+    float mipError = 0.0f;
+    for (const glm::vec3& texel : cubemap.texels) mipError = std::max(mipError, std::fabs(texel.x - 1.0f));
+
+    // irradiance: furnace, and against the brute force convolution of a 4x finer source
+    CubemapImage irradiance;
+    const int runs = 10;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) BuildIrradianceCubemap(env, IRRADIANCE_MAP_SIZE, irradiance);
+    double irradianceMs = ElapsedMs(t0) / runs;
+    EnvironmentImage fine = env.downsampled(4 * IRRADIANCE_SOURCE_WIDTH);
+    float worst = 0.0f, mean = 0.0f;
+    int count = 0;
+    for (int face = 0; face < 6; face++)
+        for (int y = 2; y < IRRADIANCE_MAP_SIZE; y += 8)
+            for (int x = 2; x < IRRADIANCE_MAP_SIZE; x += 8, count++) {
+                glm::vec3 ref = IrradianceReference(fine, CubemapTexelDirection(face, x, y, IRRADIANCE_MAP_SIZE));
+                glm::vec3 texel = irradiance.face(0, face)[size_t(y) * IRRADIANCE_MAP_SIZE + x];
+                float error = glm::length(texel - ref) / std::max(glm::length(ref), 1e-3f);
+                worst = std::max(worst, error);
+                mean += error;
+            }
+    mean /= count;
+    BuildIrradianceCubemap(furnace, IRRADIANCE_MAP_SIZE, irradiance);
+    float furnaceError = 0.0f;
+    for (const glm::vec3& texel : irradiance.texels) furnaceError = std::max(furnaceError, std::fabs(texel.x - 1.0f));
+    bool irradianceOk = mipError < 1e-5f && furnaceError < 2e-3f && mean < 0.01f;
+    ok = ok && irradianceOk;
+    std::printf("box mips furnace error %.6f  irradiance %d^2 from %d wide: %.2f ms  furnace error %.4f  vs %d wide: mean %.2f%%, max %.2f%%%s\n",
+                mipError, IRRADIANCE_MAP_SIZE, IRRADIANCE_SOURCE_WIDTH, irradianceMs, furnaceError, fine.width,
+                mean * 100.0f, worst * 100.0f, irradianceOk ? "" : "  FAIL");
+    return ok ? 0 : 1;
+}
+
+int RunBenchmark(const std::string& name) {
+    if (name == "dedup") return BenchDedup();
+    if (name == "objload") return BenchObjLoad();
+    if (name == "meshcache") return BenchMeshCache();
+    if (name == "packing") return BenchPacking();
+    if (name == "reorder") return BenchReorder();
+    if (name == "tangents") return BenchTangents();
+    if (name == "lod") return BenchLod();
+    if (name == "meshlets") return BenchMeshlets();
+    if (name == "imagewrite") return BenchImageWrite();
+    if (name == "texcompress") return BenchTextureCompress();
+    if (name == "mips") return BenchMips();
+    if (name == "decode") return BenchDecode();
+    if (name == "ibl") return BenchIbl();
+    if (name == "iblbake") return BenchIblBake();
+
+    std::cerr << "Unknown benchmark: " << name << "\n"
+              << "Available: dedup, objload, meshcache, packing, reorder, tangents, lod, meshlets, imagewrite, texcompress, mips, decode, ibl, iblbake" << std::endl;
+    return 1;
+}
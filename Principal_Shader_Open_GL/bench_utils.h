@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+
+// Headless CPU benchmarks, run with: Principal_Shader_Open_GL --bench <name>
+// Returns a process exit code (0 on success).
+int RunBenchmark(const std::string& name);
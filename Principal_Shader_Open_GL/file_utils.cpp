@@ -0,0 +1,174 @@
+#include "file_utils.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<const uint8_t*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+    if (fileHandle) CloseHandle(static_cast<HANDLE>(fileHandle));
+    bytes = nullptr;
+    length = 0;
+    fileHandle = mappingHandle = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference to the file
+    if (view == MAP_FAILED) return false;
+
+    bytes = static_cast<const uint8_t*>(view);
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+#endif
+
+// ─────────────────────────────────────────────
+// Hashing
+// ─────
+static inline uint64_t Rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+
+static inline uint64_t HashRound(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = Rotl64(acc, 31);
+    return acc * PRIME1;
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // four lanes keep the multiplies independent
+        uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = HashRound(v1, Read64(p));
+            v2 = HashRound(v2, Read64(p + 8));
+            v3 = HashRound(v3, Read64(p + 16));
+            v4 = HashRound(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+        for (uint64_t v : { v1, v2, v3, v4 }) h = (h ^ HashRound(0, v)) * PRIME1 + PRIME3;
+    } else {
+        h = seed + PRIME3;
+    }
+    h += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) h = Rotl64(h ^ HashRound(0, Read64(p)), 27) * PRIME1 + PRIME3;
+    for (; p < end; p++) h = Rotl64(h ^ (*p * PRIME3), 11) * PRIME1;
+
+    // final avalanche
+    h ^= h >> 33; h *= PRIME2;
+    h ^= h >> 29; h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool HashFile(const std::string& path, uint64_t& hashOut) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    hashOut = HashBytes(file.data(), file.size());
+    return true;
+}
+
+bool WriteFileAtomic(const std::string& path, std::initializer_list<FilePiece> pieces) {
+    std::string tmpPath = path + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        for (const FilePiece& piece : pieces) out.write(static_cast<const char*>(piece.data), std::streamsize(piece.size));
+        out.close(); // flushes: a full disk may only show up here
+        written = !out.fail();
+    }
+
+    std::error_code ec;
+    if (written) std::filesystem::rename(tmpPath, path, ec);
+    if (!written || ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
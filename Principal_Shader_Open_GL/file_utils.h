@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+// ─────────────────────────────────────────────
+// MappedFile: read-only memory mapping of a whole file
+// ─────
+// The mapping stays valid until the object is destroyed or closed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// 64-bit non-cryptographic content hash (4 independent multiply/rotate lanes, so it runs near memory speed)
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+bool HashFile(const std::string& path, uint64_t& hashOut); // maps the file and hashes it; false if unreadable
+
+// Writes the pieces, in order, to <path>.tmp and renames that over path, so a crash never leaves a
+// half-written file behind. False, with the .tmp removed, if any write, the flush on close or the
+// rename fails (disk full, read-only folder, ...).
+struct FilePiece {
+    const void* data;
+    size_t size;
+};
+bool WriteFileAtomic(const std::string& path, std::initializer_list<FilePiece> pieces);
@@ -0,0 +1,409 @@
+#include "headless.h"
+#include "image_write.h"
+#include "mesh_utils.h"
+#include "shader_utils.h"
+#include "texture_utils.h"
+#include "thread_utils.h"
+#include "uniforms.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// texture slots, in job file order and in the texture units basic.frag samples them from
+enum { SLOT_BASE_COLOR, SLOT_NORMAL, SLOT_ROUGHNESS, SLOT_METALLIC, SLOT_AO, SLOT_COUNT };
+static const char* DEFAULT_TEXTURES[SLOT_COUNT] = {
+    "textures/GoldPaint_BaseColor.jpg", "textures/GoldPaint_Normal.png", "textures/GoldPaint_Roughness.jpg",
+    "textures/GoldPaint_Metallic.jpg", "textures/GoldPaint_AmbientOcclusion.jpg",
+};
+static const TextureRole SLOT_ROLES[SLOT_COUNT] = { // picks each slot's mip filtering
+    TextureRole::BaseColor, TextureRole::Normal, TextureRole::Mask, TextureRole::Mask, TextureRole::Mask,
+};
+
+struct HeadlessJob {
+    std::string output;
+    std::string mesh; // empty = cube
+    std::string textures[SLOT_COUNT]; // empty = default
+    bool exr = false;
+};
+
+static bool ParseJobs(const std::string& path, std::vector<HeadlessJob>& jobs) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        std::istringstream fields(line);
+        std::string output;
+        if (!(fields >> output) || output[0] == '#') continue;
+
+        HeadlessJob job;
+        job.output = output;
+        std::string ext = std::filesystem::path(output).extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        if (ext != ".png" && ext != ".exr") {
+            std::cerr << path << ":" << lineNumber << ": output must be .png or .exr: " << output << std::endl;
+            return false;
+        }
+        job.exr = ext == ".exr";
+        std::string field;
+        if (fields >> field && field != "-") job.mesh = field;
+        for (int slot = 0; slot < SLOT_COUNT && fields >> field; slot++)
+            if (field != "-") job.textures[slot] = field;
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// Hidden 1x1 window whose context renders into our own FBOs. Context APIs are tried from the one that
+// needs the least (EGL, OSMesa) to the platform's native one.
+static GLFWwindow* CreateHiddenWindow(std::initializer_list<int> contextApis) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    for (int api : contextApis) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+        GLFWwindow* window = glfwCreateWindow(1, 1, "PBR Shader Tool (headless)", NULL, NULL);
+        if (window) return window;
+    }
+    return nullptr;
+}
+
+static GLFWwindow* CreateHeadlessContext() {
+    glfwSetErrorCallback([](int code, const char* description) {
+        std::cerr << "GLFW error " << code << ": " << description << std::endl;
+    });
+#ifdef GLFW_PLATFORM_NULL
+    // GLFW 3.4+: no X11/Wayland/Win32 window at all. The null platform only has EGL and OSMesa
+    // contexts, so where neither is installed (Windows, most GPU boxes) fall back to a native window.
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (glfwInit()) {
+        if (GLFWwindow* window = CreateHiddenWindow({ GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API })) return window;
+        glfwTerminate();
+        std::cerr << "No EGL/OSMesa context on the null platform, trying a hidden native window" << std::endl;
+    }
+    glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+#endif
+    if (!glfwInit()) return nullptr;
+    return CreateHiddenWindow({ GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API, GLFW_NATIVE_CONTEXT_API });
+}
+
+// ─────────────────────────────────────────────
+// Asynchronous readback
+// ─────
+// glReadPixels into a pixel pack buffer returns immediately; the copy finishes on the GPU while the
+// next jobs render. A fence tells us when the buffer can be mapped, and the PNG/EXR encode then runs
+// on the thread pool, so the render thread only ever waits on the oldest image in flight.
+static const int READBACK_RING = 3;
+
+struct PendingReadback {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    int job = -1;
+};
+
+class EncodeQueue {
+public:
+    void submit(std::function<bool()> encode) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outstanding++;
+        }
+        ThreadPool::global().submit([this, encode] {
+            bool ok = encode();
+            std::lock_guard<std::mutex> lock(mutex);
+            failures += !ok;
+            if (--outstanding == 0) done.notify_all();
+        });
+    }
+    void fail() { // a job that never got as far as an encode
+        std::lock_guard<std::mutex> lock(mutex);
+        failures++;
+    }
+    int wait() { // returns the number of failed jobs
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return outstanding == 0; });
+        return failures;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable done;
+    int outstanding = 0;
+    int failures = 0;
+};
+
+static void FinishReadback(PendingReadback& readback, const std::vector<HeadlessJob>& jobs, int width, int height,
+                           EncodeQueue& encoder) {
+    if (readback.job < 0) return;
+    const HeadlessJob& job = jobs[readback.job];
+    glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    size_t bytes = size_t(width) * height * 4 * (job.exr ? sizeof(float) : 1);
+    auto pixels = std::make_shared<std::vector<uint8_t>>(bytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (mapped) {
+        std::memcpy(pixels->data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.job = -1;
+    if (!mapped) { // nothing was read back: no image rather than a black one
+        std::cerr << "Could not map the readback of " << job.output << std::endl;
+        encoder.fail();
+        return;
+    }
+
+    std::string output = job.output;
+    bool exr = job.exr;
+    encoder.submit([=] {
+        bool ok = exr ? WriteEXR(output, width, height, 4, reinterpret_cast<const float*>(pixels->data()), true)
+                      : WritePNG(output, width, height, 4, pixels->data(), true);
+        if (!ok) std::cerr << "Could not write " << output << std::endl;
+        return ok;
+    });
+}
+
+// ─────────────────────────────────────────────
+// RunHeadless
+// ─────
+int RunHeadless(int argc, char** argv) {
+    std::string jobsPath = argv[2];
+    int width = 512, height = 512;
+    for (int i = 3; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--size" &&
+            (std::sscanf(argv[i + 1], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)) {
+            std::cerr << "--size expects <width>x<height>, got " << argv[i + 1] << std::endl;
+            return 1;
+        }
+    }
+    std::vector<HeadlessJob> jobs;
+    if (!ParseJobs(jobsPath, jobs)) {
+        std::cerr << "Could not read job file: " << jobsPath << std::endl;
+        return 1;
+    }
+
+    GLFWwindow* window = CreateHeadlessContext();
+    if (window == NULL) {
+        std::cerr << "Failed to create a headless OpenGL 3.3 context" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    std::cout << "Headless renderer: " << glGetString(GL_RENDERER) << ", " << jobs.size() << " jobs at "
+              << width << "x" << height << std::endl;
+
+    // ----- Shaders and uniforms (same defaults as the interactive app) -----
+    std::string vertexSource = ReadTextFile("shaders/basic.vert");
+    std::string fragSource = ReadTextFile("shaders/basic.frag");
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
+    GLuint fragShader = CompileShader(GL_FRAGMENT_SHADER, fragSource.c_str());
+    GLuint program = LinkProgram(vertexShader, fragShader);
+    BindProgramSlots(program);
+    VertexUniforms vertUniforms = getVertexUniforms(program);
+    UniformBlock<FrameBlock> frameBlock;
+    UniformBlock<LightsBlock> lightsBlock;
+    UniformBlock<MaterialBlock> materialBlock;
+    frameBlock.init(FRAME_BLOCK_BINDING);
+    lightsBlock.init(LIGHTS_BLOCK_BINDING);
+    materialBlock.init(MATERIAL_BLOCK_BINDING);
+    // jobs never batch (uMaterialTable stays off), but the block is active and needs a buffer behind it
+    UniformBlock<MaterialTableBlock> materialTable;
+    materialTable.init(MATERIAL_TABLE_BINDING);
+    materialTable.flush();
+
+    MaterialBlock& material = materialBlock.data;
+    material.baseTint = glm::vec3(1.0f, 1.0f, 1.0f);
+    material.roughness = 0.8f;
+    material.metallic = 0.0f;
+    material.dielectricF0 = glm::vec3(0.04f, 0.04f, 0.04f);
+    for (int i = 0; i < MAX_MATERIAL_TINTS; i++) material.tints[i] = glm::vec4(1.0f);
+    LightsBlock& lights = lightsBlock.data;
+    lights.type = 0;
+    lights.color = glm::vec3(3.0f, 3.0f, 3.0f);
+    lights.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+    lights.direction = glm::vec3(1.0f, -1.0f, -1.0f);
+    glUseProgram(program);
+    glUniform1i(vertUniforms.packedVertices, 0);
+
+    // ----- IBL -----
+    // baked on the first run, then read from textures/test.hdr.ibl
+    IBLMaps ibl;
+    GLuint brdfLut = 0;
+    if (std::filesystem::exists("textures/test.hdr")) {
+        IBLBaker baker; // only needed up front: the jobs all share one environment
+        baker.init();
+        if (LoadEnvironmentIBL(baker, "textures/test.hdr", ibl)) brdfLut = baker.brdfLut();
+        baker.cleanup();
+    }
+    lights.useIBL = ibl.environment ? 1 : 0;
+    lights.setIrradiance(ibl.irradiance);
+    lights.prefilterMaxLod = float(PREFILTER_MIP_LEVELS - 1);
+
+    // ----- Offscreen target: half float color so EXR jobs keep their HDR range -----
+    GLuint fbo, colorTexture, depthBuffer;
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless FBO incomplete at " << width << "x" << height << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+
+    PendingReadback ring[READBACK_RING];
+    for (PendingReadback& readback : ring) {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size_t(width) * height * 4 * sizeof(float), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // ----- Jobs -----
+    // consecutive jobs usually share the mesh and most maps, so only what changed is reloaded
+    Mesh mesh;
+    bool meshLoaded = false;
+    std::string meshPath;
+    GLuint textures[SLOT_COUNT] = {};
+    std::string texturePaths[SLOT_COUNT];
+    EncodeQueue encoder;
+    auto t0 = std::chrono::steady_clock::now();
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    for (size_t j = 0; j < jobs.size(); j++) {
+        const HeadlessJob& job = jobs[j];
+        if (!meshLoaded || job.mesh != meshPath) {
+            if (meshLoaded) mesh.cleanup();
+            mesh = job.mesh.empty() ? createCube() : loadObjModel(job.mesh);
+            meshPath = job.mesh;
+            meshLoaded = true;
+        }
+        // the slots that changed decode together on the thread pool
+        std::vector<int> changed;
+        std::vector<std::string> paths;
+        std::vector<MipOptions> mipOptions;
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            const std::string& path = job.textures[slot].empty() ? DEFAULT_TEXTURES[slot] : job.textures[slot];
+            if (path == texturePaths[slot]) continue;
+            changed.push_back(slot);
+            paths.push_back(path);
+            mipOptions.push_back(MipOptionsForRole(SLOT_ROLES[slot]));
+        }
+        std::vector<GLuint> loaded = LoadTextures2D(paths, mipOptions);
+        for (size_t i = 0; i < changed.size(); i++) {
+            int slot = changed[i];
+            if (textures[slot]) glDeleteTextures(1, &textures[slot]);
+            textures[slot] = loaded[i];
+            texturePaths[slot] = paths[i];
+        }
+
+        // frame the bounding sphere from a three-quarter view
+        float fovY = glm::radians(45.0f);
+        float distance = mesh.boundsRadius / std::sin(fovY * 0.5f) * 1.05f;
+        glm::vec3 eye = mesh.boundsCenter + glm::normalize(glm::vec3(0.6f, 0.45f, 1.0f)) * distance;
+        glm::mat4 view = glm::lookAt(eye, mesh.boundsCenter, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(fovY, float(width) / height, std::max(distance - 2.0f * mesh.boundsRadius, distance * 0.01f),
+                                                distance + 2.0f * mesh.boundsRadius);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glClearColor(0.1f, 0.1f, 0.1f, job.exr ? 0.0f : 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glUseProgram(program);
+        frameBlock.data.view = view;
+        frameBlock.data.projection = projection;
+        frameBlock.data.cameraPos = eye;
+        frameBlock.data.linearOutput = job.exr ? 1 : 0;
+        // maps the app leaves off by default are only used when the job names them
+        material.useBaseTex = textures[SLOT_BASE_COLOR] ? 1 : 0;
+        material.useNormalTex = textures[SLOT_NORMAL] ? 1 : 0;
+        material.useRoughnessMap = textures[SLOT_ROUGHNESS] ? 1 : 0;
+        material.useMetallicMap = textures[SLOT_METALLIC] && !job.textures[SLOT_METALLIC].empty() ? 1 : 0;
+        material.useAOMap = textures[SLOT_AO] && !job.textures[SLOT_AO].empty() ? 1 : 0;
+        frameBlock.flush();
+        lightsBlock.flush();
+        materialBlock.flush();
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            glActiveTexture(GL_TEXTURE0 + slot);
+            glBindTexture(GL_TEXTURE_2D, textures[slot]);
+        }
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.prefiltered);
+        glActiveTexture(GL_TEXTURE8);
+        glBindTexture(GL_TEXTURE_2D, brdfLut);
+
+        mesh.drawLod(mesh.selectLod(view, projection, float(height), 1.0f));
+
+        // start this image's readback; the slot's previous image is finished and handed to the encoder first
+        PendingReadback& readback = ring[j % READBACK_RING];
+        FinishReadback(readback, jobs, width, height, encoder);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glReadPixels(0, 0, width, height, GL_RGBA, job.exr ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.job = static_cast<int>(j);
+    }
+    for (size_t j = jobs.size(); j < jobs.size() + READBACK_RING; j++)
+        FinishReadback(ring[j % READBACK_RING], jobs, width, height, encoder);
+    int failures = encoder.wait();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Rendered " << jobs.size() - failures << " / " << jobs.size() << " images in " << seconds << " s ("
+              << (seconds > 0.0 ? jobs.size() / seconds * 3600.0 : 0.0) << " per hour)" << std::endl;
+
+    // ----- Cleanup -----
+    for (PendingReadback& readback : ring) glDeleteBuffers(1, &readback.pbo);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteTextures(SLOT_COUNT, textures);
+    DeleteIBLMaps(ibl);
+    glDeleteTextures(1, &brdfLut);
+    if (meshLoaded) mesh.cleanup();
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragShader);
+    glDeleteProgram(program);
+    frameBlock.cleanup();
+    lightsBlock.cleanup();
+    materialBlock.cleanup();
+    materialTable.cleanup();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures ? 1 : 0;
+}
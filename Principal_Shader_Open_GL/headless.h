@@ -0,0 +1,13 @@
+#pragma once
+
+// ─────────────────────────────────────────────
+// Headless batch rendering (render farm / CI material previews)
+// ─────
+// Run with: Principal_Shader_Open_GL --headless <jobs.txt> [--size <width>x<height>]
+// Each line of the job file (blank lines and # comments skipped) renders one image:
+//   <output.png|output.exr> <mesh.obj> [baseColor normal roughness metallic ao]
+// A "-" keeps the default (the cube / the textures the app starts with).
+// No window is shown. With GLFW 3.4+ no display server is needed either: the context comes from
+// EGL (on Mesa, EGL_PLATFORM=surfaceless runs on llvmpipe without a GPU) or OSMesa.
+// Returns a process exit code (0 when every image was written).
+int RunHeadless(int argc, char** argv);
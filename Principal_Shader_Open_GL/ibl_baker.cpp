@@ -0,0 +1,283 @@
+#include "ibl_baker.h"
+#include "shader_utils.h"
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+static GLuint BuildProgram(const char* vertexPath, const char* geometryPath, const char* fragPath) {
+    std::string vertexSource = ReadTextFile(vertexPath);
+    std::string fragSource = ReadTextFile(fragPath);
+    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
+    GLuint frag_shader = CompileShader(GL_FRAGMENT_SHADER, fragSource.c_str());
+    GLuint program;
+    if (geometryPath) {
+        std::string geometrySource = ReadTextFile(geometryPath);
+        GLuint geometry_shader = CompileShader(GL_GEOMETRY_SHADER, geometrySource.c_str());
+        program = LinkProgram(vertex_shader, geometry_shader, frag_shader);
+        glDeleteShader(geometry_shader);
+    } else {
+        program = LinkProgram(vertex_shader, frag_shader);
+    }
+    glDeleteShader(vertex_shader);
+    glDeleteShader(frag_shader);
+    return program;
+}
+
+// A program drawing into all six cubemap faces at once: sampler on unit 0, the face rotations set for good
+static GLuint BuildCubemapProgram(const char* fragPath, const char* samplerName) {
+    GLuint program = BuildProgram("shaders/fullscreen.vert", "shaders/cubemap_layers.geom", fragPath);
+    const glm::mat4 views[] = {
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+    };
+    glm::mat3 rotations[6];
+    for (int i = 0; i < 6; ++i) rotations[i] = glm::transpose(glm::mat3(views[i])); // view space -> world
+    glUseProgram(program);
+    glUniformMatrix3fv(glGetUniformLocation(program, "faceRotations"), 6, GL_FALSE, glm::value_ptr(rotations[0]));
+    glUniform1i(glGetUniformLocation(program, samplerName), 0);
+    return program;
+}
+
+#ifdef GL_VERSION_4_3
+static GLuint BuildComputeProgram(const char* computePath) {
+    std::string computeSource = ReadTextFile(computePath);
+    GLuint compute_shader = CompileShader(GL_COMPUTE_SHADER, computeSource.c_str());
+    GLuint program = LinkComputeProgram(compute_shader);
+    glDeleteShader(compute_shader);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "equirectangularMap"), 0);
+    glUniform1i(glGetUniformLocation(program, "source"), 0);
+    return program;
+}
+#endif
+
+const char* IBLBakeBackendName(IBLBakeBackend backend) {
+    switch (backend) {
+    case IBLBakeBackend::Raster: return "Raster";
+    case IBLBakeBackend::Compute: return "Compute";
+    default: return "CPU";
+    }
+}
+
+// internalFormat cubemap (RGB16F for draws, RGBA16F for image stores) with storage for levels mips,
+// clamped, trilinear when it has mips. image (optional) fills every level: the CPU backend's result.
+static GLuint AllocateCubemap(int size, int levels, GLint internalFormat = GL_RGB16F, const CubemapImage* image = nullptr) {
+    GLuint cubemap;
+    glGenTextures(1, &cubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    GLint previousAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // rows of 12 * size bytes
+    for (int level = 0; level < levels; ++level) {
+        int levelSize = std::max(size >> level, 1);
+        for (int i = 0; i < 6; ++i)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, internalFormat, levelSize, levelSize, 0, GL_RGB, GL_FLOAT,
+                         image ? image->face(level, i) : nullptr);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return cubemap;
+}
+
+// env as an RGB32F texture, for the GPU backends to sample
+static GLuint UploadEquirect(const EnvironmentImage& env) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLint previousAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, env.width, env.height, 0, GL_RGB, GL_FLOAT, env.texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+    return texture;
+}
+
+void IBLBaker::init() {
+    equirectProgram = BuildCubemapProgram("shaders/equirect_to_cubemap.frag", "equirectangularMap");
+    irradianceProgram = BuildCubemapProgram("shaders/irradiance_convolution.frag", "environmentMap");
+    prefilterProgram = BuildCubemapProgram("shaders/prefilter_environment.frag", "environmentMap");
+    prefilterRoughness = glGetUniformLocation(prefilterProgram, "roughness");
+    prefilterResolution = glGetUniformLocation(prefilterProgram, "resolution");
+    brdfProgram = BuildProgram("shaders/fullscreen.vert", nullptr, "shaders/brdf_lut.frag");
+    glGenFramebuffers(1, &captureFBO);
+    glGenVertexArrays(1, &emptyVAO);
+#ifdef GL_VERSION_4_3
+    computeSupported = GLAD_GL_VERSION_4_3 != 0; // the context we got, not the 3.3 we asked for
+    if (computeSupported) {
+        equirectComputeProgram = BuildComputeProgram("shaders/equirect_to_cubemap.comp");
+        irradianceComputeProgram = BuildComputeProgram("shaders/irradiance.comp");
+    }
+#endif
+    backend = computeSupported ? IBLBakeBackend::Compute : IBLBakeBackend::Raster;
+}
+
+void IBLBaker::cleanup() {
+    glDeleteProgram(equirectProgram);
+    glDeleteProgram(irradianceProgram);
+    glDeleteProgram(prefilterProgram);
+    glDeleteProgram(brdfProgram);
+    glDeleteProgram(equirectComputeProgram);
+    glDeleteProgram(irradianceComputeProgram);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteFramebuffers(1, &captureFBO);
+    equirectProgram = irradianceProgram = prefilterProgram = brdfProgram = 0;
+    equirectComputeProgram = irradianceComputeProgram = 0;
+    emptyVAO = captureFBO = 0;
+}
+
+bool IBLBaker::supports(IBLBakeBackend b) const {
+    return b != IBLBakeBackend::Compute || computeSupported;
+}
+
+void IBLBaker::setBackend(IBLBakeBackend b) {
+    backend = supports(b) ? b : IBLBakeBackend::Raster;
+}
+
+IBLBaker::SavedState IBLBaker::begin() {
+    SavedState state;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &state.framebuffer);
+    glGetIntegerv(GL_VIEWPORT, state.viewport);
+    state.depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST); // every pass writes each texel exactly once
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindVertexArray(emptyVAO);
+    return state;
+}
+
+void IBLBaker::end(const SavedState& state) {
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+    glViewport(state.viewport[0], state.viewport[1], state.viewport[2], state.viewport[3]);
+    if (state.depthTest) glEnable(GL_DEPTH_TEST);
+}
+
+void IBLBaker::drawFaces(GLuint cubemap, int level, int size) {
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cubemap, level); // layered: gl_Layer picks the face
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Cubemap capture FBO incomplete\n";
+        return;
+    }
+    glViewport(0, 0, size, size);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void IBLBaker::dispatchFaces(GLuint program, GLuint cubemap, int size) {
+#ifdef GL_VERSION_4_3
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "size"), size);
+    glBindImageTexture(0, cubemap, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F); // layered: z picks the face
+    glDispatchCompute(GLuint(size + 7) / 8, GLuint(size + 7) / 8, 6);
+    // sampled, mipmapped or read back next
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindImageTexture(0, 0, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+#endif
+}
+
+GLuint IBLBaker::equirectToCubemap(const EnvironmentImage& env, int size) {
+    if (backend == IBLBakeBackend::CPU) {
+        CubemapImage cubemap;
+        BuildEnvironmentCubemap(env, size, cubemap);
+        return AllocateCubemap(cubemap.size, cubemap.levels, GL_RGB16F, &cubemap);
+    }
+
+    // mipmapped down to 1x1: prefilter reads coarser levels for wide GGX lobes
+    int levels = 1;
+    while ((size >> levels) > 0) levels++;
+    bool compute = backend == IBLBakeBackend::Compute;
+    GLuint envCubemap = AllocateCubemap(size, levels, compute ? GL_RGBA16F : GL_RGB16F);
+    GLuint hdrTexture = UploadEquirect(env);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    if (compute) {
+        dispatchFaces(equirectComputeProgram, envCubemap, size);
+    } else {
+        SavedState state = begin();
+        glUseProgram(equirectProgram);
+        drawFaces(envCubemap, 0, size);
+        end(state);
+    }
+    glDeleteTextures(1, &hdrTexture);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    return envCubemap;
+}
+
+GLuint IBLBaker::convolveIrradiance(const EnvironmentImage& env, int size) {
+    if (backend != IBLBakeBackend::Compute) {
+        CubemapImage irradiance;
+        BuildIrradianceCubemap(env, size, irradiance);
+        return AllocateCubemap(size, 1, GL_RGB16F, &irradiance);
+    }
+    GLuint irradianceMap = AllocateCubemap(size, 1, GL_RGBA16F);
+    GLuint source = UploadEquirect(env.downsampled(IRRADIANCE_SOURCE_WIDTH));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source);
+    dispatchFaces(irradianceComputeProgram, irradianceMap, size);
+    glDeleteTextures(1, &source);
+    return irradianceMap;
+}
+
+GLuint IBLBaker::convolveIrradiance(GLuint envCubemap, int size) {
+    GLuint irradianceMap = AllocateCubemap(size, 1);
+
+    SavedState state = begin();
+    glUseProgram(irradianceProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    drawFaces(irradianceMap, 0, size);
+    end(state);
+    return irradianceMap;
+}
+
+GLuint IBLBaker::prefilter(GLuint envCubemap, int size, int levels) {
+    GLint envSize = 0;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &envSize);
+    GLuint prefilterMap = AllocateCubemap(size, levels);
+
+    SavedState state = begin();
+    glUseProgram(prefilterProgram);
+    glUniform1f(prefilterResolution, float(envSize));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    for (int level = 0; level < levels; ++level) {
+        glUniform1f(prefilterRoughness, PrefilterRoughness(level, levels));
+        drawFaces(prefilterMap, level, std::max(size >> level, 1));
+    }
+    end(state);
+    return prefilterMap;
+}
+
+GLuint IBLBaker::brdfLut(int size) {
+    GLuint lut;
+    glGenTextures(1, &lut);
+    glBindTexture(GL_TEXTURE_2D, lut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, size, size, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    SavedState state = begin();
+    glUseProgram(brdfProgram);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lut, 0);
+    glViewport(0, 0, size, size);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    end(state);
+    return lut;
+}
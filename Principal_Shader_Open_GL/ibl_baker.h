@@ -0,0 +1,79 @@
+#pragma once
+#include "ibl_utils.h"
+#include "ibl_cubemap.h"
+#include <glad/glad.h>
+
+// ─────────────────────────────────────────────
+// IBLBaker: the GPU passes that turn an HDR into IBL maps
+// ─────
+// Owns one capture framebuffer, an empty VAO and every bake program, compiled once by init(), so
+// baking another environment costs only its draws. Cubemaps are attached layered and
+// cubemap_layers.geom routes a fullscreen triangle to all six faces, so each cubemap level is a
+// single draw. None of the passes needs a depth buffer.
+// Every bake saves and restores the framebuffer binding, viewport and depth test, and leaves its
+// program bound.
+//
+// The environment cubemap and the irradiance convolution have three backends:
+//   Raster   the layered draws above
+//   Compute  one dispatch for all six faces (GL 4.3: equirect_to_cubemap.comp, irradiance.comp)
+//   CPU      ibl_cubemap.h on the thread pool, then an upload; needs no more GL than a texture upload
+// Compute and CPU resample and integrate the same way and agree to within half float rounding.
+enum class IBLBakeBackend { Raster, Compute, CPU };
+const char* IBLBakeBackendName(IBLBakeBackend backend);
+
+class IBLBaker {
+public:
+    IBLBaker() = default;
+    IBLBaker(const IBLBaker&) = delete;
+    IBLBaker& operator=(const IBLBaker&) = delete;
+
+    // Needs the GL context: compiles the programs and creates the framebuffer. Picks Compute when
+    // the context is 4.3 or newer, Raster otherwise.
+    void init();
+    // Deletes them; call before the context goes away
+    void cleanup();
+
+    bool supports(IBLBakeBackend backend) const;
+    // Falls back to Raster when the backend isn't supported
+    void setBackend(IBLBakeBackend backend);
+    IBLBakeBackend getBackend() const { return backend; }
+
+    // Cubemap with mips down to 1x1, resampled from the equirectangular env by the current backend
+    GLuint equirectToCubemap(const EnvironmentImage& env, int size = 512);
+    // Irradiance cubemap from env: irradiance.comp with the Compute backend, BuildIrradianceCubemap otherwise
+    GLuint convolveIrradiance(const EnvironmentImage& env, int size = IRRADIANCE_MAP_SIZE);
+    // Brute force irradiance cubemap through irradiance_convolution.frag; rendering uses
+    // ProjectIrradianceSH, this is kept to validate it
+    GLuint convolveIrradiance(GLuint envCubemap, int size = IRRADIANCE_MAP_SIZE);
+    // Split-sum specular IBL (ibl_utils.h). envCubemap must be mipmapped (equirectToCubemap's is).
+    // Level l of the result is envCubemap convolved with the GGX lobe of roughness l / (levels - 1).
+    GLuint prefilter(GLuint envCubemap, int size = PREFILTER_SIZE, int levels = PREFILTER_MIP_LEVELS);
+    // RG16F scale / bias on F0 by (NdotV, roughness); depends on no environment, so bake it once
+    GLuint brdfLut(int size = BRDF_LUT_SIZE);
+
+private:
+    struct SavedState {
+        GLint framebuffer = 0;
+        GLint viewport[4] = {};
+        GLboolean depthTest = GL_FALSE;
+    };
+    SavedState begin();
+    void end(const SavedState& state);
+    // one layered draw into every face of level of cubemap
+    void drawFaces(GLuint cubemap, int level, int size);
+    // imageStore into every face of level 0 of cubemap, one invocation per texel, then waits for the writes
+    void dispatchFaces(GLuint program, GLuint cubemap, int size);
+
+    IBLBakeBackend backend = IBLBakeBackend::Raster;
+    bool computeSupported = false;
+    GLuint captureFBO = 0;
+    GLuint emptyVAO = 0; // core profile draws need a VAO, even without attributes
+    GLuint equirectProgram = 0;
+    GLuint irradianceProgram = 0;
+    GLuint prefilterProgram = 0;
+    GLuint brdfProgram = 0;
+    GLuint equirectComputeProgram = 0;
+    GLuint irradianceComputeProgram = 0;
+    GLint prefilterRoughness = -1;
+    GLint prefilterResolution = -1;
+};
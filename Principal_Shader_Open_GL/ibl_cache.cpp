@@ -0,0 +1,77 @@
+#include "ibl_cache.h"
+#include <algorithm>
+#include <cstring>
+
+static const char IBL_CACHE_MAGIC[4] = { 'P', 'S', 'I', 'B' };
+
+int CubemapMipLevels(int size) {
+    int levels = 1;
+    while (size > 1) {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+size_t CubemapChainHalfs(int size, int levels) {
+    size_t total = 0;
+    for (int level = 0; level < levels; level++) {
+        size_t s = size_t(std::max(size >> level, 1));
+        total += 6 * s * s * 3;
+    }
+    return total;
+}
+
+std::string IBLCachePath(const std::string& hdrPath) {
+    return hdrPath + ".ibl";
+}
+
+bool OpenIBLCache(const std::string& cachePath, uint64_t sourceHash, const IBLBakeSettings& settings, MappedIBL& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    if (file.size() < sizeof(IBLCacheHeader)) return false;
+
+    const IBLCacheHeader* header = reinterpret_cast<const IBLCacheHeader*>(file.data());
+    if (std::memcmp(header->magic, IBL_CACHE_MAGIC, 4) != 0 || header->version != IBL_CACHE_VERSION) return false;
+    if (header->sourceHash != sourceHash) return false; // .hdr changed since the bake
+    if (header->environmentSize != uint32_t(settings.environmentSize) ||
+        header->environmentLevels != uint32_t(CubemapMipLevels(settings.environmentSize)) ||
+        header->prefilterSize != uint32_t(settings.prefilterSize) ||
+        header->prefilterLevels != uint32_t(settings.prefilterLevels))
+        return false; // baked with other settings
+
+    size_t environmentHalfs = CubemapChainHalfs(int(header->environmentSize), int(header->environmentLevels));
+    size_t prefilterHalfs = CubemapChainHalfs(int(header->prefilterSize), int(header->prefilterLevels));
+    if (file.size() != sizeof(IBLCacheHeader) + (environmentHalfs + prefilterHalfs) * sizeof(uint16_t)) return false;
+
+    out.header = header;
+    out.environment = reinterpret_cast<const uint16_t*>(file.data() + sizeof(IBLCacheHeader));
+    out.prefiltered = out.environment + environmentHalfs;
+    for (int k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        out.irradiance.coefficients[k] = glm::vec3(header->irradiance[k * 3], header->irradiance[k * 3 + 1],
+                                                   header->irradiance[k * 3 + 2]);
+    out.file = std::move(file);
+    return true;
+}
+
+bool WriteIBLCache(const std::string& cachePath, uint64_t sourceHash, const IBLBakeSettings& settings,
+                   const IrradianceSH& irradiance, const std::vector<uint16_t>& environment,
+                   const std::vector<uint16_t>& prefiltered) {
+    IBLCacheHeader header = {};
+    std::memcpy(header.magic, IBL_CACHE_MAGIC, 4);
+    header.version = IBL_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.environmentSize = uint32_t(settings.environmentSize);
+    header.environmentLevels = uint32_t(CubemapMipLevels(settings.environmentSize));
+    header.prefilterSize = uint32_t(settings.prefilterSize);
+    header.prefilterLevels = uint32_t(settings.prefilterLevels);
+    for (int k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        for (int c = 0; c < 3; c++) header.irradiance[k * 3 + c] = irradiance.coefficients[k][c];
+    if (environment.size() != CubemapChainHalfs(settings.environmentSize, int(header.environmentLevels)) ||
+        prefiltered.size() != CubemapChainHalfs(settings.prefilterSize, settings.prefilterLevels))
+        return false;
+
+    return WriteFileAtomic(cachePath, { { &header, sizeof(header) },
+                                        { environment.data(), environment.size() * sizeof(uint16_t) },
+                                        { prefiltered.data(), prefiltered.size() * sizeof(uint16_t) } });
+}
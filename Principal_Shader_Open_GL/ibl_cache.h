@@ -0,0 +1,54 @@
+#pragma once
+#include "ibl_utils.h"
+#include "file_utils.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Baked IBL cache: <environment>.hdr.ibl
+// ─────
+// Everything LoadEnvironmentIBL (texture_utils.h) derives from an HDR: the environment cubemap with
+// its mips, the GGX prefiltered cubemap and the irradiance SH. Cubemaps are stored as the RGB16F
+// texels GL keeps them in, so a hit maps the file and uploads straight from the mapping, with no
+// decode, projection or convolution pass.
+// Layout: IBLCacheHeader, then for the environment and then the prefiltered map every level from
+// 0 down, each level's six faces (+X -X +Y -Y +Z -Z) back to back, rows of size * 3 halfs.
+static const uint32_t IBL_CACHE_VERSION = 1; // bump when a bake shader or the SH convention changes
+
+struct IBLBakeSettings {
+    int environmentSize = 512;              // IBLBaker::equirectToCubemap face size; the cache keeps its full mip chain
+    int prefilterSize = PREFILTER_SIZE;
+    int prefilterLevels = PREFILTER_MIP_LEVELS;
+};
+
+struct IBLCacheHeader {
+    char magic[4];              // "PSIB"
+    uint32_t version;           // IBL_CACHE_VERSION
+    uint64_t sourceHash;        // HashFile of the .hdr
+    uint32_t environmentSize, environmentLevels;
+    uint32_t prefilterSize, prefilterLevels;
+    float irradiance[SH_COEFFICIENT_COUNT * 3]; // IrradianceSH::coefficients
+    uint32_t reserved;
+};
+static_assert(sizeof(IBLCacheHeader) == 144, "IBL cache header must stay 144 bytes");
+
+// a cache file mapped into memory; the pointers live as long as this object
+struct MappedIBL {
+    MappedFile file;
+    const IBLCacheHeader* header = nullptr;
+    const uint16_t* environment = nullptr; // half floats
+    const uint16_t* prefiltered = nullptr;
+    IrradianceSH irradiance;
+};
+
+// Mip levels of a full chain down to 1x1, and the halfs a cubemap chain of size / levels takes
+int CubemapMipLevels(int size);
+size_t CubemapChainHalfs(int size, int levels);
+
+std::string IBLCachePath(const std::string& hdrPath);
+// false when the cache is missing, was baked from other source bytes or settings, or is truncated
+bool OpenIBLCache(const std::string& cachePath, uint64_t sourceHash, const IBLBakeSettings& settings, MappedIBL& out);
+bool WriteIBLCache(const std::string& cachePath, uint64_t sourceHash, const IBLBakeSettings& settings,
+                   const IrradianceSH& irradiance, const std::vector<uint16_t>& environment,
+                   const std::vector<uint16_t>& prefiltered);
@@ -0,0 +1,208 @@
+#include "ibl_cubemap.h"
+#include "thread_utils.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IBL_CUBEMAP_SSE 1
+#endif
+
+static const float PI = 3.14159265358979f;
+
+size_t CubemapImage::offset(int level, int face) const {
+    size_t texels = 0;
+    for (int l = 0; l < level; l++) texels += 6 * size_t(levelSize(l)) * levelSize(l);
+    return texels + size_t(face) * levelSize(level) * levelSize(level);
+}
+
+#if IBL_CUBEMAP_SSE
+static inline __m128 Floor4(__m128 x) {
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(x, truncated), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 Select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// atan2 to within 2e-6 rad: a minimax polynomial on [0, 1], then the octant
+static __m128 Atan2x4(__m128 y, __m128 x) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(signMask, x), ay = _mm_andnot_ps(signMask, y);
+    __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 r = _mm_set1_ps(-0.01172120f);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.05265332f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.11643287f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.19354346f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.33262347f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.99997726f));
+    r = _mm_mul_ps(r, a);
+    r = Select4(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(0.5f * PI), r), r);
+    r = Select4(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PI), r), r);
+    return _mm_or_ps(r, _mm_and_ps(signMask, y));
+}
+#endif
+
+// Row y of level 0 of a face: EnvironmentImage::sample through every texel center, 4 texels at a
+// time (the trigonometry and the bilinear taps' addressing in SSE, the fetches per lane)
+static void ResampleRow(const EnvironmentImage& env, int face, int y, int size, glm::vec3* out) {
+    int x = 0;
+#if IBL_CUBEMAP_SSE
+    const float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+    const __m128 one = _mm_set1_ps(1.0f), T = _mm_set1_ps(tc), negT = _mm_set1_ps(-tc);
+    for (; x + 4 <= size; x += 4) {
+        __m128 sc = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_setr_ps(float(x), float(x + 1), float(x + 2), float(x + 3)),
+                                                     _mm_set1_ps(0.5f)), _mm_set1_ps(2.0f / size)), one);
+        __m128 negS = _mm_sub_ps(_mm_setzero_ps(), sc);
+        __m128 dx, dy, dz; // CubemapTexelDirection's table
+        switch (face) {
+        case 0: dx = one; dy = negT; dz = negS; break;
+        case 1: dx = _mm_set1_ps(-1.0f); dy = negT; dz = sc; break;
+        case 2: dx = sc; dy = one; dz = T; break;
+        case 3: dx = sc; dy = _mm_set1_ps(-1.0f); dz = negT; break;
+        case 4: dx = sc; dy = negT; dz = one; break;
+        default: dx = negS; dy = negT; dz = _mm_set1_ps(-1.0f); break;
+        }
+        __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                                                      _mm_mul_ps(dz, dz))));
+        dx = _mm_mul_ps(dx, inverseLength);
+        dy = _mm_mul_ps(dy, inverseLength);
+        dz = _mm_mul_ps(dz, inverseLength);
+
+        // theta = acos(dy), phi = atan2(dz, dx), mapped like equirect_to_cubemap.frag
+        __m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(dy, dy)), _mm_setzero_ps()));
+        __m128 theta = Atan2x4(sinTheta, dy);
+        __m128 u = _mm_add_ps(_mm_mul_ps(Atan2x4(dz, dx), _mm_set1_ps(0.5f / PI)), _mm_set1_ps(0.5f));
+        u = _mm_sub_ps(u, Floor4(u));
+        __m128 v = _mm_sub_ps(one, _mm_mul_ps(theta, _mm_set1_ps(1.0f / PI)));
+
+        // taps: fx in [-0.5, width - 0.5) wraps around, fy in [-0.5, height - 0.5] clamps
+        __m128 fx = _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps(float(env.width))), _mm_set1_ps(0.5f));
+        __m128 fy = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(float(env.height))), _mm_set1_ps(0.5f));
+        __m128 fx0 = Floor4(fx), fy0 = Floor4(fy);
+        alignas(16) float tx[4], ty[4];
+        alignas(16) int32_t x0[4], x1[4], y0[4], y1[4];
+        _mm_store_ps(tx, _mm_sub_ps(fx, fx0));
+        _mm_store_ps(ty, _mm_sub_ps(fy, fy0));
+        const __m128i zero = _mm_setzero_si128(), width = _mm_set1_epi32(env.width), height = _mm_set1_epi32(env.height);
+        __m128i left = _mm_cvttps_epi32(fx0), bottom = _mm_cvttps_epi32(fy0);
+        __m128i right = _mm_add_epi32(left, _mm_set1_epi32(1)), top = _mm_add_epi32(bottom, _mm_set1_epi32(1));
+        _mm_store_si128((__m128i*)x0, _mm_add_epi32(left, _mm_and_si128(_mm_cmplt_epi32(left, zero), width)));
+        _mm_store_si128((__m128i*)x1, _mm_andnot_si128(_mm_cmpeq_epi32(right, width), right));
+        _mm_store_si128((__m128i*)y0, _mm_andnot_si128(_mm_cmplt_epi32(bottom, zero), bottom));
+        _mm_store_si128((__m128i*)y1, _mm_add_epi32(top, _mm_cmpeq_epi32(top, height)));
+        const float* texels = &env.texels[0].x;
+        for (int lane = 0; lane < 4; lane++) {
+            const float* a = texels + (size_t(y0[lane]) * env.width + x0[lane]) * 3;
+            const float* b = texels + (size_t(y0[lane]) * env.width + x1[lane]) * 3;
+            const float* c = texels + (size_t(y1[lane]) * env.width + x0[lane]) * 3;
+            const float* d = texels + (size_t(y1[lane]) * env.width + x1[lane]) * 3;
+            float wa = (1.0f - tx[lane]) * (1.0f - ty[lane]), wb = tx[lane] * (1.0f - ty[lane]);
+            float wc = (1.0f - tx[lane]) * ty[lane], wd = tx[lane] * ty[lane];
+            out[x + lane] = glm::vec3(wa * a[0] + wb * b[0] + wc * c[0] + wd * d[0],
+                                      wa * a[1] + wb * b[1] + wc * c[1] + wd * d[1],
+                                      wa * a[2] + wb * b[2] + wc * c[2] + wd * d[2]);
+        }
+    }
+#endif
+    for (; x < size; x++) out[x] = env.sample(CubemapTexelDirection(face, x, y, size));
+}
+
+void BuildEnvironmentCubemap(const EnvironmentImage& env, int size, CubemapImage& out) {
+    out.size = size;
+    out.levels = 1;
+    while ((size >> out.levels) > 0) out.levels++;
+    out.texels.resize(out.offset(out.levels - 1, 6)); // one past the last level
+    if (env.texels.empty()) return;
+
+    ParallelFor(6 * size_t(size), [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            int face = int(row / size), y = int(row % size);
+            ResampleRow(env, face, y, size, out.face(0, face) + size_t(y) * size);
+        }
+    }, 8);
+
+    // 2x2 box mips; an odd size clamps the second texel to the edge
+    for (int level = 1; level < out.levels; level++) {
+        int srcSize = out.levelSize(level - 1), dstSize = out.levelSize(level);
+        ParallelFor(6 * size_t(dstSize), [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++) {
+                int face = int(row / dstSize), y = int(row % dstSize);
+                const glm::vec3* src = out.face(level - 1, face);
+                const glm::vec3* top = src + size_t(std::min(2 * y, srcSize - 1)) * srcSize;
+                const glm::vec3* bottom = src + size_t(std::min(2 * y + 1, srcSize - 1)) * srcSize;
+                glm::vec3* dst = out.face(level, face) + size_t(y) * dstSize;
+                for (int x = 0; x < dstSize; x++) {
+                    int x0 = std::min(2 * x, srcSize - 1), x1 = std::min(2 * x + 1, srcSize - 1);
+                    dst[x] = 0.25f * (top[x0] + top[x1] + bottom[x0] + bottom[x1]);
+                }
+            }
+        }, 16);
+    }
+}
+
+// Source texels as structure of arrays, radiance pre-weighted by solid angle / pi, padded to 4
+struct IrradianceSource {
+    std::vector<float> x, y, z, r, g, b;
+};
+
+static glm::vec3 ConvolveDirection(const IrradianceSource& source, const glm::vec3& n) {
+    size_t count = source.x.size(), i = 0;
+    glm::vec3 irradiance(0.0f);
+#if IBL_CUBEMAP_SSE
+    const __m128 nx = _mm_set1_ps(n.x), ny = _mm_set1_ps(n.y), nz = _mm_set1_ps(n.z);
+    __m128 r = _mm_setzero_ps(), g = _mm_setzero_ps(), b = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(&source.x[i])),
+                                              _mm_mul_ps(ny, _mm_loadu_ps(&source.y[i]))),
+                                   _mm_mul_ps(nz, _mm_loadu_ps(&source.z[i])));
+        cosine = _mm_max_ps(cosine, _mm_setzero_ps());
+        r = _mm_add_ps(r, _mm_mul_ps(cosine, _mm_loadu_ps(&source.r[i])));
+        g = _mm_add_ps(g, _mm_mul_ps(cosine, _mm_loadu_ps(&source.g[i])));
+        b = _mm_add_ps(b, _mm_mul_ps(cosine, _mm_loadu_ps(&source.b[i])));
+    }
+    alignas(16) float lanes[3][4];
+    _mm_store_ps(lanes[0], r);
+    _mm_store_ps(lanes[1], g);
+    _mm_store_ps(lanes[2], b);
+    for (int c = 0; c < 3; c++) irradiance[c] = (lanes[c][0] + lanes[c][1]) + (lanes[c][2] + lanes[c][3]);
+#endif
+    for (; i < count; i++) {
+        float cosine = std::max(n.x * source.x[i] + n.y * source.y[i] + n.z * source.z[i], 0.0f);
+        irradiance += cosine * glm::vec3(source.r[i], source.g[i], source.b[i]);
+    }
+    return irradiance;
+}
+
+void BuildIrradianceCubemap(const EnvironmentImage& env, int size, CubemapImage& out) {
+    out.size = size;
+    out.levels = 1;
+    out.texels.assign(6 * size_t(size) * size, glm::vec3(0.0f));
+    if (env.texels.empty()) return;
+
+    EnvironmentImage coarse = env.downsampled(IRRADIANCE_SOURCE_WIDTH);
+    IrradianceSource source;
+    size_t count = (coarse.texels.size() + 3) & ~size_t(3);
+    for (std::vector<float>* channel : { &source.x, &source.y, &source.z, &source.r, &source.g, &source.b })
+        channel->assign(count, 0.0f);
+    for (int y = 0; y < coarse.height; y++) {
+        float weight = coarse.solidAngle(y) / PI;
+        for (int x = 0; x < coarse.width; x++) {
+            size_t i = size_t(y) * coarse.width + x;
+            glm::vec3 d = coarse.direction(x, y);
+            glm::vec3 radiance = coarse.texels[i] * weight;
+            source.x[i] = d.x; source.y[i] = d.y; source.z[i] = d.z;
+            source.r[i] = radiance.x; source.g[i] = radiance.y; source.b[i] = radiance.z;
+        }
+    }
+
+    ParallelFor(6 * size_t(size), [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            int face = int(row / size), y = int(row % size);
+            glm::vec3* dst = out.face(0, face) + size_t(y) * size;
+            for (int x = 0; x < size; x++) dst[x] = ConvolveDirection(source, CubemapTexelDirection(face, x, y, size));
+        }
+    }, 4);
+}
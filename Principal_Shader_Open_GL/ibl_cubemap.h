@@ -0,0 +1,33 @@
+#pragma once
+#include "ibl_utils.h"
+#include <algorithm>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// CPU cubemap bakes
+// ─────
+// The CPU backend of IBLBaker (ibl_baker.h). It makes the same maps as equirect_to_cubemap.comp and
+// irradiance.comp, on the thread pool with SSE. Use it on machines whose GL can't run the bake, such
+// as the no-GPU CI nodes and software rasterizers. Both backends resample and integrate the same way,
+// so they agree to within half float rounding (CompareIBLBackends in texture_utils.h checks this).
+static const int IRRADIANCE_MAP_SIZE = 32;
+static const int IRRADIANCE_SOURCE_WIDTH = 64; // env is box filtered to this before the cosine convolution
+
+// RGB float cubemap: every level from 0, each level's six faces (+X -X +Y -Y +Z -Z) back to back,
+// rows as glGetTexImage returns them
+struct CubemapImage {
+    int size = 0, levels = 0;
+    std::vector<glm::vec3> texels;
+
+    int levelSize(int level) const { return std::max(size >> level, 1); }
+    size_t offset(int level, int face) const;
+    glm::vec3* face(int level, int face) { return texels.data() + offset(level, face); }
+    const glm::vec3* face(int level, int face) const { return texels.data() + offset(level, face); }
+};
+
+// Level 0 bilinearly resampled from env (EnvironmentImage::sample at every texel center), then 2x2
+// box filtered down to 1x1 like glGenerateMipmap
+void BuildEnvironmentCubemap(const EnvironmentImage& env, int size, CubemapImage& out);
+// One level: env's cosine convolution divided by pi per texel, the quantity irradiance_convolution.frag
+// estimates, summed exactly over the texels of env box filtered to IRRADIANCE_SOURCE_WIDTH
+void BuildIrradianceCubemap(const EnvironmentImage& env, int size, CubemapImage& out);
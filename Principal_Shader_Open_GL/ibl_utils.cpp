@@ -0,0 +1,295 @@
+#include "ibl_utils.h"
+#include "image_decode.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IBL_SSE 1
+#endif
+
+static const float PI = 3.14159265358979f;
+
+// ─────────────────────────────────────────────
+// Equirectangular environment
+// ─────
+bool LoadEnvironmentImage(const std::string& path, EnvironmentImage& out) {
+    DecodedImage image;
+    if (!DecodeImageHDR(path, true, image)) return false;
+    const float* data = image.hdrPixels();
+    int channels = image.channels;
+    out.width = image.width;
+    out.height = image.height;
+    out.texels.resize(size_t(out.width) * out.height);
+    for (size_t i = 0; i < out.texels.size(); i++) {
+        const float* p = data + i * channels;
+        out.texels[i] = channels >= 3 ? glm::vec3(p[0], p[1], p[2]) : glm::vec3(p[0]);
+    }
+    return true;
+}
+
+glm::vec3 EnvironmentImage::sample(const glm::vec3& d) const {
+    if (texels.empty()) return glm::vec3(0.0f);
+    glm::vec3 dir = glm::normalize(d);
+    float theta = std::acos(glm::clamp(dir.y, -1.0f, 1.0f));
+    float phi = std::atan2(dir.z, dir.x);
+    float u = phi / (2.0f * PI) + 0.5f;
+    u -= std::floor(u);
+    float v = 1.0f - theta / PI;
+
+    float fx = u * width - 0.5f, fy = v * height - 0.5f;
+    int x0 = int(std::floor(fx)), y0 = int(std::floor(fy));
+    float tx = fx - x0, ty = fy - y0;
+    int x1 = (x0 + 1) % width;
+    x0 = (x0 + width) % width;
+    int y1 = std::min(std::max(y0 + 1, 0), height - 1);
+    y0 = std::min(std::max(y0, 0), height - 1);
+    const glm::vec3* row0 = &texels[size_t(y0) * width];
+    const glm::vec3* row1 = &texels[size_t(y1) * width];
+    return glm::mix(glm::mix(row0[x0], row0[x1], tx), glm::mix(row1[x0], row1[x1], tx), ty);
+}
+
+glm::vec3 EnvironmentImage::direction(int x, int y) const {
+    float theta = (1.0f - (y + 0.5f) / height) * PI;
+    float phi = ((x + 0.5f) / width - 0.5f) * 2.0f * PI;
+    return glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+}
+
+float EnvironmentImage::solidAngle(int y) const {
+    float theta = (1.0f - (y + 0.5f) / height) * PI;
+    return (2.0f * PI / width) * (PI / height) * std::sin(theta);
+}
+
+EnvironmentImage EnvironmentImage::downsampled(int maxWidth) const {
+    EnvironmentImage out = *this;
+    while (out.width > maxWidth && out.width % 2 == 0 && out.height % 2 == 0) {
+        EnvironmentImage half;
+        half.width = out.width / 2;
+        half.height = out.height / 2;
+        half.texels.resize(size_t(half.width) * half.height);
+        for (int y = 0; y < half.height; y++)
+            for (int x = 0; x < half.width; x++) {
+                const glm::vec3* top = &out.texels[size_t(2 * y) * out.width + 2 * x];
+                const glm::vec3* bottom = top + out.width;
+                half.texels[size_t(y) * half.width + x] = 0.25f * (top[0] + top[1] + bottom[0] + bottom[1]);
+            }
+        out = std::move(half);
+    }
+    return out;
+}
+
+glm::vec3 CubemapTexelDirection(int face, int x, int y, int size) {
+    // the major axis table of the GL spec (8.13, "Cube Map Texture Selection"), inverted
+    float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+    float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+    glm::vec3 d;
+    switch (face) {
+    case 0: d = glm::vec3(1.0f, -tc, -sc); break;
+    case 1: d = glm::vec3(-1.0f, -tc, sc); break;
+    case 2: d = glm::vec3(sc, 1.0f, tc); break;
+    case 3: d = glm::vec3(sc, -1.0f, -tc); break;
+    case 4: d = glm::vec3(sc, -tc, 1.0f); break;
+    default: d = glm::vec3(-sc, -tc, -1.0f); break;
+    }
+    return glm::normalize(d);
+}
+
+// ─────────────────────────────────────────────
+// GGX importance sampling (mirrors brdf_lut.frag / prefilter_environment.frag)
+// ─────
+static glm::vec2 Hammersley(uint32_t i, uint32_t count) {
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2(float(i) / float(count), float(bits) * 2.3283064365386963e-10f);
+}
+
+// half vector around +Z
+static glm::vec3 ImportanceSampleGGX(const glm::vec2& xi, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0f * PI * xi.x;
+    float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+    return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+glm::vec2 IntegrateBrdf(float NdotV, float roughness, int sampleCount) {
+    glm::vec3 V(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV); // N = +Z
+    float k = roughness * roughness / 2.0f; // Schlick-GGX k for IBL
+    float scale = 0.0f, bias = 0.0f;
+    for (int i = 0; i < sampleCount; i++) {
+        glm::vec3 H = ImportanceSampleGGX(Hammersley(uint32_t(i), uint32_t(sampleCount)), roughness);
+        glm::vec3 L = 2.0f * glm::dot(V, H) * H - V;
+        float NdotL = std::max(L.z, 0.0f);
+        if (NdotL <= 0.0f) continue;
+        float NdotH = std::max(H.z, 0.0f);
+        float VdotH = std::max(glm::dot(V, H), 0.0f);
+        float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+        float visibility = G * VdotH / (NdotH * NdotV);
+        float fresnel = std::pow(1.0f - VdotH, 5.0f);
+        scale += (1.0f - fresnel) * visibility;
+        bias += fresnel * visibility;
+    }
+    return glm::vec2(scale, bias) / float(sampleCount);
+}
+
+void BuildBrdfLut(int size, std::vector<glm::vec2>& out, int sampleCount) {
+    out.resize(size_t(size) * size);
+    ParallelFor(size_t(size), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+            for (int x = 0; x < size; x++)
+                out[y * size + x] = IntegrateBrdf((x + 0.5f) / size, (y + 0.5f) / size, sampleCount);
+    });
+}
+
+glm::vec3 PrefilterReference(const EnvironmentImage& env, const glm::vec3& direction, float roughness) {
+    glm::vec3 R = glm::normalize(direction);
+    if (roughness <= 0.0f || env.texels.empty()) return env.sample(R);
+    // the importance sampled estimator sum(L * NdotL) / sum(NdotL) with L drawn from pdf = D(H) / 4
+    // (N = V) converges to this integral of L * NdotL * D(H) over the sphere, normalized the same way
+    float a = roughness * roughness, a2 = a * a;
+    std::vector<glm::vec2> columns(env.width); // cos / sin of each column's phi
+    for (int x = 0; x < env.width; x++) {
+        float phi = ((x + 0.5f) / env.width - 0.5f) * 2.0f * PI;
+        columns[x] = glm::vec2(std::cos(phi), std::sin(phi));
+    }
+    glm::vec3 radiance(0.0f);
+    float weight = 0.0f;
+    for (int y = 0; y < env.height; y++) {
+        float solidAngle = env.solidAngle(y);
+        float theta = (1.0f - (y + 0.5f) / env.height) * PI;
+        float sinTheta = std::sin(theta), cosTheta = std::cos(theta);
+        const glm::vec3* row = &env.texels[size_t(y) * env.width];
+        for (int x = 0; x < env.width; x++) {
+            glm::vec3 L(sinTheta * columns[x].x, cosTheta, sinTheta * columns[x].y);
+            float NdotL = glm::dot(R, L);
+            if (NdotL <= 0.0f) continue;
+            float NdotH2 = (1.0f + NdotL) * 0.5f; // cos^2 of the half angle, H = normalize(R + L)
+            float denom = NdotH2 * (a2 - 1.0f) + 1.0f;
+            float w = a2 / (PI * denom * denom) * NdotL * solidAngle;
+            radiance += row[x] * w;
+            weight += w;
+        }
+    }
+    return weight > 0.0f ? radiance / weight : env.sample(R);
+}
+
+// ─────────────────────────────────────────────
+// Spherical harmonics irradiance
+// ─────
+// Real SH basis constants (band 0, 1, 1, 1, 2, 2, 2, 2, 2)
+static const float SH_Y00 = 0.282095f, SH_Y1 = 0.488603f, SH_Y2 = 1.092548f, SH_Y20 = 0.315392f, SH_Y22 = 0.546274f;
+// clamped cosine convolution per band, over pi: 1, 2/3, 1/4
+static const float SH_BAND_SCALE[SH_COEFFICIENT_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+                                                           0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+static void ShBasis(float x, float y, float z, float* out) {
+    out[0] = SH_Y00;
+    out[1] = SH_Y1 * y;
+    out[2] = SH_Y1 * z;
+    out[3] = SH_Y1 * x;
+    out[4] = SH_Y2 * x * y;
+    out[5] = SH_Y2 * y * z;
+    out[6] = SH_Y20 * (3.0f * z * z - 1.0f);
+    out[7] = SH_Y2 * x * z;
+    out[8] = SH_Y22 * (x * x - y * y);
+}
+
+glm::vec3 IrradianceSH::evaluate(const glm::vec3& normal) const {
+    float basis[SH_COEFFICIENT_COUNT];
+    ShBasis(normal.x, normal.y, normal.z, basis);
+    glm::vec3 irradiance(0.0f);
+    for (int k = 0; k < SH_COEFFICIENT_COUNT; k++) irradiance += coefficients[k] * basis[k];
+    return glm::max(irradiance, glm::vec3(0.0f));
+}
+
+// Adds one row's radiance * basis * solid angle to sums[coefficient * 3 + channel]
+static void ProjectRow(const glm::vec3* row, int width, float sinTheta, float cosTheta, float solidAngle,
+                       const float* cosPhi, const float* sinPhi, float* sums) {
+    int x = 0;
+#if IBL_SSE
+    __m128 acc[SH_COEFFICIENT_COUNT * 3];
+    for (__m128& a : acc) a = _mm_setzero_ps();
+    const __m128 st = _mm_set1_ps(sinTheta), w = _mm_set1_ps(solidAngle);
+    const __m128 Y = _mm_set1_ps(cosTheta);
+    for (; x + 4 <= width; x += 4) {
+        __m128 X = _mm_mul_ps(st, _mm_loadu_ps(cosPhi + x));
+        __m128 Z = _mm_mul_ps(st, _mm_loadu_ps(sinPhi + x));
+        __m128 basis[SH_COEFFICIENT_COUNT];
+        basis[0] = _mm_set1_ps(SH_Y00);
+        basis[1] = _mm_mul_ps(_mm_set1_ps(SH_Y1), Y);
+        basis[2] = _mm_mul_ps(_mm_set1_ps(SH_Y1), Z);
+        basis[3] = _mm_mul_ps(_mm_set1_ps(SH_Y1), X);
+        basis[4] = _mm_mul_ps(_mm_set1_ps(SH_Y2), _mm_mul_ps(X, Y));
+        basis[5] = _mm_mul_ps(_mm_set1_ps(SH_Y2), _mm_mul_ps(Y, Z));
+        basis[6] = _mm_mul_ps(_mm_set1_ps(SH_Y20), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(Z, Z)), _mm_set1_ps(1.0f)));
+        basis[7] = _mm_mul_ps(_mm_set1_ps(SH_Y2), _mm_mul_ps(X, Z));
+        basis[8] = _mm_mul_ps(_mm_set1_ps(SH_Y22), _mm_sub_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)));
+        // 4 RGB texels, AoS -> one register per channel, weighted by the row's solid angle
+        const float* p = &row[x].x;
+        __m128 channel[3] = { _mm_mul_ps(w, _mm_setr_ps(p[0], p[3], p[6], p[9])),
+                              _mm_mul_ps(w, _mm_setr_ps(p[1], p[4], p[7], p[10])),
+                              _mm_mul_ps(w, _mm_setr_ps(p[2], p[5], p[8], p[11])) };
+        for (int k = 0; k < SH_COEFFICIENT_COUNT; k++)
+            for (int c = 0; c < 3; c++)
+                acc[k * 3 + c] = _mm_add_ps(acc[k * 3 + c], _mm_mul_ps(basis[k], channel[c]));
+    }
+    for (int i = 0; i < SH_COEFFICIENT_COUNT * 3; i++) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc[i]);
+        sums[i] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+    for (; x < width; x++) {
+        float basis[SH_COEFFICIENT_COUNT];
+        ShBasis(sinTheta * cosPhi[x], cosTheta, sinTheta * sinPhi[x], basis);
+        glm::vec3 radiance = row[x] * solidAngle;
+        for (int k = 0; k < SH_COEFFICIENT_COUNT; k++)
+            for (int c = 0; c < 3; c++) sums[k * 3 + c] += basis[k] * radiance[c];
+    }
+}
+
+IrradianceSH ProjectIrradianceSH(const EnvironmentImage& env) {
+    IrradianceSH sh;
+    if (env.texels.empty()) return sh;
+    std::vector<float> cosPhi(env.width), sinPhi(env.width);
+    for (int x = 0; x < env.width; x++) {
+        float phi = ((x + 0.5f) / env.width - 0.5f) * 2.0f * PI;
+        cosPhi[x] = std::cos(phi);
+        sinPhi[x] = std::sin(phi);
+    }
+    // one set of float sums per row, added up in double: millions of texels would drown in float rounding
+    const int sumCount = SH_COEFFICIENT_COUNT * 3;
+    std::vector<float> rowSums(size_t(env.height) * sumCount, 0.0f);
+    ParallelFor(size_t(env.height), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            float theta = (1.0f - (y + 0.5f) / env.height) * PI;
+            ProjectRow(&env.texels[y * env.width], env.width, std::sin(theta), std::cos(theta), env.solidAngle(int(y)),
+                       cosPhi.data(), sinPhi.data(), &rowSums[y * sumCount]);
+        }
+    }, 16);
+    double totals[SH_COEFFICIENT_COUNT * 3] = {};
+    for (int y = 0; y < env.height; y++)
+        for (int i = 0; i < sumCount; i++) totals[i] += rowSums[size_t(y) * sumCount + i];
+    for (int k = 0; k < SH_COEFFICIENT_COUNT; k++)
+        sh.coefficients[k] = glm::vec3(float(totals[k * 3]), float(totals[k * 3 + 1]), float(totals[k * 3 + 2])) * SH_BAND_SCALE[k];
+    return sh;
+}
+
+glm::vec3 IrradianceReference(const EnvironmentImage& env, const glm::vec3& normal) {
+    glm::vec3 n = glm::normalize(normal);
+    glm::vec3 irradiance(0.0f);
+    for (int y = 0; y < env.height; y++) {
+        float solidAngle = env.solidAngle(y);
+        for (int x = 0; x < env.width; x++) {
+            float cosine = glm::dot(n, env.direction(x, y));
+            if (cosine > 0.0f) irradiance += env.texels[size_t(y) * env.width + x] * (cosine * solidAngle);
+        }
+    }
+    return irradiance / PI;
+}
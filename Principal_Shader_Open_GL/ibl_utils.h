@@ -0,0 +1,72 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Split-sum image based lighting
+// ─────
+// Specular IBL is split into two precomputed factors (Karis, "Real Shading in Unreal Engine 4"):
+//   prefiltered(R, roughness)  the environment convolved with the GGX lobe around R (assuming
+//                              N = V = R), one cubemap mip per roughness step
+//   brdf(NdotV, roughness)     the BRDF's integral as a scale and bias on F0, environment independent
+// so basic.frag pays two fetches per pixel: prefiltered * (F0 * brdf.x + brdf.y).
+// The GPU bakes them (IBLBaker::prefilter / brdfLut in ibl_baker.h); the functions here
+// are their CPU reference, used by ValidateIBL.
+static const int PREFILTER_SIZE = 256;      // face size of the prefiltered map's level 0
+static const int PREFILTER_MIP_LEVELS = 6;  // 256 .. 8; roughness = level / (levels - 1)
+static const int BRDF_LUT_SIZE = 512;
+static const int IBL_SAMPLE_COUNT = 1024;   // GGX importance samples per texel, GPU and CPU alike
+
+inline float PrefilterRoughness(int level, int levels = PREFILTER_MIP_LEVELS) {
+    return levels > 1 ? float(level) / float(levels - 1) : 0.0f;
+}
+
+// Equirectangular HDR (the same mapping as equirect_to_cubemap.frag), rows bottom first like
+// LoadHDRTexture's upload
+struct EnvironmentImage {
+    int width = 0, height = 0;
+    std::vector<glm::vec3> texels;
+
+    glm::vec3 sample(const glm::vec3& direction) const; // bilinear
+    glm::vec3 direction(int x, int y) const;            // through the texel center
+    float solidAngle(int y) const;                      // of one texel in row y
+    EnvironmentImage downsampled(int maxWidth) const;   // box filtered by powers of two
+};
+bool LoadEnvironmentImage(const std::string& path, EnvironmentImage& out);
+
+// Direction through texel (x, y) of a GL cubemap face (0..5 = +X -X +Y -Y +Z -Z), rows as glGetTexImage returns them
+glm::vec3 CubemapTexelDirection(int face, int x, int y, int size);
+
+// BRDF scale (x) and bias (y) on F0, by importance sampling like brdf_lut.frag
+glm::vec2 IntegrateBrdf(float NdotV, float roughness, int sampleCount = IBL_SAMPLE_COUNT);
+// size x size table, x = NdotV, y = roughness at texel centers, on the thread pool
+void BuildBrdfLut(int size, std::vector<glm::vec2>& out, int sampleCount = IBL_SAMPLE_COUNT);
+
+// The prefiltered radiance around R, integrated over every texel of env instead of sampled, so it
+// is free of the sampling noise and mip bias of prefilter_environment.frag. Cost is one pass over
+// env per direction: validate against a downsampled copy.
+glm::vec3 PrefilterReference(const EnvironmentImage& env, const glm::vec3& R, float roughness);
+
+// ─────────────────────────────────────────────
+// Diffuse irradiance as 9 spherical harmonics (L2)
+// ─────
+// Irradiance is the environment convolved with a clamped cosine, which all but removes everything
+// above band 2 (Ramamoorthi & Hanrahan, "An Efficient Representation for Irradiance Environment
+// Maps"): 9 RGB coefficients replace the 32x32 irradiance cubemap, and projecting the equirect
+// pixels LoadHDRTexture already decoded takes milliseconds instead of a 15,700 fetch per texel
+// convolution pass. basic.frag evaluates them per pixel (uIrradianceSH).
+static const int SH_COEFFICIENT_COUNT = 9;
+
+struct IrradianceSH {
+    // Y00, Y1-1, Y10, Y11, Y2-2, Y2-1, Y20, Y21, Y22, already convolved and divided by pi: the
+    // same quantity irradiance_convolution.frag stores, so diffuse = albedo * evaluate(N)
+    glm::vec3 coefficients[SH_COEFFICIENT_COUNT] = {};
+
+    glm::vec3 evaluate(const glm::vec3& normal) const;
+};
+
+// Every texel weighted by its solid angle, on the thread pool with SSE over 4 texels at a time
+IrradianceSH ProjectIrradianceSH(const EnvironmentImage& env);
+// Brute force cosine convolution over every texel of env, for validation
+glm::vec3 IrradianceReference(const EnvironmentImage& env, const glm::vec3& normal);
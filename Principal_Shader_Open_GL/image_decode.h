@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Image decoding backends
+// ─────
+// Every image the renderer reads (LoadTexture2D, LoadHDRTexture, the texture streamer, ORM
+// packing) goes through DecodeImage. The file is memory mapped and handed to the first backend
+// that recognizes its signature; stb_image is always last and takes everything.
+//   TurboJpegDecoder  libjpeg-turbo's SIMD (SSE2/AVX2/NEON) IDCT and color conversion, built
+//                     when CMake finds libturbojpeg (HAVE_TURBOJPEG)
+//   StbDecoder        stb_image: JPEG/PNG/TGA/BMP/HDR, SSE2 IDCT, one thread per image
+// Decoders are stateless and thread safe, so whole material sets decode concurrently
+// (DecodeImages) on the thread pool.
+
+// Decoded pixels, top row first unless flipped. Owns either 8-bit pixels or float (HDR) data.
+class DecodedImage {
+public:
+    DecodedImage() = default;
+    ~DecodedImage() { reset(); }
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+    DecodedImage(DecodedImage&& other) noexcept { *this = std::move(other); }
+    DecodedImage& operator=(DecodedImage&& other) noexcept;
+
+    // takes ownership; release frees data (stbi_image_free, tjFree, ...)
+    void assign(void* data, int width, int height, int channels, bool isFloat, void (*release)(void*));
+    void reset();
+
+    explicit operator bool() const { return data != nullptr; }
+    const uint8_t* pixels() const { return isFloat ? nullptr : static_cast<const uint8_t*>(data); }
+    const float* hdrPixels() const { return isFloat ? static_cast<const float*>(data) : nullptr; }
+    size_t byteSize() const { return size_t(width) * height * channels * (isFloat ? sizeof(float) : 1); }
+
+    int width = 0, height = 0, channels = 0;
+
+private:
+    void* data = nullptr;
+    bool isFloat = false;
+    void (*release)(void*) = nullptr;
+};
+
+class ImageDecoder {
+public:
+    virtual ~ImageDecoder() = default;
+    virtual const char* name() const = 0;
+    virtual bool canDecode(const uint8_t* data, size_t size) const = 0; // by file signature
+    // requiredChannels 0 = as stored (grayscale stays 1 channel); false with error set on failure
+    virtual bool decode(const uint8_t* data, size_t size, int requiredChannels, bool flipY, DecodedImage& out,
+                        std::string& error) const = 0;
+    // float pixels (Radiance .hdr); false when the backend has no HDR path
+    virtual bool decodeHDR(const uint8_t*, size_t, bool, DecodedImage&, std::string& error) const {
+        error = "no HDR support";
+        return false;
+    }
+};
+
+// Registered backends, fastest first; the last one is stb_image
+const std::vector<const ImageDecoder*>& ImageDecoders();
+const ImageDecoder& StbImageDecoder(); // the baseline, for benchmarks
+
+// Maps path and decodes it with the first backend that accepts it. Prints the error and returns
+// false on failure. Safe to call from any thread.
+bool DecodeImage(const std::string& path, int requiredChannels, bool flipY, DecodedImage& out);
+bool DecodeImageHDR(const std::string& path, bool flipY, DecodedImage& out);
+
+struct ImageDecodeRequest {
+    std::string path;
+    int requiredChannels = 0;
+    bool flipY = true;
+};
+// Decodes every request concurrently on the thread pool; failed and empty-path entries are left empty
+void DecodeImages(const std::vector<ImageDecodeRequest>& requests, std::vector<DecodedImage>& out);
@@ -0,0 +1,320 @@
+#include "image_write.h"
+#include "vertex_packing.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// ─────────────────────────────────────────────
+// Checksums
+// ─────
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool initialized = [] {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return true;
+    }();
+    (void)initialized;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t Adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        size_t block = std::min(size, size_t(5552)); // largest run before the sums can overflow
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+// ─────────────────────────────────────────────
+// Deflate (RFC 1951): greedy LZ77 over hash chains, one block of fixed Huffman codes
+// ─────
+// Fixed codes skip building and storing trees, which costs a little ratio but keeps the encoder
+// small and fast; filtered image rows are mostly short literals and long runs anyway.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+    void put(uint32_t value, int count) { // LSB first, as deflate packs everything but Huffman codes
+        bits |= uint64_t(value) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back(uint8_t(bits));
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+    void putCode(uint32_t code, int length) { // Huffman codes go MSB first
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        put(reversed, length);
+    }
+    void flush() {
+        if (bitCount > 0) out.push_back(uint8_t(bits));
+        bits = 0;
+        bitCount = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t bits = 0;
+    int bitCount = 0;
+};
+
+static void PutFixedSymbol(BitWriter& writer, int symbol) {
+    if (symbol < 144) writer.putCode(0x30 + symbol, 8);
+    else if (symbol < 256) writer.putCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) writer.putCode(symbol - 256, 7);
+    else writer.putCode(0xC0 + symbol - 280, 8);
+}
+
+static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                            513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static void PutMatch(BitWriter& writer, int length, int distance) {
+    int l = int(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, length) - LENGTH_BASE) - 1;
+    PutFixedSymbol(writer, 257 + l);
+    writer.put(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+    int d = int(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, distance) - DISTANCE_BASE) - 1;
+    writer.putCode(d, 5);
+    writer.put(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+}
+
+static void ZlibCompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    const int WINDOW = 32768, HASH_BITS = 15, MAX_CHAIN = 32, MIN_MATCH = 3, MAX_MATCH = 258;
+    out.push_back(0x78); // deflate, 32K window
+    out.push_back(0x01); // fastest compression level, header checksum
+    BitWriter writer(out);
+    writer.put(1, 1); // final block
+    writer.put(1, 2); // fixed Huffman codes
+
+    std::vector<int32_t> head(size_t(1) << HASH_BITS, -1), prev(WINDOW, -1);
+    auto hash = [&](size_t p) {
+        uint32_t v = data[p] | (data[p + 1] << 8) | (data[p + 2] << 16);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    };
+    auto insert = [&](size_t p) {
+        uint32_t h = hash(p);
+        prev[p & (WINDOW - 1)] = head[h];
+        head[h] = int32_t(p);
+    };
+
+    size_t pos = 0;
+    while (pos < size) {
+        int bestLength = 0, bestDistance = 0;
+        if (pos + MIN_MATCH <= size) {
+            int maxLength = int(std::min(size - pos, size_t(MAX_MATCH)));
+            int32_t candidate = head[hash(pos)];
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; chain++) {
+                size_t distance = pos - size_t(candidate);
+                if (distance > size_t(WINDOW)) break;
+                const uint8_t* a = data + candidate;
+                const uint8_t* b = data + pos;
+                if (a[bestLength] == b[bestLength]) { // can't beat the best without matching its last byte
+                    int length = 0;
+                    while (length < maxLength && a[length] == b[length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = int(distance);
+                        if (length == maxLength) break;
+                    }
+                }
+                int32_t next = prev[candidate & (WINDOW - 1)];
+                if (next >= candidate) break; // slot was reused by a newer position
+                candidate = next;
+            }
+            insert(pos);
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            PutMatch(writer, bestLength, bestDistance);
+            for (size_t p = pos + 1; p < pos + bestLength && p + MIN_MATCH <= size; p++) insert(p);
+            pos += bestLength;
+        } else {
+            PutFixedSymbol(writer, data[pos]);
+            pos++;
+        }
+    }
+    PutFixedSymbol(writer, 256); // end of block
+    writer.flush();
+
+    uint32_t adler = Adler32(data, size);
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(adler >> shift));
+}
+
+// ─────────────────────────────────────────────
+// PNG
+// ─────
+static void PutBigEndian32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(v >> shift));
+}
+
+static void PutChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t size) {
+    PutBigEndian32(out, uint32_t(size));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    PutBigEndian32(out, Crc32(out.data() + start, size + 4));
+}
+
+static uint8_t Paeth(int a, int b, int c) {
+    int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+void EncodePNG(int width, int height, int channels, const uint8_t* pixels, bool flipY, std::vector<uint8_t>& out) {
+    size_t rowBytes = size_t(width) * channels;
+
+    // every row gets the filter whose output has the smallest sum of |signed bytes|,
+    // the usual cheap stand-in for "compresses best"
+    std::vector<uint8_t> filtered(height * (rowBytes + 1));
+    std::vector<uint8_t> candidate(rowBytes);
+    std::vector<uint8_t> zeroRow(rowBytes, 0);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = pixels + size_t(flipY ? height - 1 - y : y) * rowBytes;
+        const uint8_t* above = y == 0 ? zeroRow.data() : pixels + size_t(flipY ? height - y : y - 1) * rowBytes;
+        uint8_t* dst = &filtered[y * (rowBytes + 1)];
+        uint64_t bestCost = UINT64_MAX;
+        for (int filter = 0; filter < 5; filter++) {
+            uint64_t cost = 0;
+            for (size_t i = 0; i < rowBytes; i++) {
+                int left = i >= size_t(channels) ? row[i - channels] : 0;
+                int upLeft = i >= size_t(channels) ? above[i - channels] : 0;
+                int predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? above[i]
+                              : filter == 3 ? (left + above[i]) / 2 : Paeth(left, above[i], upLeft);
+                candidate[i] = uint8_t(row[i] - predicted);
+                cost += std::abs(int(int8_t(candidate[i])));
+            }
+            if (cost < bestCost) {
+                bestCost = cost;
+                dst[0] = uint8_t(filter);
+                std::memcpy(dst + 1, candidate.data(), rowBytes);
+            }
+        }
+    }
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.assign(SIGNATURE, SIGNATURE + 8);
+    uint8_t header[13];
+    for (int i = 0; i < 4; i++) {
+        header[i] = uint8_t(uint32_t(width) >> (24 - 8 * i));
+        header[4 + i] = uint8_t(uint32_t(height) >> (24 - 8 * i));
+    }
+    header[8] = 8;                        // bits per channel
+    header[9] = channels == 4 ? 6 : 2;    // RGBA : RGB
+    header[10] = header[11] = header[12] = 0; // deflate, adaptive filtering, no interlace
+    PutChunk(out, "IHDR", header, sizeof(header));
+
+    std::vector<uint8_t> compressed;
+    compressed.reserve(filtered.size() / 2);
+    ZlibCompress(filtered.data(), filtered.size(), compressed);
+    PutChunk(out, "IDAT", compressed.data(), compressed.size());
+    PutChunk(out, "IEND", nullptr, 0);
+}
+
+// ─────────────────────────────────────────────
+// OpenEXR
+// ─────
+template <typename T>
+static void PutLittleEndian(std::vector<uint8_t>& out, T v) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &v, sizeof(T)); // every target we build for is little-endian
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void PutAttribute(std::vector<uint8_t>& out, const char* name, const char* type, const std::vector<uint8_t>& value) {
+    out.insert(out.end(), name, name + std::strlen(name) + 1);
+    out.insert(out.end(), type, type + std::strlen(type) + 1);
+    PutLittleEndian(out, int32_t(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void EncodeEXR(int width, int height, int channels, const float* pixels, bool flipY, std::vector<uint8_t>& out) {
+    // channels are stored in alphabetical order; source index of A/B/G/R in an RGB(A) pixel
+    const char* names[4] = { "A", "B", "G", "R" };
+    const int sources[4] = { 3, 2, 1, 0 };
+    int first = channels == 4 ? 0 : 1;
+
+    out.clear();
+    PutLittleEndian(out, uint32_t(20000630)); // magic
+    PutLittleEndian(out, uint32_t(2));        // version 2, single-part scanline
+
+    std::vector<uint8_t> value;
+    for (int c = first; c < 4; c++) {
+        value.insert(value.end(), names[c], names[c] + 2);
+        PutLittleEndian(value, int32_t(1)); // HALF
+        PutLittleEndian(value, uint32_t(0)); // pLinear + reserved
+        PutLittleEndian(value, int32_t(1)); // x sampling
+        PutLittleEndian(value, int32_t(1)); // y sampling
+    }
+    value.push_back(0);
+    PutAttribute(out, "channels", "chlist", value);
+    PutAttribute(out, "compression", "compression", { 0 }); // NO_COMPRESSION
+    value.clear();
+    for (int32_t v : { 0, 0, width - 1, height - 1 }) PutLittleEndian(value, v);
+    PutAttribute(out, "dataWindow", "box2i", value);
+    PutAttribute(out, "displayWindow", "box2i", value);
+    PutAttribute(out, "lineOrder", "lineOrder", { 0 }); // INCREASING_Y
+    value.clear();
+    PutLittleEndian(value, 1.0f);
+    PutAttribute(out, "pixelAspectRatio", "float", value);
+    PutAttribute(out, "screenWindowWidth", "float", value);
+    value.clear();
+    PutLittleEndian(value, 0.0f);
+    PutLittleEndian(value, 0.0f);
+    PutAttribute(out, "screenWindowCenter", "v2f", value);
+    out.push_back(0); // end of header
+
+    // offset table, then one block per scanline: y, byte count, then each channel's row
+    int storedChannels = 4 - first;
+    uint32_t blockBytes = uint32_t(width) * storedChannels * sizeof(uint16_t);
+    uint64_t offset = out.size() + uint64_t(height) * sizeof(uint64_t);
+    for (int y = 0; y < height; y++, offset += 8 + blockBytes) PutLittleEndian(out, offset);
+
+    for (int y = 0; y < height; y++) {
+        const float* row = pixels + size_t(flipY ? height - 1 - y : y) * width * channels;
+        PutLittleEndian(out, int32_t(y));
+        PutLittleEndian(out, blockBytes);
+        for (int c = first; c < 4; c++)
+            for (int x = 0; x < width; x++) PutLittleEndian(out, FloatToHalf(row[size_t(x) * channels + sources[c]]));
+    }
+}
+
+// ─────────────────────────────────────────────
+// Files
+// ─────
+static bool WriteBytes(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return bool(out);
+}
+
+bool WritePNG(const std::string& path, int width, int height, int channels, const uint8_t* pixels, bool flipY) {
+    std::vector<uint8_t> bytes;
+    EncodePNG(width, height, channels, pixels, flipY, bytes);
+    return WriteBytes(path, bytes);
+}
+
+bool WriteEXR(const std::string& path, int width, int height, int channels, const float* pixels, bool flipY) {
+    std::vector<uint8_t> bytes;
+    EncodeEXR(width, height, channels, pixels, flipY, bytes);
+    return WriteBytes(path, bytes);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Image writers for headless renders
+// ─────
+// PNG: 8-bit RGB/RGBA, per-row adaptive filters, zlib stream with LZ77 + fixed Huffman codes.
+// EXR: uncompressed scanline OpenEXR with half-float channels (linear HDR, no tone mapping).
+// Pixels are tightly packed rows, top row first; pass flipY for OpenGL readbacks (bottom row first).
+
+void EncodePNG(int width, int height, int channels, const uint8_t* pixels, bool flipY, std::vector<uint8_t>& out);
+void EncodeEXR(int width, int height, int channels, const float* pixels, bool flipY, std::vector<uint8_t>& out);
+
+bool WritePNG(const std::string& path, int width, int height, int channels, const uint8_t* pixels, bool flipY = false);
+bool WriteEXR(const std::string& path, int width, int height, int channels, const float* pixels, bool flipY = false);
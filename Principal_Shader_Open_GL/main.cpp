@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -28,6 +29,14 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 #include "texture_utils.h"
 #include "mesh_utils.h"
 #include "uniforms.h"
+#include "bench_utils.h"
+#include "headless.h"
+#include "thread_utils.h"
+#include "texture_streamer.h"
+#include "scene.h"
+#include "material_atlas.h"
+#include "scene_batch.h"
+#include "shader_permutations.h"
 
 // IMGUI
 #include "imgui.h"
@@ -44,27 +53,121 @@ const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
 // globals
-GLuint baseColorTextureID;
-GLuint normalMapTextureID;
-GLuint roughnessTextureID;
-GLuint metallicTextureID;
-GLuint hdrTextureID;
-GLuint aoTextureID;
-
-static void Reload2D(GLuint &tex, const std::string& path) {
-    if (tex) glDeleteTextures(1, &tex);
-    tex = LoadTexture2D(path);
+TextureHandle baseColorTexture;
+TextureHandle normalMapTexture;
+TextureHandle roughnessTexture = INVALID_TEXTURE_HANDLE;
+TextureHandle metallicTexture = INVALID_TEXTURE_HANDLE;
+std::string environmentPath = "textures/test.hdr"; // HDR the IBL maps come from
+TextureHandle aoTexture = INVALID_TEXTURE_HANDLE;
+TextureHandle ormTexture = INVALID_TEXTURE_HANDLE;
+OrmSources maskMaps; // AO / roughness / metallic paths, streamed packed or separately
+static void LoadMask(TextureStreamer& streamer, TextureHandle& handle, const std::string& path) {
+    if (handle == INVALID_TEXTURE_HANDLE) handle = streamer.load(path, TextureRole::Mask);
+    else streamer.load(handle, path, TextureRole::Mask);
 }
-static void ReloadHDR(GLuint &hdrTex, GLuint &envCubemap, GLuint &irradianceMap, const std::string& path) {
-    if (hdrTex) glDeleteTextures(1, &hdrTex);
-    hdrTex = LoadHDRTexture(path);
-    if (envCubemap) glDeleteTextures(1, &envCubemap);
-    envCubemap = EquirectToCubemap(hdrTex, 0, 0, 512);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-    if (irradianceMap) glDeleteTextures(1, &irradianceMap);
-    irradianceMap = ConvolveIrradiance(envCubemap);
+
+// Streams the mask maps as one ORM texture or as three separate ones, and frees the other set
+static void LoadMaskMaps(TextureStreamer& streamer, bool packed) {
+    if (packed) {
+        if (ormTexture == INVALID_TEXTURE_HANDLE) ormTexture = streamer.loadOrm(maskMaps);
+        else streamer.loadOrm(ormTexture, maskMaps);
+        streamer.release(roughnessTexture);
+        streamer.release(metallicTexture);
+        streamer.release(aoTexture);
+    } else {
+        LoadMask(streamer, roughnessTexture, maskMaps.roughness);
+        LoadMask(streamer, metallicTexture, maskMaps.metallic);
+        LoadMask(streamer, aoTexture, maskMaps.ao);
+        streamer.release(ormTexture);
+    }
+}
+
+// Swaps in another environment; one seen before comes from its <hdr>.ibl cache without any bake pass,
+// a new one only pays for the draws (baker's programs and framebuffer are long-lived)
+static bool ReloadHDR(IBLBaker &baker, IBLMaps &ibl, const std::string& path) {
+    IBLMaps loaded;
+    if (!LoadEnvironmentIBL(baker, path, loaded)) return false;
+    DeleteIBLMaps(ibl);
+    ibl = loaded;
+    environmentPath = path;
+    return true;
 }
 
+// ---- Instancing Stress Test ----
+// count copies of the mesh on a cube grid inside the mesh's own bounding sphere, so the view stays framed
+static void BuildInstanceGrid(const glm::vec3& boundsCenter, float boundsRadius, const glm::mat4& model, int count,
+                              std::vector<InstanceData>& instances) {
+    int side = 1;
+    while (side * side * side < count) side++;
+    float cell = 2.0f * boundsRadius / side;
+    // shrink each copy into its cell, around the bounds center
+    glm::mat4 shrink = glm::scale(glm::mat4(1.0f), glm::vec3(0.8f / side)) * glm::translate(glm::mat4(1.0f), -boundsCenter);
+    instances.resize(count);
+    ParallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int x = int(i) % side, y = int(i) / side % side, z = int(i) / (side * side);
+            glm::vec3 offset = boundsCenter + cell * (glm::vec3(x, y, z) - 0.5f * float(side - 1));
+            glm::mat4 local = shrink;
+            local[3] += glm::vec4(offset, 0.0f);
+            instances[i].model = model * local;
+            instances[i].materialIndex = unsigned(x * 3 + y * 5 + z * 7) % MAX_MATERIAL_TINTS;
+        }
+    }, 4096);
+}
+
+// ---- Shipped PBR Sets ----
+// appended to every scene as extra materials; the batched path spreads them over the instances
+struct ShippedMaterial {
+    const char* name;
+    const char* baseColor;
+    const char* normal;
+    const char* ao;
+    const char* roughness;
+    const char* metallic;
+};
+static const ShippedMaterial SHIPPED_MATERIALS[] = {
+    { "GoldPaint", "textures/gold metal/GoldPaint_BaseColor.jpg", "", "textures/gold metal/GoldPaint_AmbientOcclusion.jpg",
+      "textures/gold metal/GoldPaint_Roughness.jpg", "textures/gold metal/GoldPaint_Metallic.jpg" },
+    { "TilesCeramicWhite", "textures/white ceramic/Poliigon_TilesCeramicWhite_6956_BaseColor.jpg",
+      "textures/white ceramic/Poliigon_TilesCeramicWhite_6956_Normal.png",
+      "textures/white ceramic/Poliigon_TilesCeramicWhite_6956_AmbientOcclusion.jpg",
+      "textures/white ceramic/Poliigon_TilesCeramicWhite_6956_Roughness.jpg",
+      "textures/white ceramic/Poliigon_TilesCeramicWhite_6956_Metallic.jpg" },
+    { "RattanWeave", "textures/basket/Poliigon_RattanWeave_6945_BaseColor.jpg", "",
+      "textures/basket/Poliigon_RattanWeave_6945_AmbientOcclusion.jpg", "textures/basket/Poliigon_RattanWeave_6945_Roughness.jpg",
+      "textures/basket/Poliigon_RattanWeave_6945_Metallic.jpg" },
+    { "MetalGalvanizedSteelWorn001", "textures/MetalGalvanizedSteelWorn001/MetalGalvanizedSteelWorn001_COL_2K_METALNESS.jpg",
+      "textures/MetalGalvanizedSteelWorn001/MetalGalvanizedSteelWorn001_NRM_2K_METALNESS.jpg", "",
+      "textures/MetalGalvanizedSteelWorn001/MetalGalvanizedSteelWorn001_ROUGHNESS_2K_METALNESS.jpg",
+      "textures/MetalGalvanizedSteelWorn001/MetalGalvanizedSteelWorn001_METALNESS_2K_METALNESS.jpg" },
+};
+static const int SHIPPED_MATERIAL_COUNT = sizeof(SHIPPED_MATERIALS) / sizeof(SHIPPED_MATERIALS[0]);
+
+// Only the atlas reads these materials, so they carry source paths and no streamed textures
+static void AddShippedMaterials(Scene& scene) {
+    for (const ShippedMaterial& shipped : SHIPPED_MATERIALS) {
+        Material material;
+        material.name = shipped.name;
+        material.sources.baseColor = shipped.baseColor;
+        material.sources.normal = shipped.normal;
+        material.sources.orm.ao = shipped.ao;
+        material.sources.orm.roughness = shipped.roughness;
+        material.sources.orm.metallic = shipped.metallic;
+        MaterialBlock& params = material.params;
+        params.useBaseTex = 1;
+        params.useNormalTex = shipped.normal[0] ? 1 : 0;
+        params.useAOMap = shipped.ao[0] ? 1 : 0;
+        params.useRoughnessMap = shipped.roughness[0] ? 1 : 0;
+        params.useMetallicMap = shipped.metallic[0] ? 1 : 0;
+        scene.materials.push_back(material);
+    }
+}
+
+static const int STRESS_INSTANCE_COUNTS[] = { 1, 1000, 10000, 100000 };
+static const int STRESS_LEVELS = 4;
+static const int REPORT_WARMUP_FRAMES = 30;  // let orphaned buffers and the driver settle after a count change
+static const int REPORT_FRAMES = 120;
+
 // ---- Mouse Controls ----
 float pitch = 0.0f;
 float yaw = 0.0f;
@@ -98,7 +201,14 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
 
 // ─────────────────────────────────────────────
 // Main
-int main() {
+int main(int argc, char** argv) {
+    // --bench <name>: run a headless benchmark and exit
+    if (argc >= 3 && std::string(argv[1]) == "--bench")
+        return RunBenchmark(argv[2]);
+    // --headless <jobs.txt> [--size WxH]: render material previews offscreen and exit
+    if (argc >= 3 && std::string(argv[1]) == "--headless")
+        return RunHeadless(argc, argv);
+
     std::cout << "OpenGL PBR Project Starting..." << std::endl;
     std::cout << "Working directory: " << std::filesystem::current_path() << std::endl;
 
@@ -151,57 +261,101 @@ int main() {
     ImGui::StyleColorsDark();
 
     // ----- Compile and Link Shaders ------
-    std::string vertexSource = ReadTextFile("shaders/basic.vert");
-    std::string fragSource = ReadTextFile("shaders/basic.frag");
-
-    std::cout << "Vertex shader source length: " << vertexSource.length() << std::endl;
-    std::cout << "Fragment shader source length: " << fragSource.length() << std::endl;
-
-    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
-    GLuint frag_shader = CompileShader(GL_FRAGMENT_SHADER, fragSource.c_str());
-    GLuint shader_program = LinkProgram(vertex_shader, frag_shader);
-
-    // Check shader program status
-    GLint success;
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shader_program, 512, NULL, infoLog);
-        std::cout << "SHADER LINKING FAILED: " << infoLog << std::endl;
-    } else {
+    // basic.frag compiles per feature set on first use (the UI checkboxes and each material pick one);
+    // the uber shader, which branches on every flag at run time, stays available for comparison
+    ShaderPermutations permutations;
+    if (!permutations.init("shaders/basic.vert", "shaders/basic.frag"))
+        std::cout << "SHADER COMPILATION FAILED: basic.vert / basic.frag" << std::endl;
+    else if (permutations.get(UBER_VARIANT).program == 0)
+        std::cout << "SHADER LINKING FAILED: uber shader" << std::endl;
+    else
         std::cout << "Main shader program linked successfully!" << std::endl;
-    }
+    static bool useShaderPermutations = true;
+    uint32_t drawnFeatures = UBER_VARIANT; // variant of the first submesh last frame
 
-    // set up object geometry
-    Mesh currentMesh;
+    // set up object geometry: every submesh of the loaded OBJ (or the cube), drawn through a sorted draw list
+    Scene scene;
     bool usingCustomMesh = false;
+    std::string currentMeshPath;
+    static bool usePackedVertices = false;
+    static float lodPixelError = 1.0f;
+    int drawnLod = 0;
+    // meshlet culling; cone (backface) culling is opt-in since GL_CULL_FACE is off and models may be open
+    static bool useMeshletCulling = true;
+    static bool useConeCulling = false;
+    std::vector<MeshletDrawList> meshletDrawLists; // per submesh
+    MeshletCullStats cullStats;
+    size_t drawnTriangles = 0;
+    DrawList drawList;
+    DrawListStats drawStats;
+    RenderStateTracker renderState; // carries across frames, invalidated where something binds or deletes behind it
+    size_t seenEvictions = 0;       // streamer evictions the tracker has been invalidated for
+    // batched path: every material in the atlas, every submesh in one buffer, one draw (builds on first use)
+    static bool useSceneBatch = false;
+    static bool spreadShippedMaterials = true; // instances of the stress grid cycle through the shipped sets
+    MaterialAtlas atlas;
+    SceneBatch sceneBatch;
+    bool atlasDirty = true, batchDirty = true;
+    std::vector<InstanceData> batchInstances;
+    // instancing stress test (level 0 = the single object) and its frame-time report
+    static int stressLevel = 0;
+    std::vector<InstanceData> instances;
+    int reportLevel = 0; // level being measured, 0 = no report running
+    int reportFrame = 0;
+    double reportCpuMs = 0.0, reportGpuMs = 0.0;
+    int reportGpuSamples = 0;
+    double reportResults[STRESS_LEVELS][2] = {}; // [level] = { CPU frame ms, GPU draw ms }
+    float frameMs = 0.0f, gpuDrawMs = 0.0f;
+    int uniformUploads = 0; // uniform block uploads last frame
+    double lastFrameTime = 0.0;
+    auto vertexFormat = [&] { return usePackedVertices ? VertexFormat::Packed : VertexFormat::Full; };
     if (std::filesystem::exists("model.obj")) {
-        currentMesh = loadObjModel("model.obj");
+        currentMeshPath = "model.obj";
         usingCustomMesh = true;
-    } else {
-        currentMesh = createCube();
     }
     // ---- Load Textures -----
-    baseColorTextureID = LoadTexture2D("textures/GoldPaint_BaseColor.jpg");
-    normalMapTextureID = LoadTexture2D("textures/GoldPaint_Normal.png");
-    roughnessTextureID = LoadTexture2D("textures/GoldPaint_Roughness.jpg");
-    metallicTextureID = LoadTexture2D("textures/GoldPaint_Metallic.jpg");
-    aoTextureID = LoadTexture2D("textures/GoldPaint_AmbientOcclusion.jpg");
-    
-    std::cout << "Texture IDs - Base: " << baseColorTextureID 
-              << ", Normal: " << normalMapTextureID 
-              << ", Roughness: " << roughnessTextureID
-              << ", Metallic: " << metallicTextureID
-              << ", AO: " << aoTextureID << std::endl;
-    
-    hdrTextureID = LoadHDRTexture("textures/test.hdr");
-    std::cout << "HDR texture ID: " << hdrTextureID << std::endl;
+    // PBR maps decode on worker threads and upload a slice per frame, so picking a 4K map never stalls.
+    // Each role gets its block format (BC1 / BC5 / BC4), cached as <map>.dds after the first load.
+    TextureStreamer streamer;
+    streamer.init();
+    baseColorTexture = streamer.load("textures/GoldPaint_BaseColor.jpg", TextureRole::BaseColor);
+    normalMapTexture = streamer.load("textures/GoldPaint_Normal.png", TextureRole::Normal);
+    // AO / roughness / metallic stay three BC4 masks by default; packed into one ORM texture (R/G/B) they
+    // take one fetch instead of three, but as uncompressed RGB8 about 2.7x the memory (texture_orm.h)
+    static bool packOrm = false;
+    maskMaps.ao = "textures/GoldPaint_AmbientOcclusion.jpg";
+    maskMaps.roughness = "textures/GoldPaint_Roughness.jpg";
+    maskMaps.metallic = "textures/GoldPaint_Metallic.jpg";
+    LoadMaskMaps(streamer, packOrm);
+
+    // the default material's files, for the atlas
+    scene.materials[0].sources.baseColor = "textures/GoldPaint_BaseColor.jpg";
+    scene.materials[0].sources.normal = "textures/GoldPaint_Normal.png";
+    scene.materials[0].sources.orm = maskMaps;
+
+    // the OBJ's .mtl maps stream like the ones above
+    auto loadScene = [&] {
+        if (usingCustomMesh) {
+            LoadObjScene(currentMeshPath, vertexFormat(), streamer, scene);
+        } else {
+            scene.clear(streamer);
+            scene.add(createCube(vertexFormat()), 0, "cube");
+        }
+        AddShippedMaterials(scene);
+        atlasDirty = batchDirty = true;
+        renderState.invalidate(); // createMesh bound VAOs, the old ones are gone
+    };
+    loadScene();
     
-    GLuint envCubemap = EquirectToCubemap(hdrTextureID, 0, 0, 512);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-    GLuint irradianceMap = ConvolveIrradiance(envCubemap);
+    // environment cubemap, GGX prefiltered cubemap and diffuse SH: baked once per HDR, then read from <hdr>.ibl
+    IBLBaker iblBaker;
+    iblBaker.init();
+    IBLMaps ibl;
+    LoadEnvironmentIBL(iblBaker, environmentPath, ibl);
+    // split-sum specular: the BRDF LUT depends on no environment, one for the whole run
+    GLuint brdfLut = iblBaker.brdfLut();
     
-    std::cout << "Environment cubemap ID: " << envCubemap << ", Irradiance map ID: " << irradianceMap << std::endl;
+    std::cout << "Environment cubemap ID: " << ibl.environment << ", Prefiltered map ID: " << ibl.prefiltered << std::endl;
 
     // ----- Compile Skybox Shaders -----
     std::string sbVS = ReadTextFile("shaders/skybox.vert");
@@ -210,6 +364,7 @@ int main() {
     GLuint sbF = CompileShader(GL_FRAGMENT_SHADER, sbFS.c_str());
     GLuint sbProg = LinkProgram(sbV, sbF);
     
+    GLint success;
     glGetProgramiv(sbProg, GL_LINK_STATUS, &success);
     if (!success) {
         char infoLog[512];
@@ -224,10 +379,17 @@ int main() {
     GLint sbView = glGetUniformLocation(sbProg, "view");
     GLint sbProj = glGetUniformLocation(sbProg, "projection");
 
-    // ----- Get Uniform Locations -----
-    LightingUniforms lightUniforms = getLightingUniforms(shader_program);
-    MaterialUniforms matUniforms = getMaterialUniforms(shader_program);
-    VertexUniforms vertUniforms = getVertexUniforms(shader_program);
+    // ----- Uniform Blocks -----
+    // frame, lights and material state live in three uniform buffers bound once here; the render loop
+    // copies the UI state into them and re-uploads only the blocks that changed. Each shader variant
+    // points its blocks and samplers at them when it is compiled.
+    UniformBlock<FrameBlock> frameBlock;
+    UniformBlock<LightsBlock> lightsBlock;
+    UniformBlock<MaterialBlock> materialBlock;
+    frameBlock.init(FRAME_BLOCK_BINDING);
+    lightsBlock.init(LIGHTS_BLOCK_BINDING);
+    materialBlock.init(MATERIAL_BLOCK_BINDING);
+    atlas.init();
 
     // ----- ImGui Control Variables -----
     static float roughness = 0.8f;
@@ -246,29 +408,14 @@ int main() {
     static int currentToneMapping = 0;
 
     // ----- Set Initial Uniform Values -----
-    glUseProgram(shader_program);
-    
-    glUniform1i(matUniforms.uUseBaseTex, useBaseColorTex ? 1 : 0);
-    glUniform1i(matUniforms.uBaseTex, 0);
-    glUniform3f(matUniforms.uBaseTint, baseTintColor[0], baseTintColor[1], baseTintColor[2]);
-    glUniform1f(matUniforms.uRoughness, roughness);  
-    glUniform1f(matUniforms.uMetallic, metallic);
-    glUniform3f(matUniforms.uDielectricF0, 0.04f, 0.04f, 0.04f);
-    glUniform1i(matUniforms.uNormalTex, 1);
-    glUniform1i(matUniforms.uUseNormalTex, useNormalMap ? 1 : 0);
-    glUniform1i(matUniforms.uRoughnessMap, 2);
-    glUniform1i(matUniforms.uUseRoughnessMap, useRoughnessMap ? 1 : 0);
-    glUniform1i(matUniforms.uMetallicMap, 3);
-    glUniform1i(matUniforms.uUseMetallicMap, useMetallicMap ? 1 : 0);
-    glUniform1i(matUniforms.uAOMap, 4);
-    glUniform1i(matUniforms.uUseAOMap, useAOMap ? 1 : 0);
-
-    glUniform1i(lightUniforms.uLightType, 0);
-    glUniform3f(lightUniforms.uLightColor, lightColor[0] * lightIntensity, lightColor[1] * lightIntensity, lightColor[2] * lightIntensity);
-    glUniform3f(lightUniforms.uAmbient, 0.1f, 0.1f, 0.1f);
-    glUniform1f(lightUniforms.uSpotCosInner, cosf(glm::radians(15.0f)));
-    glUniform1f(lightUniforms.uSpotCosOuter, cosf(glm::radians(25.0f)));
-    glUniform3f(lightUniforms.uCamPos, 0.0f, 0.0f, 5.0f);
+    scene.materials[0].name = "default";
+    scene.materials[0].params.dielectricF0 = glm::vec3(0.04f, 0.04f, 0.04f);
+    lightsBlock.data.type = 0;
+    lightsBlock.data.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+    lightsBlock.data.spotCosInner = cosf(glm::radians(15.0f));
+    lightsBlock.data.spotCosOuter = cosf(glm::radians(25.0f));
+    lightsBlock.data.prefilterMaxLod = float(PREFILTER_MIP_LEVELS - 1);
+    lightsBlock.data.setIrradiance(ibl.irradiance);
 
     // Set projection matrix
     glm::mat4 projection = glm::perspective(
@@ -277,18 +424,71 @@ int main() {
         0.1f,
         100.0f
     );
-    glUniformMatrix4fv(vertUniforms.projectionMatrix, 1, GL_FALSE, glm::value_ptr(projection));
+    frameBlock.data.projection = projection;
 
     // ----- Render Settings -----
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
+    // per-instance tints for the stress test; instance 0 (the single object) stays untinted
+    const glm::vec3 materialTints[MAX_MATERIAL_TINTS] = {
+        { 1.0f, 1.0f, 1.0f }, { 0.9f, 0.3f, 0.3f }, { 0.3f, 0.8f, 0.3f }, { 0.3f, 0.4f, 0.9f },
+        { 0.9f, 0.8f, 0.3f }, { 0.8f, 0.4f, 0.9f }, { 0.3f, 0.8f, 0.8f }, { 0.6f, 0.6f, 0.6f },
+    };
+    for (int i = 0; i < MAX_MATERIAL_TINTS; i++) scene.instanceTints[i] = glm::vec4(materialTints[i], 0.0f);
+
+    // GPU time of the object draw, read back a frame later so the CPU never waits on it
+    GLuint gpuTimer;
+    glGenQueries(1, &gpuTimer);
+    bool gpuTimerPending = false;
+
     std::cout << "Starting render loop..." << std::endl;
+    lastFrameTime = glfwGetTime();
 
     // ===== MAIN RENDER LOOP =====
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        streamer.update();
+
+        // ----- Frame Timing -----
+        double now = glfwGetTime();
+        float lastFrameMs = float((now - lastFrameTime) * 1000.0);
+        lastFrameTime = now;
+        frameMs += (lastFrameMs - frameMs) * 0.1f;
+        float lastGpuMs = -1.0f;
+        if (gpuTimerPending) {
+            GLint ready = 0;
+            glGetQueryObjectiv(gpuTimer, GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (ready) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(gpuTimer, GL_QUERY_RESULT, &ns);
+                lastGpuMs = float(ns / 1.0e6);
+                gpuDrawMs += (lastGpuMs - gpuDrawMs) * 0.1f;
+                gpuTimerPending = false;
+            }
+        }
+        if (reportLevel > 0 && ++reportFrame > REPORT_WARMUP_FRAMES) {
+            reportCpuMs += lastFrameMs;
+            if (lastGpuMs >= 0.0f) {
+                reportGpuMs += lastGpuMs;
+                reportGpuSamples++;
+            }
+            if (reportFrame == REPORT_WARMUP_FRAMES + REPORT_FRAMES) {
+                reportResults[reportLevel][0] = reportCpuMs / REPORT_FRAMES;
+                reportResults[reportLevel][1] = reportGpuSamples ? reportGpuMs / reportGpuSamples : 0.0;
+                reportFrame = reportGpuSamples = 0;
+                reportCpuMs = reportGpuMs = 0.0;
+                if (++reportLevel == STRESS_LEVELS) {
+                    reportLevel = 0;
+                    glfwSwapInterval(1);
+                    std::cout << "Instancing frame times (" << scene.triangleCount() << " tris per instance):" << std::endl;
+                    for (int i = 1; i < STRESS_LEVELS; i++)
+                        std::cout << "  " << STRESS_INSTANCE_COUNTS[i] << " instances: " << reportResults[i][0]
+                                  << " ms/frame CPU, " << reportResults[i][1] << " ms GPU draw" << std::endl;
+                }
+            }
+        }
 
         // ----- Start ImGui Frame -----
         ImGui_ImplOpenGL3_NewFrame();
@@ -316,16 +516,78 @@ int main() {
         }
         if (ImGuiFileDialog::Instance()->Display("ChooseObj")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
-                std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                currentMesh = loadObjModel(path);
+                currentMeshPath = ImGuiFileDialog::Instance()->GetFilePathName();
                 usingCustomMesh = true;
+                loadScene();
             }
             ImGuiFileDialog::Instance()->Close();
         }
+        if (ImGui::Checkbox("Packed Vertices (20 B)", &usePackedVertices)) loadScene();
+        ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.25f, 8.0f);
+        const Mesh& firstMesh = scene.submeshes[0].mesh;
+        drawnLod = std::min(drawnLod, (int)firstMesh.lods.size() - 1); // last frame's level, mesh may have changed
+        ImGui::Text("LOD %d / %d (%zu tris)", drawnLod, (int)firstMesh.lods.size() - 1, drawnTriangles);
+        ImGui::Checkbox("Meshlet Culling", &useMeshletCulling);
+        ImGui::SameLine();
+        ImGui::Checkbox("Cone Culling", &useConeCulling);
+        if (useMeshletCulling)
+            ImGui::Text("Meshlets culled: %zu / %zu (%zu tris)", cullStats.meshletsCulled, cullStats.meshletsTested,
+                        cullStats.trianglesCulled);
+        const RenderStateStats& bindStats = renderState.stats();
+        ImGui::Text("Scene: %zu submeshes, %zu materials", scene.submeshes.size(), scene.materials.size());
+        ImGui::Text("Draws %zu, material switches %zu", drawStats.draws, drawStats.materialSwitches);
+        ImGui::Text("Binds: %zu issued, %zu avoided (program %zu, VAO %zu, texture %zu)", bindStats.issued(),
+                    bindStats.skipped(), bindStats.programBindsSkipped, bindStats.vertexArrayBindsSkipped,
+                    bindStats.textureBindsSkipped);
+        ImGui::Checkbox("Batch All Materials (atlas + one draw)", &useSceneBatch);
+        if (useSceneBatch) {
+            ImGui::Checkbox("Shipped PBR sets across instances", &spreadShippedMaterials);
+            const MaterialAtlasStats& atlasStats = atlas.stats();
+            if (sceneBatch.built())
+                ImGui::Text("%zu commands via %s", sceneBatch.commandCount(),
+                            sceneBatch.indirect() ? "glMultiDrawElementsIndirect" : "base-vertex draws (no GL 4.3)");
+            else
+                ImGui::Text("Batching needs full vertices: drawing per material");
+            if (atlas.building())
+                ImGui::Text("Atlas: building, drawing per material until it is uploaded");
+            else
+                ImGui::Text("Atlas: %d materials, %d/%d/%d layers (%d/%d/%d px), %.1f MB, %.0f ms", atlas.materialCount(),
+                            atlasStats.layers[0], atlasStats.layers[1], atlasStats.layers[2], atlasStats.layerSize[0],
+                            atlasStats.layerSize[1], atlasStats.layerSize[2], atlasStats.bytes / (1024.0 * 1024.0),
+                            atlasStats.buildMs);
+        }
+        ImGui::Separator();
+
+        ImGui::Text("Instancing Stress Test");
+        const char* stressLabels[STRESS_LEVELS] = { "1", "1k", "10k", "100k" };
+        for (int i = 0; i < STRESS_LEVELS; i++) {
+            if (i > 0) ImGui::SameLine();
+            ImGui::RadioButton(stressLabels[i], &stressLevel, i);
+        }
+        ImGui::Text("Frame %.2f ms, GPU draw %.2f ms", frameMs, gpuDrawMs);
+        ImGui::Text("Uniform block uploads: %d", uniformUploads);
+        if (reportLevel > 0) {
+            ImGui::Text("Measuring %d instances...", STRESS_INSTANCE_COUNTS[reportLevel]);
+        } else if (ImGui::Button("Frame-Time Report (1k / 10k / 100k)")) {
+            reportLevel = 1;
+            reportFrame = 0;
+            glfwSwapInterval(0); // vsync would cap every result at the refresh rate
+        }
+        for (int i = 1; i < STRESS_LEVELS; i++)
+            if (reportResults[i][0] > 0.0)
+                ImGui::Text("  %6d: %.2f ms CPU, %.2f ms GPU", STRESS_INSTANCE_COUNTS[i], reportResults[i][0], reportResults[i][1]);
         ImGui::Separator();
 
         ImGui::Separator();
         ImGui::Text("Load Texture Maps");
+        TextureStreamStats streamStats = streamer.stats();
+        ImGui::Text("Streaming: %zu decoding, %zu uploading, %.2f MB/frame", streamStats.decodesQueued,
+                    streamStats.uploadsQueued, streamStats.uploadMBPerFrame);
+        ImGui::Text("Texture memory: %.1f MB (%.1f MB cached, %zu cache hits)", streamStats.residentBytes / (1024.0 * 1024.0),
+                    streamStats.cachedBytes / (1024.0 * 1024.0), streamStats.cacheHits);
+        int cacheBudgetMB = int(streamer.getCacheBudget() >> 20);
+        if (ImGui::SliderInt("Texture cache (MB)", &cacheBudgetMB, 0, 2048))
+            streamer.setCacheBudget(size_t(cacheBudgetMB) << 20);
         // --- File pickers ---
         if (ImGui::Button("Load Base Color")) {
             FileDialogConfig cfg; 
@@ -365,132 +627,162 @@ int main() {
                 "Image files{.png,.jpg,.jpeg,.bmp,.tga}", cfg);
         }
 
+        if (ImGui::Button("Load Environment HDR")) {
+            FileDialogConfig cfg; cfg.path = "."; cfg.countSelectionMax = 1; cfg.flags = ImGuiFileDialogFlags_Modal;
+            ImGuiFileDialog::Instance()->OpenDialog(
+                "PickHDR", "Choose Environment",
+                "HDR files{.hdr}", cfg);
+        }
+
         // --- Handle results ---
         if (ImGuiFileDialog::Instance()->Display("PickBase")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
                 std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                Reload2D(baseColorTextureID, path);
+                streamer.load(baseColorTexture, path, TextureRole::BaseColor);
+                scene.materials[0].sources.baseColor = path;
+                atlasDirty = true;
             }
             ImGuiFileDialog::Instance()->Close();
         }
         if (ImGuiFileDialog::Instance()->Display("PickNormal")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
                 std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                Reload2D(normalMapTextureID, path);
+                streamer.load(normalMapTexture, path, TextureRole::Normal);
+                scene.materials[0].sources.normal = path;
+                atlasDirty = true;
             }
             ImGuiFileDialog::Instance()->Close();
         }
         if (ImGuiFileDialog::Instance()->Display("PickRough")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
-                std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                Reload2D(roughnessTextureID, path);
+                maskMaps.roughness = ImGuiFileDialog::Instance()->GetFilePathName();
+                if (packOrm) streamer.loadOrm(ormTexture, maskMaps);
+                else LoadMask(streamer, roughnessTexture, maskMaps.roughness);
+                scene.materials[0].sources.orm = maskMaps;
+                atlasDirty = true;
             }
             ImGuiFileDialog::Instance()->Close();
         }
         if (ImGuiFileDialog::Instance()->Display("PickMetallic")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
-                std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                Reload2D(metallicTextureID, path);
+                maskMaps.metallic = ImGuiFileDialog::Instance()->GetFilePathName();
+                if (packOrm) streamer.loadOrm(ormTexture, maskMaps);
+                else LoadMask(streamer, metallicTexture, maskMaps.metallic);
+                scene.materials[0].sources.orm = maskMaps;
+                atlasDirty = true;
             }
             ImGuiFileDialog::Instance()->Close();
         }
 
         if (ImGuiFileDialog::Instance()->Display("PickAO")) {
             if (ImGuiFileDialog::Instance()->IsOk()) {
-                std::string path = ImGuiFileDialog::Instance()->GetFilePathName();
-                Reload2D(aoTextureID, path);
+                maskMaps.ao = ImGuiFileDialog::Instance()->GetFilePathName();
+                if (packOrm) streamer.loadOrm(ormTexture, maskMaps);
+                else LoadMask(streamer, aoTexture, maskMaps.ao);
+                scene.materials[0].sources.orm = maskMaps;
+                atlasDirty = true;
             }
             ImGuiFileDialog::Instance()->Close();
         }
 
-        ImGui::Separator();
-        if (ImGui::Checkbox("Use Base Color Texture", &useBaseColorTex)) {
-            glUseProgram(shader_program);
-            glUniform1i(matUniforms.uUseBaseTex, useBaseColorTex ? 1 : 0);
+        if (ImGuiFileDialog::Instance()->Display("PickHDR")) {
+            if (ImGuiFileDialog::Instance()->IsOk()) {
+                if (ReloadHDR(iblBaker, ibl, ImGuiFileDialog::Instance()->GetFilePathName()))
+                    lightsBlock.data.setIrradiance(ibl.irradiance);
+                renderState.invalidate(); // the load or bake bound its own programs and textures
+            }
+            ImGuiFileDialog::Instance()->Close();
         }
-        if (ImGui::Checkbox("Use Normal Map", &useNormalMap)) {
-            glUseProgram(shader_program);
-            glUniform1i(matUniforms.uUseNormalTex, useNormalMap ? 1 : 0);
+
+        ImGui::Separator();
+        ImGui::Checkbox("Use Base Color Texture", &useBaseColorTex);
+        ImGui::Checkbox("Use Normal Map", &useNormalMap);
+        ImGui::Checkbox("Use Roughness Map", &useRoughnessMap);
+        ImGui::Checkbox("Use Metallic Map", &useMetallicMap);
+        ImGui::Checkbox("Use AO Map", &useAOMap);
+        if (ImGui::Checkbox("Pack ORM (AO/Roughness/Metallic)", &packOrm)) {
+            LoadMaskMaps(streamer, packOrm);
         }
-        if (ImGui::Checkbox("Use Roughness Map", &useRoughnessMap)) {
-            glUseProgram(shader_program);
-            glUniform1i(matUniforms.uUseRoughnessMap, useRoughnessMap ? 1 : 0);
+        if (packOrm) ImGui::Text("ORM: one fetch instead of three, RGB8 at ~2.7x the memory of three BC4 masks");
+        ImGui::Checkbox("Use IBL", &useIBL);
+        ImGui::Checkbox("Shader Permutations (off: uber shader)", &useShaderPermutations);
+        ImGui::Text("%zu shader variants compiled", permutations.variants().size());
+        ImGui::SameLine();
+        if (ImGui::Button("Variant report (console)")) permutations.printReport();
+        auto drawnVariant = permutations.variants().find(drawnFeatures);
+        if (drawnVariant != permutations.variants().end()) {
+            const ShaderVariant& variant = drawnVariant->second;
+            if (variant.instructions >= 0)
+                ImGui::Text("Variant %s: %d instructions", ShaderFeatureString(drawnFeatures).c_str(), variant.instructions);
+            else
+                ImGui::Text("Variant %s: %d B binary", ShaderFeatureString(drawnFeatures).c_str(), variant.binaryBytes);
         }
-        if (ImGui::Checkbox("Use Metallic Map", &useMetallicMap)) {
-            glUseProgram(shader_program);
-            glUniform1i(matUniforms.uUseMetallicMap, useMetallicMap ? 1 : 0);
+        if (ImGui::Button("Validate IBL (console)")) {
+            ValidateIBL(iblBaker, environmentPath, ibl, brdfLut);
+            renderState.invalidate();
         }
-        if (ImGui::Checkbox("Use AO Map", &useAOMap)) {
-            glUseProgram(shader_program);
-            glUniform1i(glGetUniformLocation(shader_program, "useAOMap"), useAOMap ? 1 : 0);
+        ImGui::Text("Bake new HDRs with:");
+        const IBLBakeBackend bakeBackends[] = { IBLBakeBackend::Raster, IBLBakeBackend::Compute, IBLBakeBackend::CPU };
+        int bakeBackend = int(iblBaker.getBackend());
+        for (int i = 0; i < 3; i++) {
+            if (!iblBaker.supports(bakeBackends[i])) continue; // Compute needs a 4.3 context
+            ImGui::SameLine();
+            if (ImGui::RadioButton(IBLBakeBackendName(bakeBackends[i]), &bakeBackend, i)) iblBaker.setBackend(bakeBackends[i]);
         }
-        if (ImGui::Checkbox("Use IBL", &useIBL)) {
-            glUseProgram(shader_program);
-            glUniform1i(glGetUniformLocation(shader_program, "useIBL"), useIBL ? 1 : 0);
+        if (ImGui::Button("Compare IBL bake backends (console)")) {
+            CompareIBLBackends(iblBaker, environmentPath);
+            renderState.invalidate();
         }
 
 
 
         ImGui::Text("Material Properties");
-        if (ImGui::SliderFloat("Roughness", &roughness, 0.0f, 1.0f)) {
-            glUseProgram(shader_program);
-            glUniform1f(matUniforms.uRoughness, roughness);
-        }
-        if (ImGui::SliderFloat("Metallic", &metallic, 0.0f, 1.0f)) {
-            glUseProgram(shader_program);
-            glUniform1f(matUniforms.uMetallic, metallic);
-        }
-        if (ImGui::ColorEdit3("Base Tint", baseTintColor)) {
-            glUseProgram(shader_program);
-            glUniform3f(matUniforms.uBaseTint, baseTintColor[0], baseTintColor[1], baseTintColor[2]);
-        }
+        ImGui::SliderFloat("Roughness", &roughness, 0.0f, 1.0f);
+        ImGui::SliderFloat("Metallic", &metallic, 0.0f, 1.0f);
+        ImGui::ColorEdit3("Base Tint", baseTintColor);
 
         ImGui::Separator();
         ImGui::Text("Lighting");
-        if (ImGui::SliderFloat3("Light Direction", lightDir, -1.0f, 1.0f)) {
-            glm::vec3 dir = glm::normalize(glm::vec3(lightDir[0], lightDir[1], lightDir[2]));
-            glUseProgram(shader_program);
-            glUniform3f(lightUniforms.uDirDir, dir.x, dir.y, dir.z);
-        }
-        if (ImGui::ColorEdit3("Light Color", lightColor)) {
-            glUseProgram(shader_program);
-            glUniform3f(lightUniforms.uLightColor, lightColor[0] * lightIntensity, lightColor[1] * lightIntensity, lightColor[2] * lightIntensity);
-        }
-        if (ImGui::SliderFloat("Light Intensity", &lightIntensity, 0.0f, 100.0f)) {
-            glUseProgram(shader_program);
-            glUniform3f(lightUniforms.uLightColor, lightColor[0] * lightIntensity, lightColor[1] * lightIntensity, lightColor[2] * lightIntensity);
-        }
+        ImGui::SliderFloat3("Light Direction", lightDir, -1.0f, 1.0f);
+        ImGui::ColorEdit3("Light Color", lightColor);
+        ImGui::SliderFloat("Light Intensity", &lightIntensity, 0.0f, 100.0f);
 
         
         ImGui::End();
 
-        // ----- Render Main Object -----
+        // ----- Render Scene -----
         // Make sure viewport is correct for 3D rendering
         glfwGetFramebufferSize(window, &w, &h);
         glViewport(0, 0, w, h);
-        
-        glUseProgram(shader_program);
-
-        // Bind textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, baseColorTextureID);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalMapTextureID);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, roughnessTextureID);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, metallicTextureID);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, aoTextureID);  // Fix: 2D texture, not cubemap
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-        
-        // Set IBL uniforms
-        glUniform1i(glGetUniformLocation(shader_program, "useIBL"), useIBL ? 1 : 0);
-        glUniform1i(glGetUniformLocation(shader_program, "irradianceMap"), 5);
-        glUniform1i(glGetUniformLocation(shader_program, "environmentMap"), 6);
+
+        // binds carry over from the last frame, unless the streamer deleted a texture whose name may be reused
+        renderState.beginFrame();
+        size_t evictions = streamer.stats().evictions;
+        if (evictions != seenEvictions) {
+            renderState.invalidate();
+            seenEvictions = evictions;
+        }
+        renderState.bindTexture(6, GL_TEXTURE_CUBE_MAP, ibl.prefiltered);
+        renderState.bindTexture(8, GL_TEXTURE_2D, brdfLut);
+
+        // the default material follows the UI
+        Material& defaultMaterial = scene.materials[0];
+        MaterialBlock& material = defaultMaterial.params;
+        material.baseTint = glm::vec3(baseTintColor[0], baseTintColor[1], baseTintColor[2]);
+        material.roughness = roughness;
+        material.metallic = metallic;
+        material.useBaseTex = useBaseColorTex ? 1 : 0;
+        material.useNormalTex = useNormalMap ? 1 : 0;
+        material.useRoughnessMap = useRoughnessMap ? 1 : 0;
+        material.useMetallicMap = useMetallicMap ? 1 : 0;
+        material.useAOMap = useAOMap ? 1 : 0;
+        material.useOrmMap = packOrm ? 1 : 0;
+        defaultMaterial.textures[MATERIAL_BASE_COLOR] = baseColorTexture;
+        defaultMaterial.textures[MATERIAL_NORMAL] = normalMapTexture;
+        defaultMaterial.textures[MATERIAL_ROUGHNESS] = packOrm ? INVALID_TEXTURE_HANDLE : roughnessTexture;
+        defaultMaterial.textures[MATERIAL_METALLIC] = packOrm ? INVALID_TEXTURE_HANDLE : metallicTexture;
+        defaultMaterial.textures[MATERIAL_AO] = packOrm ? INVALID_TEXTURE_HANDLE : aoTexture;
+        defaultMaterial.textures[MATERIAL_ORM] = packOrm ? ormTexture : INVALID_TEXTURE_HANDLE;
 
         // Update time-based lighting
         float time = glfwGetTime();
@@ -499,14 +791,9 @@ int main() {
         
         // Use manual light direction if being controlled, otherwise use animated
         // if (lightDir[0] == 0.0f && lightDir[1] == -0.7f && lightDir[2] == 0.3f) {
-        //     glUniform3f(lightUniforms.uDirDir, animatedDir.x, animatedDir.y, animatedDir.z);
+        //     lightsBlock.data.direction = animatedDir;
         // }
 
-        // Update camera position (add this line)
-        glUniform3f(lightUniforms.uCamPos, 0.0f, 0.0f, 5.0f);
-        // Force light direction pointing down at the surface
-        glUniform3f(lightUniforms.uDirDir, 1.0f, -1.0f, -1.0f);
-
         // Update matrices
         // glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
         // model = glm::rotate(model, time * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -525,13 +812,117 @@ glm::mat4 view = glm::lookAt(
 );
 
 
-        // glUniformMatrix4fv(vertUniforms.modelMatrix, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(vertUniforms.modelMatrix, 1, GL_FALSE, glm::value_ptr(model));
-
-        glUniformMatrix4fv(vertUniforms.viewMatrix, 1, GL_FALSE, glm::value_ptr(view));
-
-        // Draw the cube
-        currentMesh.draw();
+        // the atlas and the merged buffers are only built once the batched path is on
+        // the atlas builds in the background; until it is uploaded the scene draws per material
+        if (useSceneBatch && atlasDirty) {
+            atlas.build(scene.materials); // deletes the old arrays
+            atlasDirty = false;
+            renderState.invalidate();
+        }
+        if (atlas.update()) renderState.invalidate(); // the uploads bound the new arrays
+        if (useSceneBatch && batchDirty) {
+            sceneBatch.build(scene);
+            batchDirty = false;
+            renderState.invalidate();
+        }
+        bool batching = useSceneBatch && atlas.built() && sceneBatch.built();
+
+        // ----- Uniform blocks: this frame's state, then one glBufferSubData per block that changed -----
+        FrameBlock& frame = frameBlock.data;
+        frame.view = view;
+        frame.cameraPos = glm::vec3(0.0f, 0.0f, 5.0f);
+        frame.materialTable = batching ? 1 : 0;
+        LightsBlock& lights = lightsBlock.data;
+        lights.direction = glm::vec3(1.0f, -1.0f, -1.0f); // Force light direction pointing down at the surface
+        lights.color = glm::vec3(lightColor[0] * lightIntensity, lightColor[1] * lightIntensity, lightColor[2] * lightIntensity);
+        lights.useIBL = useIBL ? 1 : 0;
+        uniformUploads = int(frameBlock.flush()) + int(lightsBlock.flush());
+
+        bool timeGpu = !gpuTimerPending;
+        if (timeGpu) glBeginQuery(GL_TIME_ELAPSED, gpuTimer);
+        int instanceCount = STRESS_INSTANCE_COUNTS[reportLevel > 0 ? reportLevel : stressLevel];
+        // stress grid: rebuilt and re-uploaded every frame like a live scene
+        if (instanceCount > 1) BuildInstanceGrid(scene.boundsCenter, scene.boundsRadius, model, instanceCount, instances);
+        meshletDrawLists.resize(scene.submeshes.size());
+        cullStats = MeshletCullStats();
+        drawnTriangles = 0;
+        drawList.clear();
+        sceneBatch.clear();
+        if (batching) {
+            // the table row of each material; instances name theirs in materialIndex
+            uniformUploads += int(atlas.updateTable(scene.materials));
+            atlas.bind(renderState);
+        }
+        int firstShipped = int(scene.materials.size()) - SHIPPED_MATERIAL_COUNT;
+        for (size_t s = 0; s < scene.submeshes.size(); s++) {
+            SubMesh& submesh = scene.submeshes[s];
+            Mesh& mesh = submesh.mesh;
+            int lod;
+            const MeshletDrawList* ranges = nullptr;
+            if (instanceCount == 1) {
+                // coarsest LOD that stays within the pixel error budget, minus culled meshlets
+                InstanceData single = { model, 0 };
+                if (batching) {
+                    single.materialIndex = unsigned(submesh.material);
+                } else {
+                    mesh.setInstances(&single, 1);
+                }
+                lod = mesh.selectLod(view * model, projection, (float)h, lodPixelError);
+                if (useMeshletCulling) {
+                    MeshletCullStats culled = mesh.cullLod(lod, view * model, projection, useConeCulling, meshletDrawLists[s]);
+                    cullStats.meshletsTested += culled.meshletsTested;
+                    cullStats.meshletsCulled += culled.meshletsCulled;
+                    cullStats.trianglesCulled += culled.trianglesCulled;
+                    ranges = &meshletDrawLists[s];
+                }
+                if (batching) {
+                    if (ranges) sceneBatch.add(scene, int(s), *ranges, single);
+                    else sceneBatch.add(scene, int(s), lod, &single, 1);
+                }
+            } else {
+                // one LOD for all, picked for a copy near the grid center
+                lod = mesh.selectLod(view * instances[instanceCount / 2].model, projection, (float)h, lodPixelError);
+                if (batching) {
+                    // the grid's tint index picks a shipped set, or every copy keeps its submesh's material
+                    batchInstances = instances;
+                    for (InstanceData& instance : batchInstances)
+                        instance.materialIndex = spreadShippedMaterials
+                                                     ? unsigned(firstShipped + int(instance.materialIndex) % SHIPPED_MATERIAL_COUNT)
+                                                     : unsigned(submesh.material);
+                    sceneBatch.add(scene, int(s), lod, batchInstances.data(), batchInstances.size());
+                } else {
+                    mesh.setInstances(instances.data(), instances.size());
+                }
+            }
+            if (s == 0) drawnLod = lod;
+            drawnTriangles += mesh.lods[lod].indexCount / 3;
+            if (!batching) {
+                // the variant for this material's maps; the draw list sorts by program, so each variant binds once
+                uint32_t features = useShaderPermutations
+                                        ? ShaderFeaturesFor(scene.materials[submesh.material].params, lights, false)
+                                        : UBER_VARIANT;
+                const ShaderVariant& variant = permutations.get(features);
+                if (s == 0) drawnFeatures = variant.features;
+                drawList.add(variant.program, variant.vertexUniforms, submesh.material, int(s), lod, ranges);
+            }
+        }
+        if (batching) {
+            const ShaderVariant& variant =
+                permutations.get(useShaderPermutations ? ShaderFeaturesFor(material, lights, true) : UBER_VARIANT);
+            drawnFeatures = variant.features;
+            renderState.useProgram(variant.program);
+            glUniform1i(variant.vertexUniforms.packedVertices, 0);
+            drawStats = DrawListStats();
+            drawStats.draws = sceneBatch.draw(renderState);
+        } else {
+            drawList.sort();
+            drawStats = drawList.submit(scene, streamer, materialBlock, renderState);
+            uniformUploads += int(drawStats.materialUploads);
+        }
+        if (timeGpu) {
+            glEndQuery(GL_TIME_ELAPSED);
+            gpuTimerPending = true;
+        }
 
         // ----- Render Skybox -----
         glm::mat4 R = glm::rotate(glm::mat4(1.0f), time * 0.25f, glm::vec3(0,1,0));
@@ -539,12 +930,11 @@ glm::mat4 view = glm::lookAt(
         glm::mat4 viewSky = glm::mat4(glm::mat3(view * R));
 
         glDepthFunc(GL_LEQUAL);
-        glUseProgram(sbProg);
+        renderState.useProgram(sbProg);
         glUniformMatrix4fv(sbView, 1, GL_FALSE, glm::value_ptr(viewSky));
         glUniformMatrix4fv(sbProj, 1, GL_FALSE, glm::value_ptr(projection));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-        renderCube();
+        renderState.bindTexture(0, GL_TEXTURE_CUBE_MAP, ibl.environment);
+        renderCube(renderState);
         glDepthFunc(GL_LESS);
 
         // ----- Render ImGui -----
@@ -556,19 +946,19 @@ glm::mat4 view = glm::lookAt(
     }
 
     // ----- Cleanup -----
-    glDeleteShader(vertex_shader);
-    glDeleteShader(frag_shader);
-    glDeleteProgram(shader_program);
+    permutations.cleanup();
     glDeleteProgram(sbProg);
-    glDeleteTextures(1, &baseColorTextureID);
-    glDeleteTextures(1, &normalMapTextureID);
-    glDeleteTextures(1, &roughnessTextureID);
-    glDeleteTextures(1, &metallicTextureID);
-    glDeleteTextures(1, &aoTextureID);
-    glDeleteTextures(1, &hdrTextureID);
-    glDeleteTextures(1, &envCubemap);
-    glDeleteTextures(1, &irradianceMap);
-    currentMesh.cleanup();
+    sceneBatch.cleanup();
+    atlas.cleanup();
+    scene.clear(streamer);
+    frameBlock.cleanup();
+    lightsBlock.cleanup();
+    materialBlock.cleanup();
+    streamer.cleanup();
+    DeleteIBLMaps(ibl);
+    glDeleteTextures(1, &brdfLut);
+    iblBaker.cleanup();
+    glDeleteQueries(1, &gpuTimer);
     
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -0,0 +1,313 @@
+#include "material_atlas.h"
+#include "image_decode.h"
+#include "texture_mips.h"
+#include "texture_orm.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Every layer is RGB: base color and ORM use all three channels, normals their first two
+static const int ATLAS_CHANNELS = 3;
+
+namespace {
+struct SourceImage {
+    const uint8_t* pixels = nullptr; // ATLAS_CHANNELS per pixel, bottom row first like every texture upload
+    int width = 0, height = 0;
+};
+}
+
+// Box filter when the source covers the layer in both directions (every source pixel under the
+// footprint counts), bilinear otherwise
+static void ResampleLayer(const SourceImage& source, int size, uint8_t* out) {
+    const int w = source.width, h = source.height;
+    const uint8_t* src = source.pixels;
+    if (w == size && h == size) {
+        std::copy(src, src + size_t(size) * size * ATLAS_CHANNELS, out);
+        return;
+    }
+    bool shrink = w >= size && h >= size;
+    for (int y = 0; y < size; y++) {
+        uint8_t* row = out + size_t(y) * size * ATLAS_CHANNELS;
+        if (shrink) {
+            int y0 = int(int64_t(y) * h / size), y1 = std::max(y0 + 1, int(int64_t(y + 1) * h / size));
+            for (int x = 0; x < size; x++) {
+                int x0 = int(int64_t(x) * w / size), x1 = std::max(x0 + 1, int(int64_t(x + 1) * w / size));
+                float sum[ATLAS_CHANNELS] = {};
+                for (int sy = y0; sy < y1; sy++) {
+                    const uint8_t* p = src + (size_t(sy) * w + x0) * ATLAS_CHANNELS;
+                    for (int sx = x0; sx < x1; sx++, p += ATLAS_CHANNELS)
+                        for (int c = 0; c < ATLAS_CHANNELS; c++) sum[c] += p[c];
+                }
+                float scale = 1.0f / float((y1 - y0) * (x1 - x0));
+                for (int c = 0; c < ATLAS_CHANNELS; c++) row[x * ATLAS_CHANNELS + c] = uint8_t(sum[c] * scale + 0.5f);
+            }
+            continue;
+        }
+        // bilinear, pixel centers aligned (as PackOrm resamples)
+        float sy = std::min(std::max((y + 0.5f) * h / size - 0.5f, 0.0f), float(h - 1));
+        int y0 = int(sy), y1 = std::min(y0 + 1, h - 1);
+        float fy = sy - y0;
+        for (int x = 0; x < size; x++) {
+            float sx = std::min(std::max((x + 0.5f) * w / size - 0.5f, 0.0f), float(w - 1));
+            int x0 = int(sx), x1 = std::min(x0 + 1, w - 1);
+            float fx = sx - x0;
+            const uint8_t* a = src + (size_t(y0) * w + x0) * ATLAS_CHANNELS;
+            const uint8_t* b = src + (size_t(y0) * w + x1) * ATLAS_CHANNELS;
+            const uint8_t* c0 = src + (size_t(y1) * w + x0) * ATLAS_CHANNELS;
+            const uint8_t* d = src + (size_t(y1) * w + x1) * ATLAS_CHANNELS;
+            for (int c = 0; c < ATLAS_CHANNELS; c++) {
+                float top = a[c] + (b[c] - a[c]) * fx;
+                float bottom = c0[c] + (d[c] - c0[c]) * fx;
+                row[x * ATLAS_CHANNELS + c] = uint8_t(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+// An array of layerCount layers the size of chain, every mip level allocated; UploadLayer fills them
+static GLuint AllocateArray(const MipChain& chain, GLsizei layerCount, size_t& bytes) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+        const MipLevel& mip = chain.levels[level];
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), GL_RGB8, mip.width, mip.height, layerCount, 0, GL_RGB,
+                     GL_UNSIGNED_BYTE, nullptr);
+        bytes += size_t(mip.width) * mip.height * 4 * layerCount; // drivers pad RGB8 texels to 4 bytes
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, GLint(chain.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+static void UploadLayer(GLuint texture, const MipChain& chain, GLint layer) {
+    GLint previousAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB rows are tightly packed
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+        const MipLevel& mip = chain.levels[level];
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), 0, 0, layer, mip.width, mip.height, 1, GL_RGB, GL_UNSIGNED_BYTE,
+                        chain.data.data() + mip.offset);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+}
+
+struct MaterialAtlas::Build {
+    // inputs, copied so the scene can change while the worker runs
+    std::vector<MaterialSources> sources;
+    int maxLayerSize = 0;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<bool> cancelled{ false };
+    std::atomic<bool> ready{ false }; // the worker is done with everything below
+
+    std::vector<MaterialLayers> layers;          // per material
+    std::vector<MipChain> chains[ARRAY_COUNT];   // per layer
+    int layerSize[ARRAY_COUNT] = {};
+
+    // upload progress (render thread)
+    int uploadArray = 0;
+    size_t uploadLayer = 0;
+};
+
+void MaterialAtlas::init() {
+    table.init(MATERIAL_TABLE_BINDING);
+    table.flush();
+}
+
+void MaterialAtlas::releaseArrays() {
+    for (GLuint& array : arrays) {
+        if (array) glDeleteTextures(1, &array);
+        array = 0;
+    }
+    layers.clear();
+}
+
+void MaterialAtlas::cancel() {
+    if (pending) pending->cancelled = true; // the worker drops it at its next step
+    pending.reset();
+}
+
+void MaterialAtlas::cleanup() {
+    cancel();
+    releaseArrays();
+    table.cleanup();
+}
+
+bool MaterialAtlas::build(const std::vector<Material>& materials, int maxLayerSize) {
+    cancel();
+    releaseArrays();
+    statistics = MaterialAtlasStats();
+    size_t count = std::min(materials.size(), size_t(MAX_TABLE_MATERIALS));
+    if (materials.size() > count)
+        std::cout << "Material atlas: " << materials.size() - count << " materials past the table's " << MAX_TABLE_MATERIALS
+                  << " rows left out" << std::endl;
+    if (count == 0) return false;
+
+    auto build = std::make_shared<Build>();
+    build->start = std::chrono::steady_clock::now();
+    build->maxLayerSize = maxLayerSize;
+    for (size_t m = 0; m < count; m++) build->sources.push_back(materials[m].sources);
+    pending = build;
+    builder.submit([build] {
+        prepare(*build);
+        build->ready.store(true, std::memory_order_release);
+    });
+    return true;
+}
+
+void MaterialAtlas::prepare(Build& build) {
+    size_t count = build.sources.size();
+    // distinct sources per array; slots[m][a] indexes them, -1 = the material has no such map
+    std::vector<std::string> keys[ARRAY_COUNT];
+    std::vector<OrmSources> ormSets; // parallel to keys[ORM]
+    std::vector<std::array<int, ARRAY_COUNT>> slots(count);
+    auto slotOf = [&](int array, const std::string& key) {
+        if (key.empty()) return -1;
+        std::vector<std::string>& list = keys[array];
+        auto found = std::find(list.begin(), list.end(), key);
+        if (found != list.end()) return int(found - list.begin());
+        list.push_back(key);
+        return int(list.size()) - 1;
+    };
+    build.layers.resize(count);
+    for (size_t m = 0; m < count; m++) {
+        const MaterialSources& sources = build.sources[m];
+        const OrmSources& orm = sources.orm;
+        slots[m][BASE_COLOR] = slotOf(BASE_COLOR, sources.baseColor);
+        slots[m][NORMAL] = slotOf(NORMAL, sources.normal);
+        bool hasOrm = !orm.ao.empty() || !orm.roughness.empty() || !orm.metallic.empty();
+        slots[m][ORM] = slotOf(ORM, hasOrm ? orm.ao + '\n' + orm.roughness + '\n' + orm.metallic : std::string());
+        if (slots[m][ORM] == int(ormSets.size())) ormSets.push_back(orm);
+        build.layers[m].ormChannels = (orm.ao.empty() ? 0 : ORM_CHANNEL_AO) |
+                                      (orm.roughness.empty() ? 0 : ORM_CHANNEL_ROUGHNESS) |
+                                      (orm.metallic.empty() ? 0 : ORM_CHANNEL_METALLIC);
+    }
+
+    // decode everything up front: the layer size depends on the largest source
+    std::vector<DecodedImage> decoded[2];
+    std::vector<SourceImage> images[ARRAY_COUNT];
+    for (int a : { BASE_COLOR, NORMAL }) {
+        if (build.cancelled) return;
+        std::vector<ImageDecodeRequest> requests(keys[a].size());
+        for (size_t i = 0; i < requests.size(); i++) {
+            requests[i].path = keys[a][i];
+            requests[i].requiredChannels = ATLAS_CHANNELS;
+        }
+        DecodeImages(requests, decoded[a]);
+        images[a].resize(decoded[a].size());
+        for (size_t i = 0; i < decoded[a].size(); i++) {
+            if (!decoded[a][i]) continue;
+            images[a][i].pixels = decoded[a][i].pixels();
+            images[a][i].width = decoded[a][i].width;
+            images[a][i].height = decoded[a][i].height;
+        }
+    }
+    std::vector<std::vector<uint8_t>> ormPixels(ormSets.size());
+    images[ORM].resize(ormSets.size());
+    ParallelFor(ormSets.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !build.cancelled; i++) {
+            SourceImage& image = images[ORM][i];
+            if (PackOrm(ormSets[i], true, ormPixels[i], image.width, image.height)) image.pixels = ormPixels[i].data();
+        }
+    });
+
+    static const TextureRole roles[ARRAY_COUNT] = { TextureRole::BaseColor, TextureRole::Normal, TextureRole::Orm };
+    for (int a = 0; a < ARRAY_COUNT; a++) {
+        if (build.cancelled) return;
+        // sources that failed to decode get no layer; their materials fall back to the parameters
+        std::vector<int> layerOf(images[a].size(), -1);
+        std::vector<const SourceImage*> used;
+        int size = 0;
+        for (size_t i = 0; i < images[a].size(); i++) {
+            const SourceImage& image = images[a][i];
+            if (!image.pixels) continue;
+            layerOf[i] = int(used.size());
+            used.push_back(&image);
+            size = std::max(size, std::max(image.width, image.height));
+        }
+        if (used.empty()) continue;
+        size = std::min(size, build.maxLayerSize);
+
+        std::vector<MipChain>& chains = build.chains[a];
+        chains.resize(used.size());
+        MipOptions options = MipOptionsForRole(roles[a]);
+        ParallelFor(used.size(), [&](size_t begin, size_t end) {
+            std::vector<uint8_t> layer(size_t(size) * size * ATLAS_CHANNELS);
+            for (size_t l = begin; l < end && !build.cancelled; l++) {
+                ResampleLayer(*used[l], size, layer.data());
+                BuildMipChain(layer.data(), size, size, ATLAS_CHANNELS, options, chains[l]);
+            }
+        });
+        build.layerSize[a] = size;
+        for (size_t m = 0; m < count; m++)
+            if (slots[m][a] >= 0) build.layers[m].layer[a] = layerOf[slots[m][a]];
+    }
+}
+
+bool MaterialAtlas::update() {
+    if (!pending || !pending->ready.load(std::memory_order_acquire)) return false;
+    Build& build = *pending;
+
+    // one layer, every mip level, per call: the arrays fill over a few frames instead of in one stall
+    for (; build.uploadArray < ARRAY_COUNT; build.uploadArray++, build.uploadLayer = 0) {
+        std::vector<MipChain>& chains = build.chains[build.uploadArray];
+        if (build.uploadLayer >= chains.size()) continue;
+        if (build.uploadLayer == 0)
+            arrays[build.uploadArray] = AllocateArray(chains[0], GLsizei(chains.size()), statistics.bytes);
+        UploadLayer(arrays[build.uploadArray], chains[build.uploadLayer], GLint(build.uploadLayer));
+        build.uploadLayer++;
+        if (build.uploadLayer < chains.size() || build.uploadArray + 1 < ARRAY_COUNT) return false;
+    }
+
+    // every layer is in: the table takes the new layout, rows past the new count go back to the defaults
+    for (int a = 0; a < ARRAY_COUNT; a++) {
+        statistics.layerSize[a] = build.layerSize[a];
+        statistics.layers[a] = int(build.chains[a].size());
+    }
+    layers = std::move(build.layers);
+    table.data = MaterialTableBlock();
+    statistics.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build.start).count();
+    std::cout << "Material atlas: " << layers.size() << " materials, layers " << statistics.layers[BASE_COLOR] << " base color / "
+              << statistics.layers[NORMAL] << " normal / " << statistics.layers[ORM] << " ORM, "
+              << statistics.bytes / (1024.0 * 1024.0) << " MB, ready after " << statistics.buildMs << " ms" << std::endl;
+    pending.reset();
+    return true;
+}
+
+bool MaterialAtlas::updateTable(const std::vector<Material>& materials) {
+    size_t count = std::min(materials.size(), layers.size());
+    for (size_t m = 0; m < count; m++) {
+        const MaterialBlock& params = materials[m].params;
+        const MaterialLayers& source = layers[m];
+        MaterialRecord& record = table.data.materials[m];
+        record.baseTint = params.baseTint;
+        record.roughness = params.roughness;
+        record.metallic = params.metallic;
+        record.baseColorLayer = params.useBaseTex ? source.layer[BASE_COLOR] : -1;
+        record.normalLayer = params.useNormalTex ? source.layer[NORMAL] : -1;
+        // a channel only overrides its parameter when its map exists and the material uses it
+        GLint channels = source.layer[ORM] >= 0 ? source.ormChannels : 0;
+        if (!params.useAOMap) channels &= ~ORM_CHANNEL_AO;
+        if (!params.useRoughnessMap) channels &= ~ORM_CHANNEL_ROUGHNESS;
+        if (!params.useMetallicMap) channels &= ~ORM_CHANNEL_METALLIC;
+        record.ormChannels = channels;
+        record.ormLayer = channels ? source.layer[ORM] : -1;
+    }
+    return table.flush();
+}
+
+void MaterialAtlas::bind(RenderStateTracker& state) const {
+    state.bindTexture(ATLAS_BASE_COLOR_UNIT, GL_TEXTURE_2D_ARRAY, arrays[BASE_COLOR]);
+    state.bindTexture(ATLAS_NORMAL_UNIT, GL_TEXTURE_2D_ARRAY, arrays[NORMAL]);
+    state.bindTexture(ATLAS_ORM_UNIT, GL_TEXTURE_2D_ARRAY, arrays[ORM]);
+}
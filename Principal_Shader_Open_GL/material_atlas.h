@@ -0,0 +1,88 @@
+#pragma once
+#include "render_state.h"
+#include "scene.h"
+#include "thread_utils.h"
+#include "uniforms.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// MaterialAtlas: every material's maps in texture arrays, picked through a material table
+// ─────
+// With one texture per unit, each material is its own set of binds and so its own draw. The atlas
+// puts every base color map of the scene in one GL_TEXTURE_2D_ARRAY, every normal map in a second
+// and every packed ORM (texture_orm.h) in a third, all layers of an array the same size, and writes
+// one MaterialRecord per material into the MaterialTable block: its parameters plus its layer in
+// each array. With uMaterialTable set basic.frag reads the row named by the instance's material
+// index, so the three arrays stay bound for the whole scene and SceneBatch (scene_batch.h) draws
+// every material at once.
+// A build runs off the render thread like a TextureStreamer load: sources decode on the thread pool
+// and are resampled to the layer size (box filter down, bilinear up) and mip mapped there, then
+// update() uploads one layer per frame. A file shared by several materials takes one layer. GL 3.3
+// has no SSBOs, so the table is a uniform block: MAX_TABLE_MATERIALS rows of 48 bytes, within the
+// 16 KB every driver allows.
+static const int ATLAS_BASE_COLOR_UNIT = 9; // BindProgramSlots
+static const int ATLAS_NORMAL_UNIT = 10;
+static const int ATLAS_ORM_UNIT = 11;
+
+struct MaterialAtlasStats {
+    int layerSize[3] = {}; // base color, normal, ORM
+    int layers[3] = {};
+    size_t bytes = 0;      // all three arrays, mips included
+    double buildMs = 0.0;  // build() until the last layer was uploaded
+};
+
+class MaterialAtlas {
+public:
+    MaterialAtlas() = default;
+    MaterialAtlas(const MaterialAtlas&) = delete;
+    MaterialAtlas& operator=(const MaterialAtlas&) = delete;
+
+    // Needs the GL context. Creates the table buffer right away: every program linking basic.frag has
+    // the MaterialTable block active, batched or not
+    void init();
+    // Call before the context goes away
+    void cleanup();
+
+    // Starts building the arrays from the maps of materials and returns right away. The previous
+    // atlas (and any build still in flight) is dropped: built() stays false, so the caller draws per
+    // material, until update() has uploaded every layer. Layers are as large as the largest source of
+    // their array, capped at maxLayerSize. Materials past MAX_TABLE_MATERIALS are left out with a
+    // message; false when there is nothing to build from.
+    bool build(const std::vector<Material>& materials, int maxLayerSize = 1024);
+    // Render thread, once per frame: uploads one layer of a finished build, and swaps the atlas in
+    // with the last one; returns whether it did
+    bool update();
+    bool built() const { return !layers.empty(); }
+    bool building() const { return pending != nullptr; }
+    int materialCount() const { return static_cast<int>(layers.size()); }
+
+    // Rewrites the table from the materials' current parameters and use flags (the default material
+    // follows the UI) and uploads it when a byte changed; returns whether it did
+    bool updateTable(const std::vector<Material>& materials);
+    // The three arrays on ATLAS_*_UNIT
+    void bind(RenderStateTracker& state) const;
+    const MaterialAtlasStats& stats() const { return statistics; }
+
+private:
+    enum { BASE_COLOR, NORMAL, ORM, ARRAY_COUNT };
+    struct MaterialLayers {
+        GLint layer[ARRAY_COUNT] = { -1, -1, -1 };
+        GLint ormChannels = 0; // ORM_CHANNEL_* bits whose source file exists
+    };
+
+    struct Build; // a build's sources and results, shared with the worker preparing it
+
+    static void prepare(Build& build); // worker thread: decode, resample, mips
+    void releaseArrays();
+    void cancel();
+
+    GLuint arrays[ARRAY_COUNT] = {};
+    std::vector<MaterialLayers> layers; // per material
+    UniformBlock<MaterialTableBlock> table;
+    MaterialAtlasStats statistics;
+    std::shared_ptr<Build> pending; // being prepared or uploaded
+    ThreadPool builder{ 1 };        // last, so a running build is joined before the rest goes away
+};
@@ -0,0 +1,76 @@
+#include "mesh_cache.h"
+#include <cstring>
+#include <iostream>
+
+static const char MESH_CACHE_MAGIC[4] = { 'P', 'S', 'M', 'C' };
+
+std::string MeshCachePath(const std::string& objPath) {
+    return objPath + ".meshcache";
+}
+
+bool OpenMeshCache(const std::string& cachePath, uint64_t sourceHash, MappedMesh& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    if (file.size() < sizeof(MeshCacheHeader)) return false;
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.data());
+    if (std::memcmp(header->magic, MESH_CACHE_MAGIC, 4) != 0) return false;
+    if (header->version != MESH_CACHE_VERSION || header->vertexStride != sizeof(Vertex)) return false;
+    if (header->sourceHash != sourceHash) return false; // .obj changed since the cache was written
+
+    size_t expectedSize = sizeof(MeshCacheHeader) +
+                          size_t(header->vertexCount) * sizeof(Vertex) +
+                          size_t(header->indexCount) * sizeof(unsigned int) +
+                          size_t(header->lodCount) * sizeof(MeshLod) +
+                          size_t(header->meshletCount) * sizeof(Meshlet);
+    if (file.size() != expectedSize || header->lodCount == 0) return false;
+
+    const unsigned int* indices = reinterpret_cast<const unsigned int*>(file.data() + sizeof(MeshCacheHeader) + size_t(header->vertexCount) * sizeof(Vertex));
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(indices + header->indexCount);
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(lods + header->lodCount);
+    for (uint32_t i = 0; i < header->lodCount; i++) {
+        if (size_t(lods[i].indexOffset) + lods[i].indexCount > header->indexCount) return false;
+        if (size_t(lods[i].meshletOffset) + lods[i].meshletCount > header->meshletCount) return false;
+    }
+    for (uint32_t i = 0; i < header->meshletCount; i++)
+        if (size_t(meshlets[i].indexOffset) + meshlets[i].indexCount > header->indexCount) return false;
+
+    out.header = header;
+    out.vertices = reinterpret_cast<const Vertex*>(file.data() + sizeof(MeshCacheHeader));
+    out.indices = indices;
+    out.lods = lods;
+    out.meshlets = meshlets;
+    out.file = std::move(file);
+    return true;
+}
+
+bool WriteMeshCache(const std::string& cachePath, uint64_t sourceHash,
+                    const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                    const std::vector<MeshLod>& lods, const std::vector<Meshlet>& meshlets) {
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = MESH_CACHE_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    header.meshletCount = static_cast<uint32_t>(meshlets.size());
+    header.sourceHash = sourceHash;
+
+    glm::vec3 lo(0.0f), hi(0.0f);
+    if (!vertices.empty()) lo = hi = vertices[0].position;
+    for (const Vertex& v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = lo[i];
+        header.boundsMax[i] = hi[i];
+    }
+
+    return WriteFileAtomic(cachePath, { { &header, sizeof(header) },
+                                        { vertices.data(), vertices.size() * sizeof(Vertex) },
+                                        { indices.data(), indices.size() * sizeof(unsigned int) },
+                                        { lods.data(), lods.size() * sizeof(MeshLod) },
+                                        { meshlets.data(), meshlets.size() * sizeof(Meshlet) } });
+}
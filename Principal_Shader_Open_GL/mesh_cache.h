@@ -0,0 +1,46 @@
+#pragma once
+#include "mesh_utils.h"
+#include "file_utils.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Binary mesh cache: <model>.obj.meshcache
+// ─────
+// Layout: MeshCacheHeader, then vertexCount Vertex structs, then indexCount unsigned ints
+// (every LOD level back to back), then lodCount MeshLod entries, then meshletCount Meshlet entries.
+// Loading maps the file and hands those arrays straight to createMesh (no parse, no copy).
+static const uint32_t MESH_CACHE_VERSION = 7; // 2: indices/vertices stored in OptimizeMesh order, 3: vec4 tangents with bitangent sign, 4: LOD table, 5: meshlets, 6: tangent splits in fetch order, 7: LODs collapse along seams
+
+struct MeshCacheHeader {
+    char magic[4];          // "PSMC"
+    uint32_t version;       // MESH_CACHE_VERSION
+    uint32_t vertexStride;  // sizeof(Vertex) when the cache was written
+    uint32_t vertexCount;
+    uint32_t indexCount;    // all LOD levels
+    uint32_t lodCount;
+    uint64_t sourceHash;    // HashBytes of the .obj this was built from
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t meshletCount;  // all LOD levels
+    uint32_t reserved1;
+};
+static_assert(sizeof(MeshCacheHeader) == 64, "mesh cache header must stay 64 bytes");
+
+// a cache file mapped into memory; the pointers live as long as this object
+struct MappedMesh {
+    MappedFile file;
+    const MeshCacheHeader* header = nullptr;
+    const Vertex* vertices = nullptr;
+    const unsigned int* indices = nullptr;
+    const MeshLod* lods = nullptr;
+    const Meshlet* meshlets = nullptr;
+};
+
+std::string MeshCachePath(const std::string& objPath);
+// false when the cache is missing, was built from different source bytes, or is truncated/corrupt
+bool OpenMeshCache(const std::string& cachePath, uint64_t sourceHash, MappedMesh& out);
+bool WriteMeshCache(const std::string& cachePath, uint64_t sourceHash,
+                    const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                    const std::vector<MeshLod>& lods, const std::vector<Meshlet>& meshlets);
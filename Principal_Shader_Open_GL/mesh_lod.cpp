@@ -0,0 +1,454 @@
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// ─────────────────────────────────────────────
+// Quadrics
+// ─────
+// Sum of area-weighted squared plane distances. Evaluate() / weight is the mean squared
+// distance from p to the planes of every triangle merged into this vertex so far.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::vec3& n, float d, float w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * double(d) * d;
+        weight += w;
+    }
+    void add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double r = a00 * x * x + a11 * y * y + a22 * z * z
+                 + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                 + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return r > 0.0 ? r : 0.0;
+    }
+};
+
+// distance error of moving the surface summarized by (qa + qb) to p
+static float CollapseError(const Quadric& qa, const Quadric& qb, const glm::vec3& p) {
+    double w = qa.weight + qb.weight;
+    if (w <= 0.0) return 0.0f;
+    return static_cast<float>(std::sqrt((qa.evaluate(p) + qb.evaluate(p)) / w));
+}
+
+// ─────────────────────────────────────────────
+// Topology: which vertices may move, and how
+// ─────
+// positionId[v] is the smallest vertex index with a bit-identical position; vertices sharing one
+// are the sides of a UV/normal seam. Per pass, over the triangles still left:
+//   free    the only vertex at its position: collapses into any neighbour
+//   seam    one of exactly two vertices at its position, each side on exactly two seam edges (an
+//           edge one triangle uses by index and two by position). It only collapses along a seam
+//           edge, together with its sibling on the other side, so both sides stay welded.
+//   locked  everything else: seam corners and ends, open borders (edges by position used by a single
+//           triangle) and edges used by more than two triangles
+static const uint8_t VERTEX_FREE = 0, VERTEX_SEAM = 1, VERTEX_LOCKED = 2;
+static const unsigned int NO_VERTEX = 0xFFFFFFFFu;
+
+struct SeamLinks {
+    unsigned int sibling = NO_VERTEX;                  // the other side's vertex at this position
+    unsigned int next[2] = { NO_VERTEX, NO_VERTEX };   // neighbours along the seam, this side
+};
+
+static void FindPositionIds(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& positionId) {
+    std::vector<unsigned int> order(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) order[i] = static_cast<unsigned int>(i);
+    auto positionLess = [&](unsigned int a, unsigned int b) {
+        int c = std::memcmp(&vertices[a].position, &vertices[b].position, sizeof(glm::vec3));
+        return c != 0 ? c < 0 : a < b;
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+
+    positionId.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount;) {
+        size_t j = i + 1;
+        while (j < vertexCount && std::memcmp(&vertices[order[i]].position, &vertices[order[j]].position, sizeof(glm::vec3)) == 0) j++;
+        for (size_t k = i; k < j; k++) positionId[order[k]] = order[i];
+        i = j;
+    }
+}
+
+static inline uint64_t EdgeKey(uint64_t a, uint64_t b) {
+    return a < b ? (a << 32) | b : (b << 32) | a;
+}
+
+// sorted edge keys -> (key, number of triangles using it)
+static void CountEdges(std::vector<uint64_t>& keys, std::vector<std::pair<uint64_t, unsigned int>>& counts) {
+    std::sort(keys.begin(), keys.end());
+    counts.clear();
+    for (size_t i = 0; i < keys.size();) {
+        size_t j = i + 1;
+        while (j < keys.size() && keys[j] == keys[i]) j++;
+        counts.push_back({ keys[i], static_cast<unsigned int>(j - i) });
+        i = j;
+    }
+}
+
+static void ClassifyVertices(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                             const std::vector<unsigned int>& positionId, std::vector<uint8_t>& kind,
+                             std::vector<SeamLinks>& seams) {
+    kind.assign(vertexCount, VERTEX_LOCKED);
+    seams.assign(vertexCount, SeamLinks());
+    std::vector<uint8_t> referenced(vertexCount, 0), lockedPosition(vertexCount, 0), seamEdges(vertexCount, 0);
+    std::vector<unsigned int> groupSize(vertexCount, 0), groupFirst(vertexCount, NO_VERTEX);
+    for (size_t i = 0; i < indexCount; i++) referenced[indices[i]] = 1;
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (!referenced[v]) continue;
+        unsigned int group = positionId[v];
+        if (groupSize[group]++ == 0) groupFirst[group] = static_cast<unsigned int>(v);
+        else if (groupSize[group] == 2) {
+            seams[v].sibling = groupFirst[group];
+            seams[groupFirst[group]].sibling = static_cast<unsigned int>(v);
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    keys.reserve(indexCount);
+    std::vector<std::pair<uint64_t, unsigned int>> positionEdges, vertexEdges;
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+        for (int e = 0; e < 3; e++) {
+            unsigned int a = positionId[indices[i + e]], b = positionId[indices[i + (e + 1) % 3]];
+            if (a != b) keys.push_back(EdgeKey(a, b));
+        }
+    CountEdges(keys, positionEdges);
+    for (const auto& edge : positionEdges) {
+        if (edge.second == 2) continue;
+        lockedPosition[edge.first >> 32] = 1;
+        lockedPosition[edge.first & 0xFFFFFFFFu] = 1;
+    }
+
+    keys.clear();
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+        for (int e = 0; e < 3; e++) keys.push_back(EdgeKey(indices[i + e], indices[i + (e + 1) % 3]));
+    CountEdges(keys, vertexEdges);
+    for (const auto& edge : vertexEdges) {
+        if (edge.second != 1) continue;
+        unsigned int a = static_cast<unsigned int>(edge.first >> 32), b = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+        if (lockedPosition[positionId[a]] || lockedPosition[positionId[b]]) continue; // an open border, not a seam
+        for (unsigned int v : { a, b }) {
+            unsigned int other = v == a ? b : a;
+            if (seamEdges[v] < 2) seams[v].next[seamEdges[v]] = other;
+            seamEdges[v] = uint8_t(std::min(seamEdges[v] + 1, 3));
+        }
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (!referenced[v] || lockedPosition[positionId[v]]) continue;
+        unsigned int size = groupSize[positionId[v]];
+        if (size == 1 && seamEdges[v] == 0) kind[v] = VERTEX_FREE;
+        else if (size == 2 && seamEdges[v] == 2 && seamEdges[seams[v].sibling] == 2) kind[v] = VERTEX_SEAM;
+    }
+}
+
+// the neighbour of v along its seam that sits at the same position as `at`, or NO_VERTEX
+static unsigned int SeamNeighbourAt(const SeamLinks& links, const std::vector<unsigned int>& positionId, unsigned int at) {
+    for (unsigned int n : links.next)
+        if (n != NO_VERTEX && positionId[n] == positionId[at]) return n;
+    return NO_VERTEX;
+}
+
+// Weight of the seam penalty against the distance error; 1 = a unit of attribute deviation (UV or
+// normal, measured along the seam in object units) costs as much as the same surface distance.
+static const float SEAM_ATTRIBUTE_WEIGHT = 1.0f;
+
+// What collapsing seam vertex `from` (and its sibling) along the seam into `to` costs beyond the
+// surface error: the seam polyline loses `from`, so it is measured against the segment from its
+// other seam neighbour to `to`. Distance of `from` to that segment, plus on each side how far its
+// UV and normal are from what the segment interpolates there (UVs scaled to object units by the
+// segment's length ratio).
+static float SeamPenalty(const Vertex* vertices, const std::vector<SeamLinks>& seams, const std::vector<unsigned int>& positionId,
+                         unsigned int from, unsigned int to) {
+    const SeamLinks& links = seams[from];
+    unsigned int prev = links.next[0] == to ? links.next[1] : links.next[0];
+    const glm::vec3& p = vertices[from].position;
+    const glm::vec3& a = vertices[prev].position;
+    const glm::vec3& b = vertices[to].position;
+    glm::vec3 ab = b - a;
+    float length2 = glm::dot(ab, ab);
+    float t = length2 > 0.0f ? std::min(std::max(glm::dot(p - a, ab) / length2, 0.0f), 1.0f) : 0.0f;
+    float penalty = glm::length(p - (a + ab * t));
+
+    float attribute = 0.0f;
+    unsigned int sides[2][3] = { { from, prev, to },
+                                 { links.sibling, SeamNeighbourAt(seams[links.sibling], positionId, prev),
+                                   SeamNeighbourAt(seams[links.sibling], positionId, to) } };
+    for (const auto& side : sides) {
+        if (side[1] == NO_VERTEX || side[2] == NO_VERTEX) return INFINITY;
+        const Vertex& v = vertices[side[0]];
+        const Vertex& va = vertices[side[1]];
+        const Vertex& vb = vertices[side[2]];
+        float uvLength = glm::length(vb.texCoord - va.texCoord);
+        float toObject = uvLength > 1e-8f ? std::sqrt(length2) / uvLength : 0.0f;
+        float uvError = glm::length(v.texCoord - glm::mix(va.texCoord, vb.texCoord, t)) * toObject;
+        glm::vec3 normal = glm::mix(va.normal, vb.normal, t);
+        float normalLength = glm::length(normal);
+        float normalError = normalLength > 1e-8f ? glm::length(v.normal - normal / normalLength) * glm::length(p - b) : 0.0f;
+        attribute = std::max(attribute, uvError + normalError);
+    }
+    return penalty + SEAM_ATTRIBUTE_WEIGHT * attribute;
+}
+
+// ─────────────────────────────────────────────
+// SimplifyMesh
+// ─────
+// Works in passes. Each pass ranks every edge by its cheaper allowed collapse direction and
+// applies collapses cheapest-first, touching each vertex at most once, until the pass has
+// removed enough triangles. Collapses that would flip a neighbouring triangle are skipped.
+// A seam collapse moves two vertices, one per side: pairFrom into pairTo.
+struct CollapseCandidate {
+    unsigned int from, to;
+    float error;
+    unsigned int pairFrom, pairTo;
+};
+
+float SimplifyMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                   size_t targetIndexCount, float maxError, std::vector<unsigned int>& out) {
+    out.assign(indices, indices + indexCount);
+    if (indexCount <= targetIndexCount || vertexCount == 0) return 0.0f;
+
+    std::vector<unsigned int> positionId;
+    FindPositionIds(vertices, vertexCount, positionId);
+    std::vector<uint8_t> kind;
+    std::vector<SeamLinks> seams;
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        glm::vec3 n = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+        float len = glm::length(n);
+        if (len <= 0.0f) continue;
+        n /= len;
+        float area = 0.5f * len;
+        float d = -glm::dot(n, p0);
+        for (int k = 0; k < 3; k++) quadrics[indices[i + k]].addPlane(n, d, area);
+    }
+
+    // from -> to: free vertices into any neighbour, seam vertices along their seam with their sibling
+    auto price = [&](unsigned int from, unsigned int to) {
+        CollapseCandidate c = { from, to, INFINITY, NO_VERTEX, NO_VERTEX };
+        const glm::vec3& target = vertices[to].position;
+        if (kind[from] == VERTEX_FREE) {
+            c.error = CollapseError(quadrics[from], quadrics[to], target);
+        } else if (kind[from] == VERTEX_SEAM && (seams[from].next[0] == to || seams[from].next[1] == to)) {
+            unsigned int pairFrom = seams[from].sibling;
+            unsigned int pairTo = SeamNeighbourAt(seams[pairFrom], positionId, to);
+            if (pairTo == NO_VERTEX) return c;
+            // both sides' surfaces, as one quadric per position
+            Quadric source = quadrics[from], destination = quadrics[to];
+            source.add(quadrics[pairFrom]);
+            if (pairTo != to) destination.add(quadrics[pairTo]);
+            c.error = CollapseError(source, destination, target) + SeamPenalty(vertices, seams, positionId, from, to);
+            c.pairFrom = pairFrom;
+            c.pairTo = pairTo;
+        }
+        return c;
+    };
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<unsigned int> adjStart(vertexCount + 1), adjacency;
+    std::vector<CollapseCandidate> candidates;
+    std::vector<unsigned int> ringFrom, ringTo;
+    float reachedError = 0.0f;
+
+    // One vertex's half of a collapse: false if a triangle that survives it would turn over, or
+    // would end up with every corner on a seam or border (a sliver along it that no later pass
+    // can remove), or if it breaks the link condition. lost counts the triangles it removes.
+    auto collapseAllowed = [&](unsigned int from, unsigned int to, size_t& lost) {
+        const glm::vec3& target = vertices[to].position;
+        lost = 0;
+        for (unsigned int i = adjStart[from]; i < adjStart[from + 1]; i++) {
+            const unsigned int* tri = &out[3 * adjacency[i]];
+            unsigned int v0 = remap[tri[0]], v1 = remap[tri[1]], v2 = remap[tri[2]];
+            if (v0 == to || v1 == to || v2 == to) { lost++; continue; }
+            glm::vec3 p0 = vertices[v0].position, p1 = vertices[v1].position, p2 = vertices[v2].position;
+            glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+            if (v0 == from) p0 = target;
+            if (v1 == from) p1 = target;
+            if (v2 == from) p2 = target;
+            glm::vec3 after = glm::cross(p1 - p0, p2 - p0);
+            if (glm::dot(before, after) <= 0.0f) return false;
+            if (kind[to] != VERTEX_FREE) {
+                unsigned int o0 = v0 == from ? v1 : v0, o1 = v2 == from ? v1 : v2;
+                if (kind[o0] != VERTEX_FREE && kind[o1] != VERTEX_FREE) return false;
+            }
+        }
+
+        // link condition: u and v may only share the vertices opposite their shared edge,
+        // otherwise the collapse pinches the surface into a non-manifold edge.
+        // Compared by position so a seam's two sides count as one vertex.
+        ringFrom.clear();
+        ringTo.clear();
+        for (unsigned int i = adjStart[from]; i < adjStart[from + 1]; i++)
+            for (int k = 0; k < 3; k++) ringFrom.push_back(positionId[out[3 * adjacency[i] + k]]);
+        for (unsigned int i = adjStart[to]; i < adjStart[to + 1]; i++)
+            for (int k = 0; k < 3; k++) ringTo.push_back(positionId[out[3 * adjacency[i] + k]]);
+        std::sort(ringFrom.begin(), ringFrom.end());
+        ringFrom.erase(std::unique(ringFrom.begin(), ringFrom.end()), ringFrom.end());
+        std::sort(ringTo.begin(), ringTo.end());
+        ringTo.erase(std::unique(ringTo.begin(), ringTo.end()), ringTo.end());
+        size_t shared = 0;
+        for (size_t i = 0, j = 0; i < ringFrom.size() && j < ringTo.size();) {
+            if (ringFrom[i] < ringTo[j]) i++;
+            else if (ringTo[j] < ringFrom[i]) j++;
+            else { shared++; i++; j++; }
+        }
+        return shared == lost + 2; // both rings also contain u and v themselves
+    };
+
+    while (out.size() > targetIndexCount) {
+        const size_t triCount = out.size() / 3;
+        ClassifyVertices(out.data(), out.size(), vertexCount, positionId, kind, seams);
+
+        // vertex -> triangle adjacency for the flip test
+        std::fill(adjStart.begin(), adjStart.end(), 0);
+        for (unsigned int v : out) adjStart[v + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) adjStart[v + 1] += adjStart[v];
+        adjacency.resize(out.size());
+        {
+            std::vector<unsigned int> cursor(adjStart.begin(), adjStart.end() - 1);
+            for (size_t i = 0; i < out.size(); i++) adjacency[cursor[out[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // every edge once from each triangle that has it as a < b, priced in parallel
+        candidates.resize(out.size());
+        ParallelFor(triCount, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                for (int e = 0; e < 3; e++) {
+                    unsigned int a = out[3 * t + e], b = out[3 * t + (e + 1) % 3];
+                    CollapseCandidate c = { a, b, INFINITY, NO_VERTEX, NO_VERTEX };
+                    if (a < b) {
+                        CollapseCandidate ab = price(a, b), ba = price(b, a);
+                        c = ab.error <= ba.error ? ab : ba;
+                    }
+                    candidates[3 * t + e] = c;
+                }
+            }
+        }, 1 << 12);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [&](const CollapseCandidate& c) { return !(c.error <= maxError); }),
+                         candidates.end());
+        if (candidates.empty()) break;
+        std::sort(candidates.begin(), candidates.end(), [](const CollapseCandidate& a, const CollapseCandidate& b) {
+            return a.error != b.error ? a.error < b.error : (a.from != b.from ? a.from < b.from : a.to < b.to);
+        });
+
+        for (size_t v = 0; v < vertexCount; v++) remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        const size_t trianglesToRemove = (out.size() - targetIndexCount) / 3;
+        size_t removed = 0, collapses = 0;
+
+        for (const CollapseCandidate& c : candidates) {
+            if (removed >= trianglesToRemove) break;
+            if (touched[c.from] || touched[c.to]) continue;
+            bool seam = c.pairFrom != NO_VERTEX;
+            if (seam && (touched[c.pairFrom] || touched[c.pairTo])) continue;
+
+            size_t lost = 0, pairLost = 0;
+            if (!collapseAllowed(c.from, c.to, lost)) continue;
+            if (seam && !collapseAllowed(c.pairFrom, c.pairTo, pairLost)) continue;
+
+            // neighbours are frozen for the rest of the pass so the adjacency above stays valid
+            for (unsigned int from : { c.from, seam ? c.pairFrom : c.from })
+                for (unsigned int i = adjStart[from]; i < adjStart[from + 1]; i++)
+                    for (int k = 0; k < 3; k++) touched[remap[out[3 * adjacency[i] + k]]] = 1;
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            if (seam) {
+                remap[c.pairFrom] = c.pairTo;
+                quadrics[c.pairTo].add(quadrics[c.pairFrom]);
+            }
+            reachedError = std::max(reachedError, c.error);
+            removed += lost + pairLost;
+            collapses++;
+        }
+        if (collapses == 0) break;
+
+        // apply the pass and drop triangles that collapsed to a line
+        size_t write = 0;
+        for (size_t i = 0; i < out.size(); i += 3) {
+            unsigned int v0 = remap[out[i]], v1 = remap[out[i + 1]], v2 = remap[out[i + 2]];
+            if (v0 == v1 || v1 == v2 || v0 == v2) continue;
+            out[write++] = v0; out[write++] = v1; out[write++] = v2;
+        }
+        out.resize(write);
+    }
+    return reachedError;
+}
+
+// ─────────────────────────────────────────────
+// LOD chain
+// ─────
+static const size_t MAX_LODS = 8;
+static const size_t MIN_LOD_TRIANGLES = 64;
+
+void BuildLodChain(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<MeshLod>& lods) {
+    lods.clear();
+    lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+    if (vertices.empty() || indices.size() < 3 * 2 * MIN_LOD_TRIANGLES) return;
+
+    // no single collapse may move the surface by more than 5% of the mesh size
+    glm::vec3 lo = vertices[0].position, hi = lo;
+    for (const Vertex& v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    float maxError = 0.05f * glm::length(hi - lo);
+
+    std::vector<unsigned int> level(indices.begin(), indices.end()), next;
+    float error = 0.0f;
+    while (lods.size() < MAX_LODS && level.size() >= 3 * 2 * MIN_LOD_TRIANGLES) {
+        float reached = SimplifyMesh(vertices.data(), vertices.size(), level.data(), level.size(),
+                                     level.size() / 2 / 3 * 3, maxError, next);
+        if (next.size() > level.size() * 9 / 10) break; // stalled on locked corners/borders
+
+        // each level starts from the previous one, so their errors add up
+        error += reached;
+        OptimizeVertexCache(next.data(), next.size(), vertices.size());
+        lods.push_back({ static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(next.size()), error });
+        indices.insert(indices.end(), next.begin(), next.end());
+        level.swap(next);
+    }
+
+    std::cout << "LOD chain:";
+    for (const MeshLod& lod : lods) std::cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+    std::cout << " tris (error)" << std::endl;
+}
+
+// ─────────────────────────────────────────────
+// Mesh::selectLod
+// ─────
+int Mesh::selectLod(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, float maxPixelError) const {
+    if (lods.size() <= 1) return 0;
+
+    // the largest axis scale turns object-space error into view-space error
+    float scale = std::max({ glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])),
+                             glm::length(glm::vec3(modelView[2])) });
+    float pixelsPerUnit = scale * projection[1][1] * 0.5f * viewportHeight;
+    if (projection[3][3] != 1.0f) { // perspective: measure at the nearest point of the bounding sphere
+        glm::vec3 center = glm::vec3(modelView * glm::vec4(boundsCenter, 1.0f));
+        float distance = -center.z - boundsRadius * scale;
+        if (distance <= 0.0f) return 0;
+        pixelsPerUnit /= distance;
+    }
+
+    int lod = 0;
+    for (size_t i = 1; i < lods.size() && lods[i].error * pixelsPerUnit <= maxPixelError; i++) lod = static_cast<int>(i);
+    return lod;
+}
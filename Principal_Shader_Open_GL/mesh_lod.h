@@ -0,0 +1,22 @@
+#pragma once
+#include "mesh_utils.h"
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Mesh simplification (quadric error metrics) and LOD chains
+// ─────
+// Half-edge collapses ordered by QEM cost (Garland & Heckbert 1997): a vertex is merged into a
+// neighbour, so every LOD reuses LOD 0's vertices and only needs new indices.
+// A vertex on a UV/normal seam (same position, different attributes) only collapses along the
+// seam, together with its copy on the other side, at a cost that adds how far the attributes
+// drift; seam corners and open borders are never moved, so seams don't tear and silhouettes of
+// open meshes keep their outline.
+
+// Simplifies a triangle list towards targetIndexCount without exceeding maxError
+// (object-space distance to the input surface). Returns the error reached.
+float SimplifyMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                   size_t targetIndexCount, float maxError, std::vector<unsigned int>& out);
+
+// Treats `indices` as LOD 0, appends each coarser level (about half the triangles of the one
+// before) to it and describes all levels in `lods`. Levels stop when simplification stalls.
+void BuildLodChain(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<MeshLod>& lods);
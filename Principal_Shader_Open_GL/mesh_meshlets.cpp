@@ -0,0 +1,190 @@
+#include "mesh_meshlets.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// ─────────────────────────────────────────────
+// Building
+// ─────
+// Bounding sphere (box center, farthest corner) and normal cone of one meshlet
+static void ComputeMeshletBounds(const Vertex* vertices, const unsigned int* indices, Meshlet& meshlet) {
+    const unsigned int* tris = indices + meshlet.indexOffset;
+    glm::vec3 lo = vertices[tris[0]].position, hi = lo;
+    for (unsigned int i = 1; i < meshlet.indexCount; i++) {
+        lo = glm::min(lo, vertices[tris[i]].position);
+        hi = glm::max(hi, vertices[tris[i]].position);
+    }
+    meshlet.center = 0.5f * (lo + hi);
+    float radius2 = 0.0f;
+    for (unsigned int i = 0; i < meshlet.indexCount; i++) {
+        glm::vec3 d = vertices[tris[i]].position - meshlet.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radius2);
+
+    // cone axis = average face normal, cutoff = cosine of the widest normal around it.
+    // Zero-area triangles have no normal and can't be seen anyway, so they don't widen the cone.
+    glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+    size_t normalCount = 0;
+    glm::vec3 sum(0.0f);
+    for (unsigned int i = 0; i < meshlet.indexCount; i += 3) {
+        const glm::vec3& p0 = vertices[tris[i]].position;
+        glm::vec3 n = glm::cross(vertices[tris[i + 1]].position - p0, vertices[tris[i + 2]].position - p0);
+        float length = glm::length(n);
+        if (length <= 0.0f) continue;
+        normals[normalCount] = n / length;
+        sum += normals[normalCount++];
+    }
+    float sumLength = glm::length(sum);
+    if (normalCount == 0 || sumLength < 1e-6f) {
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = -1.0f;
+        return;
+    }
+    meshlet.coneAxis = sum / sumLength;
+    meshlet.coneCutoff = 1.0f;
+    for (size_t i = 0; i < normalCount; i++)
+        meshlet.coneCutoff = std::min(meshlet.coneCutoff, glm::dot(meshlet.coneAxis, normals[i]));
+}
+
+void BuildMeshlets(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                   MeshLod* lods, size_t lodCount, std::vector<Meshlet>& meshlets) {
+    meshlets.clear();
+
+    // owner[v] = last meshlet that referenced v, so counting a triangle's new vertices is O(1)
+    std::vector<uint32_t> owner(vertexCount, UINT32_MAX);
+    for (size_t l = 0; l < lodCount; l++) {
+        MeshLod& lod = lods[l];
+        lod.meshletOffset = static_cast<unsigned int>(meshlets.size());
+        size_t meshletVertices = 0;
+        for (unsigned int i = lod.indexOffset; i + 3 <= lod.indexOffset + lod.indexCount; i += 3) {
+            uint32_t current = static_cast<uint32_t>(meshlets.size()) - 1;
+            unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            bool open = meshlets.size() > lod.meshletOffset; // each level starts its own meshlets
+            size_t added = (owner[a] != current) + (b != a && owner[b] != current) + (c != a && c != b && owner[c] != current);
+
+            // start a new meshlet when this triangle would overflow either limit
+            if (!open || meshletVertices + added > MESHLET_MAX_VERTICES ||
+                meshlets.back().indexCount / 3 >= MESHLET_MAX_TRIANGLES) {
+                meshlets.push_back({ i, 0, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), -1.0f });
+                current = static_cast<uint32_t>(meshlets.size()) - 1;
+                meshletVertices = 0;
+            }
+            for (unsigned int v : { a, b, c }) {
+                if (owner[v] == current) continue;
+                owner[v] = current;
+                meshletVertices++;
+            }
+            meshlets.back().indexCount += 3;
+        }
+        lod.meshletCount = static_cast<unsigned int>(meshlets.size()) - lod.meshletOffset;
+    }
+
+    ParallelFor(meshlets.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) ComputeMeshletBounds(vertices, indices, meshlets[i]);
+    }, 1024);
+}
+
+// ─────────────────────────────────────────────
+// Culling
+// ─────
+// Frustum planes from the combined matrix (Gribb & Hartmann), normalized so a sphere test
+// can compare signed distances against the radius. Extracted from modelViewProjection they
+// live in object space, so meshlet bounds never need transforming.
+static void ExtractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+    for (int i = 0; i < 6; i++) planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// Every triangle faces away when the camera is behind all their planes. With every normal within
+// angle a of the axis and the sphere center at angle t from the axis (seen from the camera), the
+// closest any normal gets to facing the camera is cos(t + a); the sphere's radius covers how far
+// the triangles' planes sit from its center.
+static bool MeshletBackfacing(const Meshlet& m, const glm::vec3& cameraPosition) {
+    if (m.coneCutoff <= 0.0f) return false;
+    glm::vec3 toCenter = m.center - cameraPosition;
+    float distance = glm::length(toCenter);
+    if (distance <= m.radius) return false;
+    float cosT = glm::dot(toCenter, m.coneAxis) / distance;
+    float sinT = std::sqrt(std::max(0.0f, 1.0f - cosT * cosT));
+    float sinA = std::sqrt(std::max(0.0f, 1.0f - m.coneCutoff * m.coneCutoff));
+    return distance * (cosT * m.coneCutoff - sinT * sinA) > m.radius;
+}
+
+MeshletCullStats CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& modelViewProjection,
+                              const glm::vec3& cameraPosition, bool coneCulling, MeshletDrawList& drawList) {
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(modelViewProjection, planes);
+
+    drawList.visible.resize(meshletCount);
+    unsigned char* visible = drawList.visible.data();
+    ParallelFor(meshletCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Meshlet& m = meshlets[i];
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++)
+                inside = glm::dot(glm::vec3(planes[p]), m.center) + planes[p].w >= -m.radius;
+            visible[i] = inside && !(coneCulling && MeshletBackfacing(m, cameraPosition));
+        }
+    }, 4096);
+
+    // compact into draw ranges; neighbours in the EBO merge into one range
+    MeshletCullStats stats;
+    stats.meshletsTested = meshletCount;
+    drawList.counts.clear();
+    drawList.offsets.clear();
+    size_t rangeEnd = SIZE_MAX;
+    for (size_t i = 0; i < meshletCount; i++) {
+        const Meshlet& m = meshlets[i];
+        if (!visible[i]) {
+            stats.meshletsCulled++;
+            stats.trianglesCulled += m.indexCount / 3;
+            continue;
+        }
+        if (m.indexOffset == rangeEnd) drawList.counts.back() += static_cast<GLsizei>(m.indexCount);
+        else {
+            drawList.counts.push_back(static_cast<GLsizei>(m.indexCount));
+            drawList.offsets.push_back((const void*)(size_t(m.indexOffset) * sizeof(unsigned int)));
+        }
+        rangeEnd = size_t(m.indexOffset) + m.indexCount;
+    }
+    return stats;
+}
+
+// ─────────────────────────────────────────────
+// Mesh::cullLod / drawLodCulled
+// ─────
+MeshletCullStats Mesh::cullLod(int lod, const glm::mat4& modelView, const glm::mat4& projection, bool coneCulling,
+                               MeshletDrawList& drawList) const {
+    const MeshLod& level = lods[lod];
+    if (level.meshletCount == 0) {
+        drawList.counts.assign(1, static_cast<GLsizei>(level.indexCount));
+        drawList.offsets.assign(1, (const void*)(size_t(level.indexOffset) * sizeof(unsigned int)));
+        return MeshletCullStats();
+    }
+
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]); // eye in object space
+    return CullMeshlets(meshlets.data() + level.meshletOffset, level.meshletCount, projection * modelView,
+                        cameraPosition, coneCulling, drawList);
+}
+
+MeshletCullStats Mesh::drawLodCulled(int lod, const glm::mat4& modelView, const glm::mat4& projection, bool coneCulling,
+                                     MeshletDrawList& drawList) const {
+    MeshletCullStats stats = cullLod(lod, modelView, projection, coneCulling, drawList);
+    if (!drawList.counts.empty()) {
+        glBindVertexArray(VAO);
+        glMultiDrawElements(GL_TRIANGLES, drawList.counts.data(), GL_UNSIGNED_INT, drawList.offsets.data(),
+                            static_cast<GLsizei>(drawList.counts.size()));
+    }
+    return stats;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "mesh_utils.h"
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Meshlets: clusters of at most 64 vertices / 124 triangles
+// ─────
+// Each LOD's index range is cut into consecutive runs of triangles, so a meshlet is just a
+// sub-range of the EBO and visible meshlets can be drawn with one glMultiDrawElements call.
+// The runs follow the vertex cache order from mesh_optimize.h, which keeps them spatially tight.
+static const size_t MESHLET_MAX_VERTICES = 64;
+static const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// Replaces `meshlets` with the meshlets of every level and fills in each level's meshletOffset/Count.
+void BuildMeshlets(const Vertex* vertices, size_t vertexCount, const unsigned int* indices,
+                   MeshLod* lods, size_t lodCount, std::vector<Meshlet>& meshlets);
+
+// Tests meshlets against the frustum of modelViewProjection (object space -> clip space) and, with
+// coneCulling, against the object-space camera position. Runs on the thread pool and writes the
+// surviving EBO ranges to drawList.
+MeshletCullStats CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& modelViewProjection,
+                              const glm::vec3& cameraPosition, bool coneCulling, MeshletDrawList& drawList);
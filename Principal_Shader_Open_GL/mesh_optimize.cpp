@@ -0,0 +1,235 @@
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+
+// ─────────────────────────────────────────────
+// Cache simulation
+// ─────
+// FIFO cache shared by the analyzers: a vertex is resident if it missed within the last `size` misses.
+// reset() just moves the clock past every old entry, so clearing is O(1).
+struct FifoCacheSim {
+    std::vector<size_t> entered;
+    size_t clock;
+    unsigned int size;
+
+    FifoCacheSim(size_t vertexCount, unsigned int cacheSize)
+        : entered(vertexCount, 0), clock(cacheSize + 1), size(cacheSize) {}
+
+    bool access(unsigned int v) { // true on a miss
+        if (clock - entered[v] <= size) return false;
+        entered[v] = clock++;
+        return true;
+    }
+    void reset() { clock += size + 1; }
+};
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) return stats;
+
+    FifoCacheSim cache(vertexCount, cacheSize);
+    std::vector<char> used(vertexCount, 0);
+    size_t misses = 0, uniqueVerts = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int v = indices[i];
+        if (!used[v]) { used[v] = 1; uniqueVerts++; }
+        if (cache.access(v)) misses++;
+    }
+    stats.acmr = float(misses) / float(indexCount / 3);
+    stats.atvr = uniqueVerts ? float(misses) / float(uniqueVerts) : 0.0f;
+    return stats;
+}
+
+// ─────────────────────────────────────────────
+// Tipsify
+// ─────
+std::vector<size_t> OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    std::vector<size_t> boundaries;
+    size_t triCount = indexCount / 3;
+    if (triCount == 0) return boundaries;
+
+    // vertex -> triangle adjacency (CSR)
+    std::vector<unsigned int> adjOffset(vertexCount + 1, 0);
+    for (size_t i = 0; i < triCount * 3; i++) adjOffset[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) adjOffset[v + 1] += adjOffset[v];
+    std::vector<unsigned int> adjTris(triCount * 3);
+    {
+        std::vector<unsigned int> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for (size_t t = 0; t < triCount; t++)
+            for (int k = 0; k < 3; k++) adjTris[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<unsigned int> live(vertexCount);        // triangles still to emit per vertex
+    for (size_t v = 0; v < vertexCount; v++) live[v] = adjOffset[v + 1] - adjOffset[v];
+    std::vector<unsigned int> timestamp(vertexCount, 0); // when the vertex last entered the cache
+    std::vector<char> emitted(triCount, 0);
+    std::vector<unsigned int> deadEnd;                   // recently used vertices, to restart near them
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(triCount * 3);
+
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0; // input order fallback when the dead-end stack runs dry
+    auto nextLiveInInputOrder = [&]() -> int {
+        for (; cursor < vertexCount; cursor++)
+            if (live[cursor] > 0) return int(cursor);
+        return -1;
+    };
+
+    int fan = nextLiveInInputOrder();
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (unsigned int a = adjOffset[fan]; a < adjOffset[fan + 1]; a++) {
+            unsigned int t = adjTris[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - timestamp[v] > cacheSize) timestamp[v] = time++;
+            }
+        }
+
+        // next fanning vertex: the candidate that is still in cache and will stay there longest
+        int next = -1, best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            int priority = 0;
+            if (time - timestamp[v] + 2 * live[v] <= cacheSize) priority = int(time - timestamp[v]);
+            if (priority > best) { best = priority; next = int(v); }
+        }
+        if (next < 0) {
+            // dead end: everything nearby is finished, this starts a new cluster
+            while (!deadEnd.empty() && next < 0) {
+                unsigned int d = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[d] > 0) next = int(d);
+            }
+            if (next < 0) next = nextLiveInInputOrder();
+            if (next >= 0) boundaries.push_back(output.size() / 3);
+        }
+        fan = next;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+    return boundaries;
+}
+
+// ─────────────────────────────────────────────
+// Overdraw
+// ─────
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      const std::vector<size_t>& hardBoundaries, float threshold, unsigned int cacheSize) {
+    size_t triCount = indexCount / 3;
+    if (triCount == 0) return;
+
+    // cluster starts: Tipsify's restarts, plus soft splits that don't cost much cache efficiency
+    std::vector<size_t> hard = { 0 };
+    for (size_t b : hardBoundaries) if (b > hard.back() && b < triCount) hard.push_back(b);
+    hard.push_back(triCount);
+
+    std::vector<size_t> clusterStart;
+    FifoCacheSim cache(vertexCount, cacheSize);
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t begin = hard[h], end = hard[h + 1];
+
+        size_t clusterMisses = 0;
+        cache.reset();
+        for (size_t i = begin * 3; i < end * 3; i++) clusterMisses += cache.access(indices[i]);
+        float clusterAcmr = float(clusterMisses) / float(end - begin);
+
+        size_t start = begin, misses = 0;
+        clusterStart.push_back(begin);
+        cache.reset();
+        for (size_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) misses += cache.access(indices[t * 3 + k]);
+            size_t tris = t + 1 - start;
+            // split once the running ACMR is back under budget, but not into slivers
+            if (tris >= 16 && t + 1 < end && float(misses) / tris <= clusterAcmr * threshold) {
+                clusterStart.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.reset(); // the next cluster may be drawn far from this one
+            }
+        }
+    }
+    clusterStart.push_back(triCount);
+    size_t clusterCount = clusterStart.size() - 1;
+
+    // mesh centroid (area weighted)
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCenter(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    for (size_t c = 0; c < clusterCount; c++) {
+        float area = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length = 2 * area
+            float a = glm::length(n);
+            clusterCenter[c] += (p0 + p1 + p2) * (a / 3.0f);
+            clusterNormal[c] += n;
+            area += a;
+        }
+        meshCenter += clusterCenter[c];
+        meshArea += area;
+        if (area > 0.0f) clusterCenter[c] /= area;
+    }
+    if (meshArea > 0.0f) meshCenter /= meshArea;
+
+    // clusters facing away from the middle of the mesh tend to occlude the rest: draw them first
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float len = glm::length(clusterNormal[c]);
+        sortKey[c] = len > 0.0f ? glm::dot(clusterCenter[c] - meshCenter, clusterNormal[c] / len) : 0.0f;
+    }
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triCount * 3);
+    for (size_t c : order)
+        sorted.insert(sorted.end(), indices + clusterStart[c] * 3, indices + clusterStart[c + 1] * 3);
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+// ─────────────────────────────────────────────
+// Vertex fetch
+// ─────
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, unsigned int* indices, size_t indexCount) {
+    const unsigned int UNUSED = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int& r = remap[indices[i]];
+        if (r == UNUSED) {
+            r = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = r;
+    }
+    vertices.swap(reordered);
+}
+
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    if (indices.size() < 3) return;
+    VertexCacheStats before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    std::vector<size_t> clusters = OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    OptimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size(), clusters);
+    OptimizeVertexFetch(vertices, indices.data(), indices.size());
+
+    VertexCacheStats after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    std::cout << "Mesh reorder (FIFO 16): ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
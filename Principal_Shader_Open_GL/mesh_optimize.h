@@ -0,0 +1,31 @@
+#pragma once
+#include "mesh_utils.h"
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Index/vertex reordering between dedup and upload
+// ─────
+// 1. OptimizeVertexCache: Tipsify (Sander et al. 2007) reorders triangles for the post-transform cache
+// 2. OptimizeOverdraw:    splits that order into clusters and draws outward-facing, outer clusters first
+// 3. OptimizeVertexFetch: renumbers vertices in first-use order so the VBO is read front to back
+// None of these change the geometry, only the order it is stored in.
+
+struct VertexCacheStats {
+    float acmr = 0.0f; // average cache miss ratio: vertex transforms per triangle (0.5 is ideal, 3 is worst)
+    float atvr = 0.0f; // average transform to vertex ratio: transforms per unique vertex (1 is ideal)
+};
+
+// Simulates a FIFO post-transform cache on the CPU, no GPU needed
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorders triangles in place; returns the triangle offsets where Tipsify had to restart (cluster boundaries)
+std::vector<size_t> OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+// Reorders whole clusters from OptimizeVertexCache. threshold lets clusters be split further as long as
+// their own ACMR stays within threshold x of the unsplit cluster (1.05 = up to 5% more cache misses).
+void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                      const std::vector<size_t>& hardBoundaries, float threshold = 1.05f, unsigned int cacheSize = 16);
+// Remaps vertices into first-use order (unreferenced vertices are dropped)
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, unsigned int* indices, size_t indexCount);
+
+// Runs all three passes and prints ACMR/ATVR before and after
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
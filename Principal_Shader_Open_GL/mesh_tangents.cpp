@@ -0,0 +1,327 @@
+// mesh_tangents.cpp
+#include "mesh_utils.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define TANGENTS_SSE 1
+#endif
+
+// ─────────────────────────────────────────────
+// ComputeTangents: MikkTSpace-compatible tangent frames
+// ─────
+// Follows the MikkTSpace rules so baked normal maps line up:
+//  - per-triangle tangent from the UV gradient, flipped when the UV winding is mirrored
+//  - per corner, projected onto the vertex normal's plane and weighted by the corner angle
+//  - corners of mirrored and non-mirrored triangles never average together; a vertex used
+//    by both is split, and the duplicate takes the mirrored corners
+//  - w = bitangent sign, so B = cross(N, T) * w
+// Triangles with zero UV area contribute nothing; a vertex with no usable triangle gets an
+// arbitrary frame around its normal instead of NaNs.
+//
+// Triangles are processed in fixed-size chunks, in parallel. Chunk c owns the vertices between
+// the largest index used by chunks 0..c-1 and the largest used by chunks 0..c; after
+// OptimizeVertexFetch (vertices numbered by first use) that's nearly every vertex it touches.
+// Corner tangents are computed 4 triangles at a time with SIMD and added straight into owned
+// vertices; the rest go to the chunk's overflow list, merged afterwards in chunk order.
+// Chunking doesn't depend on the thread count, so neither does the result.
+
+static const uint8_t FACE_ORIENT_PRESERVING = 1; // UV winding matches triangle winding
+static const uint8_t FACE_HAS_TANGENT = 2;       // non-zero UV area and tangent length
+
+// ─────────────────────────────────────────────
+// 4-wide float helpers (SSE2, or plain loops where it isn't available)
+// ─────
+#if TANGENTS_SSE
+struct F4 { __m128 v; };
+static inline void Store4(float* p, F4 a) { _mm_storeu_ps(p, a.v); }
+static inline F4 Splat4(float f) { return { _mm_set1_ps(f) }; }
+static inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+static inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline F4 operator/(F4 a, F4 b) { return { _mm_div_ps(a.v, b.v) }; }
+static inline F4 Sqrt4(F4 a) { return { _mm_sqrt_ps(a.v) }; }
+static inline F4 RsqrtEstimate4(F4 a) { return { _mm_rsqrt_ps(a.v) }; } // ~12 bits
+static inline F4 Min4(F4 a, F4 b) { return { _mm_min_ps(a.v, b.v) }; }
+static inline F4 Max4(F4 a, F4 b) { return { _mm_max_ps(a.v, b.v) }; }
+static inline F4 Abs4(F4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+static inline F4 Greater4(F4 a, F4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; } // all-ones lanes where a > b
+static inline F4 MaskAnd4(F4 mask, F4 a) { return { _mm_and_ps(mask.v, a.v) }; }
+static inline F4 MaskBoth4(F4 m0, F4 m1) { return { _mm_and_ps(m0.v, m1.v) }; }
+static inline F4 Select4(F4 mask, F4 a, F4 b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+static inline int MaskBits4(F4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+struct F4 { float v[4]; };
+#define F4_MAP(expr) F4 r; for (int i = 0; i < 4; i++) r.v[i] = (expr); return r
+static inline void Store4(float* p, F4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+static inline F4 Splat4(float f) { F4_MAP(f); }
+static inline F4 operator+(F4 a, F4 b) { F4_MAP(a.v[i] + b.v[i]); }
+static inline F4 operator-(F4 a, F4 b) { F4_MAP(a.v[i] - b.v[i]); }
+static inline F4 operator*(F4 a, F4 b) { F4_MAP(a.v[i] * b.v[i]); }
+static inline F4 operator/(F4 a, F4 b) { F4_MAP(a.v[i] / b.v[i]); }
+static inline F4 Sqrt4(F4 a) { F4_MAP(std::sqrt(a.v[i])); }
+static inline F4 RsqrtEstimate4(F4 a) { F4_MAP(1.0f / std::sqrt(a.v[i])); }
+static inline F4 Min4(F4 a, F4 b) { F4_MAP(std::min(a.v[i], b.v[i])); }
+static inline F4 Max4(F4 a, F4 b) { F4_MAP(std::max(a.v[i], b.v[i])); }
+static inline F4 Abs4(F4 a) { F4_MAP(std::fabs(a.v[i])); }
+// masks hold 1.0 / 0.0 per lane
+static inline F4 Greater4(F4 a, F4 b) { F4_MAP(a.v[i] > b.v[i] ? 1.0f : 0.0f); }
+static inline F4 MaskAnd4(F4 mask, F4 a) { F4_MAP(mask.v[i] != 0.0f ? a.v[i] : 0.0f); }
+static inline F4 MaskBoth4(F4 m0, F4 m1) { F4_MAP(m0.v[i] != 0.0f && m1.v[i] != 0.0f ? 1.0f : 0.0f); }
+static inline F4 Select4(F4 mask, F4 a, F4 b) { F4_MAP(mask.v[i] != 0.0f ? a.v[i] : b.v[i]); }
+static inline int MaskBits4(F4 mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= (mask.v[i] != 0.0f) << i; return bits; }
+#undef F4_MAP
+#endif
+
+struct Vec3x4 { F4 x, y, z; };
+
+static inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static inline Vec3x4 operator*(const Vec3x4& a, F4 s) { return { a.x * s, a.y * s, a.z * s }; }
+static inline F4 Dot4(const Vec3x4& a, const Vec3x4& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+// 1 / sqrt(x) to ~23 bits: hardware estimate + one Newton step, no divide.
+// Lanes where x is ~0 get `fallback` instead of inf/NaN.
+static inline F4 RsqrtNonZero4(F4 x, F4 fallback) {
+    F4 r = RsqrtEstimate4(x);
+    r = r * (Splat4(1.5f) - Splat4(0.5f) * x * r * r);
+    return Select4(Greater4(x, Splat4(FLT_MIN)), r, fallback);
+}
+
+// v / |v|, v unchanged when it's ~0 (MikkTSpace leaves near-zero vectors alone)
+static inline Vec3x4 NormalizeNonZero4(const Vec3x4& v) {
+    return v * RsqrtNonZero4(Dot4(v, v), Splat4(1.0f));
+}
+
+// removes the component along unit vector n
+static inline Vec3x4 ProjectOntoPlane4(const Vec3x4& v, const Vec3x4& n) {
+    return v - n * Dot4(n, v);
+}
+
+// acos via Abramowitz & Stegun 4.4.46 (|error| <= 2e-8 rad on [0, 1]), mirrored for negative inputs
+static inline F4 Acos4(F4 c) {
+    F4 x = Abs4(c);
+    F4 p = Splat4(-0.0012624911f);
+    p = p * x + Splat4(0.0066700901f);
+    p = p * x + Splat4(-0.0170881256f);
+    p = p * x + Splat4(0.0308918810f);
+    p = p * x + Splat4(-0.0501743046f);
+    p = p * x + Splat4(0.0889789874f);
+    p = p * x + Splat4(-0.2145988016f);
+    p = p * x + Splat4(1.5707963050f);
+    F4 r = Sqrt4(Max4(Splat4(1.0f) - x, Splat4(0.0f))) * p;
+    return Select4(Greater4(Splat4(0.0f), c), Splat4(3.14159265358979f) - r, r);
+}
+
+// position / normal / uv of 4 vertices, transposed to SoA
+#if TANGENTS_SSE
+static_assert(offsetof(Vertex, normal) == 12 && offsetof(Vertex, texCoord) == 24,
+              "LoadVertices4 reads Vertex as two 16-byte rows");
+static inline void LoadVertices4(const Vertex* const vtx[4], Vec3x4& p, Vec3x4& n, F4& u, F4& v) {
+    // row 0 = (px, py, pz, nx), row 1 = (ny, nz, u, v)
+    __m128 a0 = _mm_loadu_ps(&vtx[0]->position.x), a1 = _mm_loadu_ps(&vtx[1]->position.x);
+    __m128 a2 = _mm_loadu_ps(&vtx[2]->position.x), a3 = _mm_loadu_ps(&vtx[3]->position.x);
+    __m128 b0 = _mm_loadu_ps(&vtx[0]->normal.y), b1 = _mm_loadu_ps(&vtx[1]->normal.y);
+    __m128 b2 = _mm_loadu_ps(&vtx[2]->normal.y), b3 = _mm_loadu_ps(&vtx[3]->normal.y);
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+    p = { { a0 }, { a1 }, { a2 } };
+    n = { { a3 }, { b0 }, { b1 } };
+    u = { b2 };
+    v = { b3 };
+}
+#else
+static inline void LoadVertices4(const Vertex* const vtx[4], Vec3x4& p, Vec3x4& n, F4& u, F4& v) {
+    for (int i = 0; i < 4; i++) {
+        p.x.v[i] = vtx[i]->position.x; p.y.v[i] = vtx[i]->position.y; p.z.v[i] = vtx[i]->position.z;
+        n.x.v[i] = vtx[i]->normal.x;   n.y.v[i] = vtx[i]->normal.y;   n.z.v[i] = vtx[i]->normal.z;
+        u.v[i] = vtx[i]->texCoord.x;   v.v[i] = vtx[i]->texCoord.y;
+    }
+}
+#endif
+
+// ─────────────────────────────────────────────
+// Corner tangents, 4 triangles at a time
+// ─────
+// Writes each corner's angle-weighted tangent to result[corner][xyz][lane]; lanes without a
+// usable tangent are zero and cleared in validBits.
+static void ComputeCornerBlock(const Vertex* vertices, const unsigned int* indices, size_t firstTri, size_t lanes,
+                               float result[3][3][4], int& orientBits, int& validBits) {
+    // short blocks repeat their last triangle
+    const Vertex* corner[3][4];
+    for (size_t lane = 0; lane < 4; lane++) {
+        const unsigned int* tri = indices + 3 * (firstTri + std::min(lane, lanes - 1));
+        for (int k = 0; k < 3; k++) corner[k][lane] = vertices + tri[k];
+    }
+    Vec3x4 p[3], n[3];
+    F4 u[3], v[3];
+    // normals are used as given, like MikkTSpace (which expects them normalized)
+    for (int k = 0; k < 3; k++) LoadVertices4(corner[k], p[k], n[k], u[k], v[k]);
+
+    // face tangent (MikkTSpace eq. 18): scaled by the sign of the UV area instead of dividing by it
+    F4 t21x = u[1] - u[0], t21y = v[1] - v[0];
+    F4 t31x = u[2] - u[0], t31y = v[2] - v[0];
+    Vec3x4 d1 = p[1] - p[0], d2 = p[2] - p[0];
+    F4 signedArea = t21x * t31y - t21y * t31x;
+    Vec3x4 faceT = d1 * t31y - d2 * t21y;
+
+    F4 orient = Greater4(signedArea, Splat4(0.0f));
+    F4 faceLen2 = Dot4(faceT, faceT);
+    F4 valid = MaskBoth4(Greater4(Abs4(signedArea), Splat4(FLT_MIN)), Greater4(faceLen2, Splat4(FLT_MIN)));
+    F4 scale = Select4(orient, Splat4(1.0f), Splat4(-1.0f)) * RsqrtNonZero4(faceLen2, Splat4(0.0f));
+    faceT = faceT * MaskAnd4(valid, scale);
+
+    for (int k = 0; k < 3; k++) {
+        const Vec3x4& pk = p[k];
+        const Vec3x4& nk = n[k];
+        Vec3x4 t = NormalizeNonZero4(ProjectOntoPlane4(faceT, nk));
+        // corner angle between the two edges, both projected onto the normal's plane;
+        // a collapsed edge counts as perpendicular, like MikkTSpace
+        Vec3x4 e0 = ProjectOntoPlane4(p[(k + 2) % 3] - pk, nk);
+        Vec3x4 e1 = ProjectOntoPlane4(p[(k + 1) % 3] - pk, nk);
+        F4 cosAngle = Dot4(e0, e1) * RsqrtNonZero4(Dot4(e0, e0) * Dot4(e1, e1), Splat4(0.0f));
+        cosAngle = Min4(Max4(cosAngle, Splat4(-1.0f)), Splat4(1.0f));
+        t = t * Acos4(cosAngle);
+        Store4(result[k][0], t.x);
+        Store4(result[k][1], t.y);
+        Store4(result[k][2], t.z);
+    }
+    orientBits = MaskBits4(orient);
+    validBits = MaskBits4(valid) & ((1 << lanes) - 1);
+}
+
+// ─────────────────────────────────────────────
+// Finishing
+// ─────
+// any unit vector perpendicular to n (Duff et al. 2017), for vertices with no usable UVs
+static glm::vec3 FallbackTangent(glm::vec3 n) {
+    float len = glm::length(n);
+    n = len > FLT_MIN ? n / len : glm::vec3(0.0f, 0.0f, 1.0f);
+    float sign = std::copysign(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    return glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+}
+
+static glm::vec4 FinishTangent(const glm::vec3& sum, const glm::vec3& normal, float sign) {
+    float len = glm::length(sum);
+    if (!(len > FLT_MIN)) return glm::vec4(FallbackTangent(normal), 1.0f); // also catches NaN
+    return glm::vec4(sum / len, sign);
+}
+
+struct OverflowCorner {
+    unsigned int vertex;
+    int orient; // 1 = orientation preserving
+    glm::vec3 tangent;
+};
+
+static const size_t TANGENT_CHUNK_TRIS = 1 << 14;
+
+void ComputeTangents(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const size_t triCount = indices.size() / 3;
+    const size_t vertexCount = vertices.size();
+    if (vertexCount == 0) return;
+    const size_t chunkCount = (triCount + TANGENT_CHUNK_TRIS - 1) / TANGENT_CHUNK_TRIS;
+
+    // vertex ownership: chunk c owns [ownedEnd[c - 1], ownedEnd[c])
+    std::vector<size_t> ownedEnd(chunkCount, 0);
+    ParallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t last = std::min(3 * triCount, 3 * (c + 1) * TANGENT_CHUNK_TRIS);
+            unsigned int maxIndex = 0;
+            for (size_t i = 3 * c * TANGENT_CHUNK_TRIS; i < last; i++) maxIndex = std::max(maxIndex, indices[i]);
+            ownedEnd[c] = size_t(maxIndex) + 1;
+        }
+    });
+    for (size_t c = 1; c < chunkCount; c++) ownedEnd[c] = std::max(ownedEnd[c], ownedEnd[c - 1]);
+
+    // per vertex: sums[2v] = mirrored corners, sums[2v + 1] = orientation-preserving corners;
+    // found[v] has bit `orient` set once a corner of that orientation contributed
+    std::vector<glm::vec3> sums(2 * vertexCount, glm::vec3(0.0f));
+    std::vector<uint8_t> found(vertexCount, 0);
+    std::vector<uint8_t> faceFlags(triCount);
+    std::vector<std::vector<OverflowCorner>> overflow(chunkCount);
+
+    ParallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t ownedBegin = c ? ownedEnd[c - 1] : 0;
+            size_t firstTri = c * TANGENT_CHUNK_TRIS;
+            size_t lastTri = std::min(triCount, firstTri + TANGENT_CHUNK_TRIS);
+            for (size_t t0 = firstTri; t0 < lastTri; t0 += 4) {
+                size_t lanes = std::min<size_t>(4, lastTri - t0);
+                alignas(16) float result[3][3][4];
+                int orientBits, validBits;
+                ComputeCornerBlock(vertices.data(), indices.data(), t0, lanes, result, orientBits, validBits);
+
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    int orient = (orientBits >> lane) & 1;
+                    bool valid = (validBits >> lane) & 1;
+                    faceFlags[t0 + lane] = uint8_t((orient ? FACE_ORIENT_PRESERVING : 0) | (valid ? FACE_HAS_TANGENT : 0));
+                    if (!valid) continue;
+                    for (int k = 0; k < 3; k++) {
+                        unsigned int v = indices[3 * (t0 + lane) + k];
+                        glm::vec3 t(result[k][0][lane], result[k][1][lane], result[k][2][lane]);
+                        if (v >= ownedBegin && v < ownedEnd[c]) {
+                            sums[2 * size_t(v) + orient] += t;
+                            found[v] |= uint8_t(1 << orient);
+                        } else {
+                            overflow[c].push_back({ v, orient, t });
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    for (const auto& list : overflow) {
+        for (const OverflowCorner& corner : list) {
+            sums[2 * size_t(corner.vertex) + corner.orient] += corner.tangent;
+            found[corner.vertex] |= uint8_t(1 << corner.orient);
+        }
+    }
+    overflow = std::vector<std::vector<OverflowCorner>>();
+
+    // orientation-preserving corners keep the original vertex; mirrored ones move to a copy below
+    ParallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            if (found[v] & 2)
+                vertices[v].tangent = FinishTangent(sums[2 * v + 1], vertices[v].normal, 1.0f);
+            else if (found[v] & 1)
+                vertices[v].tangent = FinishTangent(sums[2 * v], vertices[v].normal, -1.0f);
+            else
+                vertices[v].tangent = glm::vec4(FallbackTangent(vertices[v].normal), 1.0f);
+        }
+    }, 1 << 12);
+
+    // Split vertices used by both orientations (only UV mirror seams get here)
+    std::vector<unsigned int> copyOf;
+    size_t splitCount = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (found[v] != 3) continue;
+        if (copyOf.empty()) copyOf.assign(vertexCount, 0);
+        Vertex copy = vertices[v];
+        copy.tangent = FinishTangent(sums[2 * v], copy.normal, -1.0f);
+        copyOf[v] = static_cast<unsigned int>(vertices.size());
+        vertices.push_back(copy);
+        splitCount++;
+    }
+    if (!splitCount) return;
+
+    ParallelFor(triCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            if (faceFlags[t] != FACE_HAS_TANGENT) continue; // mirrored triangles with a tangent only
+            for (int k = 0; k < 3; k++) {
+                unsigned int& index = indices[3 * t + k];
+                if (found[index] == 3) index = copyOf[index];
+            }
+        }
+    }, 1 << 14);
+    std::cout << "Tangents: split " << splitCount << " vertices on mirrored UV seams" << std::endl;
+}
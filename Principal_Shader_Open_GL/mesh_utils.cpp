@@ -1,5 +1,11 @@
 // mesh_utils.cpp
 #include "mesh_utils.h"
+#include "thread_utils.h"
+#include "mesh_cache.h"
+#include "vertex_packing.h"
+#include "mesh_optimize.h"
+#include "mesh_lod.h"
+#include "mesh_meshlets.h"
 #include "External/tinyobjloader/tiny_obj_loader.h"
 #include <glad/glad.h>
 #include <cstddef>
@@ -8,35 +14,44 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+
+// attribute layout for a VBO of PackedVertex (locations match the full layout, basic.vert decodes)
+static void SetPackedVertexAttributes() {
+    // position: unorm16 x3, scaled back into the mesh bounds by uPosOffset/uPosScale; w carries the bitangent sign
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+    // normal: octahedral snorm16 x2
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(1);
+    // texCoord: half float x2
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+    glEnableVertexAttribArray(2);
+    // tangent: octahedral snorm16 x2
+    glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+    glEnableVertexAttribArray(3);
+}
 
+void SetInstanceAttributes(size_t firstInstance) {
+    size_t base = firstInstance * sizeof(InstanceData);
+    // model matrix: a mat4 attribute takes four consecutive locations, one column each
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribDivisor(4 + column, 1); // advance once per instance, not per vertex
+    }
+    // material index: integer attribute, so the I variant (no float conversion)
+    glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, materialIndex)));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+}
 
-Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
-    Mesh mesh;
-    mesh.vertexCount = vertices.size();
-    mesh.indexCount = indices.size();
-    
-    glGenVertexArrays(1, &mesh.VAO); // generate 1 VAO
-    glGenBuffers(1, &mesh.VBO); // create 1 buffer ID
-    glGenBuffers(1, &mesh.EBO); 
-
-
-    // VAO
-    glBindVertexArray(mesh.VAO); // bind it (make it active)
-    
-    // VBO
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO); // bind the buffer (target = array buffer)
-    glBufferData(GL_ARRAY_BUFFER, 
-        vertices.size() * sizeof(Vertex), 
-        vertices.data(), GL_STATIC_DRAW);
-    
-
-    // EBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO); // bind the buffer (target = array buffer)
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            indices.size() * sizeof(unsigned int),   // not sizeof(Vertex)
-            indices.data(), GL_STATIC_DRAW);
-
-
+// attribute layout for a VBO of Vertex
+static void SetFullVertexAttributes() {
     // position attribute (location = 0)
     glVertexAttribPointer(
         0,                                  // index (matches "layout (location = 0)" in shader)
@@ -73,78 +88,125 @@ Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned
     // tangent attribute (location = 3)
     glVertexAttribPointer(
         3,                                  // index (matches "layout (location = 3)" in shader)
-        3,                                  // size 
+        4,                                  // size (xyz + bitangent sign)
         GL_FLOAT,                           // type
         GL_FALSE,                           // normalize?
         sizeof(Vertex),                     // stride (size of 1 Vertex)
         (void*)offsetof(Vertex, tangent)   // offset (start at beginning of array)
     );
     glEnableVertexAttribArray(3); // enable that vertex attribute
+}
 
-    glBindVertexArray(0); // unbinds VAO to prevent accidntal modification elswhere
-    return mesh;
+void SetVertexAttributes(VertexFormat format) {
+    if (format == VertexFormat::Packed) SetPackedVertexAttributes();
+    else SetFullVertexAttributes();
+}
+
+// instance buffer + its attributes on the bound VAO (one identity instance until setInstances is called)
+static void CreateInstanceBuffer(Mesh& mesh) {
+    glGenBuffers(1, &mesh.instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceVBO);
+    InstanceData identity = { glm::mat4(1.0f), 0 };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData), &identity, GL_STREAM_DRAW);
+    mesh.instanceCount = 1;
+    mesh.instanceCapacity = 1;
+    SetInstanceAttributes(0);
+}
+
+void Mesh::setInstances(const InstanceData* instances, size_t count) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    // glBufferData with no data orphans the old storage: draws still reading it keep their copy and the
+    // driver hands back fresh memory (GL 3.3 has no persistent mapping). Capacity only ever doubles.
+    if (count > instanceCapacity) instanceCapacity = std::max(count, instanceCapacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+    instanceCount = static_cast<int>(count);
 }
 
-void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
-    // Loop through each triangle (3 indices at a time)
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        // fetch triangle vertex data
-        Vertex& v0 = vertices[indices[i]];
-        Vertex& v1 = vertices[indices[i + 1]];
-        Vertex& v2 = vertices[indices[i + 2]];
-
-        // World Positions
-        glm::vec3 pos0 = v0.position;
-        glm::vec3 pos1 = v1.position;
-        glm::vec3 pos2 = v2.position;
-
-        // Texture coordinates
-        glm::vec2 uv0 = v0.texCoord;
-        glm::vec2 uv1 = v1.texCoord;
-        glm::vec2 uv2 = v2.texCoord;
-
-        // Vector Edges of the triangle (in model space)
-        glm::vec3 edge1 = pos1 - pos0;
-        glm::vec3 edge2 = pos2 - pos0;
-
-        // UV deltas (in texture space) - UV space edges
-        glm::vec2 deltaUV1 = uv1 - uv0;
-        glm::vec2 deltaUV2 = uv2 - uv0;
-
-        float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        glm::vec3 tangent;
-        tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent = glm::normalize(tangent);
-
-        // Accumulate tangent per vertex (in case of sharing)
-        v0.tangent += tangent;
-        v1.tangent += tangent;
-        v2.tangent += tangent;
+Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, VertexFormat format,
+                const std::vector<MeshLod>& lods, const std::vector<Meshlet>& meshlets) {
+    return createMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), format, lods.data(), lods.size(),
+                      meshlets.data(), meshlets.size());
+}
+
+Mesh createMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, VertexFormat format,
+                const MeshLod* lods, size_t lodCount, const Meshlet* meshlets, size_t meshletCount) {
+    Mesh mesh;
+    mesh.vertexCount = static_cast<int>(vertexCount);
+    mesh.format = format;
+    if (lodCount > 0) mesh.lods.assign(lods, lods + lodCount);
+    else mesh.lods.push_back({ 0, static_cast<unsigned int>(indexCount), 0.0f });
+    mesh.indexCount = static_cast<int>(mesh.lods[0].indexCount);
+    if (meshletCount > 0) mesh.meshlets.assign(meshlets, meshlets + meshletCount);
+    else BuildMeshlets(vertices, vertexCount, indices, mesh.lods.data(), mesh.lods.size(), mesh.meshlets);
+
+    // bounding sphere for LOD selection (box center, farthest vertex)
+    if (vertexCount > 0) {
+        glm::vec3 lo = vertices[0].position, hi = lo;
+        for (size_t i = 1; i < vertexCount; i++) {
+            lo = glm::min(lo, vertices[i].position);
+            hi = glm::max(hi, vertices[i].position);
+        }
+        mesh.boundsCenter = 0.5f * (lo + hi);
+        float radius2 = 0.0f;
+        for (size_t i = 0; i < vertexCount; i++) {
+            glm::vec3 d = vertices[i].position - mesh.boundsCenter;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+        mesh.boundsRadius = std::sqrt(radius2);
     }
+    
+    glGenVertexArrays(1, &mesh.VAO); // generate 1 VAO
+    glGenBuffers(1, &mesh.VBO); // create 1 buffer ID
+    glGenBuffers(1, &mesh.EBO); 
+
 
-    // Normalize the accumulated tangents
-    for (Vertex& v : vertices) {
-        v.tangent = glm::normalize(v.tangent);
+    // VAO
+    glBindVertexArray(mesh.VAO); // bind it (make it active)
+    
+    // VBO
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO); // bind the buffer (target = array buffer)
+    if (format == VertexFormat::Packed) {
+        mesh.quantization = ComputeQuantization(vertices, vertexCount);
+        std::vector<PackedVertex> packed;
+        PackVertices(vertices, vertexCount, mesh.quantization, packed);
+        glBufferData(GL_ARRAY_BUFFER, 
+            packed.size() * sizeof(PackedVertex), 
+            packed.data(), GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, 
+            vertexCount * sizeof(Vertex), 
+            vertices, GL_STATIC_DRAW);
     }
+    
+
+    // EBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO); // bind the buffer (target = array buffer)
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            indexCount * sizeof(unsigned int),   // not sizeof(Vertex)
+            indices, GL_STATIC_DRAW);
+
+    SetVertexAttributes(format);
+    CreateInstanceBuffer(mesh);
+
+    glBindVertexArray(0); // unbinds VAO to prevent accidntal modification elswhere
+    return mesh;
 }
 
 Mesh createQuad() {
     //each Vertex has vec of position, normal, texCoord and tangent 
     std::vector<Vertex> vertices = {
         // Bottom-left
-        { glm::vec3(-1.0f, -1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
+        { glm::vec3(-1.0f, -1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
 
         // Bottom-right
-        { glm::vec3( 1.0f, -1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
+        { glm::vec3( 1.0f, -1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
 
         // Top-left
-        { glm::vec3(-1.0f,  1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3(-1.0f,  1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Top-right
-        { glm::vec3( 1.0f,  1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3( 1.0f,  1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
     };
 
     std::vector<unsigned int> indices = {
@@ -156,7 +218,7 @@ Mesh createQuad() {
     return createMesh(vertices, indices); // send to GPU
 }
 
-void renderCube() {
+void renderCube(RenderStateTracker& state) {
     static unsigned int cubeVAO = 0;
     static unsigned int cubeVBO = 0;
     if (cubeVAO == 0) {
@@ -208,54 +270,53 @@ void renderCube() {
         glGenBuffers(1, &cubeVBO);
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        glBindVertexArray(cubeVAO);
+        state.bindVertexArray(cubeVAO);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     }
-    glBindVertexArray(cubeVAO);
+    state.bindVertexArray(cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
 }
 
-Mesh createCube() {
+Mesh createCube(VertexFormat format) {
     // Each face needs its own vertices to have correct UV mapping
     // 24 vertices total (4 per face, 6 faces)
     std::vector<Vertex> vertices = {
         // Front face (Z+)
-        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Back face (Z-)
-        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Left face (X-)
-        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Right face (X+)
-        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Bottom face (Y-)
-        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) },
+        { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f, -0.5f, -0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f, -0.5f,  0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) },
 
         // Top face (Y+)
-        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec3(0.0f) },
-        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f) },
-        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f) }
+        { glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec4(0.0f) },
+        { glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec4(0.0f) },
+        { glm::vec3(-0.5f,  0.5f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec4(0.0f) }
     };
 
     std::vector<unsigned int> indices = {
@@ -274,80 +335,257 @@ Mesh createCube() {
     };
 
     ComputeTangents(vertices, indices);
-    return createMesh(vertices, indices);
+    return createMesh(vertices, indices, format);
 }
 
-Mesh loadObjModel(const std::string& path) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+// ─────────────────────────────────────────────
+// VertexDedupTable
+// ─────
+VertexDedupTable::VertexDedupTable(size_t expectedKeys, size_t positionCount)
+    : positionCount(positionCount) {
+    // keep the load factor at or below 50%
+    size_t capacity = 16;
+    while (capacity < expectedKeys * 2) capacity <<= 1;
+    rehash(capacity);
+}
 
-    bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
+size_t VertexDedupTable::homeSlot(int v, int n, int t) const {
+    // The position index picks the run, a mix of the normal/uv indices picks the slot inside it.
+    // OBJ corners reference nearby positions in sequence, so this keeps probes cache-friendly.
+    uint32_t h = static_cast<uint32_t>(n) * 0x9E3779B1u ^ static_cast<uint32_t>(t) * 0x85EBCA77u;
+    h ^= h >> 15;
+    size_t run = static_cast<size_t>(static_cast<uint32_t>(v)) << strideShift;
+    return (run + (h & ((1u << strideShift) - 1))) & mask;
+}
 
-    if (!warn.empty()) std::cout << "tinyobj warning: " << warn << std::endl;
-    if (!err.empty()) std::cerr << "tinyobj error: " << err << std::endl;
-    if (!success) {
-        std::cerr << "Failed to load OBJ: " << path << std::endl;
-        return createCube(); // fallback
+void VertexDedupTable::rehash(size_t newCapacity) {
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(newCapacity, Slot{ 0, 0, 0, EMPTY_SLOT });
+    mask = newCapacity - 1;
+    strideShift = 0;
+    while (positionCount > 0 && (positionCount << (strideShift + 1)) <= newCapacity) strideShift++;
+
+    for (const Slot& s : old) {
+        if (s.value == EMPTY_SLOT) continue;
+        size_t i = homeSlot(s.v, s.n, s.t);
+        while (slots[i].value != EMPTY_SLOT) i = (i + 1) & mask;
+        slots[i] = s;
     }
+}
 
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+unsigned int VertexDedupTable::findOrInsert(int vertexIndex, int normalIndex, int texcoordIndex, unsigned int newIndex) {
+    size_t i = homeSlot(vertexIndex, normalIndex, texcoordIndex);
+    while (true) {
+        Slot& s = slots[i];
+        if (s.value == EMPTY_SLOT) break;
+        if (s.v == vertexIndex && s.n == normalIndex && s.t == texcoordIndex) return s.value;
+        i = (i + 1) & mask;
+    }
+
+    // new key: grow only if the up-front estimate was too low
+    if ((count + 1) * 2 > slots.size()) {
+        rehash(slots.size() * 2);
+        return findOrInsert(vertexIndex, normalIndex, texcoordIndex, newIndex);
+    }
+    slots[i] = Slot{ vertexIndex, normalIndex, texcoordIndex, newIndex };
+    count++;
+    return newIndex;
+}
+
+static Vertex MakeObjVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx) {
+    Vertex vert;
+    vert.position = {
+        attrib.vertices[3 * idx.vertex_index + 0],
+        attrib.vertices[3 * idx.vertex_index + 1],
+        attrib.vertices[3 * idx.vertex_index + 2]
+    };
+
+    vert.normal = glm::vec3(0.0f);
+    if (idx.normal_index >= 0 && !attrib.normals.empty()) {
+        vert.normal = {
+            attrib.normals[3 * idx.normal_index + 0],
+            attrib.normals[3 * idx.normal_index + 1],
+            attrib.normals[3 * idx.normal_index + 2]
+        };
+    }
+
+    vert.texCoord = glm::vec2(0.0f);
+    if (idx.texcoord_index >= 0 && !attrib.texcoords.empty()) {
+        vert.texCoord = {
+            attrib.texcoords[2 * idx.texcoord_index + 0],
+            attrib.texcoords[2 * idx.texcoord_index + 1]
+        };
+    }
+
+    vert.tangent = glm::vec4(0.0f); // to be calculated
+    return vert;
+}
 
-    std::unordered_map<std::string, unsigned int> uniqueVertexMap;
+void BuildObjVertices(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    // Reserve everything from the face corner count so the hot loop never allocates.
+    // Unique vertices can't exceed the corner count, and for closed meshes they rarely
+    // exceed the largest attribute array by much, so size the table for whichever is smaller.
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) cornerCount += shape.mesh.indices.size();
+    size_t attribCount = std::max({ attrib.vertices.size() / 3, attrib.normals.size() / 3, attrib.texcoords.size() / 2 });
+    size_t expectedUnique = std::min(cornerCount, attribCount + attribCount / 4);
+
+    VertexDedupTable uniqueVertices(expectedUnique, attrib.vertices.size() / 3);
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(expectedUnique);
+    indices.reserve(cornerCount);
 
     for (const auto& shape : shapes) {
         size_t index_offset = 0;
         for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
             int fv = shape.mesh.num_face_vertices[f];
             for (int v = 0; v < fv; v++) {
-                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-
-                glm::vec3 pos = {
-                    attrib.vertices[3 * idx.vertex_index + 0],
-                    attrib.vertices[3 * idx.vertex_index + 1],
-                    attrib.vertices[3 * idx.vertex_index + 2]
-                };
-
-                glm::vec3 normal = glm::vec3(0.0f);
-                if (idx.normal_index >= 0 && !attrib.normals.empty()) {
-                    normal = {
-                        attrib.normals[3 * idx.normal_index + 0],
-                        attrib.normals[3 * idx.normal_index + 1],
-                        attrib.normals[3 * idx.normal_index + 2]
-                    };
-                }
-
-                glm::vec2 uv = glm::vec2(0.0f);
-                if (idx.texcoord_index >= 0 && !attrib.texcoords.empty()) {
-                    uv = {
-                        attrib.texcoords[2 * idx.texcoord_index + 0],
-                        attrib.texcoords[2 * idx.texcoord_index + 1]
-                    };
-                }
-
-                Vertex vert;
-                vert.position = pos;
-                vert.normal = normal;
-                vert.texCoord = uv;
-                vert.tangent = glm::vec3(0.0f); // to be calculated
-
-                std::string key = std::to_string(idx.vertex_index) + "/" +
-                                  std::to_string(idx.normal_index) + "/" +
-                                  std::to_string(idx.texcoord_index);
-
-                if (uniqueVertexMap.count(key) == 0) {
-                    uniqueVertexMap[key] = static_cast<unsigned int>(vertices.size());
-                    vertices.push_back(vert);
-                }
-
-                indices.push_back(uniqueVertexMap[key]);
+                const tinyobj::index_t& idx = shape.mesh.indices[index_offset + v];
+
+                unsigned int newIndex = static_cast<unsigned int>(vertices.size());
+                unsigned int index = uniqueVertices.findOrInsert(idx.vertex_index, idx.normal_index, idx.texcoord_index, newIndex);
+                if (index == newIndex)
+                    vertices.push_back(MakeObjVertex(attrib, idx));
+
+                indices.push_back(index);
             }
             index_offset += fv;
         }
     }
+}
 
+void BuildObjVerticesParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                              std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    // treat all shapes as one long corner stream
+    std::vector<size_t> shapeStart(shapes.size() + 1, 0);
+    for (size_t s = 0; s < shapes.size(); s++)
+        shapeStart[s + 1] = shapeStart[s] + shapes[s].mesh.indices.size();
+    size_t cornerCount = shapeStart.back();
+
+    ThreadPool& pool = ThreadPool::global();
+    const size_t minCornersPerChunk = 1 << 16;
+    size_t chunkCount = std::min<size_t>(cornerCount / minCornersPerChunk, pool.size() * 4);
+    if (chunkCount < 2) {
+        BuildObjVertices(attrib, shapes, vertices, indices);
+        return;
+    }
+    size_t chunkSize = (cornerCount + chunkCount - 1) / chunkCount;
+
+    auto forEachCorner = [&](size_t begin, size_t end, auto&& fn) {
+        size_t s = std::upper_bound(shapeStart.begin(), shapeStart.end(), begin) - shapeStart.begin() - 1;
+        for (size_t i = begin; i < end; s++) {
+            const std::vector<tinyobj::index_t>& src = shapes[s].mesh.indices;
+            size_t stop = std::min(end, shapeStart[s + 1]);
+            for (; i < stop; i++) fn(i, src[i - shapeStart[s]]);
+        }
+    };
+
+    // 1) each chunk dedups on its own; indices temporarily hold chunk-local ids
+    indices.assign(cornerCount, 0);
+    std::vector<std::vector<tinyobj::index_t>> localVerts(chunkCount);
+    ParallelFor(chunkCount, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) {
+            size_t begin = c * chunkSize, end = std::min(cornerCount, begin + chunkSize);
+            VertexDedupTable table((end - begin) / 2, (end - begin) / 2);
+            std::vector<tinyobj::index_t>& uniques = localVerts[c];
+            forEachCorner(begin, end, [&](size_t i, const tinyobj::index_t& idx) {
+                unsigned int newIndex = static_cast<unsigned int>(uniques.size());
+                unsigned int index = table.findOrInsert(idx.vertex_index, idx.normal_index, idx.texcoord_index, newIndex);
+                if (index == newIndex) uniques.push_back(idx);
+                indices[i] = index;
+            });
+        }
+    });
+
+    // 2) merge chunk uniques in stream order, so ids come out in the same first-use order
+    //    as the serial loader. Only unique vertices pass through here, not every corner.
+    size_t localTotal = 0;
+    for (const auto& uniques : localVerts) localTotal += uniques.size();
+    size_t attribCount = std::max({ attrib.vertices.size() / 3, attrib.normals.size() / 3, attrib.texcoords.size() / 2 });
+    VertexDedupTable globalTable(std::min(localTotal, attribCount + attribCount / 4), attrib.vertices.size() / 3);
+
+    std::vector<std::vector<unsigned int>> remap(chunkCount);
+    std::vector<unsigned int> firstNewId(chunkCount + 1, 0); // prefix sum of vertices first seen per chunk
+    unsigned int nextId = 0;
+    for (size_t c = 0; c < chunkCount; c++) {
+        firstNewId[c] = nextId;
+        remap[c].resize(localVerts[c].size());
+        for (size_t u = 0; u < localVerts[c].size(); u++) {
+            const tinyobj::index_t& idx = localVerts[c][u];
+            remap[c][u] = globalTable.findOrInsert(idx.vertex_index, idx.normal_index, idx.texcoord_index, nextId);
+            if (remap[c][u] == nextId) nextId++;
+        }
+    }
+    firstNewId[chunkCount] = nextId;
+
+    // 3) chunks rewrite their indices and fill in the vertices they introduced
+    vertices.resize(nextId);
+    ParallelFor(chunkCount, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) {
+            size_t begin = c * chunkSize, end = std::min(cornerCount, begin + chunkSize);
+            for (size_t i = begin; i < end; i++) indices[i] = remap[c][indices[i]];
+            for (size_t u = 0; u < localVerts[c].size(); u++) {
+                if (remap[c][u] >= firstNewId[c])
+                    vertices[remap[c][u]] = MakeObjVertex(attrib, localVerts[c][u]);
+            }
+        }
+    });
+}
+
+void ProcessObjShapes(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                      std::vector<MeshLod>& lods, std::vector<Meshlet>& meshlets) {
+    BuildObjVerticesParallel(attrib, shapes, vertices, indices);
+    OptimizeMesh(vertices, indices); // file order -> vertex cache / overdraw / fetch friendly order
+
+    size_t vertexCount = vertices.size();
     ComputeTangents(vertices, indices);
-    return createMesh(vertices, indices);
+    // mirrored UV splits were appended at the end of the VBO: renumber into first-use order again
+    if (vertices.size() != vertexCount) OptimizeVertexFetch(vertices, indices.data(), indices.size());
+
+    BuildLodChain(vertices, indices, lods); // appends the coarser levels to indices
+    BuildMeshlets(vertices.data(), vertices.size(), indices.data(), lods.data(), lods.size(), meshlets);
+}
+
+Mesh loadObjModel(const std::string& path, VertexFormat format) {
+    // The binary cache next to the .obj is valid as long as the .obj bytes haven't changed.
+    // On a hit the file is mapped and uploaded directly: no tinyobj, no dedup, no tangents, no LODs, no meshlets.
+    uint64_t sourceHash = 0;
+    bool hashed = HashFile(path, sourceHash);
+    std::string cachePath = MeshCachePath(path);
+    if (hashed) {
+        MappedMesh cached;
+        if (OpenMeshCache(cachePath, sourceHash, cached)) {
+            std::cout << "Loaded mesh cache: " << cachePath << std::endl;
+            return createMesh(cached.vertices, cached.header->vertexCount, cached.indices, cached.header->indexCount, format,
+                              cached.lods, cached.header->lodCount, cached.meshlets, cached.header->meshletCount);
+        }
+    }
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
+
+    if (!warn.empty()) std::cout << "tinyobj warning: " << warn << std::endl;
+    if (!err.empty()) std::cerr << "tinyobj error: " << err << std::endl;
+    if (!success) {
+        std::cerr << "Failed to load OBJ: " << path << std::endl;
+        return createCube(format); // fallback
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    ProcessObjShapes(attrib, shapes, vertices, indices, lods, meshlets);
+
+    if (hashed && !WriteMeshCache(cachePath, sourceHash, vertices, indices, lods, meshlets))
+        std::cerr << "Could not write mesh cache: " << cachePath << std::endl;
+    return createMesh(vertices, indices, format, lods, meshlets);
 }
@@ -10,6 +10,9 @@
 #include <iostream>
 #include <cstddef>
 #include <filesystem>
+#include <vector>
+#include "External/tinyobjloader/tiny_obj_loader.h"
+#include "render_state.h"
 // ─────────────────────────────────────────────
 // Vertex struct: holds per-vertex data
 // ─────
@@ -18,36 +21,190 @@ struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 texCoord;
-    glm::vec3 tangent = glm::vec3(0.0);
+    glm::vec4 tangent = glm::vec4(0.0); // xyz = tangent, w = bitangent sign (B = cross(N, T) * w)
 };
 
+// ─────────────────────────────────────────────
+// VertexFormat: how a Mesh's vertex buffer is laid out on the GPU
+// ─────
+// Full   = Vertex as-is (48 bytes of floats)
+// Packed = PackedVertex (20 bytes, see vertex_packing.h); basic.vert decodes it when uPackedVertices is set
+enum class VertexFormat { Full, Packed };
+
+// Packed positions are unorm16 inside the mesh bounds: position = offset + scale * stored
+struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// One level of detail: a range of the mesh's shared EBO (see mesh_lod.h)
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    float error; // how far this level may deviate from LOD 0, in object-space units
+    unsigned int meshletOffset = 0; // this level's run of Mesh::meshlets (see mesh_meshlets.h)
+    unsigned int meshletCount = 0;
+};
+
+// A small cluster of one LOD's triangles: a contiguous EBO range plus what the CPU needs to cull it
+struct Meshlet {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    glm::vec3 center; // bounding sphere, object space
+    float radius;
+    glm::vec3 coneAxis; // every triangle normal lies within acos(coneCutoff) of coneAxis
+    float coneCutoff;   // <= 0: normals too spread out to ever be all backfacing
+};
+
+// Per-frame output of meshlet culling, reused between frames so drawing doesn't allocate.
+// Visible meshlets that sit next to each other in the EBO are merged into one range.
+struct MeshletDrawList {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets; // byte offsets into the EBO, as glMultiDrawElements wants them
+    std::vector<unsigned char> visible;
+};
+
+struct MeshletCullStats {
+    size_t meshletsTested = 0;
+    size_t meshletsCulled = 0;
+    size_t trianglesCulled = 0;
+};
+
+// Per-instance data read by basic.vert (locations 4-7: model matrix columns, 8: material index)
+struct InstanceData {
+    glm::mat4 model;
+    unsigned int materialIndex; // into basic.frag's uMaterialTints, or its MaterialTable row when batched
+};
+static const int MAX_MATERIAL_TINTS = 8;
+
 // ─────────────────────────────────────────────
 // Mesh struct: holds GPU handle info and helpers
 // ─────
+// Every draw is instanced: plain draws use instance 0, so one object is just a one-instance upload.
 struct Mesh {
     GLuint VAO; // Vertex Array Object: blueprint of how OpenGL should handle vertex data later in rendering
     GLuint VBO; // Vertex Buffer Object: holds actual vertex data (like triangle positions)
     GLuint EBO;
+    GLuint instanceVBO; // InstanceData per instance, re-filled with setInstances
+    int instanceCount = 0;
+    size_t instanceCapacity = 0; // instances the current buffer storage holds
     int vertexCount;
-    int indexCount;
+    int indexCount; // LOD 0 only; coarser levels follow it in the EBO
+    VertexFormat format = VertexFormat::Full;
+    VertexQuantization quantization; // only meaningful for VertexFormat::Packed
+    std::vector<MeshLod> lods;       // lods[0] is full detail
+    std::vector<Meshlet> meshlets;   // every level's meshlets, back to back
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
 
     void draw() const {
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
     }
 
+    void drawLod(int lod) const {
+        const MeshLod& level = lods[lod];
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(size_t(level.indexOffset) * sizeof(unsigned int)));
+    }
+
+    // coarsest level whose error covers at most maxPixelError pixels on screen (mesh_lod.cpp)
+    int selectLod(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, float maxPixelError) const;
+
+    // picks the level from projected screen size and draws it; returns the level drawn
+    int draw(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, float maxPixelError = 1.0f) const {
+        int lod = selectLod(modelView, projection, viewportHeight, maxPixelError);
+        drawLod(lod);
+        return lod;
+    }
+
+    // every instance uploaded by setInstances, all at the same level of detail
+    void drawInstanced(int lod) const {
+        const MeshLod& level = lods[lod];
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+                                (void*)(size_t(level.indexOffset) * sizeof(unsigned int)), instanceCount);
+    }
+
+    // replaces the instance buffer contents; the old storage is orphaned so the GPU never stalls on it (mesh_utils.cpp)
+    void setInstances(const InstanceData* instances, size_t count);
+
+    // fills drawList with the index ranges of `lod` worth drawing: its meshlets inside the frustum and, with
+    // coneCulling, not facing away; the whole level when it has no meshlets. Issues no GL calls (mesh_meshlets.cpp)
+    MeshletCullStats cullLod(int lod, const glm::mat4& modelView, const glm::mat4& projection, bool coneCulling,
+                             MeshletDrawList& drawList) const;
+    // cullLod, then one glMultiDrawElements over the ranges
+    MeshletCullStats drawLodCulled(int lod, const glm::mat4& modelView, const glm::mat4& projection, bool coneCulling,
+                                   MeshletDrawList& drawList) const;
+
     void cleanup() const {
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
         glDeleteBuffers(1, &EBO);
+        glDeleteBuffers(1, &instanceVBO);
     }
 };
 
-void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices); // calculate tangent vectors for each vertex to support nomal mapping
+// ─────────────────────────────────────────────
+// VertexDedupTable: maps an OBJ (v, vn, vt) index triple to a vertex index
+// ─────
+// Open addressing with linear probing. Slots are reserved once from the corner count,
+// so lookups never allocate (the table only grows if the estimate was too small).
+// Each position index owns a small run of slots, so the table is walked in roughly the
+// same order as the OBJ's own vertex list instead of jumping around memory.
+class VertexDedupTable {
+public:
+    VertexDedupTable(size_t expectedKeys, size_t positionCount);
+
+    // returns the index already stored for this triple, or stores and returns newIndex
+    unsigned int findOrInsert(int vertexIndex, int normalIndex, int texcoordIndex, unsigned int newIndex);
+    size_t size() const { return count; }
+
+private:
+    struct Slot {
+        int v, n, t;
+        unsigned int value; // EMPTY_SLOT when unused
+    };
+    static constexpr unsigned int EMPTY_SLOT = 0xFFFFFFFFu;
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+    size_t positionCount = 0;
+    unsigned int strideShift = 0; // log2 of the slots owned by each position index
+
+    size_t homeSlot(int v, int n, int t) const;
+    void rehash(size_t newCapacity);
+};
+
+void ComputeTangents(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices); // MikkTSpace-compatible tangents for normal mapping; may split vertices on mirrored UV seams (mesh_tangents.cpp)
 Mesh createQuad();
-Mesh createMesh(); // generic function for any obj passed in 
-Mesh createCube();
-Mesh loadObjModel(const std::string& path);
-void renderCube();
+Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+                VertexFormat format = VertexFormat::Full, const std::vector<MeshLod>& lods = {},
+                const std::vector<Meshlet>& meshlets = {}); // generic function for any obj passed in 
+// uploads straight from the given memory (e.g. a mapped cache); no lods = the whole index buffer is LOD 0,
+// no meshlets = built here
+Mesh createMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                VertexFormat format = VertexFormat::Full, const MeshLod* lods = nullptr, size_t lodCount = 0,
+                const Meshlet* meshlets = nullptr, size_t meshletCount = 0);
+Mesh createCube(VertexFormat format = VertexFormat::Full);
+// Attribute pointers on the bound VAO: the vertex layout of format for the bound GL_ARRAY_BUFFER
+// (locations 0-3), and the InstanceData layout (locations 4-8) starting firstInstance records into
+// the bound GL_ARRAY_BUFFER. Moving firstInstance stands in for baseInstance where there is none.
+void SetVertexAttributes(VertexFormat format);
+void SetInstanceAttributes(size_t firstInstance = 0);
+Mesh loadObjModel(const std::string& path, VertexFormat format = VertexFormat::Full);
+// expands every face corner of the parsed OBJ into deduplicated vertices + triangle indices
+void BuildObjVertices(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+// same output as BuildObjVertices, byte for byte; splits the corner stream across the thread pool
+void BuildObjVerticesParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                              std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+// everything loadObjModel does between parsing and upload: BuildObjVerticesParallel, OptimizeMesh,
+// tangents, the LOD chain and meshlets
+void ProcessObjShapes(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                      std::vector<MeshLod>& lods, std::vector<Meshlet>& meshlets);
+void renderCube(RenderStateTracker& state); // unit cube positions only, for the skybox
 
 
@@ -0,0 +1,58 @@
+#include "render_state.h"
+
+static int TargetSlot(GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_CUBE_MAP: return 2;
+    default: return -1;
+    }
+}
+
+void RenderStateTracker::useProgram(GLuint newProgram) {
+    if (newProgram == program) {
+        counters.programBindsSkipped++;
+        return;
+    }
+    glUseProgram(newProgram);
+    program = newProgram;
+    counters.programBinds++;
+}
+
+void RenderStateTracker::bindVertexArray(GLuint newVertexArray) {
+    if (newVertexArray == vertexArray) {
+        counters.vertexArrayBindsSkipped++;
+        return;
+    }
+    glBindVertexArray(newVertexArray);
+    vertexArray = newVertexArray;
+    counters.vertexArrayBinds++;
+}
+
+void RenderStateTracker::bindTexture(int unit, GLenum target, GLuint texture) {
+    int slot = TargetSlot(target);
+    bool tracked = slot >= 0 && unit >= 0 && unit < MAX_TEXTURE_UNITS;
+    if (tracked && textures[unit][slot] == texture) {
+        counters.textureBindsSkipped++;
+        return;
+    }
+    if (unit != activeUnit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (tracked) textures[unit][slot] = texture;
+    counters.textureBinds++;
+}
+
+void RenderStateTracker::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    activeUnit = -1;
+    for (auto& unit : textures)
+        for (GLuint& texture : unit) texture = UNKNOWN;
+}
+
+void RenderStateTracker::beginFrame() {
+    counters = RenderStateStats();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+// ─────────────────────────────────────────────
+// RenderStateTracker: drops binds that would change nothing
+// ─────
+// Remembers the program, vertex array and per-unit texture bindings it set last, and skips a call
+// that would set the same again, across frames. It only sees what goes through it: after code that
+// binds behind its back (the IBL baker, createMesh, the scene batch and atlas uploads) or deletes an
+// object it may still hold (names get reused), the render loop calls invalidate(). The texture
+// streamer and ImGui's backend restore what they bind, so they are safe.
+struct RenderStateStats {
+    size_t programBinds = 0, programBindsSkipped = 0;
+    size_t vertexArrayBinds = 0, vertexArrayBindsSkipped = 0;
+    size_t textureBinds = 0, textureBindsSkipped = 0;
+
+    size_t issued() const { return programBinds + vertexArrayBinds + textureBinds; }
+    size_t skipped() const { return programBindsSkipped + vertexArrayBindsSkipped + textureBindsSkipped; }
+};
+
+class RenderStateTracker {
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    RenderStateTracker() { invalidate(); }
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY and GL_TEXTURE_CUBE_MAP are tracked per unit; other targets
+    // and units past MAX_TEXTURE_UNITS always bind
+    void bindTexture(int unit, GLenum target, GLuint texture);
+
+    // Forget everything: the next call of each kind binds
+    void invalidate();
+    // Zero the counters; the cache carries over from the last frame
+    void beginFrame();
+    const RenderStateStats& stats() const { return counters; }
+
+private:
+    static const int TRACKED_TARGETS = 3;
+    static const GLuint UNKNOWN = ~0u;
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    int activeUnit = -1;
+    GLuint textures[MAX_TEXTURE_UNITS][TRACKED_TARGETS];
+    RenderStateStats counters;
+};
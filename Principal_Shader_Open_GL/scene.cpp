@@ -0,0 +1,226 @@
+#include "scene.h"
+#include "file_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+
+// ─────────────────────────────────────────────
+// Scene
+// ─────
+void Scene::add(const Mesh& mesh, int material, const std::string& name) {
+    SubMesh submesh;
+    submesh.name = name;
+    submesh.mesh = mesh;
+    submesh.material = material;
+    if (submeshes.empty()) {
+        boundsCenter = mesh.boundsCenter;
+        boundsRadius = mesh.boundsRadius;
+    } else {
+        // smallest sphere around both spheres
+        glm::vec3 toMesh = mesh.boundsCenter - boundsCenter;
+        float distance = glm::length(toMesh);
+        if (distance + mesh.boundsRadius > boundsRadius) {
+            if (distance + boundsRadius <= mesh.boundsRadius) {
+                boundsCenter = mesh.boundsCenter;
+                boundsRadius = mesh.boundsRadius;
+            } else {
+                float radius = 0.5f * (distance + boundsRadius + mesh.boundsRadius);
+                boundsCenter += toMesh * ((radius - boundsRadius) / distance);
+                boundsRadius = radius;
+            }
+        }
+    }
+    submeshes.push_back(submesh);
+}
+
+size_t Scene::triangleCount() const {
+    size_t triangles = 0;
+    for (const SubMesh& submesh : submeshes) triangles += submesh.mesh.lods[0].indexCount / 3;
+    return triangles;
+}
+
+void Scene::clear(TextureStreamer& streamer) {
+    for (const SubMesh& submesh : submeshes) submesh.mesh.cleanup();
+    submeshes.clear();
+    for (size_t m = 1; m < materials.size(); m++)
+        for (TextureHandle handle : materials[m].textures)
+            if (handle != INVALID_TEXTURE_HANDLE) streamer.release(handle);
+    materials.resize(1);
+    boundsCenter = glm::vec3(0.0f);
+    boundsRadius = 0.0f;
+}
+
+// ─────────────────────────────────────────────
+// LoadObjScene
+// ─────
+// a text search, so an OBJ without materials never pays for a parse before loadObjModel's cache lookup
+static bool ObjUsesMaterials(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    static const char keyword[] = "usemtl";
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+    return std::search(begin, end, std::boyer_moore_horspool_searcher(keyword, keyword + 6)) != end;
+}
+
+static Material MakeMaterial(const tinyobj::material_t& source, const std::string& baseDir, TextureStreamer& streamer) {
+    Material material;
+    material.name = source.name;
+    MaterialBlock& params = material.params;
+    params.baseTint = glm::vec3(source.diffuse[0], source.diffuse[1], source.diffuse[2]);
+    // Pr when the .mtl has PBR extensions, otherwise the GGX roughness closest to its Blinn-Phong exponent
+    params.roughness = source.roughness > 0.0f ? source.roughness : std::pow(2.0f / (source.shininess + 2.0f), 0.25f);
+    params.metallic = source.metallic;
+
+    auto load = [&](MaterialTexture slot, const std::string& name, TextureRole role, std::string& path) {
+        if (name.empty()) return 0;
+        path = baseDir + name;
+        material.textures[slot] = streamer.load(path, role);
+        return 1;
+    };
+    MaterialSources& sources = material.sources;
+    params.useBaseTex = load(MATERIAL_BASE_COLOR, source.diffuse_texname, TextureRole::BaseColor, sources.baseColor);
+    // norm only: bump / map_Bump is usually a height map, not a tangent space normal map
+    params.useNormalTex = load(MATERIAL_NORMAL, source.normal_texname, TextureRole::Normal, sources.normal);
+    params.useRoughnessMap = load(MATERIAL_ROUGHNESS, source.roughness_texname, TextureRole::Mask, sources.orm.roughness);
+    params.useMetallicMap = load(MATERIAL_METALLIC, source.metallic_texname, TextureRole::Mask, sources.orm.metallic);
+    params.useAOMap = load(MATERIAL_AO, source.ambient_texname, TextureRole::Mask, sources.orm.ao);
+    return material;
+}
+
+void LoadObjScene(const std::string& path, VertexFormat format, TextureStreamer& streamer, Scene& scene) {
+    scene.clear(streamer);
+    std::string name = std::filesystem::path(path).stem().string();
+    if (!ObjUsesMaterials(path)) {
+        scene.add(loadObjModel(path, format), 0, name);
+        return;
+    }
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    std::string baseDir = std::filesystem::path(path).parent_path().string();
+    if (!baseDir.empty()) baseDir += '/';
+
+    bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), baseDir.c_str());
+
+    if (!warn.empty()) std::cout << "tinyobj warning: " << warn << std::endl;
+    if (!err.empty()) std::cerr << "tinyobj error: " << err << std::endl;
+    if (!success) {
+        std::cerr << "Failed to load OBJ: " << path << std::endl;
+        scene.add(createCube(format), 0, "cube"); // fallback
+        return;
+    }
+
+    for (const tinyobj::material_t& source : materials) scene.materials.push_back(MakeMaterial(source, baseDir, streamer));
+
+    // each material's faces of a shape are copied into a shape of their own and processed like a whole OBJ
+    std::vector<tinyobj::shape_t> part(1);
+    for (const tinyobj::shape_t& shape : shapes) {
+        const tinyobj::mesh_t& source = shape.mesh;
+        auto faceMaterial = [&](size_t f) { return f < source.material_ids.size() ? source.material_ids[f] : -1; };
+        std::vector<int> ids;
+        for (size_t f = 0; f < source.num_face_vertices.size(); f++) ids.push_back(faceMaterial(f));
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        for (int id : ids) {
+            tinyobj::mesh_t& mesh = part[0].mesh;
+            mesh.indices.clear();
+            mesh.num_face_vertices.clear();
+            size_t offset = 0;
+            for (size_t f = 0; f < source.num_face_vertices.size(); f++) {
+                unsigned int corners = source.num_face_vertices[f];
+                if (faceMaterial(f) == id) {
+                    mesh.num_face_vertices.push_back(corners);
+                    mesh.indices.insert(mesh.indices.end(), source.indices.begin() + offset,
+                                        source.indices.begin() + offset + corners);
+                }
+                offset += corners;
+            }
+
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            std::vector<MeshLod> lods;
+            std::vector<Meshlet> meshlets;
+            ProcessObjShapes(attrib, part, vertices, indices, lods, meshlets);
+            int material = id >= 0 && id < int(materials.size()) ? id + 1 : 0;
+            scene.add(createMesh(vertices, indices, format, lods, meshlets), material, shape.name);
+        }
+    }
+    std::cout << "Loaded scene " << path << ": " << scene.submeshes.size() << " submeshes, " << materials.size()
+              << " materials" << std::endl;
+}
+
+// ─────────────────────────────────────────────
+// DrawList
+// ─────
+uint64_t MakeDrawKey(GLuint program, int material, int submesh) {
+    return (uint64_t(program & 0xFFFFu) << 48) | (uint64_t(unsigned(material) & 0xFFFFFFu) << 24) |
+           uint64_t(unsigned(submesh) & 0xFFFFFFu);
+}
+
+void DrawList::add(GLuint program, const VertexUniforms& vertexUniforms, int material, int submesh, int lod,
+                   const MeshletDrawList* ranges) {
+    items.push_back({ MakeDrawKey(program, material, submesh), program, &vertexUniforms, material, submesh, lod, ranges });
+}
+
+void DrawList::sort() {
+    std::stable_sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+}
+
+DrawListStats DrawList::submit(const Scene& scene, const TextureStreamer& streamer, UniformBlock<MaterialBlock>& materialBlock,
+                               RenderStateTracker& state) const {
+    DrawListStats stats;
+    GLuint program = 0;
+    int material = -1, submesh = -1;
+    for (size_t i = 0; i < items.size(); i++) {
+        const DrawItem& item = items[i];
+        bool programChanged = i == 0 || item.program != program;
+        if (programChanged) {
+            state.useProgram(item.program);
+            program = item.program;
+            stats.programSwitches++;
+        }
+
+        if (item.material != material) {
+            const Material& source = scene.materials[item.material];
+            materialBlock.data = source.params;
+            std::copy(std::begin(scene.instanceTints), std::end(scene.instanceTints), materialBlock.data.tints);
+            if (materialBlock.flush()) stats.materialUploads++;
+            for (int t = 0; t < MATERIAL_TEXTURE_COUNT; t++) {
+                if (source.textures[t] != INVALID_TEXTURE_HANDLE)
+                    state.bindTexture(MATERIAL_TEXTURE_UNITS[t], GL_TEXTURE_2D, streamer.get(source.textures[t]));
+            }
+            material = item.material;
+            stats.materialSwitches++;
+        }
+
+        const Mesh& mesh = scene.submeshes[item.submesh].mesh;
+        if (programChanged || item.submesh != submesh) {
+            // packed meshes need their quantization bounds to decode positions
+            const VertexUniforms& vertexUniforms = *item.vertexUniforms;
+            glUniform1i(vertexUniforms.packedVertices, mesh.format == VertexFormat::Packed ? 1 : 0);
+            glUniform3fv(vertexUniforms.posOffset, 1, glm::value_ptr(mesh.quantization.offset));
+            glUniform3fv(vertexUniforms.posScale, 1, glm::value_ptr(mesh.quantization.scale));
+            submesh = item.submesh;
+        }
+
+        state.bindVertexArray(mesh.VAO);
+        if (item.ranges) {
+            if (item.ranges->counts.empty()) continue;
+            glMultiDrawElements(GL_TRIANGLES, item.ranges->counts.data(), GL_UNSIGNED_INT, item.ranges->offsets.data(),
+                                static_cast<GLsizei>(item.ranges->counts.size()));
+        } else {
+            const MeshLod& level = mesh.lods[item.lod];
+            glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT,
+                                    (void*)(size_t(level.indexOffset) * sizeof(unsigned int)), mesh.instanceCount);
+        }
+        stats.draws++;
+    }
+    return stats;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "mesh_utils.h"
+#include "render_state.h"
+#include "texture_orm.h"
+#include "texture_streamer.h"
+#include "uniforms.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Scene: materials, submeshes and a sorted draw list
+// ─────
+// An OBJ loads as one submesh per (shape, material) pair, each a full Mesh with its own LODs and
+// meshlets, plus one Material per .mtl entry. Each frame the caller adds a DrawItem per submesh to
+// a DrawList, sorts it by (program, material, submesh) and submits it. Program switches, Material
+// block uploads and material texture binds then happen once per run of equal keys, and
+// RenderStateTracker drops whatever is still redundant.
+
+enum MaterialTexture {
+    MATERIAL_BASE_COLOR, MATERIAL_NORMAL, MATERIAL_ROUGHNESS, MATERIAL_METALLIC, MATERIAL_AO, MATERIAL_ORM,
+    MATERIAL_TEXTURE_COUNT
+};
+// the unit basic.frag samples each one from (BindProgramSlots in uniforms.h)
+static const int MATERIAL_TEXTURE_UNITS[MATERIAL_TEXTURE_COUNT] = { 0, 1, 2, 3, 4, 7 };
+
+// Files a material's maps come from (empty: none), kept for MaterialAtlas, which decodes them itself
+struct MaterialSources {
+    std::string baseColor;
+    std::string normal;
+    OrmSources orm;
+};
+
+struct Material {
+    std::string name;
+    MaterialSources sources;
+    MaterialBlock params; // uploaded as the Material block; its tints are replaced by Scene::instanceTints
+    TextureHandle textures[MATERIAL_TEXTURE_COUNT] = { INVALID_TEXTURE_HANDLE, INVALID_TEXTURE_HANDLE,
+                                                       INVALID_TEXTURE_HANDLE, INVALID_TEXTURE_HANDLE,
+                                                       INVALID_TEXTURE_HANDLE, INVALID_TEXTURE_HANDLE }; // unset: not bound
+};
+
+struct SubMesh {
+    std::string name; // OBJ shape name
+    Mesh mesh;
+    int material = 0; // into Scene::materials
+};
+
+struct Scene {
+    // materials[0] is the default material: faces without one use it, and the app drives it from the UI
+    std::vector<Material> materials = std::vector<Material>(1);
+    std::vector<SubMesh> submeshes;
+    glm::vec4 instanceTints[MAX_MATERIAL_TINTS] = {}; // xyz, by InstanceData::materialIndex, under every material
+    glm::vec3 boundsCenter = glm::vec3(0.0f);         // sphere around every submesh
+    float boundsRadius = 0.0f;
+
+    // Takes ownership of mesh and grows the bounds
+    void add(const Mesh& mesh, int material, const std::string& name);
+    size_t triangleCount() const; // LOD 0 of every submesh
+    // Deletes the submeshes and releases the textures of the loaded materials; the default one stays
+    void clear(TextureStreamer& streamer);
+};
+
+// The OBJ's shapes, split by material, become the submeshes of scene (cleared first) and its .mtl
+// materials follow the default one, their maps streamed through streamer (paths relative to the
+// .obj). An OBJ without usemtl goes through loadObjModel as one submesh of the default material, so
+// it keeps the mesh cache; multi-material OBJs are processed on every load. A file that fails to
+// parse leaves the cube, like loadObjModel.
+void LoadObjScene(const std::string& path, VertexFormat format, TextureStreamer& streamer, Scene& scene);
+
+// ─────────────────────────────────────────────
+// DrawList
+// ─────
+// Program in the top 16 bits, then material and submesh in 24 bits each, so sorting by key groups
+// draws by program first, then by material within it, then by mesh.
+uint64_t MakeDrawKey(GLuint program, int material, int submesh);
+
+struct DrawItem {
+    uint64_t key;
+    GLuint program;
+    const VertexUniforms* vertexUniforms; // program's packed-vertex locations
+    int material;
+    int submesh;
+    int lod;
+    const MeshletDrawList* ranges; // set: one instance, glMultiDrawElements over them; null: the whole lod, every instance
+};
+
+struct DrawListStats {
+    size_t draws = 0;
+    size_t programSwitches = 0;
+    size_t materialSwitches = 0;
+    size_t materialUploads = 0; // Material block uploads; materials with equal parameters share one
+};
+
+class DrawList {
+public:
+    void clear() { items.clear(); }
+    void add(GLuint program, const VertexUniforms& vertexUniforms, int material, int submesh, int lod,
+             const MeshletDrawList* ranges = nullptr);
+    void sort(); // by key, stable
+    size_t size() const { return items.size(); }
+
+    // Issues the items in order. Programs may be different variants of basic.frag
+    // (shader_permutations.h), so each item brings its own program's packed-vertex locations.
+    DrawListStats submit(const Scene& scene, const TextureStreamer& streamer, UniformBlock<MaterialBlock>& materialBlock,
+                         RenderStateTracker& state) const;
+
+private:
+    std::vector<DrawItem> items;
+};
@@ -0,0 +1,167 @@
+#include "scene_batch.h"
+#include <algorithm>
+#include <iostream>
+
+static GLint BufferSize(GLuint buffer) {
+    GLint size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    return size;
+}
+
+bool SceneBatch::build(const Scene& scene) {
+    cleanup();
+    if (scene.submeshes.empty()) return false;
+    for (const SubMesh& submesh : scene.submeshes) {
+        if (submesh.mesh.format != VertexFormat::Full) {
+            std::cout << "Scene batch: packed vertices decode per submesh, drawing through the draw list instead" << std::endl;
+            return false;
+        }
+    }
+
+    // where each submesh lands in the shared buffers
+    std::vector<GLint> vertexSizes, indexSizes;
+    GLintptr vertexBytes = 0, indexBytes = 0;
+    for (const SubMesh& submesh : scene.submeshes) {
+        vertexSizes.push_back(BufferSize(submesh.mesh.VBO));
+        indexSizes.push_back(BufferSize(submesh.mesh.EBO));
+        ranges.push_back({ GLint(vertexBytes / GLintptr(sizeof(Vertex))), GLuint(indexBytes / GLintptr(sizeof(unsigned int))) });
+        vertexBytes += vertexSizes.back();
+        indexBytes += indexSizes.back();
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+
+    // buffer to buffer on the GPU: nothing comes back to the CPU, the indices stay relative to their
+    // submesh (the commands' baseVertex makes up for it)
+    GLintptr vertexOffset = 0, indexOffset = 0;
+    for (size_t s = 0; s < scene.submeshes.size(); s++) {
+        const Mesh& mesh = scene.submeshes[s].mesh;
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, vertexOffset, vertexSizes[s]);
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.EBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ELEMENT_ARRAY_BUFFER, 0, indexOffset, indexSizes[s]);
+        vertexOffset += vertexSizes[s];
+        indexOffset += indexSizes[s];
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    SetVertexAttributes(VertexFormat::Full);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    InstanceData identity = { glm::mat4(1.0f), 0 };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData), &identity, GL_STREAM_DRAW);
+    instanceCapacity = 1;
+    SetInstanceAttributes(0);
+    glBindVertexArray(0);
+
+#ifdef GL_VERSION_4_3
+    indirectSupported = GLAD_GL_VERSION_4_3 != 0; // the context we got, not the 3.3 we asked for
+    if (indirectSupported) glGenBuffers(1, &indirectBuffer);
+#endif
+    std::cout << "Scene batch: " << scene.submeshes.size() << " submeshes, " << (vertexBytes + indexBytes) / (1024.0 * 1024.0)
+              << " MB, " << (indirectSupported ? "glMultiDrawElementsIndirect" : "per-instance draws (no GL 4.3)") << std::endl;
+    return true;
+}
+
+void SceneBatch::cleanup() {
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = { VBO, EBO, instanceVBO, indirectBuffer };
+    for (GLuint buffer : buffers)
+        if (buffer) glDeleteBuffers(1, &buffer);
+    VAO = VBO = EBO = instanceVBO = indirectBuffer = 0;
+    instanceCapacity = commandCapacity = 0;
+    indirectSupported = false;
+    ranges.clear();
+    clear();
+}
+
+void SceneBatch::clear() {
+    commands.clear();
+    instances.clear();
+}
+
+void SceneBatch::add(const Scene& scene, int submesh, int lod, const InstanceData* source, size_t count) {
+    if (count == 0) return;
+    const MeshLod& level = scene.submeshes[submesh].mesh.lods[lod];
+    const SubMeshRange& range = ranges[submesh];
+    commands.push_back({ level.indexCount, GLuint(count), range.firstIndex + level.indexOffset, range.baseVertex,
+                         GLuint(instances.size()) });
+    instances.insert(instances.end(), source, source + count);
+}
+
+void SceneBatch::add(const Scene&, int submesh, const MeshletDrawList& culled, const InstanceData& instance) {
+    if (culled.counts.empty()) return;
+    const SubMeshRange& range = ranges[submesh];
+    GLuint baseInstance = GLuint(instances.size());
+    instances.push_back(instance);
+    for (size_t r = 0; r < culled.counts.size(); r++) {
+        GLuint firstIndex = GLuint(reinterpret_cast<size_t>(culled.offsets[r]) / sizeof(unsigned int));
+        commands.push_back({ GLuint(culled.counts[r]), 1, range.firstIndex + firstIndex, range.baseVertex, baseInstance });
+    }
+}
+
+// Grows capacity by doubling and orphans the old storage, like Mesh::setInstances
+static void StreamBuffer(GLenum target, const void* data, size_t bytes, size_t elementSize, size_t& capacity) {
+    size_t count = bytes / elementSize;
+    if (count > capacity) capacity = std::max(count, capacity * 2);
+    glBufferData(target, capacity * elementSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, bytes, data);
+}
+
+size_t SceneBatch::draw(RenderStateTracker& state) {
+    if (!VAO || commands.empty()) return 0;
+    state.bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    StreamBuffer(GL_ARRAY_BUFFER, instances.data(), instances.size() * sizeof(InstanceData), sizeof(InstanceData),
+                 instanceCapacity);
+
+#ifdef GL_VERSION_4_3
+    if (indirectSupported) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        StreamBuffer(GL_DRAW_INDIRECT_BUFFER, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand),
+                     sizeof(DrawElementsIndirectCommand), commandCapacity);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, GLsizei(commands.size()), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return 1;
+    }
+#endif
+
+    // no baseInstance: point the instance attributes (instanceVBO is still bound) at each command's
+    // first instance, and merge consecutive commands of the same single instance
+    size_t calls = 0;
+    for (size_t i = 0; i < commands.size();) {
+        const DrawElementsIndirectCommand& first = commands[i];
+        SetInstanceAttributes(first.baseInstance);
+        size_t end = i + 1;
+        if (first.instanceCount == 1)
+            while (end < commands.size() && commands[end].instanceCount == 1 && commands[end].baseInstance == first.baseInstance) end++;
+
+        if (end - i == 1) {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, GLsizei(first.count), GL_UNSIGNED_INT,
+                                              (void*)(size_t(first.firstIndex) * sizeof(unsigned int)), GLsizei(first.instanceCount),
+                                              first.baseVertex);
+        } else {
+            runCounts.clear();
+            runOffsets.clear();
+            runBaseVertices.clear();
+            for (size_t c = i; c < end; c++) {
+                runCounts.push_back(GLsizei(commands[c].count));
+                runOffsets.push_back((const void*)(size_t(commands[c].firstIndex) * sizeof(unsigned int)));
+                runBaseVertices.push_back(commands[c].baseVertex);
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, runCounts.data(), GL_UNSIGNED_INT, runOffsets.data(),
+                                          GLsizei(runCounts.size()), runBaseVertices.data());
+        }
+        calls++;
+        i = end;
+    }
+    return calls;
+}
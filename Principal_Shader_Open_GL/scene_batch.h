@@ -0,0 +1,73 @@
+#pragma once
+#include "mesh_utils.h"
+#include "render_state.h"
+#include "scene.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// SceneBatch: every submesh of a scene in one buffer, every draw in one call
+// ─────
+// build() copies the vertex and index buffers of all submeshes (every LOD) back to back into one
+// VBO and one EBO on the GPU, behind a single VAO. A draw of any submesh is then just a range of
+// that EBO plus a base vertex, and with the material coming from the instance's MaterialTable row
+// (material_atlas.h) nothing changes between draws. Each frame the caller adds commands and
+// instances, and draw() issues them:
+//   GL 4.3  one glMultiDrawElementsIndirect over every command, baseInstance picking each
+//           command's first instance
+//   GL 3.3  the instance attributes are re-pointed at each command's first instance instead; runs
+//           of single-instance commands (culled meshlet ranges) share a glMultiDrawElementsBaseVertex
+// Only VertexFormat::Full scenes batch: packed submeshes each decode with their own quantization.
+struct DrawElementsIndirectCommand { // the layout glMultiDrawElementsIndirect reads
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class SceneBatch {
+public:
+    SceneBatch() = default;
+    SceneBatch(const SceneBatch&) = delete;
+    SceneBatch& operator=(const SceneBatch&) = delete;
+
+    // Needs the GL context. Replaces the previous contents; false (and empty) when the scene has
+    // nothing to draw or a packed submesh
+    bool build(const Scene& scene);
+    // Call before the context goes away, and before the scene's meshes change
+    void cleanup();
+    bool built() const { return VAO != 0; }
+    bool indirect() const { return indirectSupported; }
+
+    // per frame: forget the last frame's commands and instances
+    void clear();
+    // every instance at one level of detail of submesh
+    void add(const Scene& scene, int submesh, int lod, const InstanceData* instances, size_t count);
+    // one instance, a command per culled range of submesh (byte offsets from Mesh::cullLod)
+    void add(const Scene& scene, int submesh, const MeshletDrawList& ranges, const InstanceData& instance);
+    size_t commandCount() const { return commands.size(); }
+
+    // Uploads the instances (and commands) and draws them all; returns the GL draw calls issued
+    size_t draw(RenderStateTracker& state);
+
+private:
+    struct SubMeshRange {
+        GLint baseVertex;
+        GLuint firstIndex;
+    };
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLuint instanceVBO = 0;
+    GLuint indirectBuffer = 0;
+    size_t instanceCapacity = 0, commandCapacity = 0;
+    bool indirectSupported = false;
+    std::vector<SubMeshRange> ranges; // per submesh
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<InstanceData> instances;
+    // GL 3.3 path: one run of single-instance commands, reused between frames
+    std::vector<GLsizei> runCounts;
+    std::vector<const void*> runOffsets;
+    std::vector<GLint> runBaseVertices;
+};
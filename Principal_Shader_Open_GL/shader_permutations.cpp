@@ -0,0 +1,183 @@
+#include "shader_permutations.h"
+#include "shader_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char* const FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+    "FEATURE_BASE_COLOR_TEX", "FEATURE_NORMAL_TEX", "FEATURE_ROUGHNESS_MAP", "FEATURE_METALLIC_MAP", "FEATURE_AO_MAP",
+    "FEATURE_ORM_MAP", "FEATURE_IBL", "FEATURE_POINT_LIGHT", "FEATURE_MATERIAL_TABLE",
+};
+static const char* const FEATURE_NAMES[SHADER_FEATURE_COUNT] = {
+    "base", "normal", "rough", "metal", "ao", "orm", "ibl", "point", "table",
+};
+
+std::string ShaderFeatureString(uint32_t features) {
+    if (features == UBER_VARIANT) return "uber";
+    std::string names;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+        if (!(features & (1u << i))) continue;
+        if (!names.empty()) names += '+';
+        names += FEATURE_NAMES[i];
+    }
+    return names.empty() ? "none" : names;
+}
+
+uint32_t ShaderFeaturesFor(const MaterialBlock& material, const LightsBlock& lights, bool materialTable) {
+    uint32_t features = 0;
+    if (lights.useIBL) features |= FEATURE_IBL;
+    if (lights.type != 0) features |= FEATURE_POINT_LIGHT;
+    if (materialTable) return features | FEATURE_MATERIAL_TABLE;
+
+    if (material.useBaseTex) features |= FEATURE_BASE_COLOR_TEX;
+    if (material.useNormalTex) features |= FEATURE_NORMAL_TEX;
+    if (material.useRoughnessMap) features |= FEATURE_ROUGHNESS_MAP;
+    if (material.useMetallicMap) features |= FEATURE_METALLIC_MAP;
+    if (material.useAOMap) features |= FEATURE_AO_MAP;
+    if (material.useOrmMap && (features & (FEATURE_ROUGHNESS_MAP | FEATURE_METALLIC_MAP | FEATURE_AO_MAP)))
+        features |= FEATURE_ORM_MAP;
+    return features;
+}
+
+std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    size_t insertAt = 0;
+    int nextLine = 1;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t end = source.find('\n', version);
+        insertAt = end == std::string::npos ? source.size() : end + 1;
+        for (size_t i = 0; i < insertAt; i++)
+            if (source[i] == '\n') nextLine++;
+    }
+    std::string block;
+    if (insertAt == source.size() && insertAt > 0 && source.back() != '\n') block += '\n';
+    for (const std::string& define : defines) block += "#define " + define + "\n";
+    block += "#line " + std::to_string(nextLine) + "\n";
+    return source.substr(0, insertAt) + block + source.substr(insertAt);
+}
+
+// NVIDIA's program binaries carry the generated assembly as text (!!NVfp5.0 ... END); count its
+// statements, leaving out declarations. Other drivers store machine code only: -1.
+static int CountAssemblyInstructions(const std::vector<char>& binary) {
+    static const char marker[] = "!!NVfp";
+    const char* begin = binary.data();
+    const char* end = begin + binary.size();
+    const char* text = std::search(begin, end, marker, marker + sizeof(marker) - 1);
+    if (text == end) return -1;
+
+    static const char* const declarations[] = { "OPTION", "PARAM", "TEMP", "ATTRIB", "OUTPUT", "SHORT", "LONG",
+                                                "CBUFFER", "BUFFER", "TEXTURE", "ADDRESS", "INT", "UINT", "FLOAT" };
+    int instructions = 0;
+    const char* line = std::find(text, end, '\n'); // skip the !!NVfp header
+    while (line < end) {
+        line++;
+        const char* lineEnd = std::find(line, end, '\n');
+        const char* p = line;
+        while (p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+        if (lineEnd - p >= 3 && std::strncmp(p, "END", 3) == 0) break;
+        bool statement = p < lineEnd && *p != '#' && std::find(p, lineEnd, ';') != lineEnd;
+        for (const char* keyword : declarations) {
+            size_t length = std::strlen(keyword);
+            if (statement && size_t(lineEnd - p) > length && std::strncmp(p, keyword, length) == 0 && p[length] == ' ')
+                statement = false;
+        }
+        if (statement) instructions++;
+        line = lineEnd;
+    }
+    return instructions;
+}
+
+static void MeasureVariant(ShaderVariant& variant) {
+    glGetProgramiv(variant.program, GL_ACTIVE_UNIFORMS, &variant.activeUniforms);
+#ifdef GL_VERSION_4_1
+    if (GLAD_GL_VERSION_4_1) { // glGetProgramBinary is core from 4.1 on
+        GLint length = 0;
+        glGetProgramiv(variant.program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            std::vector<char> binary(length);
+            GLenum format = 0;
+            glGetProgramBinary(variant.program, length, nullptr, &format, binary.data());
+            variant.binaryBytes = length;
+            variant.instructions = CountAssemblyInstructions(binary);
+        }
+    }
+#endif
+}
+
+bool ShaderPermutations::init(const char* vertexPath, const char* fragmentPath) {
+    std::string vertexSource = ReadTextFile(vertexPath);
+    fragmentSource = ReadTextFile(fragmentPath);
+    if (vertexSource.empty() || fragmentSource.empty()) return false;
+    vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
+    GLint compiled = 0;
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compiled);
+    return compiled != 0;
+}
+
+void ShaderPermutations::cleanup() {
+    for (auto& entry : cache)
+        if (entry.second.program) glDeleteProgram(entry.second.program);
+    cache.clear();
+    if (vertexShader) glDeleteShader(vertexShader);
+    vertexShader = 0;
+    fragmentSource.clear();
+}
+
+const ShaderVariant& ShaderPermutations::get(uint32_t features) {
+    auto found = cache.find(features);
+    if (found != cache.end()) {
+        if (found->second.program || features == UBER_VARIANT) return found->second;
+        return get(UBER_VARIANT);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    ShaderVariant& variant = cache[features];
+    variant.features = features;
+    std::string source = fragmentSource;
+    if (features != UBER_VARIANT) {
+        std::vector<std::string> defines = { "SHADER_PERMUTATION" };
+        for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+            defines.push_back(std::string(FEATURE_DEFINES[i]) + ((features & (1u << i)) ? " true" : " false"));
+        source = InjectDefines(fragmentSource, defines);
+    }
+
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, source.c_str());
+    GLuint program = LinkProgram(vertexShader, fragmentShader, true); // MeasureVariant reads the binary
+    glDeleteShader(fragmentShader); // flagged, freed with the program
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        std::cout << "Shader variant " << ShaderFeatureString(features) << " failed to link" << std::endl;
+        glDeleteProgram(program);
+        return features == UBER_VARIANT ? variant : get(UBER_VARIANT);
+    }
+    variant.program = program;
+    BindProgramSlots(program, features == UBER_VARIANT);
+    variant.vertexUniforms = getVertexUniforms(program);
+    glUseProgram(GLuint(previousProgram));
+    variant.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    MeasureVariant(variant);
+
+    std::cout << "Shader variant " << ShaderFeatureString(features) << ": " << variant.compileMs << " ms";
+    if (variant.instructions >= 0) std::cout << ", " << variant.instructions << " instructions";
+    std::cout << std::endl;
+    return variant;
+}
+
+void ShaderPermutations::printReport() const {
+    std::cout << "Shader variants (" << cache.size() << "):" << std::endl;
+    for (const auto& entry : cache) {
+        const ShaderVariant& variant = entry.second;
+        char instructions[16] = "n/a";
+        if (variant.instructions >= 0) std::snprintf(instructions, sizeof(instructions), "%d", variant.instructions);
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-40s %6s instr %8d B binary %3d uniforms %7.2f ms%s",
+                      ShaderFeatureString(variant.features).c_str(), instructions, variant.binaryBytes,
+                      variant.activeUniforms, variant.compileMs, variant.program ? "" : "  (failed)");
+        std::cout << line << std::endl;
+    }
+}
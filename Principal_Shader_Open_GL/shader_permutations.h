@@ -0,0 +1,78 @@
+#pragma once
+#include "uniforms.h"
+#include <glad/glad.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Shader permutations: basic.frag compiled once per feature set
+// ─────
+// The uber shader branches on the Material / Lights / Frame flags for every pixel, and keeps the
+// registers of every path live. basic.frag names each of those branches FEATURE_* and, compiled as
+// is, maps them back to the flags. ShaderPermutations compiles it with SHADER_PERMUTATION and every
+// FEATURE_* defined true or false after #version instead: the compiler folds the branches away and
+// the samplers of dropped paths go inactive. Variants compile on first request (a frame's hitch the
+// first time a checkbox combination shows up) and stay cached by feature mask. The vertex shader
+// is compiled once and linked into all of them.
+enum ShaderFeature : uint32_t {
+    FEATURE_BASE_COLOR_TEX = 1u << 0,
+    FEATURE_NORMAL_TEX = 1u << 1,
+    FEATURE_ROUGHNESS_MAP = 1u << 2,
+    FEATURE_METALLIC_MAP = 1u << 3,
+    FEATURE_AO_MAP = 1u << 4,
+    FEATURE_ORM_MAP = 1u << 5,
+    FEATURE_IBL = 1u << 6,
+    FEATURE_POINT_LIGHT = 1u << 7,
+    FEATURE_MATERIAL_TABLE = 1u << 8,
+};
+static const int SHADER_FEATURE_COUNT = 9;
+static const uint32_t UBER_VARIANT = ~0u; // key of the plain compile, every switch read at run time
+
+// "base+normal+ibl", "none", or "uber"
+std::string ShaderFeatureString(uint32_t features);
+
+// The switches a draw of material needs under lights. Batched draws (materialTable) read their
+// material from the table, so only the lighting switches apply; ORM alone, with none of the maps
+// it feeds, is dropped so it doesn't split variants that compile the same.
+uint32_t ShaderFeaturesFor(const MaterialBlock& material, const LightsBlock& lights, bool materialTable);
+
+// The source with defines inserted after its #version line, followed by a #line so compile errors
+// keep the file's line numbers
+std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines);
+
+struct ShaderVariant {
+    uint32_t features = 0;
+    GLuint program = 0; // 0: failed to link, get() hands out the uber variant instead
+    VertexUniforms vertexUniforms = {};
+    double compileMs = 0.0;  // fragment compile + link
+    int instructions = -1;   // fragment program instructions, where the driver exposes them (-1: it doesn't)
+    GLint binaryBytes = 0;   // size of the linked program binary (GL 4.1), 0 where not retrievable
+    GLint activeUniforms = 0; // samplers and plain uniforms left after dead code elimination
+};
+
+class ShaderPermutations {
+public:
+    ShaderPermutations() = default;
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // Needs the GL context. Reads both sources (ReadTextFile) and compiles the vertex shader
+    bool init(const char* vertexPath, const char* fragmentPath);
+    // Call before the context goes away
+    void cleanup();
+
+    // The variant of features, compiled, linked and set up (BindProgramSlots) on first use. Leaves
+    // the current program bound, so a RenderStateTracker's cache stays right.
+    const ShaderVariant& get(uint32_t features);
+    const std::map<uint32_t, ShaderVariant>& variants() const { return cache; }
+
+    // One line per compiled variant to stdout: features, instructions, binary size, uniforms, compile time
+    void printReport() const;
+
+private:
+    std::string fragmentSource;
+    GLuint vertexShader = 0;
+    std::map<uint32_t, ShaderVariant> cache;
+};
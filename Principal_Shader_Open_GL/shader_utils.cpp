@@ -40,10 +40,7 @@ GLuint CompileShader(GLenum type, const char* src) {
     return shader; 
 }
 
-GLuint LinkProgram(GLuint vertex_shader, GLuint frag_shader) {
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, frag_shader);
+static GLuint FinishLink(GLuint program) {
     glLinkProgram(program);
     GLint success;
     glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -63,6 +60,33 @@ GLuint LinkProgram(GLuint vertex_shader, GLuint frag_shader) {
     return program;
 }
 
+GLuint LinkProgram(GLuint vertex_shader, GLuint frag_shader, bool retrievableBinary) {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, frag_shader);
+#ifdef GL_VERSION_4_1
+    // without the hint several drivers report a binary length of 0
+    if (retrievableBinary && GLAD_GL_VERSION_4_1) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#else
+    (void)retrievableBinary;
+#endif
+    return FinishLink(program);
+}
+
+GLuint LinkProgram(GLuint vertex_shader, GLuint geometry_shader, GLuint frag_shader) {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, geometry_shader);
+    glAttachShader(program, frag_shader);
+    return FinishLink(program);
+}
+
+GLuint LinkComputeProgram(GLuint compute_shader) {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, compute_shader);
+    return FinishLink(program);
+}
+
 GLint  ULoc(GLuint program, const char* name) {  // glGetUniformLocation wrapper
     GLint loc = glGetUniformLocation(program, name);
     if (loc == -1) std::cerr << "Warning: uniform not found: " << name << "\n";
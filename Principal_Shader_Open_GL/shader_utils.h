@@ -4,5 +4,8 @@
 
 std::string ReadTextFile(const char* path);
 GLuint CompileShader(GLenum type, const char* src);
-GLuint LinkProgram(GLuint vs, GLuint fs);
+// retrievableBinary: ask the driver to keep the binary for glGetProgramBinary (GL 4.1; ignored before)
+GLuint LinkProgram(GLuint vs, GLuint fs, bool retrievableBinary = false);
+GLuint LinkProgram(GLuint vs, GLuint gs, GLuint fs);
+GLuint LinkComputeProgram(GLuint cs);
 GLint  ULoc(GLuint program, const char* name);  // glGetUniformLocation wrapper
@@ -3,41 +3,92 @@ out vec4 FragColor;
   
 in vec2 texCoord;
 in vec3 worldPos;
-in vec3 fragTangent; 
+in vec4 fragTangent; // w = bitangent sign
 in vec3 fragNormal;
+flat in uint fragMaterialIndex;
 
-// -- Lighting Uniforms --
-uniform vec3 uLight_Position;
-uniform vec3 uLight_Color;
-uniform vec3 uAmbient;
-uniform vec3 uCamera_Position;
-uniform int uLightType;
-uniform vec3 uDir_Direction;
-uniform float uSpotCosInner;
-uniform float uSpotCosOuter;
-
-// -- Material controls --
-uniform float uRoughness;
-uniform float uMetallic;
-uniform vec3 uDielectricF0;
-
-// -- Textures --
+// Uniform blocks, std140 (FrameBlock / LightsBlock / MaterialBlock / MaterialTableBlock in uniforms.h). A vec3 shares its
+// 16 byte slot with the scalar after it; reorder only together with the C++ structs.
+layout (std140) uniform Frame {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    vec3 uCamera_Position;
+    bool uLinearOutput; // headless EXR output: write linear HDR radiance, leave tone mapping and gamma to the viewer
+    bool uMaterialTable; // batched scene: the surface comes from uMaterials[fragMaterialIndex] and the atlas arrays
+};
+
+layout (std140) uniform Lights {
+    vec3 uLight_Position;
+    int uLightType;
+    vec3 uLight_Color;
+    float uSpotCosInner;
+    vec3 uDir_Direction;
+    float uSpotCosOuter;
+    vec3 uAmbient;
+    float uPrefilterMaxLod;
+    vec3 uIrradianceSH[9]; // For diffuse IBL: L2 spherical harmonics, convolved and over pi (ibl_utils.h)
+    bool useIBL;
+};
+
+layout (std140) uniform Material {
+    vec3 baseColorTint;
+    float uRoughness;
+    vec3 uDielectricF0;
+    float uMetallic;
+    vec3 uMaterialTints[8]; // per-instance tint picked by fragMaterialIndex (MAX_MATERIAL_TINTS in mesh_utils.h)
+    bool useBaseColorTex;
+    bool uUseNormalTex;
+    bool useRoughnessMap;
+    bool useMetallicMap;
+    bool useAOMap;
+    bool uUseOrmMap;   // AO/roughness/metallic come from uOrmMap
+};
+
+// Every material of a batched scene (material_atlas.h), one row per material. Layers index the atlas
+// arrays, -1 = no map; ormChannels says which ORM channels override ao (1), roughness (2), metallic (4).
+struct MaterialRecord {
+    vec3 baseTint;
+    float roughness;
+    float metallic;
+    int baseColorLayer;
+    int normalLayer;
+    int ormLayer;
+    int ormChannels;
+};
+
+layout (std140) uniform MaterialTable {
+    MaterialRecord uMaterials[256]; // MAX_TABLE_MATERIALS
+};
+
+// -- Textures (units set once by BindProgramSlots) --
 uniform sampler2D baseColorTex;
-uniform bool useBaseColorTex;
-uniform vec3 baseColorTint;
 uniform sampler2D uNormalTex;
-uniform bool uUseNormalTex;
 uniform sampler2D roughnessMap;
-uniform bool useRoughnessMap;
 uniform sampler2D metallicMap;
-uniform bool useMetallicMap;
 uniform sampler2D aoMap; 
-uniform bool useAOMap;
+uniform sampler2D uOrmMap; // R = AO, G = roughness, B = metallic (texture_orm.h)
+uniform sampler2DArray uBaseColorArray; // atlas arrays, one layer per map, picked through uMaterials
+uniform sampler2DArray uNormalArray;
+uniform sampler2DArray uOrmArray;
+
+// Feature switches. A plain compile (the uber shader) reads them from the blocks above at run time.
+// ShaderPermutations (shader_permutations.h) defines SHADER_PERMUTATION and sets every switch to true
+// or false after #version instead, so its variants carry no dead paths and no samplers they never read.
+#ifndef SHADER_PERMUTATION
+#define FEATURE_BASE_COLOR_TEX useBaseColorTex
+#define FEATURE_NORMAL_TEX uUseNormalTex
+#define FEATURE_ROUGHNESS_MAP useRoughnessMap
+#define FEATURE_METALLIC_MAP useMetallicMap
+#define FEATURE_AO_MAP useAOMap
+#define FEATURE_ORM_MAP uUseOrmMap
+#define FEATURE_IBL useIBL
+#define FEATURE_POINT_LIGHT (uLightType != 0)
+#define FEATURE_MATERIAL_TABLE uMaterialTable
+#endif
 
 // IBL - IMPORTANT: Need both maps!
-uniform samplerCube irradianceMap;  // For diffuse (blurry)
-uniform samplerCube environmentMap; // For specular (sharp) - ADD THIS!
-uniform bool useIBL;
+uniform samplerCube environmentMap; // For specular: GGX prefiltered, mip = roughness * uPrefilterMaxLod (ibl_utils.h)
+uniform sampler2D brdfLUT;          // split-sum BRDF scale / bias on F0 by (NdotV, roughness)
 
 float D_GGX(float NdotH, float roughness) {
     float alpha = roughness * roughness;
@@ -67,6 +118,20 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
 }
 
+// irradiance / pi around n from the 9 SH coefficients (same basis order as IrradianceSH)
+vec3 irradianceSH(vec3 n) {
+    vec3 e = uIrradianceSH[0] * 0.282095
+           + uIrradianceSH[1] * (0.488603 * n.y)
+           + uIrradianceSH[2] * (0.488603 * n.z)
+           + uIrradianceSH[3] * (0.488603 * n.x)
+           + uIrradianceSH[4] * (1.092548 * n.x * n.y)
+           + uIrradianceSH[5] * (1.092548 * n.y * n.z)
+           + uIrradianceSH[6] * (0.315392 * (3.0 * n.z * n.z - 1.0))
+           + uIrradianceSH[7] * (1.092548 * n.x * n.z)
+           + uIrradianceSH[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(e, vec3(0.0));
+}
+
 vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
 }
@@ -74,35 +139,57 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
 void main()
 {
     // ========== SURFACE PROPERTIES ==========
-    vec3 texColor = useBaseColorTex ? texture(baseColorTex, texCoord).rgb : vec3(1.0);
-    vec3 baseColor = texColor * baseColorTint;
-    
-    // Sample material properties
-    float roughness = uRoughness;
-    if (useRoughnessMap) {
-        roughness = texture(roughnessMap, texCoord).r;
-        // Optional: allow uniform to scale the map
-        // roughness *= uRoughness;
+    vec3 baseColor;
+    float roughness;
+    float metallic;
+    float ao;
+    bool hasNormalMap;
+    vec2 normalXY = vec2(0.0);
+    if (FEATURE_MATERIAL_TABLE) {
+        // batched scene: this instance's row of the table, every map fetched from its atlas layer
+        MaterialRecord m = uMaterials[min(fragMaterialIndex, 255u)];
+        vec3 texColor = m.baseColorLayer >= 0 ? texture(uBaseColorArray, vec3(texCoord, float(m.baseColorLayer))).rgb : vec3(1.0);
+        baseColor = texColor * m.baseTint;
+        vec3 orm = m.ormLayer >= 0 ? texture(uOrmArray, vec3(texCoord, float(m.ormLayer))).rgb : vec3(1.0, 1.0, 0.0);
+        roughness = (m.ormChannels & 2) != 0 ? orm.g : m.roughness;
+        metallic = (m.ormChannels & 4) != 0 ? orm.b : m.metallic;
+        ao = (m.ormChannels & 1) != 0 ? orm.r : 1.0;
+        hasNormalMap = m.normalLayer >= 0;
+        if (hasNormalMap) normalXY = texture(uNormalArray, vec3(texCoord, float(m.normalLayer))).rg * 2.0 - 1.0;
+    } else {
+        vec3 texColor = FEATURE_BASE_COLOR_TEX ? texture(baseColorTex, texCoord).rgb : vec3(1.0);
+        baseColor = texColor * baseColorTint * uMaterialTints[min(fragMaterialIndex, 7u)];
+
+        // Sample material properties: one fetch when AO/roughness/metallic are packed
+        vec3 orm = FEATURE_ORM_MAP ? texture(uOrmMap, texCoord).rgb : vec3(1.0, 1.0, 0.0);
+        roughness = uRoughness;
+        if (FEATURE_ROUGHNESS_MAP) {
+            roughness = FEATURE_ORM_MAP ? orm.g : texture(roughnessMap, texCoord).r;
+            // Optional: allow uniform to scale the map
+            // roughness *= uRoughness;
+        }
+
+        metallic = uMetallic;
+        if (FEATURE_METALLIC_MAP) {
+            metallic = FEATURE_ORM_MAP ? orm.b : texture(metallicMap, texCoord).r;
+            // Optional: allow uniform to scale
+            // metallic *= uMetallic;
+        }
+
+        ao = FEATURE_AO_MAP ? (FEATURE_ORM_MAP ? orm.r : texture(aoMap, texCoord).r) : 1.0;
+        hasNormalMap = FEATURE_NORMAL_TEX;
+        if (hasNormalMap) normalXY = texture(uNormalTex, texCoord).rg * 2.0 - 1.0;
     }
     roughness = clamp(roughness, 0.04, 1.0);
-    
-    float metallic = uMetallic;
-    if (useMetallicMap) {
-        metallic = texture(metallicMap, texCoord).r;
-        // Optional: allow uniform to scale
-        // metallic *= uMetallic;
-    }
     metallic = clamp(metallic, 0.0, 1.0);
     
-    float ao = useAOMap ? texture(aoMap, texCoord).r : 1.0;
-    
     // ========== NORMAL ==========
     vec3 N = normalize(fragNormal);
-    if (uUseNormalTex) {
-        vec3 normalSample = texture(uNormalTex, texCoord).rgb * 2.0 - 1.0;
-        normalSample = normalize(normalSample);
-        vec3 T = normalize(fragTangent);
-        vec3 B = normalize(cross(N, T));
+    if (hasNormalMap) {
+        // Z is rebuilt from XY: BC5 normal maps only store two channels
+        vec3 normalSample = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+        vec3 T = normalize(fragTangent.xyz);
+        vec3 B = normalize(cross(N, T)) * (fragTangent.w < 0.0 ? -1.0 : 1.0);
         mat3 TBN = mat3(T, B, N);
         N = normalize(TBN * normalSample);
     }
@@ -111,7 +198,7 @@ void main()
     vec3 L;
     float attenuation = 1.0;
     
-    if (uLightType == 0) {
+    if (!FEATURE_POINT_LIGHT) {
         L = normalize(-uDir_Direction);
     } else {
         vec3 lightVec = uLight_Position - worldPos;
@@ -152,48 +239,22 @@ void main()
     // ========== AMBIENT/IBL ==========
     vec3 ambient = vec3(0.0);
     
-    if (useIBL) {
+    if (FEATURE_IBL) {
         // Ambient fresnel with roughness
         vec3 F_ambient = fresnelSchlickRoughness(NdotV, F0, roughness);
         vec3 kS_ambient = F_ambient;
         vec3 kD_ambient = vec3(1.0) - kS_ambient;
         kD_ambient *= 1.0 - metallic;
         
-        // DIFFUSE IBL: Use irradiance map (blurry)
-        vec3 irradiance = texture(irradianceMap, N).rgb;
+        // DIFFUSE IBL: irradiance from spherical harmonics, no fetch
+        vec3 irradiance = irradianceSH(N);
         vec3 diffuse_ibl = irradiance * baseColor * kD_ambient;
         
-        // SPECULAR IBL: This is the key fix!
-        vec3 R = reflect(-V, N);
-        float lod = roughness * 4.0;
-        vec3 prefilteredColor = textureLod(environmentMap, R, lod).rgb;
-        vec3 specular_ibl = prefilteredColor * F_ambient;
-        
-        // Check if we have a separate environment map
-        // If not, fall back to irradiance but reduce its influence
-        // #ifdef HAS_ENVIRONMENT_MAP
-        //     // Proper: Sample environment map with LOD based on roughness
-        //     float MAX_REFLECTION_LOD = 4.0;
-        //     float lod = roughness * MAX_REFLECTION_LOD;
-        //     vec3 prefilteredColor = textureLod(environmentMap, R, lod).rgb;
-        // #else
-        //     // Fallback: Use irradiance but heavily attenuate based on roughness
-        //     // This reduces those cloud artifacts
-        //     vec3 prefilteredColor = texture(irradianceMap, R).rgb;
-            
-        //     // Key fix: Reduce reflection intensity based on roughness
-        //     // Rough surfaces shouldn't show clear reflections
-        //     float reflectionStrength = pow(1.0 - roughness, 2.0);
-        //     prefilteredColor *= reflectionStrength;
-        // #endif
-        
-        // // Apply fresnel to specular
-        // specular_ibl = prefilteredColor * F_ambient;
-        
-        // For very rough metals, reduce the specular contribution
-        if (metallic > 0.5 && roughness > 0.5) {
-            specular_ibl *= (1.0 - roughness * 0.5);
-        }
+        // SPECULAR IBL: split sum, two fetches - the environment convolved with the GGX lobe of this
+        // roughness, and the BRDF's integral as a scale and bias on F0
+        vec3 prefilteredColor = textureLod(environmentMap, R, roughness * uPrefilterMaxLod).rgb;
+        vec2 envBRDF = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+        vec3 specular_ibl = prefilteredColor * (F_ambient * envBRDF.x + envBRDF.y);
         
         ambient = (diffuse_ibl + specular_ibl) * ao;
     } else {
@@ -214,6 +275,11 @@ void main()
     // Prevent pure black
     color = max(color, baseColor * 0.01);
     
+    if (uLinearOutput) {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+
     // Tone mapping (moderate exposure)
     color = color * 1.0;
     color = color / (color + vec3(1.0));
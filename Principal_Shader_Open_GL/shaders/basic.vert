@@ -1,31 +1,66 @@
 #version 330 core
-layout (location = 0) in vec3 aPos; // the position variable has attribute position 0
+layout (location = 0) in vec4 aPos; // the position variable has attribute position 0 (w only set by packed vertices)
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord; // the texture variable has attribute position 2
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent; // w = bitangent sign
+// per instance (divisor 1, see InstanceData in mesh_utils.h); a single object is drawn as one instance
+layout (location = 4) in mat4 aModelMatrix; // locations 4-7: positions/rotates/scales objects in world (vertex pos -> world pos)
+layout (location = 8) in uint aMaterialIndex;
   
 out vec2 texCoord; // specify a texture output to the fragment shader
 out vec3 worldPos;
 
-out vec3 fragTangent; 
+out vec4 fragTangent; // w = bitangent sign
 out vec3 fragNormal;
+flat out uint fragMaterialIndex;
 
-uniform mat4 modelMatrix; // positions/rotates/scales objects in world (vertex pos -> world pos)
-uniform mat4 viewMatrix; // postions everything relative to camera (world pos -> camera space pos)
-uniform mat4 projectionMatrix; // creates perspective (near things big, fal things small - camera space -> screen space)
+// per frame, one uniform buffer shared by every draw (FrameBlock in uniforms.h); basic.frag declares it identically
+layout (std140) uniform Frame {
+    mat4 viewMatrix; // postions everything relative to camera (world pos -> camera space pos)
+    mat4 projectionMatrix; // creates perspective (near things big, fal things small - camera space -> screen space)
+    vec3 uCamera_Position;
+    bool uLinearOutput;
+    bool uMaterialTable;
+};
 
+// packed vertex layout (see vertex_packing.h): aPos is unorm16 inside the mesh bounds,
+// aNormal.xy / aTangent.xy are octahedral-encoded unit vectors, aPos.w is the bitangent sign
+// as 0/1, UVs arrive as half floats
+uniform bool uPackedVertices;
+uniform vec3 uPosOffset;
+uniform vec3 uPosScale;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
+    vec3 position = aPos.xyz;
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent.xyz;
+    float bitangentSign = aTangent.w;
+    if (uPackedVertices) {
+        position = uPosOffset + aPos.xyz * uPosScale;
+        normal = octDecode(aNormal.xy);
+        tangent = octDecode(aTangent.xy);
+        bitangentSign = aPos.w * 2.0 - 1.0;
+    }
+
     // model transforms vertex to world -> view transforms world to camera -> projection transforms to screen
-    gl_Position =  projectionMatrix * viewMatrix * modelMatrix * vec4(aPos, 1.0);
+    gl_Position =  projectionMatrix * viewMatrix * aModelMatrix * vec4(position, 1.0);
 
     //gl_Position = vec4(aPos, 1.0); // see how we directly give a vec3 to vec4's constructor
     texCoord = vec2(aTexCoord);
     // A point light needs each pixel’s position in world space so the fragment shader can compute a unique light direction per pixel
-    worldPos = (modelMatrix * (vec4(aPos, 1.0))).xyz;
+    worldPos = (aModelMatrix * (vec4(position, 1.0))).xyz;
 
-    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
-    fragTangent = normalize(normalMatrix * aTangent);
-    fragNormal = normalize(normalMatrix * aNormal); 
+    mat3 normalMatrix = transpose(inverse(mat3(aModelMatrix)));
+    fragTangent = vec4(normalize(normalMatrix * tangent), bitangentSign);
+    fragNormal = normalize(normalMatrix * normal); 
+    fragMaterialIndex = aMaterialIndex;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#version 330 core
+out vec2 FragColor;
+in vec2 uv; // x = NdotV, y = roughness
+
+// Split-sum BRDF integration: the specular BRDF's integral over the hemisphere as a scale (R) and
+// bias (G) on F0. Depends on nothing but its two inputs, so it is baked once per run.
+const float PI = 3.14159265359;
+const uint SAMPLE_COUNT = 1024u; // IBL_SAMPLE_COUNT in ibl_utils.h
+
+vec2 Hammersley(uint i, uint N) {
+    uint bits = (i << 16u) | (i >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(N), float(bits) * 2.3283064365386963e-10);
+}
+
+// half vector around +Z (the normal)
+vec3 ImportanceSampleGGX(vec2 Xi, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * Xi.x;
+    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    return vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+}
+
+float G_SchlickGGX(float NdotX, float k) {
+    return NdotX / (NdotX * (1.0 - k) + k);
+}
+
+void main()
+{
+    float NdotV = uv.x;
+    float roughness = uv.y;
+    vec3 V = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+    float k = roughness * roughness / 2.0; // IBL remapping of k (direct lighting uses (r + 1)^2 / 8)
+
+    float scale = 0.0;
+    float bias = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, SAMPLE_COUNT), roughness);
+        vec3 L = 2.0 * dot(V, H) * H - V;
+        float NdotL = max(L.z, 0.0);
+        if (NdotL > 0.0) {
+            float NdotH = max(H.z, 0.0);
+            float VdotH = max(dot(V, H), 0.0);
+            float G = G_SchlickGGX(NdotV, k) * G_SchlickGGX(NdotL, k);
+            float visibility = G * VdotH / (NdotH * NdotV);
+            float Fc = pow(1.0 - VdotH, 5.0);
+            scale += (1.0 - Fc) * visibility;
+            bias += Fc * visibility;
+        }
+    }
+    FragColor = vec2(scale, bias) / float(SAMPLE_COUNT);
+}
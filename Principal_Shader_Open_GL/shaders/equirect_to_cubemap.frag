@@ -21,7 +21,7 @@ void main() {
     
     // Step 2: Convert to UV coordinates [0,1]
     float u = fract(phi * INV_TWOPI + 0.5); // Normalize phi from [-π,π] to [0,1] - wraps around horizontally
-    float v = theta * INV_PI + 0.5; // Normalize theta from [0,π] to [0,1] - top to bottom
+    float v = 1.0 - theta * INV_PI; // Normalize theta from [0,π] to [1,0] - the HDR is uploaded flipped, so v = 1 is its top row
     vec2 uv = vec2(u, v);
     
     // Step 3: Sample the equirectangular map
@@ -0,0 +1,8 @@
+#version 330 core
+out vec2 uv;
+
+// one triangle covering the viewport, no vertex buffer: draw 3 vertices with any (empty) VAO bound
+void main() {
+    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
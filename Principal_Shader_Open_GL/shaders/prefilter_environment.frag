@@ -0,0 +1,72 @@
+#version 330 core
+out vec4 FragColor;
+in vec3 localPos;
+
+// GGX prefiltered environment for split-sum specular IBL: one mip per roughness step
+uniform samplerCube environmentMap; // mipmapped, for the filtered importance sampling below
+uniform float roughness;
+uniform float resolution;           // face size of environmentMap's level 0
+
+const float PI = 3.14159265359;
+const uint SAMPLE_COUNT = 1024u;    // IBL_SAMPLE_COUNT in ibl_utils.h
+
+// low discrepancy sequence: i / N and the bit reversed i
+vec2 Hammersley(uint i, uint N) {
+    uint bits = (i << 16u) | (i >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(N), float(bits) * 2.3283064365386963e-10);
+}
+
+// half vector distributed like the GGX lobe around N
+vec3 ImportanceSampleGGX(vec2 Xi, vec3 N, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * Xi.x;
+    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+float D_GGX(float NdotH, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * denom * denom);
+}
+
+void main()
+{
+    // split-sum assumption: the view and reflection directions equal the normal
+    vec3 N = normalize(localPos);
+    vec3 V = N;
+    if (roughness == 0.0) {
+        FragColor = vec4(textureLod(environmentMap, N, 0.0).rgb, 1.0); // a mirror: the lobe is a single direction
+        return;
+    }
+
+    float saTexel = 4.0 * PI / (6.0 * resolution * resolution);
+    vec3 color = vec3(0.0);
+    float totalWeight = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, SAMPLE_COUNT), N, roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+        float NdotL = dot(N, L);
+        if (NdotL > 0.0) {
+            // read the mip whose texels match the solid angle this sample stands for, so 1024 samples
+            // don't alias on bright spots (pdf = D * NdotH / (4 * VdotH) = D / 4 with N = V)
+            float pdf = D_GGX(max(dot(N, H), 0.0), roughness) * 0.25;
+            float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+            float lod = max(0.5 * log2(saSample / saTexel), 0.0);
+            color += textureLod(environmentMap, L, lod).rgb * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+    FragColor = vec4(color / max(totalWeight, 0.0001), 1.0);
+}
@@ -0,0 +1,515 @@
+#include "texture_compress.h"
+#include "texture_mips.h"
+#include "file_utils.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXCOMPRESS_SSE 1
+#endif
+
+bool RoleCompresses(TextureRole role) {
+    return role != TextureRole::Uncompressed && role != TextureRole::Orm;
+}
+
+BlockFormat RoleBlockFormat(TextureRole role) {
+    switch (role) {
+    case TextureRole::Normal: return BlockFormat::BC5;
+    case TextureRole::Mask: return BlockFormat::BC4;
+    default: return BlockFormat::BC1;
+    }
+}
+
+size_t BlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC5 ? 16 : 8;
+}
+
+TextureRole GuessTextureRole(const std::string& path) {
+    std::string name = std::filesystem::path(path).stem().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    // color first: "MetalGalvanizedSteelWorn001_COL_2K_METALNESS" is a color map despite the suffix
+    for (const char* key : { "color", "colour", "_col", "albedo", "diffuse" })
+        if (name.find(key) != std::string::npos) return TextureRole::BaseColor;
+    for (const char* key : { "normal", "nrm", "_nor" })
+        if (name.find(key) != std::string::npos) return TextureRole::Normal;
+    for (const char* key : { "rough", "metal", "occlusion", "_ao", "gloss", "spec" })
+        if (name.find(key) != std::string::npos) return TextureRole::Mask;
+    return TextureRole::BaseColor;
+}
+
+// ─────────────────────────────────────────────
+// BC1
+// ─────
+// Endpoints start on the principal axis of the block's colors, then two rounds of: quantize
+// to 565, pick each pixel's nearest palette entry, least-squares refit the endpoints to those
+// picks. The best encoding seen is kept. Palette codes: 0 = A, 1 = B, 2 = (2A+B)/3, 3 = (A+2B)/3.
+static inline uint16_t Pack565(const float c[3]) {
+    int r = int(std::lround(std::min(std::max(c[0], 0.0f), 255.0f) * (31.0f / 255.0f)));
+    int g = int(std::lround(std::min(std::max(c[1], 0.0f), 255.0f) * (63.0f / 255.0f)));
+    int b = int(std::lround(std::min(std::max(c[2], 0.0f), 255.0f) * (31.0f / 255.0f)));
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+static inline void Unpack565(uint16_t c, int rgb[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void BC1Palette(uint16_t a, uint16_t b, int palette[4][3]) {
+    Unpack565(a, palette[0]);
+    Unpack565(b, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// nearest palette entry per pixel; returns the total squared error
+static float BC1PickIndices(const float r[16], const float g[16], const float b[16], const int palette[4][3],
+                            uint8_t codes[16]) {
+#if TEXCOMPRESS_SSE
+    __m128 total = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        __m128 pr = _mm_loadu_ps(r + i), pg = _mm_loadu_ps(g + i), pb = _mm_loadu_ps(b + i);
+        __m128 best = _mm_set1_ps(1e30f), bestCode = _mm_setzero_ps();
+        for (int k = 0; k < 4; k++) {
+            __m128 dr = _mm_sub_ps(pr, _mm_set1_ps(float(palette[k][0])));
+            __m128 dg = _mm_sub_ps(pg, _mm_set1_ps(float(palette[k][1])));
+            __m128 db = _mm_sub_ps(pb, _mm_set1_ps(float(palette[k][2])));
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestCode = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(float(k))), _mm_andnot_ps(closer, bestCode));
+        }
+        total = _mm_add_ps(total, best);
+        __m128i asInt = _mm_cvttps_epi32(bestCode);
+        alignas(16) int lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), asInt);
+        for (int j = 0; j < 4; j++) codes[i + j] = uint8_t(lanes[j]);
+    }
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float best = 1e30f;
+        for (int k = 0; k < 4; k++) {
+            float dr = r[i] - palette[k][0], dg = g[i] - palette[k][1], db = b[i] - palette[k][2];
+            float d = dr * dr + dg * dg + db * db;
+            if (d < best) {
+                best = d;
+                codes[i] = uint8_t(k);
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+void CompressBC1Block(const uint8_t rgba[64], uint8_t out[8]) {
+    float r[16], g[16], b[16], mean[3] = {};
+    for (int i = 0; i < 16; i++) {
+        r[i] = rgba[i * 4 + 0];
+        g[i] = rgba[i * 4 + 1];
+        b[i] = rgba[i * 4 + 2];
+        mean[0] += r[i];
+        mean[1] += g[i];
+        mean[2] += b[i];
+    }
+    for (float& m : mean) m /= 16.0f;
+
+    // principal axis of the covariance by power iteration
+    float cov[6] = {};
+    for (int i = 0; i < 16; i++) {
+        float dr = r[i] - mean[0], dg = g[i] - mean[1], db = b[i] - mean[2];
+        cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+        cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+    }
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (length < 1e-6f) break; // flat block: any axis will do
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+    float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = ((r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2]) / axisLength2;
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    float inset = (tMax - tMin) / 16.0f; // pull the ends in: they sit on outliers, the palette is between them
+    float endA[3], endB[3];
+    for (int c = 0; c < 3; c++) {
+        endA[c] = mean[c] + axis[c] * (tMax - inset);
+        endB[c] = mean[c] + axis[c] * (tMin + inset);
+    }
+
+    static const float WEIGHT_B[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    uint16_t bestA = 0, bestB = 0;
+    uint8_t bestCodes[16] = {};
+    float bestError = 1e30f;
+    for (int round = 0; round < 2; round++) {
+        uint16_t a = Pack565(endA), bq = Pack565(endB);
+        int palette[4][3];
+        BC1Palette(a, bq, palette);
+        uint8_t codes[16];
+        float error = BC1PickIndices(r, g, b, palette, codes);
+        if (error < bestError) {
+            bestError = error;
+            bestA = a;
+            bestB = bq;
+            std::memcpy(bestCodes, codes, 16);
+        }
+        if (error == 0.0f) break;
+
+        // least squares: pixel ~ (1 - w) * A + w * B for each pixel's palette weight w
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++) {
+            float w = WEIGHT_B[codes[i]], v = 1.0f - w;
+            aa += v * v; bb += w * w; ab += v * w;
+            ax[0] += v * r[i]; ax[1] += v * g[i]; ax[2] += v * b[i];
+            bx[0] += w * r[i]; bx[1] += w * g[i]; bx[2] += w * b[i];
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) break;
+        for (int c = 0; c < 3; c++) {
+            endA[c] = (ax[c] * bb - bx[c] * ab) / det;
+            endB[c] = (bx[c] * aa - ax[c] * ab) / det;
+        }
+    }
+
+    // 4-color mode needs color0 > color1; swapping the endpoints swaps codes 0<->1 and 2<->3
+    if (bestA < bestB) {
+        std::swap(bestA, bestB);
+        for (uint8_t& code : bestCodes) code ^= 1;
+    } else if (bestA == bestB) {
+        std::memset(bestCodes, 0, 16); // equal endpoints select 3-color mode, where code 3 is black
+    }
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= uint32_t(bestCodes[i]) << (2 * i);
+    out[0] = uint8_t(bestA); out[1] = uint8_t(bestA >> 8);
+    out[2] = uint8_t(bestB); out[3] = uint8_t(bestB >> 8);
+    for (int i = 0; i < 4; i++) out[4 + i] = uint8_t(bits >> (8 * i));
+}
+
+void DecompressBC1Block(const uint8_t block[8], uint8_t rgba[64]) {
+    uint16_t a = uint16_t(block[0] | (block[1] << 8)), b = uint16_t(block[2] | (block[3] << 8));
+    int palette[4][3];
+    BC1Palette(a, b, palette);
+    bool threeColor = a <= b;
+    if (threeColor) {
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+    for (int i = 0; i < 16; i++) {
+        int code = (bits >> (2 * i)) & 3;
+        for (int c = 0; c < 3; c++) rgba[i * 4 + c] = uint8_t(palette[code][c]);
+        rgba[i * 4 + 3] = threeColor && code == 3 ? 0 : 255;
+    }
+}
+
+// ─────────────────────────────────────────────
+// BC4 (and BC5 = two BC4 blocks)
+// ─────
+// Always the 8-value mode (red0 > red1). Codes 0/1 are the endpoints; code k in 2..7 is step k-1
+// of 7 from red0 to red1, so the nearest code comes straight from rounding the pixel's position.
+static const uint8_t BC4_STEP_TO_CODE[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+static float BC4PickSteps(const float values[16], float hi, float lo, uint8_t steps[16]) {
+    float scale = 7.0f / (hi - lo);
+#if TEXCOMPRESS_SSE
+    for (int i = 0; i < 16; i += 4) {
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(hi), _mm_loadu_ps(values + i)), _mm_set1_ps(scale));
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(7.0f));
+        alignas(16) int lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvtps_epi32(t)); // round to nearest
+        for (int j = 0; j < 4; j++) steps[i + j] = uint8_t(lanes[j]);
+    }
+#else
+    for (int i = 0; i < 16; i++)
+        steps[i] = uint8_t(std::nearbyint(std::min(std::max((hi - values[i]) * scale, 0.0f), 7.0f))); // ties to even, like SSE
+#endif
+    int h = int(hi), l = int(lo);
+    float error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float decoded = float(((7 - steps[i]) * h + steps[i] * l) / 7);
+        error += (values[i] - decoded) * (values[i] - decoded);
+    }
+    return error;
+}
+
+void CompressBC4Block(const uint8_t values[16], uint8_t out[8]) {
+    float v[16];
+    float lo = 255.0f, hi = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        v[i] = values[i];
+        lo = std::min(lo, v[i]);
+        hi = std::max(hi, v[i]);
+    }
+    std::memset(out, 0, 8);
+    if (hi == lo) { // flat: both endpoints equal, every code 0
+        out[0] = out[1] = uint8_t(hi);
+        return;
+    }
+
+    uint8_t steps[16], bestSteps[16];
+    float bestError = BC4PickSteps(v, hi, lo, bestSteps);
+    int bestHi = int(hi), bestLo = int(lo);
+
+    // one least-squares refit of the endpoints to the chosen steps
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax = 0.0f, bx = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float w = bestSteps[i] / 7.0f, u = 1.0f - w;
+        aa += u * u; bb += w * w; ab += u * w;
+        ax += u * v[i]; bx += w * v[i];
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) > 1e-6f) {
+        float newHi = std::round(std::min(std::max((ax * bb - bx * ab) / det, 0.0f), 255.0f));
+        float newLo = std::round(std::min(std::max((bx * aa - ax * ab) / det, 0.0f), 255.0f));
+        if (newHi > newLo) {
+            float error = BC4PickSteps(v, newHi, newLo, steps);
+            if (error < bestError) {
+                bestError = error;
+                bestHi = int(newHi);
+                bestLo = int(newLo);
+                std::memcpy(bestSteps, steps, 16);
+            }
+        }
+    }
+
+    out[0] = uint8_t(bestHi);
+    out[1] = uint8_t(bestLo);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= uint64_t(BC4_STEP_TO_CODE[bestSteps[i]]) << (3 * i);
+    for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(bits >> (8 * i));
+}
+
+void DecompressBC4Block(const uint8_t block[8], uint8_t values[16]) {
+    int r0 = block[0], r1 = block[1];
+    int palette[8] = { r0, r1 };
+    if (r0 > r1) {
+        for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * r0 + (k - 1) * r1) / 7;
+    } else {
+        for (int k = 2; k < 6; k++) palette[k] = ((6 - k) * r0 + (k - 1) * r1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) bits |= uint64_t(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; i++) values[i] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+}
+
+// ─────────────────────────────────────────────
+// Images and mip chains
+// ─────
+// Working channels per format: BC1 keeps RGB, BC4 the first channel, BC5 a full normal (XYZ)
+// so the mips can be renormalized before Z is dropped.
+static int WorkingChannels(BlockFormat format) {
+    return format == BlockFormat::BC4 ? 1 : 3;
+}
+
+static void ToWorkingChannels(const uint8_t* pixels, size_t pixelCount, int channels, int working, std::vector<uint8_t>& out) {
+    out.resize(pixelCount * working);
+    for (size_t i = 0; i < pixelCount; i++) {
+        const uint8_t* p = pixels + i * channels;
+        for (int c = 0; c < working; c++) out[i * working + c] = p[channels >= 3 ? c : 0];
+    }
+}
+
+static void CompressLevel(const uint8_t* src, int width, int height, int channels, BlockFormat format,
+                          uint8_t* out) {
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+    ParallelFor(size_t(blocksHigh), [&](size_t begin, size_t end) {
+        uint8_t block[64], red[16], green[16];
+        for (size_t by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksWide; bx++) {
+                // gather the 4x4 block, edge pixels repeat past the image border
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx * 4 + (i & 3), width - 1), y = std::min(int(by) * 4 + (i >> 2), height - 1);
+                    const uint8_t* p = &src[(size_t(y) * width + x) * channels];
+                    for (int c = 0; c < 3; c++) block[i * 4 + c] = p[channels == 1 ? 0 : c];
+                    block[i * 4 + 3] = 255;
+                    red[i] = p[0];
+                    green[i] = p[channels == 1 ? 0 : 1];
+                }
+                uint8_t* dst = out + (by * blocksWide + bx) * blockBytes;
+                if (format == BlockFormat::BC1) {
+                    CompressBC1Block(block, dst);
+                } else {
+                    CompressBC4Block(red, dst);
+                    if (format == BlockFormat::BC5) CompressBC4Block(green, dst + 8);
+                }
+            }
+        }
+    }, 1);
+}
+
+void CompressImage(const uint8_t* pixels, int width, int height, int channels, TextureRole role,
+                   bool generateMipmaps, CompressedTexture& out) {
+    out.format = RoleBlockFormat(role);
+    out.levels.clear();
+    int working = WorkingChannels(out.format);
+    std::vector<uint8_t> level;
+    ToWorkingChannels(pixels, size_t(width) * height, channels, working, level);
+    MipChain mips;
+    if (generateMipmaps) BuildMipChain(level.data(), width, height, working, MipOptionsForRole(role), mips);
+
+    size_t total = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        CompressedLevel info;
+        info.width = w;
+        info.height = h;
+        info.offset = total;
+        info.size = size_t((w + 3) / 4) * ((h + 3) / 4) * BlockBytes(out.format);
+        total += info.size;
+        out.levels.push_back(info);
+        if (!generateMipmaps || (w == 1 && h == 1)) break;
+    }
+    out.data.resize(total);
+
+    for (size_t l = 0; l < out.levels.size(); l++) {
+        const uint8_t* src = generateMipmaps ? mips.data.data() + mips.levels[l].offset : level.data();
+        CompressLevel(src, out.levels[l].width, out.levels[l].height, working, out.format,
+                      out.data.data() + out.levels[l].offset);
+    }
+}
+
+void DecompressLevel(const CompressedTexture& texture, size_t level, std::vector<uint8_t>& pixels) {
+    const CompressedLevel& info = texture.levels[level];
+    int channels = texture.format == BlockFormat::BC1 ? 4 : texture.format == BlockFormat::BC4 ? 1 : 2;
+    int blocksWide = (info.width + 3) / 4, blocksHigh = (info.height + 3) / 4;
+    size_t blockBytes = BlockBytes(texture.format);
+    pixels.resize(size_t(info.width) * info.height * channels);
+    for (int by = 0; by < blocksHigh; by++) {
+        for (int bx = 0; bx < blocksWide; bx++) {
+            const uint8_t* block = texture.data.data() + info.offset + (size_t(by) * blocksWide + bx) * blockBytes;
+            uint8_t decoded[64], second[16];
+            if (texture.format == BlockFormat::BC1) {
+                DecompressBC1Block(block, decoded);
+            } else {
+                DecompressBC4Block(block, decoded);
+                if (texture.format == BlockFormat::BC5) DecompressBC4Block(block + 8, second);
+            }
+            for (int i = 0; i < 16; i++) {
+                int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if (x >= info.width || y >= info.height) continue;
+                uint8_t* p = &pixels[(size_t(y) * info.width + x) * channels];
+                if (texture.format == BlockFormat::BC1) {
+                    std::memcpy(p, decoded + i * 4, 4);
+                } else {
+                    p[0] = decoded[i];
+                    if (texture.format == BlockFormat::BC5) p[1] = second[i];
+                }
+            }
+        }
+    }
+}
+
+// ─────────────────────────────────────────────
+// DDS cache
+// ─────
+// Plain DDS (DXT1 / ATI1 / ATI2 FourCCs) that other tools can open. Our key lives in the
+// header's reserved words, which readers ignore.
+struct DDSPixelFormat {
+    uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+struct DDSHeader {
+    uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat format;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header is 124 bytes");
+
+static const uint32_t COMPRESSED_CACHE_VERSION = 2; // 2: mips from BuildMipChain (Kaiser, linear-light base color)
+static constexpr uint32_t FourCC(char a, char b, char c, char d) {
+    return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+static const uint32_t DDS_MAGIC = FourCC('D', 'D', 'S', ' ');
+static const uint32_t CACHE_TAG = FourCC('P', 'S', 'T', 'C');
+
+static uint32_t FormatFourCC(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC4: return FourCC('A', 'T', 'I', '1');
+    case BlockFormat::BC5: return FourCC('A', 'T', 'I', '2');
+    default: return FourCC('D', 'X', 'T', '1');
+    }
+}
+
+std::string CompressedCachePath(const std::string& imagePath) {
+    return imagePath + ".dds";
+}
+
+bool ReadCompressedCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, BlockFormat format,
+                         CompressedTexture& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    if (file.size() < 4 + sizeof(DDSHeader)) return false;
+    uint32_t magic;
+    DDSHeader header;
+    std::memcpy(&magic, file.data(), 4);
+    std::memcpy(&header, file.data() + 4, sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || header.format.fourCC != FormatFourCC(format)) return false;
+    if (header.reserved1[0] != CACHE_TAG || header.reserved1[1] != COMPRESSED_CACHE_VERSION) return false;
+    if (header.reserved1[2] != uint32_t(flipY) ||
+        (uint64_t(header.reserved1[4]) << 32 | header.reserved1[3]) != sourceHash) return false; // source changed
+    if (header.width == 0 || header.height == 0 || header.mipMapCount == 0 || header.mipMapCount > 32) return false;
+
+    out.format = format;
+    out.levels.clear();
+    size_t total = 0;
+    int w = int(header.width), h = int(header.height);
+    for (uint32_t l = 0; l < header.mipMapCount; l++, w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        CompressedLevel info;
+        info.width = w;
+        info.height = h;
+        info.offset = total;
+        info.size = size_t((w + 3) / 4) * ((h + 3) / 4) * BlockBytes(format);
+        total += info.size;
+        out.levels.push_back(info);
+    }
+    if (file.size() != 4 + sizeof(DDSHeader) + total) return false;
+    out.data.assign(file.data() + 4 + sizeof(DDSHeader), file.data() + file.size());
+    return true;
+}
+
+bool WriteCompressedCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const CompressedTexture& texture) {
+    if (texture.levels.empty()) return false;
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS HEIGHT WIDTH PIXELFORMAT MIPMAPCOUNT LINEARSIZE
+    header.width = uint32_t(texture.levels[0].width);
+    header.height = uint32_t(texture.levels[0].height);
+    header.pitchOrLinearSize = uint32_t(texture.levels[0].size);
+    header.mipMapCount = uint32_t(texture.levels.size());
+    header.reserved1[0] = CACHE_TAG;
+    header.reserved1[1] = COMPRESSED_CACHE_VERSION;
+    header.reserved1[2] = uint32_t(flipY);
+    header.reserved1[3] = uint32_t(sourceHash);
+    header.reserved1[4] = uint32_t(sourceHash >> 32);
+    header.format.size = sizeof(DDSPixelFormat);
+    header.format.flags = 0x4; // FOURCC
+    header.format.fourCC = FormatFourCC(texture.format);
+    header.caps = 0x1000 | (texture.levels.size() > 1 ? 0x8 | 0x400000 : 0); // TEXTURE (COMPLEX MIPMAP)
+
+    return WriteFileAtomic(cachePath, { { &DDS_MAGIC, 4 }, { &header, sizeof(header) },
+                                        { texture.data.data(), texture.data.size() } });
+}
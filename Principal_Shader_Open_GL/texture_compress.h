@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// Block compression for PBR maps
+// ─────
+// Each map is encoded to the block format that matches what the shader reads from it:
+//   BaseColor -> BC1 (RGB, 4 bpp)      needs EXT_texture_compression_s3tc
+//   Normal    -> BC5 (RG, 8 bpp)       core since GL 3.0 (RGTC); the shader rebuilds Z
+//   Mask      -> BC4 (R, 4 bpp)        roughness / metallic / AO, core RGTC
+//   Orm       -> uncompressed RGB8     AO / roughness / metallic packed by texture_orm.h: three
+//                                      unrelated signals, which BC1's one color line per block
+//                                      would bleed into each other
+// Mips come from BuildMipChain (texture_mips.h) and every level is encoded on the thread pool,
+// a row of blocks per job, with SSE2 for the palette searches. Results are cached next to the
+// source as <image>.dds, keyed by the source file's hash.
+enum class TextureRole { Uncompressed, BaseColor, Normal, Mask, Orm };
+enum class BlockFormat { BC1, BC4, BC5 };
+
+struct CompressedLevel {
+    int width = 0, height = 0;
+    size_t offset = 0, size = 0; // into CompressedTexture::data
+};
+
+struct CompressedTexture {
+    BlockFormat format = BlockFormat::BC1;
+    std::vector<CompressedLevel> levels; // levels[0] = full size
+    std::vector<uint8_t> data;
+};
+
+bool RoleCompresses(TextureRole role); // false for Uncompressed and Orm
+BlockFormat RoleBlockFormat(TextureRole role);
+size_t BlockBytes(BlockFormat format); // 8 for BC1/BC4, 16 for BC5
+// Picks a role from the usual file name suffixes (_Normal, _NRM, _Roughness, _AO, ...); BaseColor otherwise
+TextureRole GuessTextureRole(const std::string& path);
+
+// Single 4x4 blocks. rgba / values are 16 pixels in row order.
+void CompressBC1Block(const uint8_t rgba[64], uint8_t out[8]);
+void CompressBC4Block(const uint8_t values[16], uint8_t out[8]);
+void DecompressBC1Block(const uint8_t block[8], uint8_t rgba[64]);
+void DecompressBC4Block(const uint8_t block[8], uint8_t values[16]);
+
+// Whole images: 8-bit pixels with 1-4 channels, top row first. Channels the format doesn't
+// store are ignored; grayscale is replicated for BC1/BC5.
+void CompressImage(const uint8_t* pixels, int width, int height, int channels, TextureRole role,
+                   bool generateMipmaps, CompressedTexture& out);
+// Decodes one level back to tightly packed pixels with the format's channel count (BC1: 4, BC4: 1, BC5: 2)
+void DecompressLevel(const CompressedTexture& texture, size_t level, std::vector<uint8_t>& pixels);
+
+// ─────────────────────────────────────────────
+// DDS cache
+// ─────
+std::string CompressedCachePath(const std::string& imagePath);
+// false when the cache is missing, stale (different source hash / orientation / format) or corrupt
+bool ReadCompressedCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, BlockFormat format,
+                         CompressedTexture& out);
+bool WriteCompressedCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const CompressedTexture& texture);
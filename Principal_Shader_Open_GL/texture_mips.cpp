@@ -0,0 +1,359 @@
+#include "texture_mips.h"
+#include "file_utils.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXMIPS_SSE 1
+#endif
+
+MipOptions MipOptionsForRole(TextureRole role, MipFilter filter) {
+    MipOptions options;
+    options.filter = filter;
+    options.srgb = role == TextureRole::BaseColor;
+    options.normalMap = role == TextureRole::Normal;
+    return options;
+}
+
+const char* MipFilterName(MipFilter filter) {
+    switch (filter) {
+    case MipFilter::Box: return "box";
+    case MipFilter::Lanczos: return "lanczos";
+    default: return "kaiser";
+    }
+}
+
+// ─────────────────────────────────────────────
+// Filter kernels, in destination pixels
+// ─────
+static const float PI = 3.14159265358979f;
+
+static float Sinc(float x) {
+    x *= PI;
+    return std::fabs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+}
+
+static float BesselI0(float x) { // power series, converges quickly for the alpha used here
+    float sum = 1.0f, term = 1.0f, q = x * x * 0.25f;
+    for (int k = 1; k < 32 && term > sum * 1e-8f; k++) {
+        term *= q / float(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static float FilterRadius(MipFilter filter) {
+    return filter == MipFilter::Box ? 0.5f : 3.0f;
+}
+
+static float FilterWeight(MipFilter filter, float x) {
+    float ax = std::fabs(x);
+    switch (filter) {
+    case MipFilter::Box:
+        return ax <= 0.5f ? 1.0f : 0.0f;
+    case MipFilter::Lanczos:
+        return ax < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+    default: { // Kaiser window (alpha 4) over a sinc, 3 pixels wide
+        const float alpha = 4.0f, width = 3.0f;
+        if (ax >= width) return 0.0f;
+        float t = x / width;
+        return Sinc(x) * BesselI0(alpha * std::sqrt(1.0f - t * t)) / BesselI0(alpha);
+    }
+    }
+}
+
+// Source indices and normalized weights for every destination pixel along one axis, padded
+// with zero weights to the same tap count.
+struct FilterTaps {
+    int count = 0;
+    std::vector<int> index;
+    std::vector<float> weight;
+};
+
+static void BuildTaps(int src, int dst, const MipOptions& options, FilterTaps& taps) {
+    if (src == dst) { // this axis is already 1 pixel: pass through
+        taps.count = 1;
+        taps.index.resize(dst);
+        taps.weight.assign(dst, 1.0f);
+        for (int i = 0; i < dst; i++) taps.index[i] = i;
+        return;
+    }
+    float scale = float(src) / dst;
+    float support = FilterRadius(options.filter) * scale;
+    taps.count = int(std::ceil(support * 2.0f)) + 1;
+    taps.index.assign(size_t(dst) * taps.count, 0);
+    taps.weight.assign(size_t(dst) * taps.count, 0.0f);
+    for (int i = 0; i < dst; i++) {
+        float center = (i + 0.5f) * scale - 0.5f; // in source pixels
+        int first = int(std::ceil(center - support)), last = int(std::floor(center + support));
+        int* index = &taps.index[size_t(i) * taps.count];
+        float* weight = &taps.weight[size_t(i) * taps.count];
+        float total = 0.0f;
+        for (int j = first, t = 0; j <= last && t < taps.count; j++, t++) {
+            index[t] = options.wrap ? ((j % src) + src) % src : std::min(std::max(j, 0), src - 1);
+            weight[t] = FilterWeight(options.filter, (j - center) / scale);
+            total += weight[t];
+        }
+        if (std::fabs(total) < 1e-6f) { // can't happen with these kernels, but never divide by zero
+            index[0] = std::min(std::max(int(center + 0.5f), 0), src - 1);
+            weight[0] = total = 1.0f;
+        }
+        for (int t = 0; t < taps.count; t++) weight[t] /= total;
+    }
+}
+
+// ─────────────────────────────────────────────
+// Pixel conversion
+// ─────
+// Working pixels are 4 floats (missing channels 0, alpha 1): linear light, or a [-1, 1] normal.
+static const int SRGB_ENCODE_STEPS = 16384;
+
+static const float* SrgbToLinearTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> t(256);
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+static const uint8_t* LinearToSrgbTable() {
+    static const std::vector<uint8_t> table = [] {
+        std::vector<uint8_t> t(SRGB_ENCODE_STEPS + 1);
+        for (int i = 0; i <= SRGB_ENCODE_STEPS; i++) {
+            float l = float(i) / SRGB_ENCODE_STEPS;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            t[i] = uint8_t(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// Per-channel byte -> working value tables, so decoding a row is one lookup per channel
+struct DecodeTable {
+    float values[4][256];
+};
+
+// Channels that hold color: gray + alpha images keep their alpha in channel 1
+static int ColorChannels(int channels) {
+    return channels >= 3 ? 3 : 1;
+}
+
+static void BuildDecodeTable(int channels, const MipOptions& options, DecodeTable& table) {
+    const float* toLinear = SrgbToLinearTable();
+    bool normals = options.normalMap && channels >= 3;
+    int color = ColorChannels(channels);
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < 256; i++) {
+            if (c < 3 && normals) table.values[c][i] = i / 127.5f - 1.0f;
+            else if (c < color && options.srgb) table.values[c][i] = toLinear[i];
+            else table.values[c][i] = i / 255.0f;
+        }
+    }
+}
+
+static void DecodeRow(const uint8_t* src, int width, int channels, const DecodeTable& table, float* out) {
+    for (int x = 0; x < width; x++, src += channels, out += 4) {
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        for (int c = 0; c < channels; c++) out[c] = table.values[c][src[c]];
+    }
+}
+
+// Clamps the filter's overshoot (sinc lobes ring), renormalizes normals, and writes the 8-bit pixel.
+// The clamped floats are what the next level is filtered from.
+static void EncodePixel(float* p, int channels, const MipOptions& options, uint8_t* out) {
+    bool normals = options.normalMap && channels >= 3;
+    if (normals) {
+        float length2 = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            p[c] = std::min(std::max(p[c], -1.0f), 1.0f);
+            length2 += p[c] * p[c];
+        }
+        float scale = length2 > 1e-8f ? 1.0f / std::sqrt(length2) : 0.0f;
+        for (int c = 0; c < 3; c++) p[c] *= scale;
+        if (length2 <= 1e-8f) p[2] = 1.0f; // detail cancelled out: point straight up
+    }
+    const uint8_t* toSrgb = LinearToSrgbTable();
+    int color = ColorChannels(channels);
+    for (int c = 0; c < channels; c++) {
+        if (c < 3 && normals) {
+            out[c] = uint8_t(std::lround((p[c] + 1.0f) * 127.5f));
+            continue;
+        }
+        p[c] = std::min(std::max(p[c], 0.0f), 1.0f);
+        if (c < color && options.srgb) out[c] = toSrgb[int(p[c] * SRGB_ENCODE_STEPS + 0.5f)];
+        else out[c] = uint8_t(p[c] * 255.0f + 0.5f);
+    }
+}
+
+// acc (4 floats) += src (4 floats) * weight
+static inline void AccumulatePixel(float* acc, const float* src, float weight) {
+#if TEXMIPS_SSE
+    _mm_storeu_ps(acc, _mm_add_ps(_mm_loadu_ps(acc), _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(weight))));
+#else
+    for (int c = 0; c < 4; c++) acc[c] += src[c] * weight;
+#endif
+}
+
+// ─────────────────────────────────────────────
+// Chain
+// ─────
+// One level from the one above: rows are filtered into a (dstWidth x srcHeight) buffer, then
+// columns into next. Level 1 reads the 8-bit source directly (decoded a row at a time) so the
+// full-size image never exists in float.
+static void FilterLevel(const uint8_t* srcBytes, const std::vector<float>& srcFloats, int srcWidth, int srcHeight,
+                        int channels, const MipOptions& options, int dstWidth, int dstHeight,
+                        std::vector<float>& rows, std::vector<float>& next, uint8_t* out) {
+    FilterTaps across, down;
+    BuildTaps(srcWidth, dstWidth, options, across);
+    BuildTaps(srcHeight, dstHeight, options, down);
+
+    DecodeTable table;
+    if (srcBytes) BuildDecodeTable(channels, options, table);
+
+    rows.resize(size_t(dstWidth) * srcHeight * 4);
+    ParallelFor(size_t(srcHeight), [&](size_t begin, size_t end) {
+        std::vector<float> decoded(srcBytes ? size_t(srcWidth) * 4 : 0);
+        for (size_t y = begin; y < end; y++) {
+            const float* src = decoded.data();
+            if (srcBytes) DecodeRow(srcBytes + y * srcWidth * channels, srcWidth, channels, table, decoded.data());
+            else src = srcFloats.data() + y * srcWidth * 4;
+            float* dst = &rows[y * dstWidth * 4];
+            for (int x = 0; x < dstWidth; x++, dst += 4) {
+                const int* index = &across.index[size_t(x) * across.count];
+                const float* weight = &across.weight[size_t(x) * across.count];
+#if TEXMIPS_SSE
+                __m128 acc = _mm_setzero_ps();
+                for (int t = 0; t < across.count; t++)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + index[t] * 4), _mm_set1_ps(weight[t])));
+                _mm_storeu_ps(dst, acc);
+#else
+                dst[0] = dst[1] = dst[2] = dst[3] = 0.0f;
+                for (int t = 0; t < across.count; t++) AccumulatePixel(dst, src + index[t] * 4, weight[t]);
+#endif
+            }
+        }
+    }, 8);
+
+    next.assign(size_t(dstWidth) * dstHeight * 4, 0.0f);
+    ParallelFor(size_t(dstHeight), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            float* dst = &next[y * dstWidth * 4];
+            const int* index = &down.index[y * down.count];
+            const float* weight = &down.weight[y * down.count];
+            // tap-major: each tap streams one whole source row
+            for (int t = 0; t < down.count; t++) {
+                if (weight[t] == 0.0f) continue;
+                const float* src = &rows[size_t(index[t]) * dstWidth * 4];
+                for (int x = 0; x < dstWidth; x++) AccumulatePixel(dst + x * 4, src + x * 4, weight[t]);
+            }
+            uint8_t* pixels = out + y * dstWidth * channels;
+            for (int x = 0; x < dstWidth; x++) EncodePixel(dst + x * 4, channels, options, pixels + x * channels);
+        }
+    }, 8);
+}
+
+void BuildMipChain(const uint8_t* pixels, int width, int height, int channels, const MipOptions& options, MipChain& out) {
+    out.channels = channels;
+    out.levels.clear();
+    size_t total = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        MipLevel level;
+        level.width = w;
+        level.height = h;
+        level.offset = total;
+        total += size_t(w) * h * channels;
+        out.levels.push_back(level);
+        if (w == 1 && h == 1) break;
+    }
+    out.data.resize(total);
+    std::memcpy(out.data.data(), pixels, size_t(width) * height * channels);
+
+    std::vector<float> current, rows, next;
+    for (size_t l = 1; l < out.levels.size(); l++) {
+        const MipLevel& src = out.levels[l - 1];
+        const MipLevel& dst = out.levels[l];
+        FilterLevel(l == 1 ? pixels : nullptr, current, src.width, src.height, channels, options,
+                    dst.width, dst.height, rows, next, out.data.data() + dst.offset);
+        current.swap(next);
+    }
+}
+
+// ─────────────────────────────────────────────
+// Mip cache
+// ─────
+static const uint32_t MIP_CACHE_VERSION = 2; // 2: gray + alpha keeps alpha linear
+static const char MIP_CACHE_MAGIC[4] = { 'P', 'S', 'M', 'P' };
+
+struct MipCacheHeader {
+    char magic[4];        // "PSMP"
+    uint32_t version;     // MIP_CACHE_VERSION
+    uint64_t sourceHash;  // HashFile of the image (or HashOrmSources)
+    uint32_t flipY;
+    uint32_t options;     // MipCacheOptions
+    uint32_t width, height, channels, levelCount;
+};
+static_assert(sizeof(MipCacheHeader) == 40, "mip cache header is 40 bytes");
+
+static uint32_t MipCacheOptions(const MipOptions& options) {
+    return uint32_t(options.filter) | uint32_t(options.srgb) << 8 | uint32_t(options.normalMap) << 9 |
+           uint32_t(options.wrap) << 10;
+}
+
+std::string MipCachePath(const std::string& imagePath) {
+    return imagePath + ".mips";
+}
+
+bool ReadMipCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const MipOptions& options, MipChain& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    if (file.size() < sizeof(MipCacheHeader)) return false;
+    MipCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MIP_CACHE_MAGIC, 4) != 0 || header.version != MIP_CACHE_VERSION) return false;
+    if (header.sourceHash != sourceHash || header.flipY != uint32_t(flipY) || header.options != MipCacheOptions(options))
+        return false; // source or settings changed
+    if (header.width == 0 || header.height == 0 || header.channels < 1 || header.channels > 4 ||
+        header.levelCount == 0 || header.levelCount > 32) return false;
+
+    out.channels = int(header.channels);
+    out.levels.clear();
+    size_t total = 0;
+    int w = int(header.width), h = int(header.height);
+    for (uint32_t l = 0; l < header.levelCount; l++, w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        MipLevel level;
+        level.width = w;
+        level.height = h;
+        level.offset = total;
+        total += size_t(w) * h * out.channels;
+        out.levels.push_back(level);
+    }
+    if (file.size() != sizeof(MipCacheHeader) + total) return false;
+    out.data.assign(file.data() + sizeof(MipCacheHeader), file.data() + file.size());
+    return true;
+}
+
+bool WriteMipCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const MipOptions& options,
+                   const MipChain& chain) {
+    if (chain.levels.empty()) return false;
+    MipCacheHeader header = {};
+    std::memcpy(header.magic, MIP_CACHE_MAGIC, 4);
+    header.version = MIP_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.flipY = uint32_t(flipY);
+    header.options = MipCacheOptions(options);
+    header.width = uint32_t(chain.levels[0].width);
+    header.height = uint32_t(chain.levels[0].height);
+    header.channels = uint32_t(chain.channels);
+    header.levelCount = uint32_t(chain.levels.size());
+
+    return WriteFileAtomic(cachePath, { { &header, sizeof(header) }, { chain.data.data(), chain.data.size() } });
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "texture_compress.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// CPU mip chains
+// ─────
+// Replaces glGenerateMipmap, whose filter is up to the driver: every level is filtered from the
+// one above in float, separably (rows, then columns), on the thread pool with SSE for the taps.
+//   sRGB data (base color) is filtered in linear light and re-encoded, so mips don't darken.
+//   Normal maps are decoded to vectors and renormalized on every level.
+//   Kaiser (windowed sinc, NVTT's default) and Lanczos-3 keep more detail than the 2x2 box.
+// Textures wrap (GL_REPEAT), so the filters wrap at the edges too.
+enum class MipFilter { Box, Kaiser, Lanczos };
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Kaiser;
+    bool srgb = false;      // RGB stored sRGB encoded; alpha is always linear
+    bool normalMap = false; // RGB = XYZ * 0.5 + 0.5
+    bool wrap = true;       // false: clamp at the edges
+};
+// BaseColor -> sRGB, Normal -> renormalized, everything else linear
+MipOptions MipOptionsForRole(TextureRole role, MipFilter filter = MipFilter::Kaiser);
+const char* MipFilterName(MipFilter filter);
+
+struct MipLevel {
+    int width = 0, height = 0;
+    size_t offset = 0; // into MipChain::data, tightly packed rows of width * channels bytes
+};
+
+struct MipChain {
+    int channels = 0;
+    std::vector<MipLevel> levels; // levels[0] = the source image, down to 1x1
+    std::vector<uint8_t> data;
+};
+
+// 8-bit pixels with 1-4 channels, top row first
+void BuildMipChain(const uint8_t* pixels, int width, int height, int channels, const MipOptions& options, MipChain& out);
+
+// ─────────────────────────────────────────────
+// Mip cache: <image>.mips
+// ─────
+// A small header (source hash, orientation, filter options, size) then every level back to back.
+std::string MipCachePath(const std::string& imagePath);
+// false when the cache is missing, stale (different source hash / orientation / options) or corrupt
+bool ReadMipCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const MipOptions& options, MipChain& out);
+bool WriteMipCache(const std::string& cachePath, uint64_t sourceHash, bool flipY, const MipOptions& options,
+                   const MipChain& chain);
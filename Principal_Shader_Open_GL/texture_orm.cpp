@@ -0,0 +1,83 @@
+#include "texture_orm.h"
+#include "file_utils.h"
+#include "thread_utils.h"
+#include "image_decode.h"
+#include <algorithm>
+
+static const uint8_t ORM_DEFAULTS[3] = { 255, 255, 0 }; // AO, roughness, metallic
+
+bool PackOrm(const OrmSources& sources, bool flipY, std::vector<uint8_t>& rgb, int& width, int& height) {
+    const std::string* paths[3] = { &sources.ao, &sources.roughness, &sources.metallic };
+    // the three maps decode concurrently; one channel is enough, every map is read in .r
+    std::vector<ImageDecodeRequest> requests(3);
+    for (int c = 0; c < 3; c++) {
+        requests[c].path = *paths[c];
+        requests[c].requiredChannels = 1;
+        requests[c].flipY = flipY;
+    }
+    std::vector<DecodedImage> images;
+    DecodeImages(requests, images);
+
+    const unsigned char* channels[3] = {};
+    int widths[3] = {}, heights[3] = {};
+    width = height = 0;
+    for (int c = 0; c < 3; c++) {
+        if (!images[c]) continue;
+        channels[c] = images[c].pixels();
+        widths[c] = images[c].width;
+        heights[c] = images[c].height;
+        if (size_t(widths[c]) * heights[c] > size_t(width) * height) {
+            width = widths[c];
+            height = heights[c];
+        }
+    }
+    if (width == 0) return false;
+
+    rgb.resize(size_t(width) * height * 3);
+    ParallelFor(size_t(height), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            for (int c = 0; c < 3; c++) {
+                uint8_t* out = &rgb[y * width * 3 + c];
+                if (!channels[c]) {
+                    for (int x = 0; x < width; x++) out[x * 3] = ORM_DEFAULTS[c];
+                    continue;
+                }
+                const unsigned char* src = channels[c];
+                int w = widths[c], h = heights[c];
+                if (w == width && h == height) {
+                    for (int x = 0; x < width; x++) out[x * 3] = src[y * w + x];
+                    continue;
+                }
+                // bilinear, pixel centers aligned
+                float sy = std::min(std::max((y + 0.5f) * h / height - 0.5f, 0.0f), float(h - 1));
+                int y0 = int(sy), y1 = std::min(y0 + 1, h - 1);
+                float fy = sy - y0;
+                for (int x = 0; x < width; x++) {
+                    float sx = std::min(std::max((x + 0.5f) * w / width - 0.5f, 0.0f), float(w - 1));
+                    int x0 = int(sx), x1 = std::min(x0 + 1, w - 1);
+                    float fx = sx - x0;
+                    float top = src[size_t(y0) * w + x0] + (src[size_t(y0) * w + x1] - src[size_t(y0) * w + x0]) * fx;
+                    float bottom = src[size_t(y1) * w + x0] + (src[size_t(y1) * w + x1] - src[size_t(y1) * w + x0]) * fx;
+                    out[x * 3] = uint8_t(top + (bottom - top) * fy + 0.5f);
+                }
+            }
+        }
+    }, 64);
+    return true;
+}
+
+std::string OrmCacheName(const OrmSources& sources) {
+    for (const std::string* path : { &sources.roughness, &sources.metallic, &sources.ao })
+        if (!path->empty()) return *path + ".orm";
+    return std::string();
+}
+
+uint64_t HashOrmSources(const OrmSources& sources) {
+    uint64_t hashes[3] = {};
+    const std::string* paths[3] = { &sources.ao, &sources.roughness, &sources.metallic };
+    for (int c = 0; c < 3; c++) {
+        if (paths[c]->empty() || !HashFile(*paths[c], hashes[c])) hashes[c] = 0;
+        hashes[c] ^= uint64_t(c + 1) * 0x9E3779B97F4A7C15ull; // the same map in another slot is a different ORM
+    }
+    return HashBytes(hashes, sizeof(hashes));
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// ORM packing: AO, roughness and metallic in one RGB texture
+// ─────
+// basic.frag reads each of those maps in .r only, so one texture holds all three:
+// R = ambient occlusion, G = roughness, B = metallic. One fetch instead of three, but not less
+// memory: the packed texture is uncompressed RGB8 (drivers pad it to 4 bytes a texel), while the
+// three separate masks are BC4 at half a byte each, so ORM takes about 2.7x as much. It trades
+// memory for fetches. An empty or unreadable source fills its channel with
+// the neutral value (AO 1, roughness 1, metallic 0). Sources of different sizes are
+// resampled bilinearly to the largest one.
+struct OrmSources {
+    std::string ao, roughness, metallic;
+};
+
+// false when none of the three sources could be read
+bool PackOrm(const OrmSources& sources, bool flipY, std::vector<uint8_t>& rgb, int& width, int& height);
+
+// Caches sit next to the first named source and are named after "<map>.orm" (<map>.orm.dds,
+// <map>.orm.mips). Their key covers all three sources' bytes and which slot each one fills.
+std::string OrmCacheName(const OrmSources& sources);
+uint64_t HashOrmSources(const OrmSources& sources);
@@ -0,0 +1,492 @@
+#include "texture_streamer.h"
+#include "file_utils.h"
+#include "image_decode.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+static const int STAGING_RING = 3; // PBOs in flight: the GPU reads one while the next ones are filled
+
+// A decoded image as a list of levels, each uploaded row by row (block row by block row when compressed)
+struct TextureStreamer::Decoded {
+    struct Level {
+        int width, height;
+        int rows;        // pixel rows, or 4-pixel block rows
+        size_t rowBytes;
+        const unsigned char* data;
+    };
+    GLenum format = GL_RGBA;      // pixel format, or the compressed internal format
+    GLint internalFormat = GL_RGBA8;
+    bool compressed = false;
+    std::vector<Level> levels;
+    size_t bytes = 0;             // GPU size with mips
+    DecodedImage source;
+    std::vector<unsigned char> packedPixels; // ORM packs
+    CompressedTexture blocks;
+    MipChain mips;
+};
+
+static unsigned int DefaultDecodeThreads() {
+    return std::min(4u, std::max(1u, std::thread::hardware_concurrency() / 2));
+}
+
+TextureStreamer::TextureStreamer(size_t uploadBudget, unsigned int decodeThreads)
+    : uploadBudget(std::max<size_t>(uploadBudget, 1)),
+      decodePool(decodeThreads ? decodeThreads : DefaultDecodeThreads()) {
+}
+
+TextureStreamer::~TextureStreamer() {
+    // queued decodes still run when the pool shuts down; make them return immediately
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+}
+
+void TextureStreamer::init() {
+    // what basic.frag reads from each kind of map when it is absent
+    static const unsigned char PLACEHOLDER_PIXELS[PLACEHOLDER_COUNT][4] = {
+        { 255, 255, 255, 255 }, // base color, AO and roughness masks
+        { 128, 128, 255, 255 }, // flat tangent space normal
+        { 0, 0, 0, 255 },       // metallic mask
+        { 255, 255, 0, 255 },   // ORM: AO 1, roughness 1, metallic 0 (texture_orm.h)
+    };
+    glGenTextures(PLACEHOLDER_COUNT, placeholders);
+    for (int p = 0; p < PLACEHOLDER_COUNT; p++) {
+        glBindTexture(GL_TEXTURE_2D, placeholders[p]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_PIXELS[p]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+
+    staging.resize(STAGING_RING);
+    for (StagingBuffer& buffer : staging) glGenBuffers(1, &buffer.pbo);
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount && !bc1Supported; i++) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        bc1Supported = name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+    }
+    if (!bc1Supported) std::cout << "S3TC not supported: base color maps stay uncompressed" << std::endl;
+}
+
+void TextureStreamer::cleanup() {
+    for (auto& entry : cache) glDeleteTextures(1, &entry.second.texture);
+    cache.clear();
+    for (Slot& slot : slots) slot = Slot();
+    for (Upload& upload : uploads)
+        if (upload.texture) glDeleteTextures(1, &upload.texture);
+    uploads.clear();
+    inFlight.clear();
+    for (StagingBuffer& buffer : staging) {
+        if (buffer.fence) glDeleteSync(buffer.fence);
+        glDeleteBuffers(1, &buffer.pbo);
+    }
+    staging.clear();
+    if (placeholders[0]) glDeleteTextures(PLACEHOLDER_COUNT, placeholders);
+    for (GLuint& placeholder : placeholders) placeholder = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.clear();
+}
+
+// ─────────────────────────────────────────────
+// Loading (render thread) and decoding (worker threads)
+// ─────
+TextureHandle TextureStreamer::load(const std::string& path, TextureRole role, bool generateMipmaps, bool flipY) {
+    TextureHandle handle = static_cast<TextureHandle>(slots.size());
+    slots.push_back(Slot());
+    load(handle, path, role, generateMipmaps, flipY);
+    return handle;
+}
+
+void TextureStreamer::load(TextureHandle handle, const std::string& path, TextureRole role, bool generateMipmaps, bool flipY) {
+    submit(handle, OrmSources(), path, role, generateMipmaps, flipY);
+}
+
+TextureHandle TextureStreamer::loadOrm(const OrmSources& sources, bool generateMipmaps, bool flipY) {
+    TextureHandle handle = static_cast<TextureHandle>(slots.size());
+    slots.push_back(Slot());
+    loadOrm(handle, sources, generateMipmaps, flipY);
+    return handle;
+}
+
+void TextureStreamer::loadOrm(TextureHandle handle, const OrmSources& sources, bool generateMipmaps, bool flipY) {
+    submit(handle, sources, std::string(), TextureRole::Orm, generateMipmaps, flipY);
+}
+
+void TextureStreamer::release(TextureHandle handle) {
+    if (handle < 0 || handle >= static_cast<TextureHandle>(slots.size())) return;
+    detach(slots[handle]);
+    slots[handle].pendingKey.clear(); // an upload nobody waits for is dropped
+    evict();
+}
+
+// path|size|mtime: a stat instead of reading the file, and an edited file is a new key
+static std::string FileKey(const std::string& path) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec) size = 0;
+    auto modified = std::filesystem::last_write_time(path, ec);
+    long long ticks = ec ? 0 : static_cast<long long>(modified.time_since_epoch().count());
+    return path + "|" + std::to_string(size) + "|" + std::to_string(ticks);
+}
+
+// Mask maps share a role; metallic is told apart by name, like GuessTextureRole does. Roughness and
+// AO first: "MetalGalvanizedSteelWorn001_ROUGHNESS_2K" is not a metallic map
+TextureStreamer::Placeholder TextureStreamer::PlaceholderFor(TextureRole role, const std::string& path) {
+    switch (role) {
+    case TextureRole::Normal: return PLACEHOLDER_NORMAL;
+    case TextureRole::Orm: return PLACEHOLDER_ORM;
+    case TextureRole::Mask: {
+        std::string name = std::filesystem::path(path).stem().string();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        for (const char* key : { "rough", "gloss", "occlusion", "_ao" })
+            if (name.find(key) != std::string::npos) return PLACEHOLDER_WHITE;
+        return name.find("metal") != std::string::npos ? PLACEHOLDER_BLACK : PLACEHOLDER_WHITE;
+    }
+    default: return PLACEHOLDER_WHITE;
+    }
+}
+
+void TextureStreamer::submit(TextureHandle handle, const OrmSources& sources, const std::string& path, TextureRole role,
+                             bool generateMipmaps, bool flipY) {
+    std::string key = std::to_string(int(role)) + (generateMipmaps ? "m" : "-") + (flipY ? "f" : "-") + "|";
+    key += role == TextureRole::Orm
+               ? FileKey(sources.ao) + "|" + FileKey(sources.roughness) + "|" + FileKey(sources.metallic)
+               : FileKey(path);
+    Slot& slot = slots[handle];
+    slot.placeholder = PlaceholderFor(role, path);
+    if (cache.count(key)) { // already resident: show it now
+        attach(slot, key);
+        cacheHits++;
+        return;
+    }
+    slot.pendingKey = key;
+    if (!inFlight.insert(key).second) { // another handle already asked for it
+        cacheHits++;
+        return;
+    }
+
+    // BC1 needs S3TC; without it those roles upload plain pixels
+    bool compress = RoleCompresses(role) && (RoleBlockFormat(role) != BlockFormat::BC1 || bc1Supported);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decodesQueued++;
+    }
+    decodePool.submit([=] { decode(key, sources, path, role, compress, generateMipmaps, flipY); });
+}
+
+// ─────────────────────────────────────────────
+// Resident texture cache (render thread)
+// ─────
+bool TextureStreamer::wanted(const std::string& key) const {
+    for (const Slot& slot : slots)
+        if (slot.pendingKey == key) return true;
+    return false;
+}
+
+void TextureStreamer::attach(Slot& slot, const std::string& key) {
+    slot.pendingKey.clear();
+    if (slot.key == key) return;
+    detach(slot);
+    CacheEntry& entry = cache[key];
+    entry.refs++;
+    slot.key = key;
+    slot.texture = entry.texture;
+}
+
+void TextureStreamer::detach(Slot& slot) {
+    if (slot.key.empty()) return;
+    auto it = cache.find(slot.key);
+    if (it != cache.end() && --it->second.refs == 0) it->second.lastUsed = frame;
+    slot.key.clear();
+    slot.texture = 0;
+}
+
+// Drops unreferenced textures, least recently used first, until the cache fits its budget
+void TextureStreamer::evict() {
+    size_t total = 0;
+    for (const auto& entry : cache) total += entry.second.bytes;
+    while (total > cacheBudget) {
+        auto oldest = cache.end();
+        for (auto it = cache.begin(); it != cache.end(); ++it)
+            if (it->second.refs == 0 && (oldest == cache.end() || it->second.lastUsed < oldest->second.lastUsed))
+                oldest = it;
+        if (oldest == cache.end()) return; // everything left is in use
+        total -= oldest->second.bytes;
+        glDeleteTextures(1, &oldest->second.texture);
+        cache.erase(oldest);
+        evictions++;
+    }
+}
+
+static GLenum CompressedGLFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+}
+
+static void PixelFormat(int channels, GLenum& format, GLint& internalFormat) {
+    switch (channels) {
+    case 1: format = GL_RED; internalFormat = GL_R8; break;
+    case 2: format = GL_RG; internalFormat = GL_RG8; break;
+    case 3: format = GL_RGB; internalFormat = GL_RGB8; break;
+    default: format = GL_RGBA; internalFormat = GL_RGBA8; break;
+    }
+}
+
+static bool HasTransparency(const unsigned char* pixels, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++)
+        if (pixels[i * 4 + 3] != 255) return true;
+    return false;
+}
+
+void TextureStreamer::decode(const std::string& key, const OrmSources& sources, const std::string& path,
+                             TextureRole role, bool compress, bool generateMipmaps, bool flipY) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+    }
+
+    auto image = std::make_shared<Decoded>();
+    bool orm = role == TextureRole::Orm;
+    MipOptions mipOptions = MipOptionsForRole(role);
+    uint64_t sourceHash = 0;
+    bool hashed = (compress || generateMipmaps) &&
+                  (orm ? (sourceHash = HashOrmSources(sources), true) : HashFile(path, sourceHash));
+    std::string cacheName = orm ? OrmCacheName(sources) : path;
+    bool cached = hashed && compress &&
+                  ReadCompressedCache(CompressedCachePath(cacheName), sourceHash, flipY, RoleBlockFormat(role), image->blocks);
+    // base colors with alpha stay uncompressed, so they may have a mip cache instead
+    if (!cached && hashed && generateMipmaps && (!compress || role == TextureRole::BaseColor))
+        cached = ReadMipCache(MipCachePath(cacheName), sourceHash, flipY, mipOptions, image->mips);
+    if (!cached) {
+        int width = 0, height = 0, channels = 0;
+        const unsigned char* pixels = nullptr;
+        if (orm) {
+            if (PackOrm(sources, flipY, image->packedPixels, width, height)) {
+                channels = 3;
+                pixels = image->packedPixels.data();
+            }
+        } else if (DecodeImage(path, 0, flipY, image->source)) {
+            width = image->source.width;
+            height = image->source.height;
+            channels = image->source.channels;
+            pixels = image->source.pixels();
+        }
+        if (!pixels) {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodesQueued--;
+            decoded.push_back({ key, nullptr }); // lets the render thread forget the key
+            return;
+        }
+        // BC1 has no real alpha; cut-out or translucent base colors keep every bit
+        if (role == TextureRole::BaseColor && channels == 4 && HasTransparency(pixels, size_t(width) * height))
+            compress = false;
+
+        if (compress) {
+            CompressImage(pixels, width, height, channels, role, generateMipmaps, image->blocks);
+            if (hashed && !WriteCompressedCache(CompressedCachePath(cacheName), sourceHash, flipY, image->blocks))
+                std::cerr << "Could not write texture cache: " << CompressedCachePath(cacheName) << std::endl;
+        } else if (generateMipmaps) {
+            BuildMipChain(pixels, width, height, channels, mipOptions, image->mips);
+            if (hashed && !WriteMipCache(MipCachePath(cacheName), sourceHash, flipY, mipOptions, image->mips))
+                std::cerr << "Could not write texture cache: " << MipCachePath(cacheName) << std::endl;
+        } else {
+            PixelFormat(channels, image->format, image->internalFormat);
+            size_t rowBytes = size_t(width) * channels;
+            image->levels.push_back({ width, height, height, rowBytes, pixels });
+            image->bytes = rowBytes * height;
+        }
+        if (image->levels.empty()) { // the pixels were copied into blocks or mips
+            image->source.reset();
+            std::vector<unsigned char>().swap(image->packedPixels);
+        }
+    }
+    if (!image->mips.levels.empty()) {
+        const MipChain& mips = image->mips;
+        PixelFormat(mips.channels, image->format, image->internalFormat);
+        for (const MipLevel& level : mips.levels) {
+            size_t rowBytes = size_t(level.width) * mips.channels;
+            image->levels.push_back({ level.width, level.height, level.height, rowBytes, mips.data.data() + level.offset });
+        }
+        image->bytes = mips.data.size();
+    } else if (image->levels.empty()) {
+        const CompressedTexture& blocks = image->blocks;
+        image->compressed = true;
+        image->format = CompressedGLFormat(blocks.format);
+        image->internalFormat = GLint(image->format);
+        for (const CompressedLevel& level : blocks.levels) {
+            int rows = (level.height + 3) / 4;
+            image->levels.push_back({ level.width, level.height, rows, level.size / rows, blocks.data.data() + level.offset });
+        }
+        image->bytes = blocks.data.size();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decodesQueued--;
+    decoded.push_back({ key, image });
+}
+
+GLuint TextureStreamer::get(TextureHandle handle) const {
+    if (handle < 0 || handle >= static_cast<TextureHandle>(slots.size())) return placeholders[PLACEHOLDER_WHITE];
+    const Slot& slot = slots[handle];
+    return slot.texture ? slot.texture : placeholders[slot.placeholder];
+}
+
+bool TextureStreamer::isResident(TextureHandle handle) const {
+    return handle >= 0 && handle < static_cast<TextureHandle>(slots.size()) && slots[handle].texture &&
+           slots[handle].pendingKey.empty();
+}
+
+// ─────────────────────────────────────────────
+// Uploading (render thread)
+// ─────
+// Copies as many whole rows of the current level as fit in budget (at least one) into the staging
+// PBO and starts the texture upload from it. Returns false when the buffer could not be written.
+bool TextureStreamer::uploadSlice(Upload& upload, StagingBuffer& buffer, size_t budget, size_t& bytes) {
+    const Decoded& image = *upload.image;
+    if (!upload.texture) { // first slice: allocate every level, the rows arrive over the next frames
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // or the null data below would be read from a PBO
+        glGenTextures(1, &upload.texture);
+        glBindTexture(GL_TEXTURE_2D, upload.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size()) - 1);
+        for (size_t l = 0; l < image.levels.size(); l++) {
+            const Decoded::Level& level = image.levels[l];
+            if (image.compressed)
+                glCompressedTexImage2D(GL_TEXTURE_2D, GLint(l), image.format, level.width, level.height, 0,
+                                       GLsizei(level.rowBytes * level.rows), nullptr);
+            else
+                glTexImage2D(GL_TEXTURE_2D, GLint(l), image.internalFormat, level.width, level.height, 0,
+                             image.format, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+
+    const Decoded::Level& level = image.levels[upload.level];
+    int rows = static_cast<int>(std::min<size_t>(std::max<size_t>(budget / level.rowBytes, 1), level.rows - upload.nextRow));
+    size_t sliceBytes = rows * level.rowBytes;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+    if (sliceBytes > buffer.capacity) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, sliceBytes, nullptr, GL_STREAM_DRAW);
+        buffer.capacity = sliceBytes;
+    }
+    // the fence has signaled, so nothing reads this buffer any more
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sliceBytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) return false;
+    std::memcpy(mapped, level.data + upload.nextRow * level.rowBytes, sliceBytes);
+    if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) return false; // contents lost, retry next frame
+
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    if (image.compressed) {
+        // block rows: y on a 4-pixel boundary, the last slice ends at the level's edge
+        int y = upload.nextRow * 4, height = std::min(rows * 4, level.height - y);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, GLint(upload.level), 0, y, level.width, height, image.format,
+                                  GLsizei(sliceBytes), nullptr);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, GLint(upload.level), 0, upload.nextRow, level.width, rows, image.format,
+                        GL_UNSIGNED_BYTE, nullptr);
+    }
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    upload.nextRow += rows;
+    if (upload.nextRow == level.rows) {
+        upload.level++;
+        upload.nextRow = 0;
+    }
+    bytes += sliceBytes;
+    return true;
+}
+
+// Last rows are queued; they land before any draw that samples the texture, in command order,
+// so it can be handed out right away.
+void TextureStreamer::finish(Upload& upload) {
+    inFlight.erase(upload.key);
+    CacheEntry& entry = cache[upload.key];
+    entry.texture = upload.texture;
+    entry.bytes = upload.image->bytes;
+    entry.lastUsed = frame;
+    for (Slot& slot : slots)
+        if (slot.pendingKey == upload.key) attach(slot, upload.key);
+    evict();
+}
+
+void TextureStreamer::update() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Upload& upload : decoded) uploads.push_back(upload);
+        decoded.clear();
+    }
+
+    GLint previousTexture, previousAlignment;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of 1 and 3 channel images are tightly packed
+
+    frame++;
+    size_t bytes = 0;
+    while (!uploads.empty() && bytes < uploadBudget) {
+        Upload& upload = uploads.front();
+        if (!upload.image || !wanted(upload.key)) { // failed, or every handle moved on before it finished
+            if (upload.texture) glDeleteTextures(1, &upload.texture);
+            if (!upload.image) {
+                for (Slot& slot : slots) // they keep showing what they showed before
+                    if (slot.pendingKey == upload.key) slot.pendingKey.clear();
+            }
+            inFlight.erase(upload.key);
+            uploads.pop_front();
+            continue;
+        }
+
+        StagingBuffer& buffer = staging[nextStaging];
+        if (buffer.fence) {
+            if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break; // GPU is behind, try next frame
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+        if (!uploadSlice(upload, buffer, uploadBudget - bytes, bytes)) break;
+        nextStaging = (nextStaging + 1) % staging.size();
+        if (upload.level == upload.image->levels.size()) {
+            finish(upload);
+            uploads.pop_front();
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+    evict(); // the budget may have shrunk
+    lastBytesUploaded = bytes;
+    uploadMBPerFrame += (float(bytes) / (1024.0f * 1024.0f) - uploadMBPerFrame) * 0.1f;
+}
+
+TextureStreamStats TextureStreamer::stats() const {
+    TextureStreamStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.decodesQueued = decodesQueued;
+        stats.uploadsQueued = decoded.size();
+    }
+    stats.uploadsQueued += uploads.size();
+    stats.bytesUploaded = lastBytesUploaded;
+    stats.uploadMBPerFrame = uploadMBPerFrame;
+    for (const auto& entry : cache) {
+        stats.residentBytes += entry.second.bytes;
+        if (entry.second.refs == 0) stats.cachedBytes += entry.second.bytes;
+    }
+    stats.cacheHits = cacheHits;
+    stats.evictions = evictions;
+    return stats;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "texture_compress.h"
+#include "texture_mips.h"
+#include "texture_orm.h"
+#include "thread_utils.h"
+#include <glad/glad.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// TextureStreamer: asynchronous 2D texture loading
+// ─────
+// load() returns right away. The file is decoded on the streamer's own worker threads, then
+// uploaded from the render thread through a ring of pixel unpack buffers, a few rows at a time,
+// so each update() copies at most uploadBudget bytes. Until then get() returns a 1x1 placeholder
+// that shades as if the map were absent (white base color, flat normal, AO / roughness 1,
+// metallic 0), or the texture the handle showed before it was pointed at a new file.
+// Maps loaded with a role are block compressed (texture_compress.h) and their DDS cache is
+// read instead of the image when it is current; mips then come from the cache too.
+// Uncompressed maps get a CPU mip chain (texture_mips.h), cached as <image>.mips.
+//
+// Resident textures are shared: they are keyed by path, file size and modification time (plus
+// role and load flags), and reference counted by the handles showing them. Loading a key that is
+// already resident, or already on its way, costs nothing. Textures no handle shows any more stay
+// resident so switching back is instant, and are evicted least recently used first once all
+// resident textures exceed the cache budget.
+typedef int TextureHandle;
+static const TextureHandle INVALID_TEXTURE_HANDLE = -1;
+
+struct TextureStreamStats {
+    size_t decodesQueued = 0;    // files waiting for or being decoded
+    size_t uploadsQueued = 0;    // decoded images waiting for or being uploaded
+    size_t bytesUploaded = 0;    // by the last update()
+    float uploadMBPerFrame = 0.0f; // smoothed over recent updates
+    size_t residentBytes = 0;    // GPU memory of every resident texture, mips included
+    size_t cachedBytes = 0;      // part of residentBytes no handle shows (evictable)
+    size_t cacheHits = 0;        // loads served by a resident or in-flight texture
+    size_t evictions = 0;        // textures deleted by the budget so far; their names may come back
+};
+
+class TextureStreamer {
+public:
+    // uploadBudget: bytes copied into PBOs per update(); decodeThreads 0 = half the hardware threads (1..4)
+    explicit TextureStreamer(size_t uploadBudget = 8u << 20, unsigned int decodeThreads = 0);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Needs the GL context: creates the placeholders and the PBO ring
+    void init();
+    // Deletes every texture and buffer; call before the context goes away
+    void cleanup();
+
+    // Starts streaming path into a new handle, or into an existing one (which keeps showing its
+    // current texture until the new one is resident; a newer load() on the same handle wins).
+    TextureHandle load(const std::string& path, TextureRole role = TextureRole::Uncompressed,
+                       bool generateMipmaps = true, bool flipY = true);
+    void load(TextureHandle handle, const std::string& path, TextureRole role = TextureRole::Uncompressed,
+              bool generateMipmaps = true, bool flipY = true);
+    // Same, for AO / roughness / metallic packed into one ORM texture (uncompressed RGB8, mips cached as <map>.orm.mips)
+    TextureHandle loadOrm(const OrmSources& sources, bool generateMipmaps = true, bool flipY = true);
+    void loadOrm(TextureHandle handle, const OrmSources& sources, bool generateMipmaps = true, bool flipY = true);
+    // Detaches the handle (get() returns the placeholder again) and drops its load in flight. The
+    // texture stays cached until the budget evicts it.
+    void release(TextureHandle handle);
+    // GPU memory kept for resident textures before unreferenced ones are evicted
+    void setCacheBudget(size_t bytes) { cacheBudget = bytes; }
+    size_t getCacheBudget() const { return cacheBudget; }
+
+    GLuint get(TextureHandle handle) const; // resident texture, or the placeholder
+    bool isResident(TextureHandle handle) const;
+
+    // Once per frame on the render thread: recycles finished PBOs and uploads the next slices
+    void update();
+
+    TextureStreamStats stats() const;
+
+private:
+    struct Decoded; // a decoded image, shared with the worker that produced it
+    enum Placeholder { PLACEHOLDER_WHITE, PLACEHOLDER_NORMAL, PLACEHOLDER_BLACK, PLACEHOLDER_ORM, PLACEHOLDER_COUNT };
+    struct Slot {
+        std::string key;        // cache entry shown (empty = placeholder)
+        GLuint texture = 0;     // that entry's texture
+        std::string pendingKey; // entry the last load() asked for, until it is resident
+        Placeholder placeholder = PLACEHOLDER_WHITE; // shown while there is no texture, by the last load's role
+    };
+    struct CacheEntry {
+        GLuint texture = 0;
+        size_t bytes = 0;
+        int refs = 0;           // slots showing it
+        uint64_t lastUsed = 0;  // update() count when the last slot let go of it
+    };
+    struct Upload {
+        std::string key;
+        std::shared_ptr<Decoded> image; // null: the decode failed
+        GLuint texture = 0;  // being filled, added to the cache when the last row is in
+        size_t level = 0;
+        int nextRow = 0;     // pixel rows, or block rows for compressed levels
+    };
+    struct StagingBuffer {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr; // set while the GPU may still read from pbo
+    };
+
+    static Placeholder PlaceholderFor(TextureRole role, const std::string& path);
+    void submit(TextureHandle handle, const OrmSources& sources, const std::string& path, TextureRole role,
+                bool generateMipmaps, bool flipY);
+    void decode(const std::string& key, const OrmSources& sources, const std::string& path, TextureRole role,
+                bool compress, bool generateMipmaps, bool flipY);
+    bool uploadSlice(Upload& upload, StagingBuffer& staging, size_t budget, size_t& bytes);
+    void finish(Upload& upload);
+    bool wanted(const std::string& key) const; // some slot is waiting for it
+    void attach(Slot& slot, const std::string& key);
+    void detach(Slot& slot);
+    void evict();
+
+    size_t uploadBudget;
+    size_t cacheBudget = 256u << 20;
+    GLuint placeholders[PLACEHOLDER_COUNT] = {};
+    bool bc1Supported = false; // EXT_texture_compression_s3tc; BC4/BC5 (RGTC) are core
+    std::vector<Slot> slots;
+    std::vector<StagingBuffer> staging;
+    size_t nextStaging = 0;
+    std::deque<Upload> uploads; // render thread only
+    std::unordered_map<std::string, CacheEntry> cache;
+    std::unordered_set<std::string> inFlight; // keys being decoded or uploaded
+    uint64_t frame = 0;
+    size_t cacheHits = 0;
+    size_t evictions = 0;
+
+    mutable std::mutex mutex;   // guards decoded, decodesQueued and stopping
+    std::vector<Upload> decoded;
+    size_t decodesQueued = 0;
+    bool stopping = false;
+
+    size_t lastBytesUploaded = 0;
+    float uploadMBPerFrame = 0.0f;
+
+    ThreadPool decodePool; // last, so its workers are joined before the members they write to go away
+};
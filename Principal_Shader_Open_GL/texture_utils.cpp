@@ -1,22 +1,44 @@
 #include "texture_utils.h"
+#include "file_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <iostream>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "External/stb_image.h"
-
-
-
-GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY) {
-    stbi_set_flip_vertically_on_load(flipY);
+#include "image_decode.h"
+#include "thread_utils.h"
+
+
+// CPU half of LoadTexture2D, safe on any thread: the chain from a current <image>.mips, or the
+// decoded image (and its mips, which are then cached). A single level when generateMipmaps is off.
+static bool PrepareTexture2D(const std::string& path, bool generateMipmaps, bool flipY, const MipOptions& mipOptions,
+                             MipChain& mips) {
+    uint64_t sourceHash = 0;
+    bool hashed = generateMipmaps && HashFile(path, sourceHash);
+    if (hashed && ReadMipCache(MipCachePath(path), sourceHash, flipY, mipOptions, mips)) return true;
+
+    DecodedImage image;
+    if (!DecodeImage(path, 0, flipY, image)) return false;
+    if (generateMipmaps) {
+        BuildMipChain(image.pixels(), image.width, image.height, image.channels, mipOptions, mips);
+        if (hashed && !WriteMipCache(MipCachePath(path), sourceHash, flipY, mipOptions, mips))
+            std::cerr << "Could not write texture cache: " << MipCachePath(path) << std::endl;
+    } else {
+        mips.channels = image.channels;
+        mips.levels.assign(1, MipLevel());
+        mips.levels[0].width = image.width;
+        mips.levels[0].height = image.height;
+        mips.data.assign(image.pixels(), image.pixels() + image.byteSize());
+    }
+    return true;
+}
 
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
-    if (!data) {
-        std::cerr << "Failed to load texture at: " << path << std::endl;
-        std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
-        
+// GL half: every level of the chain, or a 1x1 white texture when there is none
+static GLuint UploadTexture2D(const MipChain& mips) {
+    if (mips.levels.empty()) {
         // Create a default 1x1 white texture instead of returning 0
         GLuint texture;
         glGenTextures(1, &texture);
@@ -25,6 +47,7 @@ GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
         return texture;
     }
+    int nrChannels = mips.channels;
 
     // Generate texture and upload data to GPU
     GLuint texture;
@@ -34,7 +57,7 @@ GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY)
     // Texture sampling and wrapping behavior
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mips.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     GLenum format;
@@ -46,7 +69,7 @@ GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY)
         format = GL_RGBA;
     else {
         std::cerr << "Unexpected number of channels: " << nrChannels << std::endl;
-        stbi_image_free(data);
+        glDeleteTextures(1, &texture);
         return 0;
     }
 
@@ -57,27 +80,43 @@ GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY)
         internalFormat = GL_RGB;
     else
         internalFormat = GL_RGBA;
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-
-    if (generateMipmaps)
-        glGenerateMipmap(GL_TEXTURE_2D);
 
-    stbi_image_free(data);
+    GLint previousAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // mip rows of 1 and 3 channel images are tightly packed
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(mips.levels.size()) - 1);
+    for (size_t l = 0; l < mips.levels.size(); l++)
+        glTexImage2D(GL_TEXTURE_2D, GLint(l), internalFormat, mips.levels[l].width, mips.levels[l].height, 0, format,
+                     GL_UNSIGNED_BYTE, mips.data.data() + mips.levels[l].offset);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
     return texture;
 }
 
-GLuint LoadHDRTexture(const std::string& path) {
-    // Use stbi_loadf for floating point data
-    // HDR files store linear values that can exceed 1.0
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    float* data = stbi_loadf(path.c_str(), &width, &height, &nrChannels, 0);
+GLuint LoadTexture2D(const std::string& path, bool generateMipmaps, bool flipY, const MipOptions& mipOptions) {
+    // mips are built on the CPU (texture_mips.h); a current <image>.mips skips the decode entirely
+    MipChain mips;
+    PrepareTexture2D(path, generateMipmaps, flipY, mipOptions, mips);
+    return UploadTexture2D(mips);
+}
 
-    if (!data) {
-        std::cerr << "Failed to load hdr texture at: " << path << std::endl;
-        std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
-        return 0;
-    }
+std::vector<GLuint> LoadTextures2D(const std::vector<std::string>& paths, const std::vector<MipOptions>& mipOptions,
+                                   bool generateMipmaps, bool flipY) {
+    // decode and build mips for the whole set on the thread pool, then upload in order
+    std::vector<MipChain> chains(paths.size());
+    ParallelFor(paths.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            PrepareTexture2D(paths[i], generateMipmaps, flipY, i < mipOptions.size() ? mipOptions[i] : MipOptions(), chains[i]);
+    }, 1);
+    std::vector<GLuint> textures;
+    for (const MipChain& mips : chains) textures.push_back(UploadTexture2D(mips));
+    return textures;
+}
+
+GLuint LoadHDRTexture(const std::string& path, EnvironmentImage* pixels) {
+    // Float pixels from the decode backend (stb_image's Radiance reader)
+    // HDR files store linear values that can exceed 1.0
+    EnvironmentImage image;
+    if (!LoadEnvironmentImage(path, image)) return 0;
 
     // Generate texture and upload data to GPU
     GLuint hdrTexture;
@@ -90,191 +129,286 @@ GLuint LoadHDRTexture(const std::string& path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    GLenum format;
-    if (nrChannels == 1)
-        format = GL_RED;  // Grayscale
-    else if (nrChannels == 3)
-        format = GL_RGB;
-    else if (nrChannels == 4)
-        format = GL_RGBA;
-    else {
-        std::cerr << "Unexpected number of channels: " << nrChannels << std::endl;
-        stbi_image_free(data);
-        return 0;
-    }
-
-   GLint internalFormat;
-    if (nrChannels == 1)
-        internalFormat = GL_R16F;
-    else if (nrChannels == 3)
-        internalFormat = GL_RGB16F;
-    else
-        internalFormat = GL_RGBA16F;
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, data);
-
-    stbi_image_free(data);
+    // RGB floats, rows of 12 * width bytes (always 4 byte aligned)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_FLOAT, image.texels.data());
+    if (pixels) *pixels = std::move(image); // kept for CPU work on the same pixels (SH irradiance)
     return hdrTexture;
-    
-    // Your task:
-    // 1. Call stbi_set_flip_vertically_on_load(true)
-    // 2. Use stbi_loadf() instead of stbi_load()
-    // 3. Create texture with GL_RGB16F or GL_RGB32F internal format
-    // 4. Use GL_FLOAT as type instead of GL_UNSIGNED_BYTE
 }
 
-GLuint EquirectToCubemap(GLuint hdrTex, GLuint /*unused*/, GLuint /*unused*/, int size) {
-    GLuint captureFBO, captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-    GLuint envCubemap;
-    glGenTextures(1, &envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    for (int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, nullptr);
+// ─────────────────────────────────────────────
+// Baked IBL maps, through <hdr>.ibl (ibl_cache.h)
+// ─────
+// RGB16F cubemap from size / levels chains of half floats laid out like the cache
+static GLuint UploadCubemapChain(int size, int levels, const uint16_t* halfs) {
+    GLuint cubemap;
+    glGenTextures(1, &cubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    GLint previousAlignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows are 6 * size bytes
+    for (int level = 0; level < levels; ++level) {
+        int levelSize = std::max(size >> level, 1);
+        for (int i = 0; i < 6; ++i) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGB16F, levelSize, levelSize, 0, GL_RGB,
+                         GL_HALF_FLOAT, halfs);
+            halfs += size_t(levelSize) * levelSize * 3;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return cubemap;
+}
 
-    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glm::mat4 views[] = {
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
-
-    // compile shaders
-    std::string vertexSource = ReadTextFile("shaders/cubemap_vertex.vert");
-    std::string fragSource = ReadTextFile("shaders/equirect_to_cubemap.frag");
-
-    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
-    GLuint frag_shader = CompileShader(GL_FRAGMENT_SHADER, fragSource.c_str());
-    GLuint shader_program = LinkProgram(vertex_shader, frag_shader);
-    glUseProgram(shader_program);
-
-    GLint loc_equirectangularMap = glGetUniformLocation(shader_program, "equirectangularMap");
-    GLint loc_proj     = glGetUniformLocation(shader_program, "projection");
-    GLint loc_view     = glGetUniformLocation(shader_program, "view");
-    glUniform1i(loc_equirectangularMap, 0);
-    glUniformMatrix4fv(loc_proj, 1, GL_FALSE, glm::value_ptr(proj));
-
-    // bind HDR
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTex);
-
-    // state
-    GLint prevViewport[4]; glGetIntegerv(GL_VIEWPORT, prevViewport);
-    glViewport(0, 0, size, size);
-    glEnable(GL_DEPTH_TEST);
-    GLint prevDepthFunc; glGetIntegerv(GL_DEPTH_FUNC, &prevDepthFunc);
-    glDepthFunc(GL_LEQUAL);
-
-    // render into each face
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Cubemap capture FBO incomplete\n";
+static void ReadCubemapChain(GLuint cubemap, int size, int levels, std::vector<uint16_t>& halfs) {
+    halfs.resize(CubemapChainHalfs(size, levels));
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    GLint previousAlignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &previousAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    uint16_t* out = halfs.data();
+    for (int level = 0; level < levels; ++level) {
+        int levelSize = std::max(size >> level, 1);
+        for (int i = 0; i < 6; ++i) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGB, GL_HALF_FLOAT, out);
+            out += size_t(levelSize) * levelSize * 3;
+        }
     }
-    for (int i = 0; i < 6; ++i) {
-        glUniformMatrix4fv(loc_view, 1, GL_FALSE, glm::value_ptr(views[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderCube(); // your helper that binds its own VAO
+    glPixelStorei(GL_PACK_ALIGNMENT, previousAlignment);
+}
+
+bool LoadEnvironmentIBL(IBLBaker& baker, const std::string& hdrPath, IBLMaps& out, const IBLBakeSettings& settings) {
+    auto t0 = std::chrono::steady_clock::now();
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    uint64_t sourceHash = 0;
+    bool hashed = HashFile(hdrPath, sourceHash);
+    std::string cachePath = IBLCachePath(hdrPath);
+    MappedIBL cached;
+    if (hashed && OpenIBLCache(cachePath, sourceHash, settings, cached)) {
+        out.environment = UploadCubemapChain(int(cached.header->environmentSize), int(cached.header->environmentLevels),
+                                             cached.environment);
+        out.prefiltered = UploadCubemapChain(int(cached.header->prefilterSize), int(cached.header->prefilterLevels),
+                                             cached.prefiltered);
+        out.irradiance = cached.irradiance;
+        std::cout << "IBL: " << hdrPath << " from cache in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms" << std::endl;
+        return true;
     }
 
-    // restore state
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
-    glDepthFunc(prevDepthFunc);
+    EnvironmentImage pixels;
+    if (!LoadEnvironmentImage(hdrPath, pixels)) return false;
+    out.irradiance = ProjectIrradianceSH(pixels);
+    out.environment = baker.equirectToCubemap(pixels, settings.environmentSize);
+    out.prefiltered = baker.prefilter(out.environment, settings.prefilterSize, settings.prefilterLevels);
+
+    if (hashed) {
+        std::vector<uint16_t> environment, prefiltered;
+        ReadCubemapChain(out.environment, settings.environmentSize, CubemapMipLevels(settings.environmentSize), environment);
+        ReadCubemapChain(out.prefiltered, settings.prefilterSize, settings.prefilterLevels, prefiltered);
+        if (!WriteIBLCache(cachePath, sourceHash, settings, out.irradiance, environment, prefiltered))
+            std::cerr << "Could not write IBL cache: " << cachePath << std::endl;
+    }
+    std::cout << "IBL: baked " << hdrPath << " (" << IBLBakeBackendName(baker.getBackend()) << ") in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms" << std::endl;
+    return true;
+}
 
-    glDeleteRenderbuffers(1, &captureRBO);
-    glDeleteFramebuffers(1, &captureFBO);
-    glDeleteProgram(shader_program);
-    glDeleteShader(vertex_shader);
-    glDeleteShader(frag_shader);
+void DeleteIBLMaps(IBLMaps& maps) {
+    glDeleteTextures(1, &maps.environment);
+    glDeleteTextures(1, &maps.prefiltered);
+    maps = IBLMaps();
+}
 
-    return envCubemap;
+static float Luminance(const glm::vec3& c) {
+    return glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
 }
 
-GLuint ConvolveIrradiance(GLuint envCubemap) {
-    GLuint captureFBO, captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-    GLuint irradianceMap;
-    glGenTextures(1, &irradianceMap);
+void ValidateIBL(IBLBaker& baker, const std::string& hdrPath, const IBLMaps& maps, GLuint brdfLut) {
+    // BRDF LUT: every 8th texel against IntegrateBrdf
+    GLint lutSize = 0;
+    glBindTexture(GL_TEXTURE_2D, brdfLut);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &lutSize);
+    if (lutSize > 0) {
+        std::vector<glm::vec2> gpu(size_t(lutSize) * lutSize);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, gpu.data());
+        const int stride = 8;
+        int samples = (lutSize + stride - 1) / stride;
+        std::vector<float> rowError(samples, 0.0f);
+        ParallelFor(size_t(samples), [&](size_t begin, size_t end) {
+            for (size_t sy = begin; sy < end; sy++) {
+                int y = int(sy) * stride;
+                for (int x = 0; x < lutSize; x += stride) {
+                    glm::vec2 ref = IntegrateBrdf((x + 0.5f) / lutSize, (y + 0.5f) / lutSize);
+                    glm::vec2 d = glm::abs(gpu[size_t(y) * lutSize + x] - ref);
+                    rowError[sy] = std::max(rowError[sy], std::max(d.x, d.y));
+                }
+            }
+        });
+        std::cout << "IBL: BRDF LUT " << lutSize << "x" << lutSize << " max error "
+                  << *std::max_element(rowError.begin(), rowError.end()) << std::endl;
+    }
+
+    // SH irradiance against the convolution shader it replaces, and both against the CPU convolution
+    EnvironmentImage env;
+    if (!LoadEnvironmentImage(hdrPath, env)) return;
+    GLuint irradianceMap = baker.convolveIrradiance(maps.environment);
+    GLint irradianceSize = 0;
     glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &irradianceSize);
+    if (irradianceSize > 0) {
+        EnvironmentImage tiny = env.downsampled(256);
+        std::vector<glm::vec3> face(size_t(irradianceSize) * irradianceSize);
+        float shMean = 0.0f, shMax = 0.0f, convolutionMean = 0.0f;
+        int count = 0, referenceCount = 0;
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        for (int f = 0; f < 6; f++) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGB, GL_FLOAT, face.data());
+            for (int y = 0; y < irradianceSize; y += 4)
+                for (int x = 0; x < irradianceSize; x += 4, count++) {
+                    glm::vec3 n = CubemapTexelDirection(f, x, y, irradianceSize);
+                    glm::vec3 convolved = face[size_t(y) * irradianceSize + x];
+                    float error = glm::length(maps.irradiance.evaluate(n) - convolved) / std::max(glm::length(convolved), 1e-3f);
+                    shMean += error;
+                    shMax = std::max(shMax, error);
+                    if (x % 16 == 0 && y % 16 == 0) { // the CPU convolution is slow: a few directions only
+                        glm::vec3 ref = IrradianceReference(tiny, n);
+                        convolutionMean += glm::length(convolved - ref) / std::max(glm::length(ref), 1e-3f);
+                        referenceCount++;
+                    }
+                }
+        }
+        std::cout << "IBL: SH irradiance vs irradiance_convolution.frag: mean error " << shMean / count * 100.0f
+                  << "%, max " << shMax * 100.0f << "% (the convolution itself is " << convolutionMean / referenceCount * 100.0f
+                  << "% off the CPU reference)" << std::endl;
+    }
+    glDeleteTextures(1, &irradianceMap);
+
+    // Prefiltered environment: a 4x4 grid of texels per face and level against PrefilterReference
+    EnvironmentImage coarse = env.downsampled(512); // the reference integrates every texel per direction
+    glBindTexture(GL_TEXTURE_CUBE_MAP, maps.prefiltered);
+    GLint maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int level = 0; level <= maxLevel; level++) {
+        GLint size = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, level, GL_TEXTURE_WIDTH, &size);
+        if (size <= 0) break;
+        float roughness = PrefilterRoughness(level, maxLevel + 1);
+        std::vector<glm::vec3> faces[6];
+        for (int face = 0; face < 6; face++) {
+            faces[face].resize(size_t(size) * size);
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_FLOAT, faces[face].data());
+        }
+        const int grid = std::min(4, int(size));
+        std::vector<float> errors(6 * grid * grid);
+        ParallelFor(errors.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                int face = int(i) / (grid * grid);
+                int x = (int(i) % grid) * size / grid + size / (2 * grid);
+                int y = (int(i) / grid % grid) * size / grid + size / (2 * grid);
+                glm::vec3 direction = CubemapTexelDirection(face, x, y, size);
+                glm::vec3 ref = PrefilterReference(roughness > 0.0f ? coarse : env, direction, roughness);
+                float gpu = Luminance(faces[face][size_t(y) * size + x]);
+                errors[i] = std::fabs(gpu - Luminance(ref)) / std::max(Luminance(ref), 1e-3f);
+            }
+        });
+        float mean = 0.0f;
+        for (float e : errors) mean += e;
+        mean /= errors.size();
+        std::cout << "IBL: prefilter level " << level << " (" << size << "^2, roughness " << roughness
+                  << ") mean error " << mean * 100.0f << "%, max " << *std::max_element(errors.begin(), errors.end()) * 100.0f
+                  << "%" << std::endl;
+    }
+}
+
+// One level of a cubemap as floats, the faces back to back
+static void ReadCubemapLevel(GLuint cubemap, int level, int size, std::vector<glm::vec3>& out) {
+    out.resize(6 * size_t(size) * size);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int face = 0; face < 6; face++)
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_FLOAT, out.data() + size_t(face) * size * size);
+}
 
-    // compile shaders
-    std::string vertexSource = ReadTextFile("shaders/cubemap_vertex.vert");  // Reuse existing
-    std::string fragSource = ReadTextFile("shaders/irradiance_convolution.frag");
-    GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, vertexSource.c_str());
-    GLuint frag_shader = CompileShader(GL_FRAGMENT_SHADER, fragSource.c_str());
-    GLuint program = LinkProgram(vertex_shader, frag_shader);
-    glUseProgram(program);
-
-    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glm::mat4 views[] = {
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+// mean and max of |a - b| / |b| over the texels
+static glm::vec2 RelativeDifference(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b) {
+    double sum = 0.0;
+    float worst = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        float d = glm::length(a[i] - b[i]) / std::max(glm::length(b[i]), 1e-3f);
+        sum += d;
+        worst = std::max(worst, d);
+    }
+    return glm::vec2(float(sum / std::max<size_t>(a.size(), 1)), worst);
+}
+
+void CompareIBLBackends(IBLBaker& baker, const std::string& hdrPath) {
+    EnvironmentImage env;
+    if (!LoadEnvironmentImage(hdrPath, env)) return;
+    IBLBakeBackend previous = baker.getBackend();
+    const IBLBakeBackend backends[] = { IBLBakeBackend::Raster, IBLBakeBackend::Compute, IBLBakeBackend::CPU };
+    const int CPU = 2;
+    const float tolerance = 0.005f; // mean relative difference; half floats alone round by up to 0.05%
+    auto bake = [&](int b, const std::function<GLuint()>& run, double& ms) {
+        baker.setBackend(backends[b]);
+        glFinish();
+        auto t0 = std::chrono::steady_clock::now();
+        GLuint texture = run();
+        glFinish();
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return texture;
     };
 
-    // set uniforms
-    glUniform1i(glGetUniformLocation(program, "environmentMap"), 0);
-    glUniform1i(glGetUniformLocation(program, "irradianceMap"), 4);  // Texture unit 4
-    glUniform1i(glGetUniformLocation(program, "useIBL"), 1);  // Enable IBL
-    GLint loc_proj     = glGetUniformLocation(program, "projection");
-    GLint loc_view     = glGetUniformLocation(program, "view");
-    glUniformMatrix4fv(loc_proj, 1, GL_FALSE, glm::value_ptr(proj));
-
-    // bind HDR
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    // Before rendering loop
-    glViewport(0, 0, 32, 32);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-
-    // render into each irradianceMap face
-    for (int i = 0; i < 6; ++i) {
-        glUniformMatrix4fv(loc_view, 1, GL_FALSE, glm::value_ptr(views[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderCube(); // your helper that binds its own VAO
+    std::vector<glm::vec3> reference, other;
+    for (int size : { 256, 512, 1024, 2048 }) {
+        GLuint cubemaps[3] = {};
+        double ms[3] = {};
+        for (int b = 0; b < 3; b++)
+            if (baker.supports(backends[b]))
+                cubemaps[b] = bake(b, [&]() { return baker.equirectToCubemap(env, size); }, ms[b]);
+        std::cout << "IBL bake " << size << "^2:";
+        for (int b = 0; b < 3; b++) {
+            std::cout << " " << IBLBakeBackendName(backends[b]) << " ";
+            if (cubemaps[b]) std::cout << ms[b] << " ms";
+            else std::cout << "unsupported";
+        }
+        std::cout << std::endl;
+
+        // against the CPU bake, at level 0 and at 1/8 size where the mip filter shows
+        for (int level : { 0, 3 }) {
+            int levelSize = std::max(size >> level, 1);
+            ReadCubemapLevel(cubemaps[CPU], level, levelSize, reference);
+            for (int b = 0; b < CPU; b++) {
+                if (!cubemaps[b]) continue;
+                ReadCubemapLevel(cubemaps[b], level, levelSize, other);
+                glm::vec2 difference = RelativeDifference(other, reference);
+                // raster samples through the texture unit, which clamps at the u = 0 / 1 seam: informational only
+                bool fail = backends[b] == IBLBakeBackend::Compute && difference.x > tolerance;
+                std::cout << "  level " << level << " " << IBLBakeBackendName(backends[b]) << " vs CPU: mean "
+                          << difference.x * 100.0f << "%, max " << difference.y * 100.0f << "%" << (fail ? "  FAIL" : "")
+                          << std::endl;
+            }
+        }
+        glDeleteTextures(3, cubemaps);
     }
 
-    // restore state
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    return irradianceMap;
-    // Similar to EquirectToCubemap but:
-    // 1. Use envCubemap as input instead of HDR texture
-    // 2. Use irradiance_convolution.frag shader
-    // 3. Make it smaller (32x32 is enough for irradiance)
-    // 4. Bind envCubemap as samplerCube, not sampler2D
-}
\ No newline at end of file
+    if (baker.supports(IBLBakeBackend::Compute)) {
+        double computeMs = 0.0, cpuMs = 0.0;
+        GLuint compute = bake(1, [&]() { return baker.convolveIrradiance(env); }, computeMs);
+        GLuint cpu = bake(CPU, [&]() { return baker.convolveIrradiance(env); }, cpuMs);
+        ReadCubemapLevel(compute, 0, IRRADIANCE_MAP_SIZE, other);
+        ReadCubemapLevel(cpu, 0, IRRADIANCE_MAP_SIZE, reference);
+        glm::vec2 difference = RelativeDifference(other, reference);
+        std::cout << "IBL irradiance " << IRRADIANCE_MAP_SIZE << "^2: Compute " << computeMs << " ms, CPU " << cpuMs
+                  << " ms, mean difference " << difference.x * 100.0f << "%, max " << difference.y * 100.0f << "%"
+                  << (difference.x > tolerance ? "  FAIL" : "") << std::endl;
+        glDeleteTextures(1, &compute);
+        glDeleteTextures(1, &cpu);
+    }
+    baker.setBackend(previous);
+}
@@ -2,13 +2,43 @@
 #pragma once
 #include "shader_utils.h"
 #include "mesh_utils.h"
+#include "ibl_utils.h"
+#include "ibl_baker.h"
+#include "ibl_cache.h"
+#include "texture_mips.h"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
+#include <vector>
 
-GLuint LoadTexture2D(const std::string& path, bool generateMipmaps=true, bool flipY=true); // returns GL texture id
-GLuint LoadHDRTexture(const std::string& path);
-GLuint EquirectToCubemap(GLuint hdrTex, GLuint cubeVAO, GLuint cubeVBO, int size = 512);
-GLuint ConvolveIrradiance(GLuint envCubemap);
\ No newline at end of file
+// returns GL texture id; mipOptions picks the mip filter and color space (MipOptionsForRole)
+GLuint LoadTexture2D(const std::string& path, bool generateMipmaps=true, bool flipY=true,
+                     const MipOptions& mipOptions = MipOptions());
+// The same for a whole material set: decodes (image_decode.h) and mips run concurrently
+std::vector<GLuint> LoadTextures2D(const std::vector<std::string>& paths, const std::vector<MipOptions>& mipOptions,
+                                   bool generateMipmaps = true, bool flipY = true);
+// pixels (optional) receives the decoded equirect image, e.g. for ProjectIrradianceSH
+GLuint LoadHDRTexture(const std::string& path, EnvironmentImage* pixels = nullptr);
+
+// Everything image based lighting needs from one HDR
+struct IBLMaps {
+    GLuint environment = 0; // cubemap with mips: skybox, and the prefilter's source
+    GLuint prefiltered = 0; // IBLBaker::prefilter
+    IrradianceSH irradiance;
+};
+// Uploads the maps from <hdr>.ibl when it matches the HDR's bytes and settings; otherwise bakes them
+// (LoadEnvironmentImage, ProjectIrradianceSH, then baker's equirectToCubemap and prefilter) and writes
+// the cache. false when the HDR can't be read.
+bool LoadEnvironmentIBL(IBLBaker& baker, const std::string& hdrPath, IBLMaps& out,
+                        const IBLBakeSettings& settings = IBLBakeSettings());
+void DeleteIBLMaps(IBLMaps& maps);
+
+// Reads the bakes back and prints their error against the CPU reference for the HDR they came from;
+// the SH irradiance is compared with IBLBaker::convolveIrradiance's output
+void ValidateIBL(IBLBaker& baker, const std::string& hdrPath, const IBLMaps& maps, GLuint brdfLut);
+// Bakes the environment cubemap of hdrPath at 256..2048 with every backend the baker supports and
+// prints their times, and how far Raster and Compute land from CPU (level 0 and level 3). Then the
+// same for the irradiance map, Compute against CPU.
+void CompareIBLBackends(IBLBaker& baker, const std::string& hdrPath);
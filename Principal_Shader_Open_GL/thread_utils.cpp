@@ -0,0 +1,94 @@
+#include "thread_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push(std::move(job));
+    }
+    wake.notify_one();
+}
+
+size_t ThreadPool::pendingJobs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ParallelFor(size_t count, const std::function<void(size_t, size_t)>& fn, size_t minChunk) {
+    if (count == 0) return;
+    ThreadPool& pool = ThreadPool::global();
+
+    // a few chunks per worker so uneven chunks still balance out
+    size_t chunkSize = std::max(minChunk, (count + pool.size() * 4 - 1) / (pool.size() * 4));
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1) {
+        fn(0, count);
+        return;
+    }
+
+    // shared with the helper jobs, which may still be queued after this call returns
+    struct State {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> doneChunks{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto runChunks = [state, &fn, count, chunkSize, chunkCount] {
+        size_t c;
+        while ((c = state->nextChunk.fetch_add(1)) < chunkCount) {
+            fn(c * chunkSize, std::min(count, (c + 1) * chunkSize));
+            if (state->doneChunks.fetch_add(1) + 1 == chunkCount) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(pool.size(), chunkCount - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        // helpers that start late find no chunks left and never touch fn
+        pool.submit([state, runChunks] { runChunks(); });
+    }
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->doneChunks.load() == chunkCount; });
+}
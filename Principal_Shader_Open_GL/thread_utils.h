@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// ThreadPool: fixed set of worker threads pulling jobs from one queue
+// ─────
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = 0); // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> job);
+    size_t pendingJobs();
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    static ThreadPool& global(); // shared pool used by ParallelFor
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+// Splits [0, count) into chunks of at least minChunk and runs fn(begin, end) on the global pool.
+// The calling thread works on chunks too, so ParallelFor can be nested inside a pool job.
+void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& fn, size_t minChunk = 1);
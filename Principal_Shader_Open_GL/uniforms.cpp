@@ -2,45 +2,84 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+#include <iostream>
 
-LightingUniforms getLightingUniforms(GLuint program) {
-    LightingUniforms u;
-    u.uLightType = glGetUniformLocation(program, "uLightType");
-    u.uLightPos = glGetUniformLocation(program, "uLight_Position");
-    u.uLightColor = glGetUniformLocation(program, "uLight_Color");
-    u.uAmbient = glGetUniformLocation(program, "uAmbient");
-    u.uDirDir = glGetUniformLocation(program, "uDir_Direction");
-    u.uSpotCosInner = glGetUniformLocation(program, "uSpotCosInner");
-    u.uSpotCosOuter = glGetUniformLocation(program, "uSpotCosOuter");
-    u.uCamPos = glGetUniformLocation(program, "uCamera_Position");
-    return u;
+static_assert(sizeof(FrameBlock) == 160, "FrameBlock no longer matches std140 Frame in basic.vert / basic.frag");
+static_assert(sizeof(LightsBlock) == 224, "LightsBlock no longer matches std140 Lights in basic.frag");
+static_assert(sizeof(MaterialBlock) == 192, "MaterialBlock no longer matches std140 Material in basic.frag");
+static_assert(sizeof(MaterialRecord) == 48, "MaterialRecord no longer matches the std140 array stride in basic.frag");
+
+void LightsBlock::setIrradiance(const IrradianceSH& sh) {
+    for (int i = 0; i < SH_COEFFICIENT_COUNT; i++) irradianceSH[i] = glm::vec4(sh.coefficients[i], 0.0f);
+}
+
+// ─────────────────────────────────────────────
+// UniformBuffer
+// ─────
+void UniformBuffer::init(GLuint binding, size_t size) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    this->size = size;
+    uploaded.clear(); // the buffer holds nothing yet
 }
 
+void UniformBuffer::cleanup() {
+    if (buffer) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    size = 0;
+    uploaded.clear();
+}
 
-MaterialUniforms getMaterialUniforms(GLuint program) {
-    MaterialUniforms u;
-    u.uUseBaseTex = glGetUniformLocation(program, "useBaseColorTex");
-    u.uBaseTex = glGetUniformLocation(program, "baseColorTex");
-    u.uBaseTint = glGetUniformLocation(program, "baseColorTint");
-    u.uRoughness = glGetUniformLocation(program, "uRoughness");
-    u.uMetallic = glGetUniformLocation(program, "uMetallic");
-    u.uDielectricF0 = glGetUniformLocation(program, "uDielectricF0");
-    u.uNormalTex = glGetUniformLocation(program, "uNormalTex");
-    u.uUseNormalTex = glGetUniformLocation(program, "uUseNormalTex");
-    u.uRoughnessMap = glGetUniformLocation(program, "roughnessMap");
-    u.uAOMap = glGetUniformLocation(program, "aoMap");
-    u.uMetallicMap = glGetUniformLocation(program, "metallicMap");
-    u.uUseRoughnessMap = glGetUniformLocation(program, "useRoughnessMap");
-    u.uUseMetallicMap = glGetUniformLocation(program, "useMetallicMap");
-    u.uUseAOMap = glGetUniformLocation(program, "useAOMap");
-    return u;
+bool UniformBuffer::update(const void* data) {
+    if (!uploaded.empty() && std::memcmp(uploaded.data(), data, size) == 0) return false;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uploaded.assign(bytes, bytes + size);
+    return true;
+}
+
+// ─────────────────────────────────────────────
+// Program setup
+// ─────
+static void BindBlock(GLuint program, const char* name, GLuint binding, bool reportMissing) {
+    GLuint index = glGetUniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX) {
+        if (reportMissing) std::cout << "Uniform block " << name << " not found in program " << program << std::endl;
+        return;
+    }
+    glUniformBlockBinding(program, index, binding);
+}
+
+void BindProgramSlots(GLuint program, bool reportMissingBlocks) {
+    BindBlock(program, "Frame", FRAME_BLOCK_BINDING, reportMissingBlocks);
+    BindBlock(program, "Lights", LIGHTS_BLOCK_BINDING, reportMissingBlocks);
+    BindBlock(program, "Material", MATERIAL_BLOCK_BINDING, reportMissingBlocks);
+    BindBlock(program, "MaterialTable", MATERIAL_TABLE_BINDING, reportMissingBlocks);
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "baseColorTex"), 0);
+    glUniform1i(glGetUniformLocation(program, "uNormalTex"), 1);
+    glUniform1i(glGetUniformLocation(program, "roughnessMap"), 2);
+    glUniform1i(glGetUniformLocation(program, "metallicMap"), 3);
+    glUniform1i(glGetUniformLocation(program, "aoMap"), 4);
+    glUniform1i(glGetUniformLocation(program, "environmentMap"), 6);
+    glUniform1i(glGetUniformLocation(program, "uOrmMap"), 7);
+    glUniform1i(glGetUniformLocation(program, "brdfLUT"), 8);
+    glUniform1i(glGetUniformLocation(program, "uBaseColorArray"), 9);
+    glUniform1i(glGetUniformLocation(program, "uNormalArray"), 10);
+    glUniform1i(glGetUniformLocation(program, "uOrmArray"), 11);
 }
 
 VertexUniforms getVertexUniforms(GLuint program) {
     VertexUniforms u;
-    u.modelMatrix = glGetUniformLocation(program, "modelMatrix");
-    u.viewMatrix = glGetUniformLocation(program, "viewMatrix");
-    u.projectionMatrix = glGetUniformLocation(program, "projectionMatrix");
+    u.packedVertices = glGetUniformLocation(program, "uPackedVertices");
+    u.posOffset = glGetUniformLocation(program, "uPosOffset");
+    u.posScale = glGetUniformLocation(program, "uPosScale");
     return u;
 }
-
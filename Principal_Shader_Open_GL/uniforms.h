@@ -1,42 +1,130 @@
 #pragma once
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <vector>
+#include "ibl_utils.h"  // SH_COEFFICIENT_COUNT
+#include "mesh_utils.h" // MAX_MATERIAL_TINTS
 
-struct LightingUniforms {
-GLint uLightType;
-GLint uLightPos;
-GLint uLightColor;
-GLint uAmbient;
-GLint uDirDir;
-GLint uSpotCosInner;
-GLint uSpotCosOuter;
-GLint uCamPos;
-};
-
-struct MaterialUniforms {
-GLint uUseBaseTex;
-GLint uBaseTex;
-GLint uBaseTint;
-GLint uRoughness;
-GLint uMetallic;
-GLint uDielectricF0;
-GLint uNormalTex;
-GLint uUseNormalTex;
-GLint uRoughnessMap;
-GLint uMetallicMap;
-GLint uAOMap;
-GLint uUseRoughnessMap;
-GLint uUseMetallicMap;
-GLint uUseAOMap;
+// ─────────────────────────────────────────────
+// Uniform blocks of basic.vert / basic.frag
+// ─────
+// std140 mirrors of the Frame, Lights and Material blocks. Each vec3 is followed by a 4 byte scalar
+// that fills the rest of its 16 byte slot, vec3 arrays have a 16 byte stride (so they are vec4 here)
+// and bools are 4 bytes. Keep the field order in step with the shaders; the static_asserts in
+// uniforms.cpp catch size drift.
+static const GLuint FRAME_BLOCK_BINDING = 0;
+static const GLuint LIGHTS_BLOCK_BINDING = 1;
+static const GLuint MATERIAL_BLOCK_BINDING = 2;
+static const GLuint MATERIAL_TABLE_BINDING = 3;
+static const int MAX_TABLE_MATERIALS = 256; // rows of MaterialTable; basic.frag sizes its array the same
+
+struct FrameBlock {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    GLint linearOutput = 0; // headless EXR jobs: linear HDR radiance, no tone mapping or gamma
+    GLint materialTable = 0; // surfaces come from MaterialTable and the atlas arrays, not Material
+    GLint pad[3] = {};
 };
 
-struct VertexUniforms {
-GLint modelMatrix;
-GLint viewMatrix;
-GLint projectionMatrix;
+struct LightsBlock {
+    glm::vec3 position = glm::vec3(0.0f);
+    GLint type = 0; // 0 directional, otherwise point
+    glm::vec3 color = glm::vec3(1.0f);
+    float spotCosInner = 1.0f;
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float spotCosOuter = 1.0f;
+    glm::vec3 ambient = glm::vec3(0.1f);
+    float prefilterMaxLod = 0.0f;
+    glm::vec4 irradianceSH[SH_COEFFICIENT_COUNT] = {}; // xyz: IrradianceSH::coefficients
+    GLint useIBL = 0;
+    GLint pad[3] = {};
+
+    void setIrradiance(const IrradianceSH& sh);
+};
+
+struct MaterialBlock {
+    glm::vec3 baseTint = glm::vec3(1.0f);
+    float roughness = 0.8f;
+    glm::vec3 dielectricF0 = glm::vec3(0.04f);
+    float metallic = 0.0f;
+    glm::vec4 tints[MAX_MATERIAL_TINTS] = {}; // xyz, picked per instance by InstanceData::materialIndex
+    GLint useBaseTex = 0;
+    GLint useNormalTex = 0;
+    GLint useRoughnessMap = 0;
+    GLint useMetallicMap = 0;
+    GLint useAOMap = 0;
+    GLint useOrmMap = 0;
+    GLint pad[2] = {};
+};
+
+// One material of a batched scene: its parameters and its layer in each MaterialAtlas array
+// (-1: no map, the parameter or a neutral value stands in). std140 rounds the 36 bytes of fields up
+// to a 48 byte array stride.
+struct MaterialRecord {
+    glm::vec3 baseTint = glm::vec3(1.0f);
+    float roughness = 0.8f;
+    float metallic = 0.0f;
+    GLint baseColorLayer = -1;
+    GLint normalLayer = -1;
+    GLint ormLayer = -1;
+    GLint ormChannels = 0; // ORM_CHANNEL_* bits: which ORM channels replace AO / roughness / metallic
+    GLint pad[3] = {};
+};
+static const GLint ORM_CHANNEL_AO = 1, ORM_CHANNEL_ROUGHNESS = 2, ORM_CHANNEL_METALLIC = 4;
+
+struct MaterialTableBlock {
+    MaterialRecord materials[MAX_TABLE_MATERIALS]; // by InstanceData::materialIndex
+};
+
+// One uniform buffer bound to its binding point for the whole run (glBindBufferBase once in init),
+// so switching programs never rebinds it. update() costs one glBufferSubData, and nothing when the
+// bytes match the last upload.
+class UniformBuffer {
+public:
+    UniformBuffer() = default;
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Needs the GL context
+    void init(GLuint binding, size_t size);
+    // Call before the context goes away
+    void cleanup();
+    // Uploads size bytes from data when they changed; returns whether it did
+    bool update(const void* data);
+
+private:
+    GLuint buffer = 0;
+    size_t size = 0;
+    std::vector<unsigned char> uploaded; // empty until the first update
+};
+
+// A block's CPU copy plus its buffer: write data as state changes, flush() once before drawing
+template <typename Block>
+class UniformBlock {
+public:
+    Block data;
+
+    void init(GLuint binding) { buffer.init(binding, sizeof(Block)); }
+    void cleanup() { buffer.cleanup(); }
+    bool flush() { return buffer.update(&data); }
+
+private:
+    UniformBuffer buffer;
 };
 
+// Once per program after linking: points its blocks at the binding points above and its samplers at
+// their texture units (0 base color, 1 normal, 2-4 roughness/metallic/AO, 6 prefiltered environment,
+// 7 ORM, 8 BRDF LUT, 9-11 the atlas arrays). GLSL 330 has no layout(binding), so this takes the place of it.
+// A block the program doesn't have is reported, unless reportMissingBlocks is false: shader variants
+// (shader_permutations.h) drop the blocks they never read.
+void BindProgramSlots(GLuint program, bool reportMissingBlocks = true);
+
+// Per mesh state, still plain uniforms: it changes with the draw, not the frame
+struct VertexUniforms {
+GLint packedVertices;
+GLint posOffset;
+GLint posScale;
+};
 
-LightingUniforms getLightingUniforms(GLuint program);
-MaterialUniforms getMaterialUniforms(GLuint program);
-VertexUniforms getVertexUniforms(GLuint program);
\ No newline at end of file
+VertexUniforms getVertexUniforms(GLuint program);
@@ -0,0 +1,202 @@
+#include "vertex_packing.h"
+#include "thread_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// ─────────────────────────────────────────────
+// Scalar encoders
+// ─────
+static float SignNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+glm::vec2 OctEncode(const glm::vec3& n) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 < 1e-20f) return glm::vec2(0.0f); // zero vectors (e.g. OBJ without normals) decode to +Z
+    glm::vec2 p(n.x / l1, n.y / l1);
+    if (n.z < 0.0f) {
+        // fold the lower hemisphere over the diagonals
+        p = glm::vec2((1.0f - std::fabs(p.y)) * SignNotZero(p.x),
+                      (1.0f - std::fabs(p.x)) * SignNotZero(p.y));
+    }
+    return p;
+}
+
+glm::vec3 OctDecode(const glm::vec2& e) {
+    // same steps as octDecode() in basic.vert
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+static int16_t ToSnorm16(float v) {
+    return static_cast<int16_t>(std::lround(glm::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+static float FromSnorm16(int16_t v) {
+    return std::max(v / 32767.0f, -1.0f); // GL's snorm conversion
+}
+
+uint16_t FloatToHalf(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mag = x & 0x7FFFFFFFu;
+
+    if (mag >= 0x7F800000u) // inf / nan
+        return static_cast<uint16_t>(sign | 0x7C00u | (mag > 0x7F800000u ? 0x200u : 0u));
+    if (mag >= 0x477FF000u) // rounds past the largest half -> inf
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    if (mag < 0x38800000u) {
+        // subnormal half (or zero): shift the mantissa with round-to-nearest-even
+        if (mag < 0x33000000u) return static_cast<uint16_t>(sign);
+        uint32_t exp = mag >> 23;
+        uint32_t mant = (mag & 0x7FFFFFu) | 0x800000u;
+        uint32_t shift = 126 - exp;
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1u))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    // normal half: rebias the exponent, round the 13 dropped mantissa bits to nearest-even
+    uint32_t h = ((mag - 0x38000000u) >> 13);
+    uint32_t rem = mag & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) h++;
+    return static_cast<uint16_t>(sign | h);
+}
+
+float HalfToFloat(uint16_t h) {
+    uint32_t sign = (h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1Fu;
+    uint32_t mant = h & 0x3FFu;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            // subnormal: normalize
+            exp = 127 - 14;
+            while ((mant & 0x400u) == 0) { mant <<= 1; exp--; }
+            bits = sign | (exp << 23) | ((mant & 0x3FFu) << 13);
+        }
+    } else if (exp == 0x1F) {
+        bits = sign | 0x7F800000u | (mant << 13);
+    } else {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// ─────────────────────────────────────────────
+// Packing
+// ─────
+VertexQuantization ComputeQuantization(const Vertex* vertices, size_t count) {
+    VertexQuantization q;
+    if (count == 0) return q;
+    glm::vec3 lo = vertices[0].position, hi = vertices[0].position;
+    for (size_t i = 1; i < count; i++) {
+        lo = glm::min(lo, vertices[i].position);
+        hi = glm::max(hi, vertices[i].position);
+    }
+    q.offset = lo;
+    q.scale = hi - lo;
+    // flat axes still need a non-zero scale to divide by
+    for (int a = 0; a < 3; a++)
+        if (q.scale[a] <= 0.0f) q.scale[a] = 1.0f;
+    return q;
+}
+
+static PackedVertex PackVertex(const Vertex& v, const VertexQuantization& q) {
+    PackedVertex p = {};
+    glm::vec3 unit = glm::clamp((v.position - q.offset) / q.scale, 0.0f, 1.0f);
+    for (int a = 0; a < 3; a++)
+        p.position[a] = static_cast<uint16_t>(std::lround(unit[a] * 65535.0f));
+    p.position[3] = v.tangent.w < 0.0f ? 0 : 65535;
+
+    glm::vec2 n = OctEncode(v.normal);
+    glm::vec2 t = OctEncode(glm::vec3(v.tangent));
+    p.normal[0] = ToSnorm16(n.x);  p.normal[1] = ToSnorm16(n.y);
+    p.tangent[0] = ToSnorm16(t.x); p.tangent[1] = ToSnorm16(t.y);
+
+    p.texCoord[0] = FloatToHalf(v.texCoord.x);
+    p.texCoord[1] = FloatToHalf(v.texCoord.y);
+    return p;
+}
+
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& q, std::vector<PackedVertex>& out) {
+    out.resize(count);
+    ParallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) out[i] = PackVertex(vertices[i], q);
+    }, 1 << 14);
+}
+
+Vertex UnpackVertex(const PackedVertex& p, const VertexQuantization& q) {
+    Vertex v;
+    glm::vec3 unit(p.position[0] / 65535.0f, p.position[1] / 65535.0f, p.position[2] / 65535.0f);
+    v.position = q.offset + unit * q.scale;
+    v.normal = OctDecode(glm::vec2(FromSnorm16(p.normal[0]), FromSnorm16(p.normal[1])));
+    v.tangent = glm::vec4(OctDecode(glm::vec2(FromSnorm16(p.tangent[0]), FromSnorm16(p.tangent[1]))),
+                          p.position[3] ? 1.0f : -1.0f);
+    v.texCoord = glm::vec2(HalfToFloat(p.texCoord[0]), HalfToFloat(p.texCoord[1]));
+    return v;
+}
+
+// ─────────────────────────────────────────────
+// Error report
+// ─────
+static float AngleDeg(const glm::vec3& a, const glm::vec3& b) {
+    // atan2 stays accurate for tiny angles, where acos(dot) is dominated by float rounding
+    return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+}
+
+PackingErrorReport MeasurePackingError(const Vertex* vertices, const PackedVertex* packed, size_t count, const VertexQuantization& q) {
+    PackingErrorReport r;
+    r.vertexCount = count;
+    r.fullBytes = count * sizeof(Vertex);
+    r.packedBytes = count * sizeof(PackedVertex);
+
+    double posSum = 0.0, normalSum = 0.0;
+    size_t normalCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& src = vertices[i];
+        Vertex dec = UnpackVertex(packed[i], q);
+
+        float posErr = glm::length(dec.position - src.position);
+        r.maxPositionError = std::max(r.maxPositionError, posErr);
+        posSum += posErr;
+
+        // zero-length inputs (missing normals, degenerate tangents) carry no direction to lose
+        if (glm::dot(src.normal, src.normal) > 1e-12f) {
+            float err = AngleDeg(src.normal, dec.normal);
+            r.maxNormalErrorDeg = std::max(r.maxNormalErrorDeg, err);
+            normalSum += err;
+            normalCount++;
+        }
+        glm::vec3 srcTangent(src.tangent);
+        if (glm::dot(srcTangent, srcTangent) > 1e-12f) {
+            r.maxTangentErrorDeg = std::max(r.maxTangentErrorDeg, AngleDeg(srcTangent, glm::vec3(dec.tangent)));
+            if ((src.tangent.w < 0.0f) != (dec.tangent.w < 0.0f)) r.tangentSignFlips++;
+        }
+
+        glm::vec2 uvErr = glm::abs(dec.texCoord - src.texCoord);
+        r.maxTexCoordError = std::max(r.maxTexCoordError, std::max(uvErr.x, uvErr.y));
+    }
+    if (count) r.meanPositionError = static_cast<float>(posSum / count);
+    if (normalCount) r.meanNormalErrorDeg = static_cast<float>(normalSum / normalCount);
+    return r;
+}
+
+void PrintPackingReport(const PackingErrorReport& r) {
+    std::cout << "Packed vertices: " << r.vertexCount << " verts, "
+              << r.fullBytes / 1024 << " KB -> " << r.packedBytes / 1024 << " KB ("
+              << (r.packedBytes ? double(r.fullBytes) / r.packedBytes : 0.0) << "x smaller)\n"
+              << "  position error: max " << r.maxPositionError << ", mean " << r.meanPositionError << " (model units)\n"
+              << "  normal error:   max " << r.maxNormalErrorDeg << " deg, mean " << r.meanNormalErrorDeg << " deg\n"
+              << "  tangent error:  max " << r.maxTangentErrorDeg << " deg, " << r.tangentSignFlips << " sign flips\n"
+              << "  uv error:       max " << r.maxTexCoordError << std::endl;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "mesh_utils.h"
+#include <cstdint>
+#include <vector>
+
+// ─────────────────────────────────────────────
+// PackedVertex: compressed GPU layout for VertexFormat::Packed (20 bytes vs 48)
+// ─────
+// position  unorm16 x3 against the mesh bounds, 4th slot = bitangent sign (0 = -1, 65535 = +1)
+// normal    octahedral, snorm16 x2
+// tangent   octahedral, snorm16 x2
+// texCoord  half float x2
+struct PackedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex layout is mirrored by createMesh");
+
+// Precision lost by packing, measured by decoding on the CPU exactly like basic.vert does
+struct PackingErrorReport {
+    size_t vertexCount = 0;
+    size_t fullBytes = 0;
+    size_t packedBytes = 0;
+    float maxPositionError = 0.0f;  // model units
+    float meanPositionError = 0.0f;
+    float maxNormalErrorDeg = 0.0f;
+    float meanNormalErrorDeg = 0.0f;
+    float maxTangentErrorDeg = 0.0f;
+    size_t tangentSignFlips = 0;    // must stay 0
+    float maxTexCoordError = 0.0f;
+};
+
+glm::vec2 OctEncode(const glm::vec3& n); // unit vector -> [-1,1]^2
+glm::vec3 OctDecode(const glm::vec2& e);
+uint16_t FloatToHalf(float f);
+float HalfToFloat(uint16_t h);
+
+VertexQuantization ComputeQuantization(const Vertex* vertices, size_t count);
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& q, std::vector<PackedVertex>& out);
+Vertex UnpackVertex(const PackedVertex& p, const VertexQuantization& q);
+
+PackingErrorReport MeasurePackingError(const Vertex* vertices, const PackedVertex* packed, size_t count, const VertexQuantization& q);
+void PrintPackingReport(const PackingErrorReport& report);